@@ -1,18 +1,51 @@
-cbuffer cbPerObject : register(b0)
+// Root constants, set for every instanced draw.
+cbuffer cbDraw : register(b0)
 {
-    float4x4 gWorldViewProj;
+    float3 gPositionOffset;
+    uint gInstanceBase;
+    float3 gPositionScale;
+    uint gDrawPadding;
 };
 
+cbuffer cbPass : register(b1)
+{
+    float4x4 gView;
+    float4x4 gProj;
+    float4x4 gViewProj;
+};
+
+// Transposed affine world matrix, one dot product per output coordinate.
+struct ObjectConstants
+{
+    float4 World[3];
+};
+
+// Object slot of every instance, in batch order.
+StructuredBuffer<uint> gInstances : register(t0);
+// One per object slot, only rewritten when the object changes.
+StructuredBuffer<ObjectConstants> gObjects : register(t1);
+
+// SCENE_VERTEX_FORMAT: positions come in as unorm inside the submesh's box, which
+// gPositionOffset and gPositionScale scale back out. Tangents and normals are octahedral
+// encoded.
 struct VertexIn
 {
     float3 PosL : POSITION;
-    float3 Tangent : TANGENT;
-    float3 Normal : NORMAL;
+    float2 Tangent : TANGENT;
+    float2 Normal : NORMAL;
     float2 Tex0 : TEX0;
     float2 Tex1 : TEX1;
     float4 Color : COLOR;
 };
 
+float3 OctDecode(float2 e)
+{
+    float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float fold = saturate(-v.z);
+    v.xy += v.xy >= 0.0f ? -fold : fold;
+    return normalize(v);
+}
+
 struct VertexOut
 {
     float4 PosH : SV_POSITION;
@@ -20,10 +53,14 @@ struct VertexOut
 };
 
 
-VertexOut VS(VertexIn vIn)
+VertexOut VS(VertexIn vIn, uint instanceId : SV_InstanceID)
 {
+    ObjectConstants object = gObjects[gInstances[gInstanceBase + instanceId]];
+    float4 posL = float4(gPositionOffset + vIn.PosL * gPositionScale, 1.0f);
+    float3 posW = float3(dot(object.World[0], posL), dot(object.World[1], posL), dot(object.World[2], posL));
+
     VertexOut vOut;
-    vOut.PosH = mul(float4(vIn.PosL, 1.0f), gWorldViewProj);
+    vOut.PosH = mul(float4(posW, 1.0f), gViewProj);
     vOut.Color = vIn.Color;
 
     return vOut;
@@ -0,0 +1,264 @@
+#include "aabb_tree.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // count boxes of a few meters spread over a 2 km square, flat like a level. Each test
+    // has a brute force twin over the same boxes in a plain array.
+    std::vector<Aabb> Scene(uint32_t count)
+    {
+        std::mt19937 random{ count };
+        std::uniform_real_distribution<float> position{ -1000.0f, 1000.0f };
+        std::uniform_real_distribution<float> size{ 0.5f, 4.0f };
+        std::vector<Aabb> boxes(count);
+        for (Aabb& box : boxes)
+        {
+            const float center[3]{ position(random), position(random) * 0.05f, position(random) };
+            const float extents[3]{ size(random), size(random), size(random) };
+            box = Aabb::FromCenterExtents(center, extents);
+        }
+        return boxes;
+    }
+
+    AabbTree Build(const std::vector<Aabb>& boxes, std::vector<AabbTree::NodeId>* leaves = nullptr)
+    {
+        AabbTree tree;
+        for (uint32_t i = 0; i < boxes.size(); ++i)
+        {
+            AabbTree::NodeId leaf{ tree.Insert(boxes[i], i) };
+            if (leaves)
+                leaves->push_back(leaf);
+        }
+        tree.Rebuild();
+        return tree;
+    }
+
+    Aabb Offset(const Aabb& box, float dx, float dz)
+    {
+        return { { box.min[0] + dx, box.min[1], box.min[2] + dz }, { box.max[0] + dx, box.max[1], box.max[2] + dz } };
+    }
+
+    // Slab test, what the tree does at its leaves.
+    bool RayBox(const Ray& ray, const Aabb& box, float& distance)
+    {
+        float near{ 0.0f };
+        float far{ ray.maxDistance };
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float inverse{ 1.0f / ray.direction[axis] };
+            float t0{ (box.min[axis] - ray.origin[axis]) * inverse };
+            float t1{ (box.max[axis] - ray.origin[axis]) * inverse };
+            near = std::max(near, std::min(t0, t1));
+            far = std::min(far, std::max(t0, t1));
+        }
+        distance = near;
+        return near <= far;
+    }
+
+    // Rays from above the level down at a slant, like picking under the cursor.
+    std::vector<Ray> Rays(uint32_t count)
+    {
+        std::mt19937 random{ 7 };
+        std::uniform_real_distribution<float> position{ -1000.0f, 1000.0f };
+        std::vector<Ray> rays(count);
+        for (Ray& ray : rays)
+            ray = { { position(random), 100.0f, position(random) }, { 0.3f, -1.0f, 0.2f } };
+        return rays;
+    }
+
+    Frustum Camera()
+    {
+        constexpr float NEAR_Z = 0.1f;
+        constexpr float FAR_Z = 1000.0f;
+        constexpr float RANGE = FAR_Z / (FAR_Z - NEAR_Z);
+        const float matrix[4][4] = {
+            { 1.0f, 0.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, RANGE, 1.0f },
+            { 0.0f, 0.0f, -NEAR_Z * RANGE, 0.0f },
+        };
+        return Frustum::FromViewProjection(matrix);
+    }
+
+    // range(1) percent of the objects move each frame by a few centimeters, about what
+    // walking characters do. Most moves stay inside the fat box and don't touch the tree,
+    // the refits counter is the share that did. Rebuilds are part of the cost.
+    void BM_AabbTreeMove(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        std::vector<AabbTree::NodeId> leaves;
+        AabbTree tree{ Build(boxes, &leaves) };
+        uint32_t moving{ static_cast<uint32_t>(boxes.size() * state.range(1) / 100) };
+
+        uint64_t refits{ 0 };
+        uint32_t frame{ 0 };
+        for (auto _ : state)
+        {
+            float step{ (frame++ % 64 < 32 ? 1.0f : -1.0f) * 0.03f };
+            for (uint32_t i = 0; i < moving; ++i)
+            {
+                boxes[i] = Offset(boxes[i], step, step * 0.5f);
+                refits += tree.Move(leaves[i], boxes[i]);
+            }
+            if (frame % 16 == 0)
+                tree.RebuildIfDegraded();
+            benchmark::ClobberMemory();
+        }
+
+        state.counters["refits"] = static_cast<double>(refits) / (state.iterations() * std::max(moving, 1u));
+        state.SetItemsProcessed(state.iterations() * moving);
+    }
+
+    // The array only stores the box, updates are free and every query pays instead.
+    void BM_BruteForceMove(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        uint32_t moving{ static_cast<uint32_t>(boxes.size() * state.range(1) / 100) };
+
+        uint32_t frame{ 0 };
+        for (auto _ : state)
+        {
+            float step{ (frame++ % 64 < 32 ? 1.0f : -1.0f) * 0.03f };
+            for (uint32_t i = 0; i < moving; ++i)
+                boxes[i] = Offset(boxes[i], step, step * 0.5f);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * moving);
+    }
+
+    // A 100 m square through the whole height of the level, a trigger volume.
+    const Aabb QUERY_BOX{ { -50.0f, -100.0f, -50.0f }, { 50.0f, 100.0f, 50.0f } };
+
+    void BM_AabbTreeQueryOverlap(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        AabbTree tree{ Build(boxes) };
+
+        uint32_t found{ 0 };
+        for (auto _ : state)
+        {
+            found = 0;
+            tree.QueryOverlap(QUERY_BOX, [&](uint32_t) { ++found; });
+            benchmark::DoNotOptimize(found);
+        }
+
+        state.counters["found"] = found;
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_BruteForceQueryOverlap(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+
+        uint32_t found{ 0 };
+        for (auto _ : state)
+        {
+            found = 0;
+            for (const Aabb& box : boxes)
+                found += box.Overlaps(QUERY_BOX);
+            benchmark::DoNotOptimize(found);
+        }
+
+        state.counters["found"] = found;
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Closest hit of 64 rays, items are rays.
+    void BM_AabbTreeRayCast(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        AabbTree tree{ Build(boxes) };
+        std::vector<Ray> rays{ Rays(64) };
+
+        uint32_t hits{ 0 };
+        for (auto _ : state)
+        {
+            hits = 0;
+            for (const Ray& ray : rays)
+                hits += static_cast<bool>(tree.RayCast(ray));
+            benchmark::DoNotOptimize(hits);
+        }
+
+        state.counters["hits"] = static_cast<double>(hits) / rays.size();
+        state.SetItemsProcessed(state.iterations() * rays.size());
+    }
+
+    void BM_BruteForceRayCast(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        std::vector<Ray> rays{ Rays(64) };
+
+        uint32_t hits{ 0 };
+        for (auto _ : state)
+        {
+            hits = 0;
+            for (const Ray& ray : rays)
+            {
+                RayHit hit;
+                for (uint32_t i = 0; i < boxes.size(); ++i)
+                {
+                    float distance;
+                    if (RayBox(ray, boxes[i], distance) && distance < hit.distance)
+                        hit = { i, distance };
+                }
+                hits += static_cast<bool>(hit);
+            }
+            benchmark::DoNotOptimize(hits);
+        }
+
+        state.counters["hits"] = static_cast<double>(hits) / rays.size();
+        state.SetItemsProcessed(state.iterations() * rays.size());
+    }
+
+    // A camera's view, about a quarter of the level. The tree skips what's behind in bulk.
+    void BM_AabbTreeQueryFrustum(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        AabbTree tree{ Build(boxes) };
+        Frustum frustum{ Camera() };
+
+        uint32_t found{ 0 };
+        for (auto _ : state)
+        {
+            found = 0;
+            tree.QueryFrustum(frustum, [&](uint32_t) { ++found; });
+            benchmark::DoNotOptimize(found);
+        }
+
+        state.counters["found"] = static_cast<double>(found) / boxes.size();
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_BruteForceQueryFrustum(benchmark::State& state)
+    {
+        std::vector<Aabb> boxes{ Scene(static_cast<uint32_t>(state.range(0))) };
+        Frustum frustum{ Camera() };
+
+        uint32_t found{ 0 };
+        for (auto _ : state)
+        {
+            found = 0;
+            for (const Aabb& box : boxes)
+                found += AabbTree::IntersectsFrustum(frustum, box);
+            benchmark::DoNotOptimize(found);
+        }
+
+        state.counters["found"] = static_cast<double>(found) / boxes.size();
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+BENCHMARK(BM_AabbTreeMove)->ArgsProduct({ { 1000, 10000, 100000 }, { 10, 100 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BruteForceMove)->ArgsProduct({ { 1000, 10000, 100000 }, { 10, 100 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_AabbTreeQueryOverlap)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BruteForceQueryOverlap)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_AabbTreeRayCast)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BruteForceRayCast)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_AabbTreeQueryFrustum)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BruteForceQueryFrustum)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,110 @@
+#include "command_state_filter.hpp"
+#include "mock_command_list.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+namespace
+{
+    using Filter = CommandStateFilter<MockCommandTraits>;
+
+    // The scene pass as RecordDraws issues it: every chunk of draws sets up the whole pass,
+    // then each draw binds its mesh's buffers and root constants.
+    struct Scene
+    {
+        // Mesh of every draw, sorted like the packets so draws of a mesh come together.
+        std::vector<uint32_t> meshes;
+        MockCommandList::DescriptorHeap heap;
+        MockCommandList::RootSignature rootSignature;
+        MockCommandList::Viewport viewport{ 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+        MockCommandList::Rect scissor{ 0, 0, 1920, 1080 };
+        MockCommandList::CpuDescriptorHandle renderTarget{ 0x10 };
+        MockCommandList::CpuDescriptorHandle depthStencil{ 0x20 };
+    };
+
+    constexpr uint32_t CHUNK_SIZE = 256;
+
+    Scene MakeScene(uint32_t drawCount, uint32_t meshCount)
+    {
+        Scene scene;
+        for (uint32_t i = 0; i < drawCount; ++i)
+            scene.meshes.push_back(static_cast<uint32_t>(static_cast<uint64_t>(i) * meshCount / drawCount));
+        return scene;
+    }
+
+    // Commands is the filter or the bare list, they take the same calls.
+    template <typename Commands>
+    void Replay(Commands& commands, const Scene& scene)
+    {
+        MockCommandList::DescriptorHeap* heaps[] = { const_cast<MockCommandList::DescriptorHeap*>(&scene.heap) };
+        for (uint32_t i = 0; i < scene.meshes.size(); ++i)
+        {
+            if (i % CHUNK_SIZE == 0)
+            {
+                commands.RSSetViewports(1, &scene.viewport);
+                commands.RSSetScissorRects(1, &scene.scissor);
+                commands.SetDescriptorHeaps(1, heaps);
+                commands.OMSetRenderTargets(1, &scene.renderTarget, true, &scene.depthStencil);
+                commands.SetGraphicsRootSignature(const_cast<MockCommandList::RootSignature*>(&scene.rootSignature));
+                commands.IASetPrimitiveTopology(4);
+                commands.SetGraphicsRootConstantBufferView(1, 0x1000);
+                commands.SetGraphicsRootShaderResourceView(2, 0x2000);
+                commands.SetGraphicsRootDescriptorTable(3, { 0x40 });
+            }
+
+            uint64_t mesh{ scene.meshes[i] };
+            const MockCommandList::VertexBufferView vertexBuffers[] = { { 0x100000 + mesh * 0x1000, 0x1000, 16 }, { 0x800000 + mesh * 0x1000, 0x1000, 24 } };
+            commands.IASetVertexBuffers(0, 2, vertexBuffers);
+            const MockCommandList::IndexBufferView indexBuffer{ 0x4000000 + mesh * 0x1000, 0x1000, 42 };
+            commands.IASetIndexBuffer(&indexBuffer);
+
+            // Position offset and scale follow the mesh, the first instance every batch.
+            const uint32_t constants[8]{ static_cast<uint32_t>(mesh), 0, 0, i, 1, 1, 1, 0 };
+            commands.SetGraphicsRoot32BitConstants(0, 8, constants, 0);
+            commands.DrawIndexedInstanced(36, 4, 0, 0, 0);
+        }
+    }
+
+    // range(0) draws over range(1) meshes on one list, with the pass setup of every chunk
+    // repeated on it. The issued counter is the share of state calls that reached the list.
+    void BM_CommandReplayFiltered(benchmark::State& state)
+    {
+        Scene scene{ MakeScene(static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1))) };
+        MockCommandList list;
+        CommandFilterStats stats;
+
+        for (auto _ : state)
+        {
+            list.calls.clear();
+            Filter filter{ &list };
+            Replay(filter, scene);
+            benchmark::DoNotOptimize(list.calls.data());
+            stats = filter.Stats();
+        }
+
+        state.counters["issued"] = static_cast<double>(stats.issued) / (stats.issued + stats.filtered);
+        state.counters["calls"] = static_cast<double>(list.calls.size());
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Every call straight to the list, what the filter has to beat.
+    void BM_CommandReplayDirect(benchmark::State& state)
+    {
+        Scene scene{ MakeScene(static_cast<uint32_t>(state.range(0)), static_cast<uint32_t>(state.range(1))) };
+        MockCommandList list;
+
+        for (auto _ : state)
+        {
+            list.calls.clear();
+            Replay(list, scene);
+            benchmark::DoNotOptimize(list.calls.data());
+        }
+
+        state.counters["calls"] = static_cast<double>(list.calls.size());
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_CommandReplayFiltered)->ArgsProduct({ { 1000, 10000 }, { 16, 1000 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CommandReplayDirect)->ArgsProduct({ { 1000, 10000 }, { 16, 1000 } })->Unit(benchmark::kMicrosecond);
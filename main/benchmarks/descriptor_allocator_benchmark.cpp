@@ -0,0 +1,61 @@
+#include "index_allocator.hpp"
+#include "ring_allocator.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Allocate and free one staging descriptor at a random spot of a heap that's range(0)
+    // percent full.
+    void BM_IndexAllocatorChurn(benchmark::State& state)
+    {
+        constexpr uint32_t CAPACITY = 4096;
+
+        IndexAllocator indices{ CAPACITY };
+        std::vector<uint32_t> live;
+        while (live.size() < static_cast<size_t>(CAPACITY * state.range(0) / 100))
+            live.push_back(indices.Allocate());
+
+        std::mt19937 random{ 1 };
+        for (auto _ : state)
+        {
+            size_t slot{ random() % live.size() };
+            indices.Free(live[slot]);
+            live[slot] = indices.Allocate();
+            benchmark::DoNotOptimize(live[slot]);
+        }
+
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+
+    // A frame's worth of range(0) tables of one to eight descriptors in the 16K descriptor
+    // ring, retired three frames later.
+    void BM_DescriptorRingFrame(benchmark::State& state)
+    {
+        uint32_t tableCount{ static_cast<uint32_t>(state.range(0)) };
+        std::mt19937 random{ 2 };
+        std::vector<uint64_t> tableSizes(tableCount);
+        for (uint64_t& size : tableSizes)
+            size = 1 + random() % 8;
+
+        RingAllocator ring{ 16 * 1024 };
+        uint64_t fence{ 0 };
+        for (auto _ : state)
+        {
+            for (uint64_t size : tableSizes)
+                benchmark::DoNotOptimize(ring.Allocate(size, 1));
+
+            ring.FinishFrame(++fence);
+            if (fence > 3)
+                ring.Retire(fence - 3);
+        }
+
+        state.SetItemsProcessed(state.iterations() * tableCount);
+    }
+}
+
+BENCHMARK(BM_IndexAllocatorChurn)->Arg(10)->Arg(50)->Arg(95);
+BENCHMARK(BM_DescriptorRingFrame)->Arg(100)->Arg(1000);
@@ -0,0 +1,32 @@
+#include "frame_ring.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include "support/simulated_queue.hpp"
+
+namespace
+{
+    struct Slot
+    {
+        uint64_t fence{ 0 };
+    };
+
+    // Frame bookkeeping alone, against a GPU range(1) frames behind with range(0) slots. The
+    // waits counter is how often the CPU would have stalled.
+    void BM_FrameRingBookkeeping(benchmark::State& state)
+    {
+        FrameRing<Slot> ring{ static_cast<uint32_t>(state.range(0)) };
+        SimulatedQueue queue{ static_cast<uint64_t>(state.range(1)) };
+
+        for (auto _ : state)
+        {
+            queue.Wait(ring.Advance());
+            benchmark::DoNotOptimize(ring.Current());
+            ring.Submit(queue.Signal());
+        }
+
+        state.counters["waits"] = benchmark::Counter(static_cast<double>(queue.WaitCount()), benchmark::Counter::kAvgIterations);
+    }
+}
+
+BENCHMARK(BM_FrameRingBookkeeping)->ArgsProduct({ { 1, 2, 3, 4 }, { 0, 1, 2, 3 } });
@@ -0,0 +1,88 @@
+#include "frustum_culler.hpp"
+#include "job_system.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // count boxes spread over a 2 km square around a camera looking down +z with a 90 degree
+    // field of view, about a quarter of them end up visible.
+    void Fill(FrustumCuller& culler, uint32_t count)
+    {
+        std::mt19937 random{ count };
+        std::uniform_real_distribution<float> position{ -1000.0f, 1000.0f };
+        std::uniform_real_distribution<float> size{ 0.5f, 4.0f };
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float center[3]{ position(random), position(random) * 0.05f, position(random) };
+            const float extents[3]{ size(random), size(random), size(random) };
+            culler.Add(center, extents, i);
+        }
+    }
+
+    Frustum Camera()
+    {
+        constexpr float NEAR_Z = 0.1f;
+        constexpr float FAR_Z = 1000.0f;
+        constexpr float RANGE = FAR_Z / (FAR_Z - NEAR_Z);
+        const float matrix[4][4] = {
+            { 1.0f, 0.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, RANGE, 1.0f },
+            { 0.0f, 0.0f, -NEAR_Z * RANGE, 0.0f },
+        };
+        return Frustum::FromViewProjection(matrix);
+    }
+
+    // range(1) picks the kernel, one thread through CullRange so the kernels compare alone.
+    void BM_FrustumCullRange(benchmark::State& state)
+    {
+        CpuFeatures::Isa isa{ static_cast<CpuFeatures::Isa>(state.range(1)) };
+        if (isa > CpuFeatures::Detected())
+        {
+            state.SkipWithError("The CPU doesn't support this kernel.");
+            return;
+        }
+        FrustumCuller::SelectKernel(isa);
+
+        FrustumCuller culler;
+        Fill(culler, static_cast<uint32_t>(state.range(0)));
+        Frustum frustum{ Camera() };
+        std::vector<uint32_t> visible(culler.Count());
+
+        uint32_t visibleCount{ 0 };
+        for (auto _ : state)
+        {
+            visibleCount = culler.CullRange(frustum, 0, culler.Count(), visible.data());
+            benchmark::DoNotOptimize(visible.data());
+        }
+
+        FrustumCuller::SelectKernel(CpuFeatures::Detected());
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.counters["visible"] = static_cast<double>(visibleCount) / state.range(0);
+    }
+
+    // What a frame pays with the widest kernel, parallel chunks and the stitching after.
+    void BM_FrustumCull(benchmark::State& state)
+    {
+        FrustumCuller culler;
+        Fill(culler, static_cast<uint32_t>(state.range(0)));
+        Frustum frustum{ Camera() };
+        JobSystem jobSystem;
+        std::vector<uint32_t> visible;
+
+        for (auto _ : state)
+        {
+            culler.Cull(frustum, jobSystem, visible);
+            benchmark::DoNotOptimize(visible.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_FrustumCullRange)->ArgsProduct({ { 10000, 100000, 1000000 }, { 0, 1, 2 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrustumCull)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,151 @@
+#include "job_system.hpp"
+#include "mesh_importer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t GLB_MAGIC = 0x46546C67;
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+    void Append(std::vector<uint8_t>& bytes, const void* data, size_t size)
+    {
+        const uint8_t* begin{ static_cast<const uint8_t*>(data) };
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+
+    // A side x side vertex grid with positions, normals and UVs, written once as a .gltf next to
+    // its .bin and once as a .glb holding both.
+    struct GltfGrid
+    {
+        explicit GltfGrid(uint32_t side)
+        {
+            std::filesystem::path directory{ std::filesystem::temp_directory_path() };
+            std::string name{ "gltf_importer_benchmark_" + std::to_string(side) };
+            gltf = directory / (name + ".gltf");
+            bin = directory / (name + ".bin");
+            glb = directory / (name + ".glb");
+
+            std::vector<float> positions;
+            std::vector<float> normals;
+            std::vector<float> texcoords;
+            for (uint32_t y = 0; y < side; ++y)
+            {
+                for (uint32_t x = 0; x < side; ++x)
+                {
+                    float u{ static_cast<float>(x) / (side - 1) };
+                    float v{ static_cast<float>(y) / (side - 1) };
+                    positions.insert(positions.end(), { u, 0.1f * (x % 7), v });
+                    normals.insert(normals.end(), { 0.0f, 1.0f, 0.0f });
+                    texcoords.insert(texcoords.end(), { u, v });
+                }
+            }
+
+            std::vector<uint32_t> indices;
+            for (uint32_t y = 0; y + 1 < side; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < side; ++x)
+                {
+                    uint32_t i{ y * side + x };
+                    indices.insert(indices.end(), { i, i + 1, i + side + 1, i, i + side + 1, i + side });
+                }
+            }
+
+            std::vector<uint8_t> data;
+            Append(data, positions.data(), positions.size() * sizeof(float));
+            Append(data, normals.data(), normals.size() * sizeof(float));
+            Append(data, texcoords.data(), texcoords.size() * sizeof(float));
+            Append(data, indices.data(), indices.size() * sizeof(uint32_t));
+
+            uint64_t vertexCount{ static_cast<uint64_t>(side) * side };
+            uint64_t offsets[] = { 0, vertexCount * 12, vertexCount * 24, vertexCount * 32, data.size() };
+            std::string views;
+            for (uint32_t i = 0; i < 4; ++i)
+                views += (i ? ", " : "") + std::string{ R"({ "buffer": 0, "byteOffset": )" } + std::to_string(offsets[i]) + R"(, "byteLength": )" + std::to_string(offsets[i + 1] - offsets[i]) + " }";
+
+            std::string count{ std::to_string(vertexCount) };
+            std::string body{ R"(, "bufferViews": [ )" + views + R"( ], "accessors": [ )"
+                R"({ "bufferView": 0, "componentType": 5126, "type": "VEC3", "count": )" + count + " }, "
+                R"({ "bufferView": 1, "componentType": 5126, "type": "VEC3", "count": )" + count + " }, "
+                R"({ "bufferView": 2, "componentType": 5126, "type": "VEC2", "count": )" + count + " }, "
+                R"({ "bufferView": 3, "componentType": 5125, "type": "SCALAR", "count": )" + std::to_string(indices.size()) + " } ], "
+                R"("meshes": [ { "primitives": [ { "attributes": { "POSITION": 0, "NORMAL": 1, "TEXCOORD_0": 2 }, "indices": 3 } ] } ] })" };
+            std::string asset{ R"({ "asset": { "version": "2.0" }, "buffers": [ { )" };
+            std::string length{ R"("byteLength": )" + std::to_string(data.size()) + " } ]" };
+
+            std::ofstream{ gltf } << asset << R"("uri": ")" << bin.filename().string() << R"(", )" << length << body;
+            std::ofstream{ bin, std::ios::binary }.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+            // Both chunks are padded to four bytes, the JSON one with spaces.
+            std::string json{ asset + length + body };
+            json.resize((json.size() + 3) & ~size_t{ 3 }, ' ');
+            data.resize((data.size() + 3) & ~size_t{ 3 }, 0);
+
+            uint32_t header[] = { GLB_MAGIC, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + data.size()) };
+            uint32_t jsonChunk[] = { static_cast<uint32_t>(json.size()), GLB_CHUNK_JSON };
+            uint32_t binChunk[] = { static_cast<uint32_t>(data.size()), GLB_CHUNK_BIN };
+            std::vector<uint8_t> file;
+            Append(file, header, sizeof(header));
+            Append(file, jsonChunk, sizeof(jsonChunk));
+            Append(file, json.data(), json.size());
+            Append(file, binChunk, sizeof(binChunk));
+            Append(file, data.data(), data.size());
+            std::ofstream{ glb, std::ios::binary }.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+            size = data.size();
+        }
+
+        ~GltfGrid()
+        {
+            std::filesystem::remove(gltf);
+            std::filesystem::remove(bin);
+            std::filesystem::remove(glb);
+        }
+
+        std::filesystem::path gltf;
+        std::filesystem::path bin;
+        std::filesystem::path glb;
+        uint64_t size{ 0 };
+    };
+
+    // Bytes are the binary buffer's, items are vertices.
+    void Import(benchmark::State& state, const std::filesystem::path& path, uint64_t size)
+    {
+        JobSystem jobSystem;
+        std::optional<MeshData> mesh;
+        for (auto _ : state)
+        {
+            mesh = ImportGltf(path, jobSystem);
+            if (!mesh)
+            {
+                state.SkipWithError("Couldn't import the glTF.");
+                break;
+            }
+            benchmark::DoNotOptimize(mesh->vertices.data());
+        }
+
+        state.SetBytesProcessed(state.iterations() * size);
+        state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(0));
+    }
+
+    void BM_GltfImport(benchmark::State& state)
+    {
+        GltfGrid grid{ static_cast<uint32_t>(state.range(0)) };
+        Import(state, grid.gltf, grid.size);
+    }
+
+    void BM_GltfImportGlb(benchmark::State& state)
+    {
+        GltfGrid grid{ static_cast<uint32_t>(state.range(0)) };
+        Import(state, grid.glb, grid.size);
+    }
+}
+
+BENCHMARK(BM_GltfImport)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_GltfImportGlb)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,106 @@
+#include "instance_batcher.hpp"
+#include "job_system.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    struct Entity
+    {
+        uint32_t mesh;
+        uint32_t lod;
+        float viewDepth;
+    };
+
+    // entityCount entities sharing meshCount meshes, a material per mesh and 8 pipelines,
+    // each at some LOD and depth.
+    std::vector<Entity> Scene(uint32_t entityCount, uint32_t meshCount)
+    {
+        std::mt19937 random{ entityCount + meshCount };
+        std::uniform_real_distribution<float> depth{ 0.5f, 500.0f };
+        std::vector<Entity> entities(entityCount);
+        for (Entity& entity : entities)
+            entity = { static_cast<uint32_t>(random() % meshCount), static_cast<uint32_t>(random() % 4), depth(random) };
+        return entities;
+    }
+
+    // range(0) entities over range(1) meshes through what BuildInstanceBatches does every
+    // frame: emit a packet each, sort, group and write the instance buffer. draws is what
+    // gets submitted, against one draw per entity without instancing.
+    void BM_InstanceBatching(benchmark::State& state)
+    {
+        uint32_t entityCount{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<Entity> entities{ Scene(entityCount, static_cast<uint32_t>(state.range(1))) };
+        JobSystem jobSystem;
+
+        constexpr uint32_t CHUNK_SIZE = 4096;
+        uint32_t chunkCount{ (entityCount + CHUNK_SIZE - 1) / CHUNK_SIZE };
+        RenderPacketStream packets;
+        InstanceBatcher batcher;
+        std::vector<InstanceData> instances(entityCount);
+        for (auto _ : state)
+        {
+            packets.Reset(chunkCount);
+            jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+            {
+                uint32_t end{ std::min(entityCount, (chunk + 1) * CHUNK_SIZE) };
+                for (uint32_t i = chunk * CHUNK_SIZE; i < end; ++i)
+                {
+                    const Entity& entity{ entities[i] };
+                    uint64_t key{ SortKey::Opaque(PACKET_PASS_SCENE, entity.mesh % 8, entity.mesh, entity.mesh, entity.lod, entity.viewDepth) };
+                    packets.Emit(chunk, { key, entity.mesh * 4 + entity.lod, i });
+                }
+            });
+
+            std::span<const RenderPacket> sorted{ packets.Sort(jobSystem) };
+            batcher.Group(sorted);
+            batcher.WriteInstances(sorted, instances.data(), jobSystem);
+            benchmark::ClobberMemory();
+        }
+
+        double draws{ static_cast<double>(batcher.Batches().size()) };
+        state.SetItemsProcessed(state.iterations() * entityCount);
+        state.counters["draws"] = draws;
+        state.counters["reduction"] = entityCount / draws;
+    }
+
+    // Only the grouping and the instance buffer, over packets sorted once up front.
+    void BM_InstanceBatchGroup(benchmark::State& state)
+    {
+        uint32_t entityCount{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<Entity> entities{ Scene(entityCount, static_cast<uint32_t>(state.range(1))) };
+        JobSystem jobSystem;
+
+        std::vector<RenderPacket> sorted;
+        for (uint32_t i = 0; i < entityCount; ++i)
+        {
+            const Entity& entity{ entities[i] };
+            sorted.push_back({ SortKey::Opaque(PACKET_PASS_SCENE, entity.mesh % 8, entity.mesh, entity.mesh, entity.lod, entity.viewDepth),
+                               entity.mesh * 4 + entity.lod, i });
+        }
+        std::vector<RenderPacket> scratch;
+        SortRenderPackets(sorted, scratch, jobSystem);
+
+        InstanceBatcher batcher;
+        std::vector<InstanceData> instances(entityCount);
+        for (auto _ : state)
+        {
+            batcher.Group(sorted);
+            batcher.WriteInstances(sorted, instances.data(), jobSystem);
+            benchmark::ClobberMemory();
+        }
+
+        double draws{ static_cast<double>(batcher.Batches().size()) };
+        state.SetItemsProcessed(state.iterations() * entityCount);
+        state.counters["draws"] = draws;
+        state.counters["reduction"] = entityCount / draws;
+    }
+}
+
+// From a few meshes shared by many entities to nearly every entity drawing its own.
+BENCHMARK(BM_InstanceBatching)->ArgsProduct({ { 100000 }, { 10, 100, 1000, 10000, 60000 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_InstanceBatchGroup)->ArgsProduct({ { 100000 }, { 10, 100, 1000, 10000, 60000 } })->Unit(benchmark::kMicrosecond);
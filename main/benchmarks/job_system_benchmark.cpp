@@ -0,0 +1,128 @@
+#include "job_system.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t ITEM_COUNT = 1 << 16;
+
+    // What JobSystem replaces: one locked queue every thread pulls from.
+    class NaivePool
+    {
+    public:
+        explicit NaivePool(uint32_t threadCount)
+        {
+            for (uint32_t i = 0; i < threadCount; ++i)
+                _threads.emplace_back([this] { Loop(); });
+        }
+
+        ~NaivePool()
+        {
+            {
+                std::lock_guard lock{ _mutex };
+                _exit = true;
+            }
+            _wake.notify_all();
+            for (std::thread& thread : _threads)
+                thread.join();
+        }
+
+        template <typename Body>
+        void ParallelFor(uint32_t count, uint32_t grain, Body& body)
+        {
+            {
+                std::lock_guard lock{ _mutex };
+                for (uint32_t begin = 0; begin < count; begin += grain)
+                {
+                    uint32_t end{ std::min(count, begin + grain) };
+                    _jobs.push_back([&body, begin, end] { for (uint32_t i = begin; i < end; ++i) body(i); });
+                    ++_pending;
+                }
+            }
+            _wake.notify_all();
+
+            std::unique_lock lock{ _mutex };
+            _done.wait(lock, [this] { return _pending == 0; });
+        }
+
+    private:
+        void Loop()
+        {
+            std::unique_lock lock{ _mutex };
+            while (true)
+            {
+                _wake.wait(lock, [this] { return _exit || !_jobs.empty(); });
+                if (_exit)
+                    return;
+
+                std::function<void()> job{ std::move(_jobs.front()) };
+                _jobs.pop_front();
+                lock.unlock();
+                job();
+                lock.lock();
+
+                if (--_pending == 0)
+                    _done.notify_all();
+            }
+        }
+
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::deque<std::function<void()>> _jobs;
+        uint32_t _pending{ 0 };
+        bool _exit{ false };
+    };
+
+    // Some arithmetic per item, like a transform or a culling test.
+    struct Work
+    {
+        std::vector<float>& values;
+
+        void operator()(uint32_t i) const
+        {
+            float v{ values[i] };
+            for (uint32_t k = 0; k < 16; ++k)
+                v = std::sqrt(v * v + 1.0f);
+            values[i] = v;
+        }
+    };
+
+    // range(0) threads doing the work, range(1) items per job. JobSystem counts the calling
+    // thread, the naive pool's caller only waits.
+    void BM_JobSystemParallelFor(benchmark::State& state)
+    {
+        JobSystem jobSystem{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<float> values(ITEM_COUNT, 1.0f);
+        Work work{ values };
+
+        for (auto _ : state)
+            jobSystem.ParallelFor(ITEM_COUNT, static_cast<uint32_t>(state.range(1)), work);
+
+        state.SetItemsProcessed(state.iterations() * ITEM_COUNT);
+    }
+
+    void BM_NaivePoolParallelFor(benchmark::State& state)
+    {
+        NaivePool pool{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<float> values(ITEM_COUNT, 1.0f);
+        Work work{ values };
+
+        for (auto _ : state)
+            pool.ParallelFor(ITEM_COUNT, static_cast<uint32_t>(state.range(1)), work);
+
+        state.SetItemsProcessed(state.iterations() * ITEM_COUNT);
+    }
+}
+
+BENCHMARK(BM_JobSystemParallelFor)->ArgsProduct({ { 1, 2, 4, 8 }, { 64, 1024 } })->UseRealTime();
+BENCHMARK(BM_NaivePoolParallelFor)->ArgsProduct({ { 1, 2, 4, 8 }, { 64, 1024 } })->UseRealTime();
@@ -0,0 +1,194 @@
+#include "binary_io.hpp"
+#include "cooked_mesh.hpp"
+#include "job_system.hpp"
+#include "mesh_data.hpp"
+#include "mesh_importer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Starts tracking the peak resident set again from the current one, so an earlier
+    // benchmark's peak doesn't hide this one's. Kernels without it keep the old peak.
+    void ResetPeakResident()
+    {
+#if defined(__linux__)
+        std::ofstream{ "/proc/self/clear_refs" } << "5";
+#endif
+    }
+
+    // Peak resident set of the process, zero where it isn't known.
+    int64_t PeakResidentBytes()
+    {
+#if defined(__linux__)
+        std::ifstream status{ "/proc/self/status" };
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.starts_with("VmHWM:"))
+                return std::stoll(line.substr(6)) * 1024;
+        }
+#endif
+        return 0;
+    }
+
+    // A side x side vertex grid, written once as OBJ and once cooked.
+    struct MeshFiles
+    {
+        explicit MeshFiles(uint32_t side)
+        {
+            std::filesystem::path directory{ std::filesystem::temp_directory_path() };
+            obj = directory / ("mesh_load_benchmark_" + std::to_string(side) + ".obj");
+            cooked = directory / ("mesh_load_benchmark_" + std::to_string(side) + ".mesh");
+
+            MeshData mesh;
+            std::ofstream file{ obj };
+            for (uint32_t y = 0; y < side; ++y)
+            {
+                for (uint32_t x = 0; x < side; ++x)
+                {
+                    float u{ static_cast<float>(x) / (side - 1) };
+                    float v{ static_cast<float>(y) / (side - 1) };
+                    file << "v " << u << ' ' << 0.1f * (x % 7) << ' ' << v << "\nvt " << u << ' ' << v << "\nvn 0 1 0\n";
+
+                    mesh.vertices.push_back({ { u, 0.1f * (x % 7), v }, { u, v }, { u, v } });
+                    mesh.extraVertices.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+                }
+            }
+
+            for (uint32_t y = 0; y + 1 < side; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < side; ++x)
+                {
+                    uint32_t i{ y * side + x };
+                    uint32_t quad[4] = { i, i + 1, i + side + 1, i + side };
+                    file << "f";
+                    for (uint32_t corner : quad)
+                        file << ' ' << corner + 1 << '/' << corner + 1 << '/' << corner + 1;
+                    file << '\n';
+
+                    mesh.indices.insert(mesh.indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+                }
+            }
+
+            CookedSubmesh submesh;
+            submesh.name = "grid";
+            submesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+            mesh.submeshes.push_back(std::move(submesh));
+
+            CookedMeshDesc desc{ mesh.Describe() };
+            desc.indexSize = 4;
+            CookMesh(cooked, desc);
+            size = std::filesystem::file_size(cooked);
+        }
+
+        ~MeshFiles()
+        {
+            std::filesystem::remove(obj);
+            std::filesystem::remove(cooked);
+        }
+
+        std::filesystem::path obj;
+        std::filesystem::path cooked;
+        uint64_t size{ 0 };
+    };
+
+    // Staging copy of every stream, what handing them to the upload service amounts to.
+    uint64_t CopyStreams(std::span<const uint8_t> vertices, std::span<const uint8_t> extraVertices, std::span<const uint8_t> indices, std::vector<uint8_t>& staging)
+    {
+        staging.resize(vertices.size() + extraVertices.size() + indices.size());
+        memcpy(staging.data(), vertices.data(), vertices.size());
+        memcpy(staging.data() + vertices.size(), extraVertices.data(), extraVertices.size());
+        memcpy(staging.data() + vertices.size() + extraVertices.size(), indices.data(), indices.size());
+        return staging.size();
+    }
+
+    // How far the process grew at most over the loads, the copies included.
+    void ReportPeakResident(benchmark::State& state, int64_t before)
+    {
+        state.counters["peakMB"] = static_cast<double>(PeakResidentBytes() - before) / (1024.0 * 1024.0);
+    }
+
+    // The path the box and imported meshes take after their first run.
+    void BM_MeshLoadCooked(benchmark::State& state)
+    {
+        MeshFiles files{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<uint8_t> staging;
+        ResetPeakResident();
+        int64_t before{ PeakResidentBytes() };
+
+        CookedMesh mesh;
+        for (auto _ : state)
+        {
+            if (!mesh.Open(files.cooked))
+            {
+                state.SkipWithError("Couldn't open the cooked mesh.");
+                break;
+            }
+            benchmark::DoNotOptimize(CopyStreams(mesh.Vertices(), mesh.ExtraVertices(), mesh.Indices(), staging));
+        }
+
+        ReportPeakResident(state, before);
+        state.SetBytesProcessed(state.iterations() * files.size);
+    }
+
+    // The cooked file read into memory instead of mapped, the streams get copied twice.
+    void BM_MeshLoadCookedRead(benchmark::State& state)
+    {
+        MeshFiles files{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<uint8_t> staging;
+        std::optional<std::vector<uint8_t>> data;
+        ResetPeakResident();
+        int64_t before{ PeakResidentBytes() };
+
+        for (auto _ : state)
+        {
+            data = ReadWholeFile(files.cooked);
+            if (!data)
+            {
+                state.SkipWithError("Couldn't read the cooked mesh.");
+                break;
+            }
+            benchmark::DoNotOptimize(CopyStreams(*data, {}, {}, staging));
+        }
+
+        ReportPeakResident(state, before);
+        state.SetBytesProcessed(state.iterations() * files.size);
+    }
+
+    // Parsing the source every time, what the cache saves.
+    void BM_MeshLoadObj(benchmark::State& state)
+    {
+        MeshFiles files{ static_cast<uint32_t>(state.range(0)) };
+        JobSystem jobSystem;
+        std::vector<uint8_t> staging;
+        std::optional<MeshData> mesh;
+        ResetPeakResident();
+        int64_t before{ PeakResidentBytes() };
+
+        for (auto _ : state)
+        {
+            mesh = ImportObj(files.obj, jobSystem);
+            if (!mesh)
+            {
+                state.SkipWithError("Couldn't import the OBJ.");
+                break;
+            }
+
+            CookedMeshDesc desc{ mesh->Describe() };
+            benchmark::DoNotOptimize(CopyStreams(desc.vertices, desc.extraVertices, desc.indices, staging));
+        }
+
+        ReportPeakResident(state, before);
+        state.SetBytesProcessed(state.iterations() * files.size);
+    }
+}
+
+BENCHMARK(BM_MeshLoadCooked)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeshLoadCookedRead)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeshLoadObj)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,144 @@
+#include "job_system.hpp"
+#include "mesh_data.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // A side x side vertex grid with its triangles in random order, what an exporter that
+    // doesn't care hands over. Every triangle gets its own three corners when unwelded is set.
+    MeshData ShuffledGrid(uint32_t side, bool unwelded = false)
+    {
+        MeshData mesh;
+        for (uint32_t y = 0; y < side; ++y)
+        {
+            for (uint32_t x = 0; x < side; ++x)
+            {
+                float u{ static_cast<float>(x) / (side - 1) };
+                float v{ static_cast<float>(y) / (side - 1) };
+                mesh.vertices.push_back({ { u, 0.1f * (x % 7), v }, { u, v }, { u, v } });
+                mesh.extraVertices.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t y = 0; y + 1 < side; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < side; ++x)
+            {
+                uint32_t i{ y * side + x };
+                triangles.push_back({ i, i + 1, i + side + 1 });
+                triangles.push_back({ i, i + side + 1, i + side });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937{ side });
+
+        for (const std::array<uint32_t, 3>& triangle : triangles)
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+
+        if (unwelded)
+        {
+            MeshData split;
+            for (uint32_t index : mesh.indices)
+            {
+                split.indices.push_back(static_cast<uint32_t>(split.vertices.size()));
+                split.vertices.push_back(mesh.vertices[index]);
+                split.extraVertices.push_back(mesh.extraVertices[index]);
+            }
+            mesh = std::move(split);
+        }
+
+        CookedSubmesh submesh;
+        submesh.name = "grid";
+        submesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        mesh.submeshes.push_back(std::move(submesh));
+        return mesh;
+    }
+
+    // The statistics of the last result next to the input's, so a run shows what the pass bought.
+    void ReportStatistics(benchmark::State& state, const VertexCacheStatistics& before, std::span<const uint32_t> indices, uint32_t vertexCount)
+    {
+        VertexCacheStatistics after{ MeshOptimizer::AnalyzeVertexCache(indices, vertexCount) };
+        state.counters["acmrBefore"] = before.acmr;
+        state.counters["acmrAfter"] = after.acmr;
+        state.counters["atvrBefore"] = before.atvr;
+        state.counters["atvrAfter"] = after.atvr;
+    }
+
+    void BM_OptimizeVertexCache(benchmark::State& state)
+    {
+        MeshData mesh{ ShuffledGrid(static_cast<uint32_t>(state.range(0))) };
+        uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+        std::vector<uint32_t> indices;
+
+        for (auto _ : state)
+        {
+            indices = mesh.indices;
+            MeshOptimizer::OptimizeVertexCache(indices, vertexCount);
+            benchmark::DoNotOptimize(indices.data());
+        }
+
+        ReportStatistics(state, MeshOptimizer::AnalyzeVertexCache(mesh.indices, vertexCount), indices, vertexCount);
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    // Starts from the cache optimized order, the before counters are that order's.
+    void BM_OptimizeOverdraw(benchmark::State& state)
+    {
+        MeshData mesh{ ShuffledGrid(static_cast<uint32_t>(state.range(0))) };
+        uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+        MeshOptimizer::OptimizeVertexCache(mesh.indices, vertexCount);
+        std::vector<uint32_t> indices;
+
+        for (auto _ : state)
+        {
+            indices = mesh.indices;
+            MeshOptimizer::OptimizeOverdraw(indices, mesh.vertices);
+            benchmark::DoNotOptimize(indices.data());
+        }
+
+        ReportStatistics(state, MeshOptimizer::AnalyzeVertexCache(mesh.indices, vertexCount), indices, vertexCount);
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    // The whole pipeline on an unwelded mesh, welding is most of what changes ATVR.
+    void BM_MeshOptimize(benchmark::State& state)
+    {
+        MeshData source{ ShuffledGrid(static_cast<uint32_t>(state.range(0)), true) };
+        JobSystem jobSystem;
+        MeshData mesh;
+
+        for (auto _ : state)
+        {
+            mesh = source;
+            MeshOptimizer::Optimize(mesh, jobSystem);
+            benchmark::DoNotOptimize(mesh.indices.data());
+        }
+
+        ReportStatistics(state, MeshOptimizer::AnalyzeVertexCache(source.indices, static_cast<uint32_t>(source.vertices.size())),
+            mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+        state.SetItemsProcessed(state.iterations() * source.indices.size() / 3);
+    }
+
+    void BM_AnalyzeVertexCache(benchmark::State& state)
+    {
+        MeshData mesh{ ShuffledGrid(static_cast<uint32_t>(state.range(0))) };
+        uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(MeshOptimizer::AnalyzeVertexCache(mesh.indices, vertexCount));
+
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+}
+
+BENCHMARK(BM_OptimizeVertexCache)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_OptimizeOverdraw)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeshOptimize)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_AnalyzeVertexCache)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
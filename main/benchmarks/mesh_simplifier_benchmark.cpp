@@ -0,0 +1,182 @@
+#include "job_system.hpp"
+#include "lod_selection.hpp"
+#include "mesh_data.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A bumpy unit sphere with side rings of side vertices, open at the poles. The bumps give
+    // every collapse some error, a plain sphere would simplify almost for free.
+    MeshData BumpySphere(uint32_t side)
+    {
+        constexpr float PI = 3.14159265f;
+
+        MeshData mesh;
+        for (uint32_t ring = 0; ring < side; ++ring)
+        {
+            float theta{ PI * (ring + 0.5f) / side };
+            for (uint32_t i = 0; i < side; ++i)
+            {
+                float phi{ 2.0f * PI * i / side };
+                float radius{ 1.0f + 0.05f * std::sin(theta * 7.0f) * std::sin(phi * 5.0f) };
+                float u{ static_cast<float>(i) / side };
+                float v{ static_cast<float>(ring) / side };
+                mesh.vertices.push_back({ { radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi) }, { u, v }, { u, v } });
+                mesh.extraVertices.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+            }
+        }
+
+        for (uint32_t ring = 0; ring + 1 < side; ++ring)
+        {
+            for (uint32_t i = 0; i < side; ++i)
+            {
+                uint32_t a{ ring * side + i };
+                uint32_t b{ ring * side + (i + 1) % side };
+                mesh.indices.insert(mesh.indices.end(), { a, b, b + side, a, b + side, a + side });
+            }
+        }
+        MeshOptimizer::OptimizeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+
+        CookedSubmesh submesh;
+        submesh.name = "sphere";
+        submesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        mesh.submeshes.push_back(std::move(submesh));
+        return mesh;
+    }
+
+    // range(1) percent of the triangles with the error left open, the reduction counter shows
+    // how close it got and error what it cost, in mesh units on a sphere of radius one.
+    void BM_SimplifyToCount(benchmark::State& state)
+    {
+        MeshData mesh{ BumpySphere(static_cast<uint32_t>(state.range(0))) };
+        uint32_t target{ static_cast<uint32_t>(mesh.indices.size() / 3 * state.range(1) / 100) * 3 };
+
+        SimplifyResult result;
+        for (auto _ : state)
+        {
+            result = MeshSimplifier::Simplify(mesh.indices, mesh.vertices, target, 1.0f);
+            benchmark::DoNotOptimize(result.indices.data());
+        }
+
+        state.counters["reduction"] = static_cast<double>(result.indices.size()) / mesh.indices.size();
+        state.counters["error"] = result.error;
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    // No triangle target, only range(1) thousandths of the extent as the error bound. Shows
+    // how far a given error budget gets.
+    void BM_SimplifyToError(benchmark::State& state)
+    {
+        MeshData mesh{ BumpySphere(static_cast<uint32_t>(state.range(0))) };
+        float targetError{ state.range(1) / 1000.0f };
+
+        SimplifyResult result;
+        for (auto _ : state)
+        {
+            result = MeshSimplifier::Simplify(mesh.indices, mesh.vertices, 0, targetError);
+            benchmark::DoNotOptimize(result.indices.data());
+        }
+
+        state.counters["reduction"] = static_cast<double>(result.indices.size()) / mesh.indices.size();
+        state.counters["error"] = result.error;
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    // The cooker's chain of levels, each level's share of the full triangle count and error.
+    void BM_GenerateLods(benchmark::State& state)
+    {
+        MeshData source{ BumpySphere(static_cast<uint32_t>(state.range(0))) };
+        JobSystem jobSystem;
+        MeshData mesh;
+
+        for (auto _ : state)
+        {
+            mesh = source;
+            MeshSimplifier::GenerateLods(mesh, jobSystem);
+            benchmark::DoNotOptimize(mesh.indices.data());
+        }
+
+        for (const CookedSubmesh& submesh : mesh.submeshes)
+        {
+            if (submesh.lodLevel == 0)
+                continue;
+            std::string level{ std::to_string(submesh.lodLevel) };
+            state.counters["lod" + level + "Triangles"] = static_cast<double>(submesh.indexCount) / source.indices.size();
+            state.counters["lod" + level + "Error"] = submesh.lodError;
+        }
+        state.SetItemsProcessed(state.iterations() * source.indices.size() / 3);
+    }
+
+    // range(1) instances of the LOD chain scattered over a 500 unit disc around the camera,
+    // sized 1 to 5, so distances cover close ups to specks. Every iteration selects all their
+    // levels the way the renderer does each frame. drawnTriangles is what gets drawn as a
+    // share of drawing every instance at full detail.
+    void BM_SceneLodSelection(benchmark::State& state)
+    {
+        MeshData mesh{ BumpySphere(static_cast<uint32_t>(state.range(0))) };
+        JobSystem jobSystem;
+        MeshSimplifier::GenerateLods(mesh, jobSystem);
+
+        std::vector<float> errors;
+        std::vector<uint32_t> triangles;
+        for (const CookedSubmesh& submesh : mesh.submeshes)
+        {
+            errors.push_back(submesh.lodError);
+            triangles.push_back(submesh.indexCount / 3);
+        }
+
+        struct Instance
+        {
+            float distance;
+            float radius;
+            uint32_t lod;
+        };
+
+        // 60 degrees vertically at 1080p.
+        constexpr float PROJECTION_SCALE = 1.7320508f;
+        constexpr float VIEWPORT_HEIGHT = 1080.0f;
+
+        uint32_t instanceCount{ static_cast<uint32_t>(state.range(1)) };
+        std::mt19937 random{ instanceCount };
+        std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+        std::vector<Instance> instances(instanceCount);
+        for (Instance& instance : instances)
+            instance = { 500.0f * std::sqrt(unit(random)), 1.0f + 4.0f * unit(random), 0 };
+
+        uint64_t drawn{ 0 };
+        for (auto _ : state)
+        {
+            drawn = 0;
+            for (Instance& instance : instances)
+            {
+                // The bumpy sphere reaches out to 1.05 in mesh units, errors scale with the instance.
+                float radius{ 1.05f * instance.radius };
+                float screenSize{ LodSelection::ScreenSize(radius, instance.distance, PROJECTION_SCALE) };
+                instance.lod = LodSelection::Select(errors, 1.05f, screenSize, VIEWPORT_HEIGHT, instance.lod);
+                drawn += triangles[instance.lod];
+            }
+            benchmark::DoNotOptimize(drawn);
+        }
+
+        std::vector<uint32_t> levelCounts(errors.size());
+        for (const Instance& instance : instances)
+            ++levelCounts[instance.lod];
+        for (size_t level = 0; level < levelCounts.size(); ++level)
+            state.counters["lod" + std::to_string(level) + "Instances"] = levelCounts[level];
+        state.counters["drawnTriangles"] = static_cast<double>(drawn) / (static_cast<double>(triangles[0]) * instanceCount);
+        state.SetItemsProcessed(state.iterations() * instanceCount);
+    }
+}
+
+BENCHMARK(BM_SimplifyToCount)->ArgsProduct({ { 64, 256, 512 }, { 50, 10 } })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SimplifyToError)->ArgsProduct({ { 64, 256, 512 }, { 1, 10 } })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GenerateLods)->Arg(64)->Arg(256)->Arg(512)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneLodSelection)->ArgsProduct({ { 64, 256 }, { 1000, 100000 } })->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,163 @@
+#include "job_system.hpp"
+#include "mesh_data.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet_builder.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // A UV sphere with side rings of side vertices, curved everywhere so the normal cones
+    // have something to bound. Cache optimized like the cooker leaves it, or with its
+    // triangles in random order.
+    MeshData Sphere(uint32_t side, bool shuffled)
+    {
+        constexpr float PI = 3.14159265f;
+
+        MeshData mesh;
+        for (uint32_t ring = 0; ring < side; ++ring)
+        {
+            float theta{ PI * (ring + 0.5f) / side };
+            for (uint32_t i = 0; i < side; ++i)
+            {
+                float phi{ 2.0f * PI * i / side };
+                float u{ static_cast<float>(i) / side };
+                float v{ static_cast<float>(ring) / side };
+                mesh.vertices.push_back({ { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) }, { u, v }, { u, v } });
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t ring = 0; ring + 1 < side; ++ring)
+        {
+            for (uint32_t i = 0; i < side; ++i)
+            {
+                uint32_t a{ ring * side + i };
+                uint32_t b{ ring * side + (i + 1) % side };
+                triangles.push_back({ a, b, b + side });
+                triangles.push_back({ a, b + side, a + side });
+            }
+        }
+        if (shuffled)
+            std::shuffle(triangles.begin(), triangles.end(), std::mt19937{ side });
+
+        for (const std::array<uint32_t, 3>& triangle : triangles)
+            mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+        if (!shuffled)
+            MeshOptimizer::OptimizeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+        return mesh;
+    }
+
+    // How full the meshlets are against the limits, and how tight their cones are: the mean
+    // cutoff, lower is tighter, and the share of meshlets back face culled from a ring of
+    // viewpoints around the sphere. About 0.6 of the sphere faces away from each of them.
+    void ReportQuality(benchmark::State& state, const MeshletData& data)
+    {
+        uint64_t vertices{ 0 };
+        uint64_t triangles{ 0 };
+        double cutoff{ 0.0 };
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            vertices += meshlet.vertexCount;
+            triangles += meshlet.triangleCount;
+        }
+
+        constexpr uint32_t VIEW_COUNT = 16;
+        uint64_t culled{ 0 };
+        for (const MeshletBounds& bounds : data.bounds)
+        {
+            cutoff += bounds.coneCutoff;
+            for (uint32_t view = 0; view < VIEW_COUNT; ++view)
+            {
+                float angle{ 6.2831853f * view / VIEW_COUNT };
+                float position[3]{ 4.0f * std::cos(angle), 1.0f, 4.0f * std::sin(angle) };
+                culled += MeshletBuilder::IsBackfacing(bounds, position);
+            }
+        }
+
+        double meshletCount{ static_cast<double>(data.meshlets.size()) };
+        state.counters["meshlets"] = meshletCount;
+        state.counters["vertexFill"] = vertices / (meshletCount * MeshletBuilder::MAX_VERTICES);
+        state.counters["triangleFill"] = triangles / (meshletCount * MeshletBuilder::MAX_TRIANGLES);
+        state.counters["coneCutoff"] = cutoff / meshletCount;
+        state.counters["backfaceCulled"] = culled / (meshletCount * VIEW_COUNT);
+    }
+
+    void Build(benchmark::State& state, bool shuffled)
+    {
+        MeshData mesh{ Sphere(static_cast<uint32_t>(state.range(0)), shuffled) };
+
+        MeshletData data;
+        for (auto _ : state)
+        {
+            data = MeshletBuilder::Build(mesh.indices, mesh.vertices);
+            benchmark::DoNotOptimize(data.meshlets.data());
+        }
+
+        ReportQuality(state, data);
+        state.SetItemsProcessed(state.iterations() * mesh.indices.size() / 3);
+    }
+
+    void BM_MeshletBuild(benchmark::State& state)
+    {
+        Build(state, false);
+    }
+
+    // What skipping the cache optimization costs the builder, it follows the index order.
+    void BM_MeshletBuildShuffled(benchmark::State& state)
+    {
+        Build(state, true);
+    }
+
+    // Bounds alone, what rebuilding them after a vertex edit would pay.
+    void BM_MeshletComputeBounds(benchmark::State& state)
+    {
+        MeshData mesh{ Sphere(static_cast<uint32_t>(state.range(0)), false) };
+        MeshletData data{ MeshletBuilder::Build(mesh.indices, mesh.vertices) };
+
+        for (auto _ : state)
+        {
+            for (const Meshlet& meshlet : data.meshlets)
+                benchmark::DoNotOptimize(MeshletBuilder::ComputeBounds(data, meshlet, mesh.vertices));
+        }
+
+        state.SetItemsProcessed(state.iterations() * data.meshlets.size());
+    }
+
+    // The cooker's path, eight submeshes built in parallel and merged.
+    void BM_MeshletBuildMeshlets(benchmark::State& state)
+    {
+        MeshData source{ Sphere(static_cast<uint32_t>(state.range(0)), false) };
+        uint32_t partSize{ static_cast<uint32_t>(source.indices.size() / 3 / 8 * 3) };
+        for (uint32_t part = 0; part < 8; ++part)
+        {
+            CookedSubmesh submesh;
+            submesh.startIndexLocation = part * partSize;
+            submesh.indexCount = part == 7 ? static_cast<uint32_t>(source.indices.size()) - part * partSize : partSize;
+            source.submeshes.push_back(std::move(submesh));
+        }
+
+        JobSystem jobSystem;
+        MeshData mesh;
+        for (auto _ : state)
+        {
+            mesh = source;
+            MeshletBuilder::BuildMeshlets(mesh, jobSystem);
+            benchmark::DoNotOptimize(mesh.meshlets.meshlets.data());
+        }
+
+        ReportQuality(state, mesh.meshlets);
+        state.SetItemsProcessed(state.iterations() * source.indices.size() / 3);
+    }
+}
+
+BENCHMARK(BM_MeshletBuild)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeshletBuildShuffled)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeshletComputeBounds)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_MeshletBuildMeshlets)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,116 @@
+#include "copy_kernels.hpp"
+#include "job_system.hpp"
+#include "object_slots.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Frames in flight, one copy of the constants each.
+    constexpr uint32_t COPY_COUNT = 3;
+    // Runs shorter than this get stored inline, like UpdateObjectConstants does.
+    constexpr uint32_t MIN_STREAMED_OBJECT_COUNT = 6;
+
+    struct Objects
+    {
+        std::vector<DirectX::XMFLOAT4X4> worlds;
+        // Where each copy's constants go, upload memory in the engine.
+        std::vector<std::vector<ObjectConstants>> copies;
+
+        explicit Objects(uint32_t count) : worlds(count), copies(COPY_COUNT, std::vector<ObjectConstants>(count))
+        {
+            for (DirectX::XMFLOAT4X4& world : worlds)
+                DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixIdentity());
+        }
+
+        void Write(uint32_t copy, uint32_t firstSlot, uint32_t count)
+        {
+            ObjectConstants* objects{ copies[copy].data() };
+            if (count < MIN_STREAMED_OBJECT_COUNT)
+            {
+                for (uint32_t slot = firstSlot; slot < firstSlot + count; ++slot)
+                    DirectX::XMStoreFloat3x4(&objects[slot].world, DirectX::XMLoadFloat4x4(&worlds[slot]));
+            }
+            else
+            {
+                CopyKernels::StreamTransposed3x4(&objects[firstSlot].world.m[0][0], &worlds[firstSlot].m[0][0], count);
+            }
+        }
+    };
+
+    // Objects that move each frame, picked at random but the same ones every frame, like
+    // the characters of a level among its static props.
+    std::vector<uint32_t> Moving(uint32_t objectCount, uint32_t percent)
+    {
+        std::mt19937 random{ objectCount };
+        std::vector<uint32_t> moving;
+        for (uint32_t slot = 0; slot < objectCount; ++slot)
+        {
+            if (random() % 100 < percent)
+                moving.push_back(slot);
+        }
+        return moving;
+    }
+
+    // range(0) objects with range(1) percent of them moving. Persistent slots only write the
+    // moved ones, once into every copy as its frame comes up. bytesPerFrame is what went
+    // to upload memory.
+    void BM_ObjectConstantsPersistent(benchmark::State& state)
+    {
+        uint32_t objectCount{ static_cast<uint32_t>(state.range(0)) };
+        Objects objects{ objectCount };
+        std::vector<uint32_t> moving{ Moving(objectCount, static_cast<uint32_t>(state.range(1))) };
+        JobSystem jobSystem;
+        ObjectSlots slots{ COPY_COUNT };
+        for (uint32_t i = 0; i < objectCount; ++i)
+            slots.Allocate();
+        for (uint32_t copy = 0; copy < COPY_COUNT; ++copy)
+            slots.Flush(copy, jobSystem, [&](uint32_t firstSlot, uint32_t count) { objects.Write(copy, firstSlot, count); });
+
+        uint64_t written{ 0 };
+        uint32_t frame{ 0 };
+        for (auto _ : state)
+        {
+            for (uint32_t slot : moving)
+            {
+                objects.worlds[slot].m[3][0] += 0.01f;
+                slots.MarkDirty(slot);
+            }
+
+            uint32_t copy{ frame++ % COPY_COUNT };
+            written += slots.Flush(copy, jobSystem, [&](uint32_t firstSlot, uint32_t count) { objects.Write(copy, firstSlot, count); });
+            CopyKernels::Fence();
+        }
+
+        state.counters["bytesPerFrame"] = static_cast<double>(written) * sizeof(ObjectConstants) / state.iterations();
+        state.SetBytesProcessed(written * sizeof(ObjectConstants));
+    }
+
+    // Every object written every frame into that frame's copy, what dynamic per frame
+    // constants cost whether anything moved or not.
+    void BM_ObjectConstantsDynamic(benchmark::State& state)
+    {
+        uint32_t objectCount{ static_cast<uint32_t>(state.range(0)) };
+        Objects objects{ objectCount };
+        std::vector<uint32_t> moving{ Moving(objectCount, static_cast<uint32_t>(state.range(1))) };
+
+        uint32_t frame{ 0 };
+        for (auto _ : state)
+        {
+            for (uint32_t slot : moving)
+                objects.worlds[slot].m[3][0] += 0.01f;
+
+            objects.Write(frame++ % COPY_COUNT, 0, objectCount);
+            CopyKernels::Fence();
+        }
+
+        state.counters["bytesPerFrame"] = static_cast<double>(objectCount) * sizeof(ObjectConstants);
+        state.SetBytesProcessed(state.iterations() * objectCount * sizeof(ObjectConstants));
+    }
+}
+
+BENCHMARK(BM_ObjectConstantsPersistent)->ArgsProduct({ { 10000, 100000 }, { 0, 1, 10, 100 } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ObjectConstantsDynamic)->ArgsProduct({ { 10000, 100000 }, { 0, 1, 10, 100 } })->Unit(benchmark::kMicrosecond);
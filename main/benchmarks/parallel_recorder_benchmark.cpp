@@ -0,0 +1,142 @@
+#include "job_system.hpp"
+#include "parallel_recorder.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t DRAW_COUNT = 20000;
+    constexpr uint32_t MIN_DRAWS_PER_CHUNK = 64;
+
+    // Stands in for a command allocator, the memory recorded commands go into. Reset keeps
+    // the memory for the next recording like ID3D12CommandAllocator::Reset does.
+    struct AllocatorStub
+    {
+        std::vector<uint8_t> commands;
+
+        void Reset() { commands.clear(); }
+    };
+
+    // Stands in for a command list, encodes calls into a growing buffer like a driver does.
+    class RecordingStub
+    {
+    public:
+        void Reset() { _commands.clear(); }
+        // Records into allocator's memory from now on.
+        void Reset(AllocatorStub& allocator) { _allocator = &allocator; }
+
+        template <typename T>
+        void Record(uint32_t opcode, const T& arguments)
+        {
+            std::vector<uint8_t>& commands{ _allocator ? _allocator->commands : _commands };
+            size_t offset{ commands.size() };
+            commands.resize(offset + sizeof(opcode) + sizeof(T));
+            memcpy(commands.data() + offset, &opcode, sizeof(opcode));
+            memcpy(commands.data() + offset + sizeof(opcode), &arguments, sizeof(T));
+        }
+
+        size_t Size() const { return _allocator ? _allocator->commands.size() : _commands.size(); }
+
+    private:
+        std::vector<uint8_t> _commands;
+        AllocatorStub* _allocator{ nullptr };
+    };
+
+    struct DrawArguments
+    {
+        uint64_t vertexBuffer[2];
+        uint64_t indexBuffer;
+        uint32_t constants[8];
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t startIndex;
+        int32_t baseVertex;
+    };
+
+    // Records DRAW_COUNT draws over range(0) workers, calling thread included, chunked the way
+    // Device records the scene.
+    void BM_ParallelRecord(benchmark::State& state)
+    {
+        JobSystem jobSystem{ static_cast<uint32_t>(state.range(0)) };
+        ParallelRecorder recorder{ jobSystem };
+        std::vector<RecordingStub> lists(recorder.WorkerCount());
+
+        std::vector<DrawArguments> draws(DRAW_COUNT);
+        for (uint32_t i = 0; i < DRAW_COUNT; ++i)
+            draws[i] = { { i, i + 1 }, i + 2, { i }, 36, 1 + i % 4, 0, 0 };
+
+        for (auto _ : state)
+        {
+            std::vector<DrawRange> chunks{ ParallelRecorder::Partition(DRAW_COUNT, recorder.WorkerCount(), MIN_DRAWS_PER_CHUNK) };
+            recorder.Run(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk)
+            {
+                RecordingStub& list{ lists[chunk] };
+                list.Reset();
+                for (uint32_t i = chunks[chunk].begin; i < chunks[chunk].end; ++i)
+                    list.Record(1, draws[i]);
+            });
+            benchmark::DoNotOptimize(lists.front().Size());
+        }
+
+        state.SetItemsProcessed(state.iterations() * DRAW_COUNT);
+    }
+
+    // Frames in flight, each with an allocator per chunk like Device's frame resources.
+    constexpr uint32_t FRAME_COUNT = 3;
+
+    // A frame per iteration over range(0) workers. With range(1) set every chunk resets the
+    // allocator it used FRAME_COUNT frames ago and records into its memory again, without
+    // it the chunk gets a fresh allocator each frame. allocatedKB is how much allocator
+    // memory a frame had to grow by.
+    void BM_ParallelRecordFrames(benchmark::State& state)
+    {
+        JobSystem jobSystem{ static_cast<uint32_t>(state.range(0)) };
+        ParallelRecorder recorder{ jobSystem };
+        bool recycle{ state.range(1) != 0 };
+        std::vector<RecordingStub> lists(recorder.WorkerCount());
+        std::vector<std::vector<AllocatorStub>> allocators(FRAME_COUNT, std::vector<AllocatorStub>(recorder.WorkerCount()));
+
+        std::vector<DrawArguments> draws(DRAW_COUNT);
+        for (uint32_t i = 0; i < DRAW_COUNT; ++i)
+            draws[i] = { { i, i + 1 }, i + 2, { i }, 36, 1 + i % 4, 0, 0 };
+
+        std::vector<size_t> grown(recorder.WorkerCount());
+        uint64_t allocated{ 0 };
+        uint64_t frame{ 0 };
+        for (auto _ : state)
+        {
+            std::vector<AllocatorStub>& frameAllocators{ allocators[frame++ % FRAME_COUNT] };
+            std::vector<DrawRange> chunks{ ParallelRecorder::Partition(DRAW_COUNT, recorder.WorkerCount(), MIN_DRAWS_PER_CHUNK) };
+            recorder.Run(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk)
+            {
+                // The GPU is done with this frame's allocators by the time it comes around again.
+                AllocatorStub& allocator{ frameAllocators[chunk] };
+                if (recycle)
+                    allocator.Reset();
+                else
+                    allocator = {};
+                size_t capacity{ allocator.commands.capacity() };
+
+                RecordingStub& list{ lists[chunk] };
+                list.Reset(allocator);
+                for (uint32_t i = chunks[chunk].begin; i < chunks[chunk].end; ++i)
+                    list.Record(1, draws[i]);
+                grown[chunk] = allocator.commands.capacity() - capacity;
+            });
+            benchmark::DoNotOptimize(lists.front().Size());
+
+            for (uint32_t chunk = 0; chunk < chunks.size(); ++chunk)
+                allocated += grown[chunk];
+        }
+
+        state.SetItemsProcessed(state.iterations() * DRAW_COUNT);
+        state.counters["allocatedKB"] = benchmark::Counter(static_cast<double>(allocated) / 1024.0, benchmark::Counter::kAvgIterations);
+    }
+}
+
+// Past the hardware thread count the extra workers only add contention.
+BENCHMARK(BM_ParallelRecord)->DenseRange(1, 8)->UseRealTime();
+BENCHMARK(BM_ParallelRecordFrames)->ArgsProduct({ { 1, 2, 4 }, { 0, 1 } })->UseRealTime();
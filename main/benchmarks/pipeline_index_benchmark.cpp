@@ -0,0 +1,89 @@
+#include "hash.hpp"
+#include "pipeline_index.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    std::vector<uint8_t> RandomBytes(size_t size)
+    {
+        std::mt19937 random{ 1 };
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes)
+            byte = static_cast<uint8_t>(random());
+        return bytes;
+    }
+
+    // Hash::Bytes over range(0) bytes, shader bytecode is a few to a few hundred KB.
+    void BM_HashBytes(benchmark::State& state)
+    {
+        std::vector<uint8_t> bytes{ RandomBytes(static_cast<size_t>(state.range(0))) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(Hash::Bytes(bytes.data(), bytes.size()));
+
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    // The shape of PsoCache::HashDesc: two shaders hashed whole, then about a hundred fields one
+    // at a time. This is the cost of every GetOrCreate, hit or miss.
+    void BM_HashPipelineDesc(benchmark::State& state)
+    {
+        std::vector<uint8_t> vertexShader{ RandomBytes(static_cast<size_t>(state.range(0))) };
+        std::vector<uint8_t> pixelShader{ RandomBytes(static_cast<size_t>(state.range(0)) * 2) };
+        std::vector<uint32_t> fields(100);
+        for (uint32_t i = 0; i < fields.size(); ++i)
+            fields[i] = i * 7;
+
+        for (auto _ : state)
+        {
+            Hasher hasher;
+            hasher.Add(0x1234);
+            hasher.Add(vertexShader.size()).AddBytes(vertexShader.data(), vertexShader.size());
+            hasher.Add(pixelShader.size()).AddBytes(pixelShader.data(), pixelShader.size());
+            for (uint32_t field : fields)
+                hasher.Add(field);
+            hasher.AddString("POSITION").AddString("NORMAL").AddString("TEXCOORD");
+            benchmark::DoNotOptimize(hasher.Value());
+        }
+
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    PipelineIndex MakeIndex(uint32_t pipelineCount)
+    {
+        std::mt19937_64 random{ pipelineCount };
+        PipelineIndex index;
+        for (uint32_t i = 0; i < pipelineCount; ++i)
+            index.pipelines.insert(random());
+        return index;
+    }
+
+    void BM_PipelineIndexSerialize(benchmark::State& state)
+    {
+        PipelineIndex index{ MakeIndex(static_cast<uint32_t>(state.range(0))) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(index.Serialize().data());
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_PipelineIndexDeserialize(benchmark::State& state)
+    {
+        std::vector<uint8_t> data{ MakeIndex(static_cast<uint32_t>(state.range(0))).Serialize() };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(PipelineIndex::Deserialize(data));
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_HashBytes)->RangeMultiplier(8)->Range(64, 1 << 20);
+BENCHMARK(BM_HashPipelineDesc)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK(BM_PipelineIndexSerialize)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_PipelineIndexDeserialize)->Arg(100)->Arg(1000)->Arg(10000);
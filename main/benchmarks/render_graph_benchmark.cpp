@@ -0,0 +1,76 @@
+#include "render_graph.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+    constexpr uint32_t RENDER_TARGET = 0x4;
+    constexpr uint32_t UNORDERED_ACCESS = 0x8;
+    constexpr uint32_t PIXEL_SHADER_RESOURCE = 0x80;
+    constexpr uint32_t NON_PIXEL_SHADER_RESOURCE = 0x40;
+    constexpr uint32_t PRESENT = 0;
+
+    // passCount passes over passCount / 4 transient targets, each pass reading two earlier
+    // targets and writing one, the last ones composing into the back buffer. Some of them
+    // end up culled, a few record onto their own command lists.
+    void BuildGraph(RenderGraph& graph, uint32_t passCount)
+    {
+        std::mt19937 random{ passCount };
+        graph.Reset();
+
+        uint32_t targetCount{ std::max(2u, passCount / 4) };
+        for (uint32_t i = 0; i < targetCount; ++i)
+            graph.ImportResource("Target", RENDER_TARGET, RENDER_TARGET, false);
+        RenderGraph::ResourceId backBuffer{ graph.ImportResource("Back buffer", PRESENT, PRESENT) };
+
+        for (uint32_t i = 0; i < passCount; ++i)
+        {
+            RenderGraph::PassId pass{ graph.AddPass("Pass", i % 32 == 31 ? RenderGraph::PASS_OWN_COMMAND_LISTS : RenderGraph::PASS_NONE) };
+            for (uint32_t r = 0; r < 2; ++r)
+                graph.Read(pass, static_cast<RenderGraph::ResourceId>(random() % targetCount), r == 0 ? PIXEL_SHADER_RESOURCE : NON_PIXEL_SHADER_RESOURCE);
+
+            if (i + 8 >= passCount)
+                graph.Write(pass, backBuffer, RENDER_TARGET);
+            else
+                graph.Write(pass, i % targetCount, random() % 2 ? RENDER_TARGET : UNORDERED_ACCESS);
+        }
+    }
+
+    // Compile alone, the graph stays the same between iterations.
+    void BM_RenderGraphCompile(benchmark::State& state)
+    {
+        RenderGraph graph;
+        BuildGraph(graph, static_cast<uint32_t>(state.range(0)));
+
+        size_t barrierCount{ 0 };
+        for (auto _ : state)
+        {
+            const RenderGraph::Compiled& compiled{ graph.Compile() };
+            barrierCount = compiled.barriers.size();
+            benchmark::DoNotOptimize(compiled.barriers.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.counters["barriers"] = static_cast<double>(barrierCount);
+    }
+
+    // What a frame pays, declaring the passes again and compiling them.
+    void BM_RenderGraphBuildAndCompile(benchmark::State& state)
+    {
+        RenderGraph graph;
+
+        for (auto _ : state)
+        {
+            BuildGraph(graph, static_cast<uint32_t>(state.range(0)));
+            benchmark::DoNotOptimize(graph.Compile().barriers.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_RenderGraphCompile)->Arg(16)->Arg(128)->Arg(512)->Arg(1024);
+BENCHMARK(BM_RenderGraphBuildAndCompile)->Arg(16)->Arg(128)->Arg(512)->Arg(1024);
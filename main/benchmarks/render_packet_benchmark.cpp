@@ -0,0 +1,116 @@
+#include "job_system.hpp"
+#include "render_packet.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // What the scene emits: opaque packets over a few pipelines, a few hundred materials
+    // and a few thousand meshes, each at some LOD and a random depth.
+    std::vector<RenderPacket> ScenePackets(uint32_t count)
+    {
+        std::mt19937 random{ count };
+        std::uniform_real_distribution<float> depth{ 0.5f, 500.0f };
+        std::vector<RenderPacket> packets(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t mesh{ static_cast<uint32_t>(random() % 4000) };
+            packets[i] = { SortKey::Opaque(PACKET_PASS_SCENE, mesh % 8, mesh % 300, mesh, static_cast<uint32_t>(random() % 4), depth(random)), i, i };
+        }
+        return packets;
+    }
+
+    // range(0) packets emitted from parallel jobs, the way BuildInstanceBatches does, then
+    // stitched together. Sorting them is measured on its own below.
+    void BM_RenderPacketEmit(benchmark::State& state)
+    {
+        uint32_t count{ static_cast<uint32_t>(state.range(0)) };
+        std::vector<RenderPacket> scene{ ScenePackets(count) };
+        JobSystem jobSystem;
+
+        constexpr uint32_t CHUNK_SIZE = 4096;
+        uint32_t chunkCount{ (count + CHUNK_SIZE - 1) / CHUNK_SIZE };
+        RenderPacketStream stream;
+        for (auto _ : state)
+        {
+            stream.Reset(chunkCount);
+            jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+            {
+                uint32_t end{ std::min(count, (chunk + 1) * CHUNK_SIZE) };
+                for (uint32_t i = chunk * CHUNK_SIZE; i < end; ++i)
+                    stream.Emit(chunk, scene[i]);
+            });
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+
+    // range(0) packets sorted by the radix sort.
+    void BM_SortRenderPackets(benchmark::State& state)
+    {
+        std::vector<RenderPacket> scene{ ScenePackets(static_cast<uint32_t>(state.range(0))) };
+        JobSystem jobSystem;
+
+        std::vector<RenderPacket> packets;
+        std::vector<RenderPacket> scratch;
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            packets = scene;
+            state.ResumeTiming();
+
+            SortRenderPackets(packets, scratch, jobSystem);
+            benchmark::DoNotOptimize(packets.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // The same packets through std::sort, single threaded and not stable.
+    void BM_StdSortPackets(benchmark::State& state)
+    {
+        std::vector<RenderPacket> scene{ ScenePackets(static_cast<uint32_t>(state.range(0))) };
+
+        std::vector<RenderPacket> packets;
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            packets = scene;
+            state.ResumeTiming();
+
+            std::sort(packets.begin(), packets.end(), [](const RenderPacket& a, const RenderPacket& b) { return a.key < b.key; });
+            benchmark::DoNotOptimize(packets.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // And through std::stable_sort, which gives the same order as the radix sort.
+    void BM_StdStableSortPackets(benchmark::State& state)
+    {
+        std::vector<RenderPacket> scene{ ScenePackets(static_cast<uint32_t>(state.range(0))) };
+
+        std::vector<RenderPacket> packets;
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            packets = scene;
+            state.ResumeTiming();
+
+            std::stable_sort(packets.begin(), packets.end(), [](const RenderPacket& a, const RenderPacket& b) { return a.key < b.key; });
+            benchmark::DoNotOptimize(packets.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_RenderPacketEmit)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SortRenderPackets)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StdSortPackets)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StdStableSortPackets)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,50 @@
+#include "ring_allocator.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t RING_SIZE = 16 * 1024 * 1024;
+    constexpr uint64_t FRAMES_IN_FLIGHT = 3;
+
+    // range(0) allocations per frame, retired FRAMES_IN_FLIGHT frames later. Sizes are mixed
+    // like a frame's constants and vertex data, so the ring wraps every few frames.
+    void BM_RingAllocatorFrames(benchmark::State& state)
+    {
+        uint32_t allocationsPerFrame{ static_cast<uint32_t>(state.range(0)) };
+
+        std::mt19937 random{ 1 };
+        std::vector<std::pair<uint64_t, uint64_t>> requests(allocationsPerFrame);
+        for (auto& [size, alignment] : requests)
+        {
+            bool constants{ random() % 4 != 0 };
+            size = constants ? 256 * (1 + random() % 4) : 16 + random() % 16384;
+            alignment = constants ? 256 : 16;
+        }
+
+        RingAllocator ring{ RING_SIZE };
+        uint64_t fence{ 0 };
+        uint64_t failed{ 0 };
+        for (auto _ : state)
+        {
+            for (auto [size, alignment] : requests)
+            {
+                uint64_t offset{ ring.Allocate(size, alignment) };
+                failed += offset == RingAllocator::INVALID_OFFSET;
+                benchmark::DoNotOptimize(offset);
+            }
+
+            ring.FinishFrame(++fence);
+            if (fence > FRAMES_IN_FLIGHT)
+                ring.Retire(fence - FRAMES_IN_FLIGHT);
+        }
+
+        state.SetItemsProcessed(state.iterations() * allocationsPerFrame);
+        state.counters["failed"] = static_cast<double>(failed);
+    }
+}
+
+BENCHMARK(BM_RingAllocatorFrames)->Arg(64)->Arg(256)->Arg(1024);
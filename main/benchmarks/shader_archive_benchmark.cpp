@@ -0,0 +1,122 @@
+#include "binary_io.hpp"
+#include "shader_archive.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr size_t BLOB_SIZE = 4096;
+
+    // entryCount blobs of typical bytecode size under random keys.
+    struct Blobs
+    {
+        explicit Blobs(uint32_t entryCount)
+        {
+            std::mt19937_64 random{ entryCount };
+            bytes.resize(entryCount * BLOB_SIZE);
+            for (uint8_t& byte : bytes)
+                byte = static_cast<uint8_t>(random());
+
+            for (uint32_t i = 0; i < entryCount; ++i)
+            {
+                keys.push_back(random());
+                entries.push_back({ keys.back(), { bytes.data() + i * BLOB_SIZE, BLOB_SIZE } });
+            }
+        }
+
+        std::vector<uint8_t> bytes;
+        std::vector<uint64_t> keys;
+        std::vector<ShaderArchive::Entry> entries;
+    };
+
+    // Written once per entry count and mapped like the cache does at startup.
+    std::filesystem::path WriteArchive(const Blobs& blobs)
+    {
+        std::filesystem::path path{ std::filesystem::temp_directory_path() / ("shader_archive_benchmark_" + std::to_string(blobs.keys.size()) + ".bin") };
+        WriteWholeFile(path, ShaderArchive::Build(blobs.entries));
+        return path;
+    }
+
+    void BM_ShaderArchiveBuild(benchmark::State& state)
+    {
+        Blobs blobs{ static_cast<uint32_t>(state.range(0)) };
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(ShaderArchive::Build(blobs.entries).data());
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * state.range(0) * BLOB_SIZE);
+    }
+
+    // Mapping and validating the entry table, paid once per run.
+    void BM_ShaderArchiveOpen(benchmark::State& state)
+    {
+        Blobs blobs{ static_cast<uint32_t>(state.range(0)) };
+        std::filesystem::path path{ WriteArchive(blobs) };
+
+        ShaderArchive archive;
+        for (auto _ : state)
+        {
+            if (!archive.Open(path))
+                state.SkipWithError("Couldn't open the archive.");
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        std::filesystem::remove(path);
+    }
+
+    // Half hits in random order, half misses.
+    void BM_ShaderArchiveFind(benchmark::State& state)
+    {
+        Blobs blobs{ static_cast<uint32_t>(state.range(0)) };
+        std::filesystem::path path{ WriteArchive(blobs) };
+        ShaderArchive archive;
+        archive.Open(path);
+
+        std::mt19937_64 random{ 7 };
+        std::vector<uint64_t> queries;
+        for (uint32_t i = 0; i < 4096; ++i)
+            queries.push_back(i % 2 ? blobs.keys[random() % blobs.keys.size()] : random());
+
+        size_t next{ 0 };
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(archive.Find(queries[next]).data());
+            next = (next + 1) % queries.size();
+        }
+
+        state.SetItemsProcessed(state.iterations());
+        archive.Close();
+        std::filesystem::remove(path);
+    }
+
+    // Keying a shader hashes its whole preprocessed source, range(0) bytes of it.
+    void BM_ShaderArchiveKey(benchmark::State& state)
+    {
+        std::string source;
+        while (source.size() < static_cast<size_t>(state.range(0)))
+            source += "float4 PS(VertexOut pin) : SV_Target { return gDiffuseMap.Sample(gsamLinear, pin.TexC) * gDiffuseAlbedo; }\n";
+        source.resize(static_cast<size_t>(state.range(0)));
+
+        std::pair<std::string_view, std::string_view> defines[] = { { "ALPHA_TEST", "1" }, { "NUM_LIGHTS", "3" } };
+        ShaderKeyDesc desc;
+        desc.preprocessedSource = source;
+        desc.defines = defines;
+        desc.entryPoint = "PS";
+        desc.target = "ps_5_0";
+
+        for (auto _ : state)
+            benchmark::DoNotOptimize(ShaderArchive::Key(desc));
+
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_ShaderArchiveBuild)->Arg(64)->Arg(1024)->Arg(8192);
+BENCHMARK(BM_ShaderArchiveOpen)->Arg(64)->Arg(1024)->Arg(8192);
+BENCHMARK(BM_ShaderArchiveFind)->Arg(64)->Arg(1024)->Arg(8192);
+BENCHMARK(BM_ShaderArchiveKey)->Arg(4 << 10)->Arg(64 << 10)->Arg(512 << 10);
@@ -0,0 +1,69 @@
+#include "tlsf_allocator.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t HEAP_SIZE = 256 * 1024 * 1024;
+
+    struct Request
+    {
+        uint64_t size;
+        uint64_t alignment;
+    };
+
+    // Buffers and textures, mostly small, 64KB placement alignment for a quarter of them.
+    std::vector<Request> MakeRequests(size_t count, uint32_t seed)
+    {
+        std::mt19937 random{ seed };
+        std::vector<Request> requests(count);
+        for (Request& request : requests)
+        {
+            bool texture{ random() % 4 == 0 };
+            request.size = texture ? 65536 * (1 + random() % 64) : 256 + random() % 65536;
+            request.alignment = texture ? 65536 : 256;
+        }
+        return requests;
+    }
+
+    // One allocation and one free of a random live block per iteration, with range(0) blocks
+    // live at a time.
+    void BM_TlsfChurn(benchmark::State& state)
+    {
+        size_t liveCount{ static_cast<size_t>(state.range(0)) };
+        std::vector<Request> requests{ MakeRequests(4096, 1) };
+        std::mt19937 random{ 2 };
+
+        TlsfAllocator allocator{ HEAP_SIZE };
+        std::vector<TlsfAllocator::Allocation> live;
+        size_t next{ 0 };
+        while (live.size() < liveCount)
+        {
+            const Request& request{ requests[next++ % requests.size()] };
+            live.push_back(allocator.Allocate(request.size, request.alignment));
+        }
+
+        uint64_t failed{ 0 };
+        for (auto _ : state)
+        {
+            size_t index{ random() % live.size() };
+            if (live[index])
+                allocator.Free(live[index]);
+
+            const Request& request{ requests[next++ % requests.size()] };
+            live[index] = allocator.Allocate(request.size, request.alignment);
+            failed += !live[index];
+        }
+
+        // How much of the free space is unusable for one big allocation after all the churn.
+        state.counters["fragmentation"] = 1.0 - static_cast<double>(allocator.LargestFreeBlock()) / static_cast<double>(allocator.FreeSize());
+        state.counters["free_blocks"] = allocator.FreeBlockCount();
+        state.counters["failed"] = static_cast<double>(failed);
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+}
+
+BENCHMARK(BM_TlsfChurn)->Arg(64)->Arg(128)->Arg(256);
@@ -0,0 +1,89 @@
+#include "job_system.hpp"
+#include "transform_system.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t NODE_COUNT = 100000;
+    constexpr uint32_t ROOT_COUNT = 1000;
+
+    // NODE_COUNT nodes under ROOT_COUNT roots, every other node parented to a random earlier
+    // one. That comes to about twenty levels, wide at the top and thinning out below.
+    std::vector<entt::entity> Hierarchy(entt::registry& registry)
+    {
+        std::mt19937 random{ 5 };
+        std::uniform_real_distribution<float> offset{ -1.0f, 1.0f };
+        std::vector<entt::entity> entities(NODE_COUNT);
+        for (uint32_t i = 0; i < NODE_COUNT; ++i)
+        {
+            entities[i] = registry.create();
+            registry.emplace<LocalTransform>(entities[i], LocalTransform{ { offset(random), offset(random), offset(random) } });
+            if (i >= ROOT_COUNT)
+                registry.emplace<Parent>(entities[i], entities[random() % i]);
+        }
+        return entities;
+    }
+
+    // range(0) tenths of a percent of the nodes move each frame, picked at random. A moved
+    // node takes its whole subtree with it, items are the nodes that got a new world matrix
+    // and recomputed their share. The patches are part of the frame's cost.
+    void BM_TransformUpdate(benchmark::State& state)
+    {
+        entt::registry registry;
+        std::vector<entt::entity> entities{ Hierarchy(registry) };
+        TransformSystem transforms{ registry };
+        JobSystem jobSystem;
+        transforms.Update(jobSystem);
+
+        std::mt19937 random{ 11 };
+        std::shuffle(entities.begin(), entities.end(), random);
+        uint32_t moving{ static_cast<uint32_t>(NODE_COUNT * state.range(0) / 1000) };
+
+        uint64_t recomputed{ 0 };
+        uint32_t next{ 0 };
+        float step{ 0.0f };
+        for (auto _ : state)
+        {
+            step += 0.01f;
+            for (uint32_t i = 0; i < moving; ++i)
+            {
+                registry.patch<LocalTransform>(entities[next], [&](LocalTransform& local) { local.position.y = step; });
+                next = (next + 1) % NODE_COUNT;
+            }
+            transforms.Update(jobSystem);
+            recomputed += transforms.Updated().size();
+        }
+
+        state.counters["levels"] = transforms.LevelCount();
+        state.counters["recomputed"] = static_cast<double>(recomputed) / (state.iterations() * NODE_COUNT);
+        state.SetItemsProcessed(recomputed);
+    }
+
+    // A reparent re-sorts the whole hierarchy and recomputes every node.
+    void BM_TransformReparent(benchmark::State& state)
+    {
+        entt::registry registry;
+        std::vector<entt::entity> entities{ Hierarchy(registry) };
+        TransformSystem transforms{ registry };
+        JobSystem jobSystem;
+        transforms.Update(jobSystem);
+
+        uint32_t frame{ 0 };
+        for (auto _ : state)
+        {
+            entt::entity child{ entities[NODE_COUNT - 1] };
+            registry.replace<Parent>(child, entities[frame++ % ROOT_COUNT]);
+            transforms.Update(jobSystem);
+        }
+
+        state.SetItemsProcessed(state.iterations() * NODE_COUNT);
+    }
+}
+
+BENCHMARK(BM_TransformUpdate)->Arg(0)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TransformReparent)->Unit(benchmark::kMillisecond);
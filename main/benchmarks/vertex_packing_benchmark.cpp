@@ -0,0 +1,175 @@
+#include "job_system.hpp"
+#include "vertex_packing.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // count random vertices with unit normals and tangents, in one submesh that uses them all.
+    MeshData RandomMesh(uint32_t count)
+    {
+        std::mt19937 random{ count };
+        std::uniform_real_distribution<float> coordinate{ -50.0f, 50.0f };
+        std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+        std::normal_distribution<float> direction;
+
+        MeshData mesh;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            mesh.vertices.push_back({ { coordinate(random), coordinate(random), coordinate(random) }, { unit(random), unit(random) }, { unit(random), unit(random) } });
+
+            MeshExtraVertex extra{ { unit(random), unit(random), unit(random), 1.0f } };
+            for (float* vector : { extra.tangent, extra.normal })
+            {
+                float v[3]{ direction(random), direction(random), direction(random) };
+                float length{ std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) };
+                for (int axis = 0; axis < 3; ++axis)
+                    vector[axis] = v[axis] / length;
+            }
+            mesh.extraVertices.push_back(extra);
+            mesh.indices.push_back(i);
+        }
+
+        CookedSubmesh submesh;
+        submesh.indexCount = count;
+        mesh.submeshes.push_back(submesh);
+        return mesh;
+    }
+
+    constexpr float OFFSET[3]{ -50.0f, -50.0f, -50.0f };
+    constexpr float SCALE[3]{ 100.0f, 100.0f, 100.0f };
+    // Quantized position and half UVs, the packed main stream.
+    constexpr uint32_t STRIDE = 16;
+
+    // range(0) vertices through all of Pack with the format in range(1), the way the cooker
+    // packs a mesh: fitting the boxes, both streams, in parallel.
+    void BM_VertexPackingPack(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        uint32_t format{ static_cast<uint32_t>(state.range(1)) };
+        JobSystem jobSystem;
+
+        size_t packedSize{ 0 };
+        for (auto _ : state)
+        {
+            PackedVertexStreams packed{ VertexPacking::Pack(mesh, format, jobSystem) };
+            packedSize = packed.vertices.size() + packed.extraVertices.size();
+            benchmark::DoNotOptimize(packed.vertices.data());
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.counters["bytesPerVertex"] = static_cast<double>(packedSize) / static_cast<double>(state.range(0));
+    }
+
+    // The batch kernels against the scalar conversions they fall back to, on range(0)
+    // vertices, single threaded.
+    void BM_PackPositions(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        std::vector<uint8_t> out(mesh.vertices.size() * STRIDE);
+        for (auto _ : state)
+        {
+            VertexPacking::PackPositions(mesh.vertices, OFFSET, SCALE, out.data(), STRIDE);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_PackPositionsScalar(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        std::vector<uint8_t> out(mesh.vertices.size() * STRIDE);
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < mesh.vertices.size(); ++i)
+            {
+                uint16_t quantized[4]{};
+                for (int axis = 0; axis < 3; ++axis)
+                    quantized[axis] = VertexPacking::QuantizeUnorm16(mesh.vertices[i].position[axis], OFFSET[axis], SCALE[axis]);
+                memcpy(out.data() + i * STRIDE, quantized, sizeof(quantized));
+            }
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_PackTexCoords(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        std::vector<uint8_t> out(mesh.vertices.size() * STRIDE);
+        for (auto _ : state)
+        {
+            VertexPacking::PackTexCoords(mesh.vertices, out.data() + 8, STRIDE);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_PackTexCoordsScalar(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        std::vector<uint8_t> out(mesh.vertices.size() * STRIDE);
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < mesh.vertices.size(); ++i)
+            {
+                const MeshVertex& vertex{ mesh.vertices[i] };
+                uint16_t halves[4]{ VertexPacking::FloatToHalf(vertex.tex0[0]), VertexPacking::FloatToHalf(vertex.tex0[1]),
+                                    VertexPacking::FloatToHalf(vertex.tex1[0]), VertexPacking::FloatToHalf(vertex.tex1[1]) };
+                memcpy(out.data() + i * STRIDE + 8, halves, sizeof(halves));
+            }
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_PackExtraVertices(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        std::vector<PackedExtraVertex> out(mesh.extraVertices.size());
+        for (auto _ : state)
+        {
+            VertexPacking::PackExtraVertices(mesh.extraVertices, out.data());
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_PackExtraVerticesScalar(benchmark::State& state)
+    {
+        MeshData mesh{ RandomMesh(static_cast<uint32_t>(state.range(0))) };
+        std::vector<PackedExtraVertex> out(mesh.extraVertices.size());
+        for (auto _ : state)
+        {
+            for (size_t i = 0; i < mesh.extraVertices.size(); ++i)
+            {
+                const MeshExtraVertex& extra{ mesh.extraVertices[i] };
+                for (int channel = 0; channel < 4; ++channel)
+                    out[i].color[channel] = VertexPacking::QuantizeUnorm8(extra.color[channel]);
+                VertexPacking::OctEncode(extra.tangent, out[i].tangent);
+                VertexPacking::OctEncode(extra.normal, out[i].normal);
+            }
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_VertexPackingPack)->ArgsProduct({ { 10000, 1000000 }, { VERTEX_FORMAT_FULL, VERTEX_FORMAT_PACKED_ATTRIBUTES, VERTEX_FORMAT_ALL } })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackPositions)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackPositionsScalar)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackTexCoords)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackTexCoordsScalar)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackExtraVertices)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PackExtraVerticesScalar)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
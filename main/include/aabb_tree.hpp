@@ -0,0 +1,210 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "frustum_culler.hpp"
+
+class JobSystem;
+
+struct Aabb
+{
+    float min[3];
+    float max[3];
+
+    bool Contains(const Aabb& other) const
+    {
+        return min[0] <= other.min[0] && min[1] <= other.min[1] && min[2] <= other.min[2] &&
+            max[0] >= other.max[0] && max[1] >= other.max[1] && max[2] >= other.max[2];
+    }
+
+    bool Overlaps(const Aabb& other) const
+    {
+        return min[0] <= other.max[0] && min[1] <= other.max[1] && min[2] <= other.max[2] &&
+            max[0] >= other.min[0] && max[1] >= other.min[1] && max[2] >= other.min[2];
+    }
+
+    float SurfaceArea() const
+    {
+        float x{ max[0] - min[0] };
+        float y{ max[1] - min[1] };
+        float z{ max[2] - min[2] };
+        return 2.0f * (x * y + y * z + z * x);
+    }
+
+    static Aabb Union(const Aabb& a, const Aabb& b)
+    {
+        return { { std::min(a.min[0], b.min[0]), std::min(a.min[1], b.min[1]), std::min(a.min[2], b.min[2]) },
+                 { std::max(a.max[0], b.max[0]), std::max(a.max[1], b.max[1]), std::max(a.max[2], b.max[2]) } };
+    }
+
+    static Aabb FromCenterExtents(const float center[3], const float extents[3])
+    {
+        return { { center[0] - extents[0], center[1] - extents[1], center[2] - extents[2] },
+                 { center[0] + extents[0], center[1] + extents[1], center[2] + extents[2] } };
+    }
+};
+
+struct Ray
+{
+    float origin[3];
+    // Needn't be normalized, hit distances are in multiples of it.
+    float direction[3];
+    float maxDistance = std::numeric_limits<float>::max();
+};
+
+struct RayHit
+{
+    static constexpr uint32_t NO_HIT = ~0u;
+
+    uint32_t payload = NO_HIT;
+    float distance = std::numeric_limits<float>::max();
+
+    explicit operator bool() const { return payload != NO_HIT; }
+};
+
+// Results of a batch of queries, query i found payloads[offsets[i], offsets[i + 1]).
+struct QueryResults
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> payloads;
+
+    size_t QueryCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    std::span<const uint32_t> operator[](size_t query) const
+    {
+        return { payloads.data() + offsets[query], payloads.data() + offsets[query + 1] };
+    }
+};
+
+// Dynamic bounding volume tree for scene queries. Leaves hold a tight box for the query
+// tests and a fattened one in the tree, so objects moving a little don't touch the tree at
+// all. Inserts pick their sibling by surface area cost and rotate on the way up to keep the
+// tree balanced. Moves that leave the fat box refit the ancestors in place, which is cheap
+// but wears the tree down over time, RebuildIfDegraded puts it back with a binned SAH build.
+// Leaf ids stay valid across rebuilds.
+class AabbTree
+{
+public:
+    using NodeId = int32_t;
+    static constexpr NodeId NULL_NODE = -1;
+
+    // Absolute margin around every leaf's tight box, in world units.
+    static constexpr float DEFAULT_MARGIN = 0.1f;
+    // Rebuild once the SAH cost has grown by this much since the last build.
+    static constexpr float REBUILD_COST_RATIO = 1.3f;
+
+    explicit AabbTree(float margin = DEFAULT_MARGIN) : _margin(margin) {}
+
+    NodeId Insert(const Aabb& box, uint32_t payload);
+    void Remove(NodeId leaf);
+
+    // Returns false when the fat box still holds box, only the tight box changes then.
+    // Otherwise the leaf gets a new fat box and its ancestors are refit.
+    bool Move(NodeId leaf, const Aabb& box);
+
+    uint32_t Payload(NodeId leaf) const { return _nodes[leaf].payload; }
+    const Aabb& TightBox(NodeId leaf) const { return _tightBoxes[leaf]; }
+    const Aabb& FatBox(NodeId leaf) const { return _nodes[leaf].box; }
+    uint32_t LeafCount() const { return _leafCount; }
+    int32_t Height() const { return _root == NULL_NODE ? 0 : _nodes[_root].height; }
+
+    // Surface area heuristic cost of the tree, the internal nodes' summed area relative to
+    // the root's. Walks every node.
+    float Cost() const;
+
+    // Top down binned SAH build over the current leaves.
+    void Rebuild();
+    // Rebuilds when refits have made the tree REBUILD_COST_RATIO times costlier than right
+    // after the last build. Meant to be called every so often, it walks every node.
+    bool RebuildIfDegraded(float ratio = REBUILD_COST_RATIO);
+
+    // Calls callback(payload) for every leaf whose tight box overlaps or is inside.
+    template <typename Callback>
+    void QueryOverlap(const Aabb& box, Callback&& callback) const
+    {
+        Traverse([&](const Aabb& node) { return node.Overlaps(box); },
+                 [&](NodeId leaf) { if (_tightBoxes[leaf].Overlaps(box)) callback(_nodes[leaf].payload); });
+    }
+
+    template <typename Callback>
+    void QueryFrustum(const Frustum& frustum, Callback&& callback) const
+    {
+        Traverse([&](const Aabb& node) { return IntersectsFrustum(frustum, node); },
+                 [&](NodeId leaf) { if (IntersectsFrustum(frustum, _tightBoxes[leaf])) callback(_nodes[leaf].payload); });
+    }
+
+    // Closest tight box along the ray, a ray starting inside a box hits it at zero.
+    RayHit RayCast(const Ray& ray) const;
+
+    // Batches run their queries in parallel on the job system, each query on one thread.
+    void QueryOverlapBatch(std::span<const Aabb> boxes, QueryResults& results, JobSystem& jobSystem) const;
+    void QueryFrustumBatch(std::span<const Frustum> frustums, QueryResults& results, JobSystem& jobSystem) const;
+    void RayCastBatch(std::span<const Ray> rays, std::span<RayHit> hits, JobSystem& jobSystem) const;
+
+    static bool IntersectsFrustum(const Frustum& frustum, const Aabb& box);
+
+private:
+    struct Node
+    {
+        Aabb box;
+        NodeId parent;
+        NodeId children[2];
+        // Leaves are zero, free nodes -1.
+        int32_t height;
+        uint32_t payload;
+
+        bool IsLeaf() const { return children[0] == NULL_NODE; }
+    };
+
+    // Deep enough for any tree the rotations or the SAH build produce at a few million leaves.
+    static constexpr uint32_t MAX_STACK_DEPTH = 256;
+
+    NodeId AllocateNode();
+    void FreeNode(NodeId node);
+    void InsertLeaf(NodeId leaf);
+    void RemoveLeaf(NodeId leaf);
+    NodeId Balance(NodeId node);
+    void Refit(NodeId node);
+    NodeId Build(std::span<NodeId> leaves, uint32_t depth);
+    Aabb Fatten(const Aabb& box) const;
+
+    template <typename Visit, typename Leaf>
+    void Traverse(Visit&& visit, Leaf&& leaf) const
+    {
+        if (_root == NULL_NODE)
+            return;
+
+        NodeId stack[MAX_STACK_DEPTH];
+        uint32_t size{ 0 };
+        stack[size++] = _root;
+        while (size > 0)
+        {
+            NodeId id{ stack[--size] };
+            const Node& node{ _nodes[id] };
+            if (!visit(node.box))
+                continue;
+
+            if (node.IsLeaf())
+            {
+                leaf(id);
+                continue;
+            }
+
+            assert(size + 2 <= MAX_STACK_DEPTH && "Tree too deep to traverse.");
+            stack[size++] = node.children[0];
+            stack[size++] = node.children[1];
+        }
+    }
+
+    std::vector<Node> _nodes;
+    std::vector<Aabb> _tightBoxes;
+    NodeId _root = NULL_NODE;
+    NodeId _freeList = NULL_NODE;
+    uint32_t _leafCount = 0;
+    float _margin;
+    float _builtCost = 0.0f;
+};
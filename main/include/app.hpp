@@ -7,6 +7,7 @@
 #include <game_timer.hpp>
 
 class Device;
+class JobSystem;
 
 constexpr uint32_t INITIAL_WIDTH = 1920;
 constexpr uint32_t INITIAL_HEIGHT = 1080;
@@ -28,6 +29,7 @@ private:
 	static LRESULT WndProc(HWND hWnd, uint32_t msg, WPARAM wParam, LPARAM lParam);
 
 	HWND _mainWnd = nullptr;
+	std::shared_ptr<JobSystem> _jobSystem;
 	std::unique_ptr<Engine> _engine;
 	std::shared_ptr<Device> _device;
 	GameTimer _timer;
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <vector>
+
+// Little endian serialization for files written by the engine, so they read back the same
+// on any platform.
+class BinaryWriter
+{
+public:
+    void WriteU8(uint8_t value) { _data.push_back(value); }
+    void WriteU16(uint16_t value) { WriteLittleEndian(value, 2); }
+    void WriteU32(uint32_t value) { WriteLittleEndian(value, 4); }
+    void WriteU64(uint64_t value) { WriteLittleEndian(value, 8); }
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes{ static_cast<const uint8_t*>(data) };
+        _data.insert(_data.end(), bytes, bytes + size);
+    }
+
+    // Pads with zeroes up to the next multiple of alignment.
+    void Align(size_t alignment)
+    {
+        _data.resize((_data.size() + alignment - 1) / alignment * alignment, 0);
+    }
+
+    size_t Size() const { return _data.size(); }
+    std::vector<uint8_t>& Data() { return _data; }
+    const std::vector<uint8_t>& Data() const { return _data; }
+
+private:
+    void WriteLittleEndian(uint64_t value, int byteCount)
+    {
+        for (int i = 0; i < byteCount; ++i)
+            _data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+
+    std::vector<uint8_t> _data;
+};
+
+// Reads what BinaryWriter wrote. Every read is bounds checked, once one fails the reader
+// stays failed and returns zeroes.
+class BinaryReader
+{
+public:
+    explicit BinaryReader(std::span<const uint8_t> data) : _data(data) {}
+
+    uint8_t ReadU8() { return static_cast<uint8_t>(ReadLittleEndian(1)); }
+    uint16_t ReadU16() { return static_cast<uint16_t>(ReadLittleEndian(2)); }
+    uint32_t ReadU32() { return static_cast<uint32_t>(ReadLittleEndian(4)); }
+    uint64_t ReadU64() { return ReadLittleEndian(8); }
+
+    bool ReadBytes(void* destination, size_t size)
+    {
+        if (!Require(size))
+            return false;
+
+        memcpy(destination, _data.data() + _offset, size);
+        _offset += size;
+        return true;
+    }
+
+    // A view into the underlying data instead of a copy.
+    std::span<const uint8_t> ReadSpan(size_t size)
+    {
+        if (!Require(size))
+            return {};
+
+        std::span<const uint8_t> span{ _data.subspan(_offset, size) };
+        _offset += size;
+        return span;
+    }
+
+    void Skip(size_t size)
+    {
+        if (Require(size))
+            _offset += size;
+    }
+
+    size_t Offset() const { return _offset; }
+    size_t Remaining() const { return _data.size() - _offset; }
+    bool Failed() const { return _failed; }
+
+private:
+    bool Require(size_t size)
+    {
+        if (_failed || size > _data.size() - _offset)
+        {
+            _failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t ReadLittleEndian(int byteCount)
+    {
+        if (!Require(byteCount))
+            return 0;
+
+        uint64_t value{ 0 };
+        for (int i = 0; i < byteCount; ++i)
+            value |= static_cast<uint64_t>(_data[_offset + i]) << (i * 8);
+        _offset += byteCount;
+        return value;
+    }
+
+    std::span<const uint8_t> _data;
+    size_t _offset = 0;
+    bool _failed = false;
+};
+
+inline std::optional<std::vector<uint8_t>> ReadWholeFile(const std::filesystem::path& path)
+{
+    std::ifstream file{ path, std::ios::binary | std::ios::ate };
+    if (!file)
+        return std::nullopt;
+
+    std::streamsize size{ file.tellg() };
+    if (size < 0)
+        return std::nullopt;
+
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(data.data()), size))
+        return std::nullopt;
+
+    return data;
+}
+
+// Writes next to the target and renames over it, so a crash never leaves a torn file behind.
+inline bool WriteWholeFile(const std::filesystem::path& path, std::span<const uint8_t> data)
+{
+    std::error_code error;
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path(), error);
+
+    std::filesystem::path temporary{ path };
+    temporary += ".tmp";
+
+    {
+        std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+        if (!file || !file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())))
+            return false;
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
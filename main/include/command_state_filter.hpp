@@ -0,0 +1,369 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+struct CommandFilterStats
+{
+    // State calls passed on to the command list and the ones dropped as redundant.
+    uint32_t issued = 0;
+    uint32_t filtered = 0;
+
+    CommandFilterStats& operator+=(const CommandFilterStats& other)
+    {
+        issued += other.issued;
+        filtered += other.filtered;
+        return *this;
+    }
+};
+
+// Records onto a graphics command list and drops state calls that wouldn't change anything.
+// Shadows the pipeline state, root signature, root arguments, descriptor heaps, vertex and
+// index buffers, topology, viewports, scissor rects and render targets. Calls that change part
+// of a range (vertex buffer slots, root constants) only pass on the changed part.
+//
+// Everything starts out unknown, so the first call of each kind always goes through. Anything
+// recorded directly on List() that changes state must be followed by Invalidate.
+//
+// Traits provides:
+//   CommandList, PipelineState, RootSignature, DescriptorHeap
+//   VertexBufferView, IndexBufferView, Viewport, Rect, CpuDescriptorHandle, without padding
+//   since they are compared bytewise
+//   GpuDescriptorHandle with a ptr member, GpuVirtualAddress, PrimitiveTopology
+template <typename Traits>
+class CommandStateFilter
+{
+public:
+    using CommandList = typename Traits::CommandList;
+    using PipelineState = typename Traits::PipelineState;
+    using RootSignature = typename Traits::RootSignature;
+    using DescriptorHeap = typename Traits::DescriptorHeap;
+    using VertexBufferView = typename Traits::VertexBufferView;
+    using IndexBufferView = typename Traits::IndexBufferView;
+    using Viewport = typename Traits::Viewport;
+    using Rect = typename Traits::Rect;
+    using CpuDescriptorHandle = typename Traits::CpuDescriptorHandle;
+    using GpuDescriptorHandle = typename Traits::GpuDescriptorHandle;
+    using GpuVirtualAddress = typename Traits::GpuVirtualAddress;
+    using PrimitiveTopology = typename Traits::PrimitiveTopology;
+
+    static constexpr uint32_t MAX_ROOT_PARAMETERS = 16;
+    // Whole root signature's worth, a single parameter can't take more.
+    static constexpr uint32_t MAX_ROOT_CONSTANTS = 64;
+    static constexpr uint32_t MAX_VERTEX_BUFFERS = 16;
+    static constexpr uint32_t MAX_VIEWPORTS = 16;
+    static constexpr uint32_t MAX_RENDER_TARGETS = 8;
+    static constexpr uint32_t MAX_DESCRIPTOR_HEAPS = 2;
+
+    // pipeline is the state the list was reset with, if any.
+    explicit CommandStateFilter(CommandList* commandList, PipelineState* pipeline = nullptr) :
+        _commandList(commandList)
+    {
+        if (pipeline)
+        {
+            _pipeline = pipeline;
+            _known |= STATE_PIPELINE;
+        }
+    }
+
+    CommandList* List() const { return _commandList; }
+    const CommandFilterStats& Stats() const { return _stats; }
+
+    // Forgets all shadowed state, the next call of every kind goes through.
+    void Invalidate()
+    {
+        _known = 0;
+        _knownVertexBuffers = 0;
+        ForgetRootArguments();
+    }
+
+    void SetPipelineState(PipelineState* pipeline)
+    {
+        if (Redundant(STATE_PIPELINE, _pipeline == pipeline))
+            return;
+        _pipeline = pipeline;
+        _commandList->SetPipelineState(pipeline);
+    }
+
+    // Root arguments only survive setting the root signature that is already bound.
+    void SetGraphicsRootSignature(RootSignature* rootSignature)
+    {
+        if (Redundant(STATE_ROOT_SIGNATURE, _rootSignature == rootSignature))
+            return;
+        _rootSignature = rootSignature;
+        ForgetRootArguments();
+        _commandList->SetGraphicsRootSignature(rootSignature);
+    }
+
+    // Tables point into the bound heaps, new heaps leave whatever was bound undefined.
+    void SetDescriptorHeaps(uint32_t count, DescriptorHeap* const* heaps)
+    {
+        assert(count <= MAX_DESCRIPTOR_HEAPS && "Too many descriptor heaps.");
+        if (Redundant(STATE_DESCRIPTOR_HEAPS, _heapCount == count && std::equal(heaps, heaps + count, _heaps.begin())))
+            return;
+        _heapCount = count;
+        std::copy(heaps, heaps + count, _heaps.begin());
+        ForgetRootArguments();
+        _commandList->SetDescriptorHeaps(count, heaps);
+    }
+
+    void SetGraphicsRoot32BitConstants(uint32_t index, uint32_t count, const void* data, uint32_t offset)
+    {
+        assert(index < MAX_ROOT_PARAMETERS && offset + count <= MAX_ROOT_CONSTANTS && "Root constants out of range.");
+        RootArgument& argument{ _rootArguments[index] };
+        if (argument.kind != ROOT_CONSTANTS)
+        {
+            argument.kind = ROOT_CONSTANTS;
+            argument.knownConstants = 0;
+        }
+
+        // Pass on the range from the first to the last value that changed.
+        const uint32_t* values{ static_cast<const uint32_t*>(data) };
+        uint32_t first{ count };
+        uint32_t last{ 0 };
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t slot{ offset + i };
+            if ((argument.knownConstants >> slot & 1) && _rootConstants[index][slot] == values[i])
+                continue;
+            _rootConstants[index][slot] = values[i];
+            argument.knownConstants |= 1ull << slot;
+            first = std::min(first, i);
+            last = i;
+        }
+
+        if (Redundant(first == count))
+            return;
+        _commandList->SetGraphicsRoot32BitConstants(index, last - first + 1, values + first, offset + first);
+    }
+
+    void SetGraphicsRootConstantBufferView(uint32_t index, GpuVirtualAddress address)
+    {
+        if (SetRootArgument(index, ROOT_CBV, static_cast<uint64_t>(address)))
+            _commandList->SetGraphicsRootConstantBufferView(index, address);
+    }
+
+    void SetGraphicsRootShaderResourceView(uint32_t index, GpuVirtualAddress address)
+    {
+        if (SetRootArgument(index, ROOT_SRV, static_cast<uint64_t>(address)))
+            _commandList->SetGraphicsRootShaderResourceView(index, address);
+    }
+
+    void SetGraphicsRootUnorderedAccessView(uint32_t index, GpuVirtualAddress address)
+    {
+        if (SetRootArgument(index, ROOT_UAV, static_cast<uint64_t>(address)))
+            _commandList->SetGraphicsRootUnorderedAccessView(index, address);
+    }
+
+    void SetGraphicsRootDescriptorTable(uint32_t index, GpuDescriptorHandle table)
+    {
+        if (SetRootArgument(index, ROOT_TABLE, static_cast<uint64_t>(table.ptr)))
+            _commandList->SetGraphicsRootDescriptorTable(index, table);
+    }
+
+    // Null views unbind the slots and always go through.
+    void IASetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferView* views)
+    {
+        assert(startSlot + count <= MAX_VERTEX_BUFFERS && "Vertex buffer slots out of range.");
+        uint32_t slots{ ((1u << count) - 1) << startSlot };
+        if (!views)
+        {
+            _knownVertexBuffers &= ~slots;
+            ++_stats.issued;
+            _commandList->IASetVertexBuffers(startSlot, count, views);
+            return;
+        }
+
+        uint32_t first{ count };
+        uint32_t last{ 0 };
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t slot{ startSlot + i };
+            if ((_knownVertexBuffers >> slot & 1) && Same(&_vertexBuffers[slot], &views[i], 1))
+                continue;
+            _vertexBuffers[slot] = views[i];
+            first = std::min(first, i);
+            last = i;
+        }
+        _knownVertexBuffers |= slots;
+
+        if (Redundant(first == count))
+            return;
+        _commandList->IASetVertexBuffers(startSlot + first, last - first + 1, views + first);
+    }
+
+    void IASetIndexBuffer(const IndexBufferView* view)
+    {
+        if (!view)
+        {
+            _known &= ~STATE_INDEX_BUFFER;
+            ++_stats.issued;
+            _commandList->IASetIndexBuffer(view);
+            return;
+        }
+
+        if (Redundant(STATE_INDEX_BUFFER, Same(&_indexBuffer, view, 1)))
+            return;
+        _indexBuffer = *view;
+        _commandList->IASetIndexBuffer(view);
+    }
+
+    void IASetPrimitiveTopology(PrimitiveTopology topology)
+    {
+        if (Redundant(STATE_TOPOLOGY, _topology == topology))
+            return;
+        _topology = topology;
+        _commandList->IASetPrimitiveTopology(topology);
+    }
+
+    void RSSetViewports(uint32_t count, const Viewport* viewports)
+    {
+        assert(count <= MAX_VIEWPORTS && "Too many viewports.");
+        if (Redundant(STATE_VIEWPORTS, _viewportCount == count && Same(_viewports.data(), viewports, count)))
+            return;
+        _viewportCount = count;
+        std::copy(viewports, viewports + count, _viewports.begin());
+        _commandList->RSSetViewports(count, viewports);
+    }
+
+    void RSSetScissorRects(uint32_t count, const Rect* rects)
+    {
+        assert(count <= MAX_VIEWPORTS && "Too many scissor rects.");
+        if (Redundant(STATE_SCISSORS, _scissorCount == count && Same(_scissors.data(), rects, count)))
+            return;
+        _scissorCount = count;
+        std::copy(rects, rects + count, _scissors.begin());
+        _commandList->RSSetScissorRects(count, rects);
+    }
+
+    // A single handle range is shadowed by its first handle, like the call describes it.
+    void OMSetRenderTargets(uint32_t count, const CpuDescriptorHandle* renderTargets, bool singleHandleRange, const CpuDescriptorHandle* depthStencil)
+    {
+        assert(count <= MAX_RENDER_TARGETS && "Too many render targets.");
+        uint32_t handleCount{ singleHandleRange ? std::min(count, 1u) : count };
+        bool same{ _renderTargetCount == count && _singleHandleRange == singleHandleRange &&
+            Same(_renderTargets.data(), renderTargets, handleCount) &&
+            _hasDepthStencil == (depthStencil != nullptr) && (!depthStencil || Same(&_depthStencil, depthStencil, 1)) };
+        if (Redundant(STATE_RENDER_TARGETS, same))
+            return;
+
+        _renderTargetCount = count;
+        _singleHandleRange = singleHandleRange;
+        std::copy(renderTargets, renderTargets + handleCount, _renderTargets.begin());
+        _hasDepthStencil = depthStencil != nullptr;
+        if (depthStencil)
+            _depthStencil = *depthStencil;
+        _commandList->OMSetRenderTargets(count, renderTargets, singleHandleRange, depthStencil);
+    }
+
+    void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance)
+    {
+        _commandList->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+    }
+
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+    {
+        _commandList->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    }
+
+private:
+    enum State : uint32_t
+    {
+        STATE_PIPELINE = 1 << 0,
+        STATE_ROOT_SIGNATURE = 1 << 1,
+        STATE_DESCRIPTOR_HEAPS = 1 << 2,
+        STATE_INDEX_BUFFER = 1 << 3,
+        STATE_TOPOLOGY = 1 << 4,
+        STATE_VIEWPORTS = 1 << 5,
+        STATE_SCISSORS = 1 << 6,
+        STATE_RENDER_TARGETS = 1 << 7,
+    };
+
+    enum RootArgumentKind : uint32_t
+    {
+        ROOT_UNKNOWN,
+        ROOT_CONSTANTS,
+        ROOT_CBV,
+        ROOT_SRV,
+        ROOT_UAV,
+        ROOT_TABLE,
+    };
+
+    struct RootArgument
+    {
+        RootArgumentKind kind = ROOT_UNKNOWN;
+        // Address or descriptor of the root descriptors and tables.
+        uint64_t value = 0;
+        // Bit per 32-bit value of root constants.
+        uint64_t knownConstants = 0;
+    };
+
+    template <typename T>
+    static bool Same(const T* a, const T* b, uint32_t count)
+    {
+        // Empty ranges can come as null, which memcmp mustn't get even for zero bytes.
+        return count == 0 || std::memcmp(a, b, sizeof(T) * count) == 0;
+    }
+
+    // Counts the call, true if it can be dropped.
+    bool Redundant(bool same)
+    {
+        ++(same ? _stats.filtered : _stats.issued);
+        return same;
+    }
+
+    // Same for state that is unknown until first set, which makes it known.
+    bool Redundant(State state, bool same)
+    {
+        bool redundant{ (_known & state) && same };
+        _known |= state;
+        return Redundant(redundant);
+    }
+
+    // True if the argument changed and the call has to go through.
+    bool SetRootArgument(uint32_t index, RootArgumentKind kind, uint64_t value)
+    {
+        assert(index < MAX_ROOT_PARAMETERS && "Root parameter out of range.");
+        RootArgument& argument{ _rootArguments[index] };
+        if (Redundant(argument.kind == kind && argument.value == value))
+            return false;
+        argument = { kind, value, 0 };
+        return true;
+    }
+
+    void ForgetRootArguments()
+    {
+        _rootArguments.fill({});
+    }
+
+    CommandList* _commandList;
+    CommandFilterStats _stats;
+    uint32_t _known{ 0 };
+
+    PipelineState* _pipeline{ nullptr };
+    RootSignature* _rootSignature{ nullptr };
+    std::array<RootArgument, MAX_ROOT_PARAMETERS> _rootArguments{};
+    std::array<std::array<uint32_t, MAX_ROOT_CONSTANTS>, MAX_ROOT_PARAMETERS> _rootConstants;
+
+    uint32_t _heapCount{ 0 };
+    std::array<DescriptorHeap*, MAX_DESCRIPTOR_HEAPS> _heaps{};
+
+    // Bit per vertex buffer slot.
+    uint32_t _knownVertexBuffers{ 0 };
+    std::array<VertexBufferView, MAX_VERTEX_BUFFERS> _vertexBuffers;
+    IndexBufferView _indexBuffer;
+    PrimitiveTopology _topology{};
+
+    uint32_t _viewportCount{ 0 };
+    std::array<Viewport, MAX_VIEWPORTS> _viewports;
+    uint32_t _scissorCount{ 0 };
+    std::array<Rect, MAX_VIEWPORTS> _scissors;
+
+    uint32_t _renderTargetCount{ 0 };
+    bool _singleHandleRange{ false };
+    std::array<CpuDescriptorHandle, MAX_RENDER_TARGETS> _renderTargets;
+    bool _hasDepthStencil{ false };
+    CpuDescriptorHandle _depthStencil;
+};
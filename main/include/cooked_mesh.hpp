@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memory_mapped_file.hpp"
+#include "meshlet.hpp"
+
+// Coarser levels a submesh can have on top of the full one.
+constexpr uint32_t MAX_SUBMESH_LODS = 4;
+
+struct CookedSubmesh
+{
+    std::string name;
+    uint32_t indexCount = 0;
+    uint32_t startIndexLocation = 0;
+    int32_t baseVertexLocation = 0;
+    float boundsCenter[3] = {};
+    float boundsExtents[3] = {};
+    uint32_t meshletOffset = 0;
+    uint32_t meshletCount = 0;
+    // LODs follow their full submesh in order, over the same vertices. lodError is how far
+    // the level strays from the full one, in mesh units.
+    uint32_t lodLevel = 0;
+    float lodError = 0.0f;
+    // Box the quantized positions are relative to, position = offset + unorm * scale. Only
+    // used with VERTEX_FORMAT_QUANTIZED_POSITIONS.
+    float positionOffset[3] = {};
+    float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+// Everything the cooker writes. The streams are raw bytes in the layout the GPU consumes.
+struct CookedMeshDesc
+{
+    // VertexFormatFlags the streams are packed with.
+    uint32_t vertexFormat = 0;
+    uint32_t vertexStride = 0;
+    uint32_t extraVertexStride = 0;
+    uint32_t indexSize = 2;
+    std::span<const uint8_t> vertices;
+    std::span<const uint8_t> extraVertices;
+    std::span<const uint8_t> indices;
+    std::vector<CookedSubmesh> submeshes;
+
+    // Optional, empty when the mesh has no meshlets built.
+    std::span<const Meshlet> meshlets;
+    std::span<const MeshletBounds> meshletBounds;
+    std::span<const uint32_t> meshletVertices;
+    std::span<const uint8_t> meshletTriangles;
+};
+
+// Mesh ready to upload as is, read through a memory mapping so the streams go from the page
+// cache straight into upload memory.
+//
+// Layout, little endian:
+//   u32 magic, u32 version, u32 vertexFormat, u32 vertexStride, u32 extraVertexStride,
+//   u32 vertexCount, u32 indexSize, u32 indexCount, u32 submeshCount
+//   STREAM_COUNT x { u64 offset, u64 size }, vertices, extra vertices, indices, meshlets,
+//                   meshlet bounds, meshlet vertices, meshlet triangles
+//   submeshCount x { u32 nameOffset, u32 nameLength, u32 indexCount, u32 startIndexLocation,
+//                    i32 baseVertexLocation, f32 center[3], f32 extents[3],
+//                    u32 meshletOffset, u32 meshletCount, u32 lodLevel, f32 lodError,
+//                    f32 positionOffset[3], f32 positionScale[3], u32 reserved }
+//   names, then each stream aligned to STREAM_ALIGNMENT
+class CookedMesh
+{
+public:
+    static constexpr uint32_t MAGIC = 0x4853454D; // "MESH"
+    static constexpr uint32_t VERSION = 4;
+    static constexpr uint32_t STREAM_ALIGNMENT = 16;
+    static constexpr size_t STREAM_COUNT = 7;
+    static constexpr size_t HEADER_SIZE = 36 + STREAM_COUNT * 16;
+    static constexpr size_t SUBMESH_SIZE = 88;
+
+    // Fails on a missing or malformed file, the mesh stays empty then.
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return _file != nullptr; }
+
+    uint32_t VertexFormat() const { return _vertexFormat; }
+    uint32_t VertexStride() const { return _vertexStride; }
+    uint32_t ExtraVertexStride() const { return _extraVertexStride; }
+    uint32_t VertexCount() const { return _vertexCount; }
+    uint32_t IndexSize() const { return _indexSize; }
+    uint32_t IndexCount() const { return _indexCount; }
+
+    // Views into the mapping.
+    std::span<const uint8_t> Vertices() const { return _vertices; }
+    std::span<const uint8_t> ExtraVertices() const { return _extraVertices; }
+    std::span<const uint8_t> Indices() const { return _indices; }
+
+    std::span<const Meshlet> Meshlets() const { return _meshlets; }
+    std::span<const MeshletBounds> MeshletBoundsData() const { return _meshletBounds; }
+    std::span<const uint32_t> MeshletVertices() const { return _meshletVertices; }
+    std::span<const uint8_t> MeshletTriangles() const { return _meshletTriangles; }
+
+    uint32_t SubmeshCount() const { return _submeshCount; }
+    CookedSubmesh SubmeshAt(uint32_t index) const;
+
+    // The streams as views into the mapping, the way the cooker was handed them.
+    CookedMeshDesc Describe() const;
+
+    // Keeps the mapping alive for as long as anything points into it.
+    const std::shared_ptr<MemoryMappedFile>& File() const { return _file; }
+
+    static std::vector<uint8_t> Build(const CookedMeshDesc& desc);
+
+private:
+    std::shared_ptr<MemoryMappedFile> _file;
+    std::span<const uint8_t> _submeshTable;
+    std::span<const uint8_t> _names;
+    std::span<const uint8_t> _vertices;
+    std::span<const uint8_t> _extraVertices;
+    std::span<const uint8_t> _indices;
+    std::span<const Meshlet> _meshlets;
+    std::span<const MeshletBounds> _meshletBounds;
+    std::span<const uint32_t> _meshletVertices;
+    std::span<const uint8_t> _meshletTriangles;
+
+    uint32_t _vertexFormat = 0;
+    uint32_t _vertexStride = 0;
+    uint32_t _extraVertexStride = 0;
+    uint32_t _vertexCount = 0;
+    uint32_t _indexSize = 0;
+    uint32_t _indexCount = 0;
+    uint32_t _submeshCount = 0;
+};
+
+// The offline step, writes desc to path in the cooked format.
+bool CookMesh(const std::filesystem::path& path, const CookedMeshDesc& desc);
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_features.hpp"
+
+// Copies into memory the CPU only ever writes, like mapped upload heaps. That memory is
+// write-combined: reads are uncached and partially written lines go out as several bus
+// transactions. The kernels stream whole 64-byte lines with non-temporal stores and only
+// write the ragged ends with plain stores.
+//
+// Streaming stores need a store fence before the GPU may see them. The copies end with one.
+// The matrix kernels are meant for many small writes in a row and leave it to Fence, once
+// after the last of them on the same thread. Jobs needn't bother, finishing one is a locked
+// instruction, which drains the write-combining buffers the same way.
+//
+// The kernels are picked at runtime from what CpuFeatures::Detected() finds, AVX2, SSE2 or
+// plain C++ otherwise. All of them write the same bytes.
+namespace CopyKernels
+{
+    // What the kernels below use, CpuFeatures::Detected() unless changed. Select can only go
+    // as far as that, it's there to compare kernels against each other.
+    CpuFeatures::Isa Selected();
+    void Select(CpuFeatures::Isa isa);
+
+    void Fence();
+
+    void StreamCopy(void* destination, const void* source, size_t size);
+
+    // Writes count row-major 4x4 matrices transposed, the layout HLSL reads by default.
+    void StreamTransposed4x4(float* destination, const float* source, size_t count);
+    // Writes the first three rows of each transpose, 12 floats per matrix. Affine matrices
+    // lose nothing, each output coordinate is one dot product with (position, 1).
+    void StreamTransposed3x4(float* destination, const float* source, size_t count);
+
+    // Copies count elements of elementSize bytes from sourceStride apart to destinationStride
+    // apart. A packed destination gets gathered and streamed in lines, a strided one gets
+    // each element streamed where it goes.
+    void StridedCopy(void* destination, size_t destinationStride, const void* source, size_t sourceStride, size_t elementSize, size_t count);
+}
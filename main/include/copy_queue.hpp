@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "d3d12.h"
+#include "upload_heap.hpp"
+#include "upload_service.hpp"
+#include "util.hpp"
+#include "fwd.hpp"
+
+struct CopyDestination
+{
+    ID3D12Resource* resource = nullptr;
+    uint64_t offset = 0;
+
+    // Textures copy a single subresource, footprint.Offset is filled in with the staging offset.
+    bool isTexture = false;
+    uint32_t subresource = 0;
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint{};
+};
+
+// Dedicated D3D12 copy queue, the backend of the upload service. Staging pages are plain
+// upload heaps. Destinations have to be in the common state, the copy queue promotes them
+// to COPY_DEST and they decay back once the batch has executed.
+class CopyQueue
+{
+public:
+    using Page = UploadHeap;
+    using Destination = CopyDestination;
+
+    CopyQueue(ID3D12Device* device);
+    ~CopyQueue();
+
+    NON_COPYABLE(CopyQueue);
+    NON_MOVABLE(CopyQueue);
+
+    std::unique_ptr<UploadHeap> CreatePage(uint64_t size);
+    void RecordCopy(const UploadHeap& page, uint64_t offset, const CopyDestination& destination, uint64_t size);
+    uint64_t Execute();
+
+    uint64_t CompletedValue() const { return _fence->GetCompletedValue(); }
+    void Wait(uint64_t fenceValue);
+    // Waits for everything executed so far.
+    void WaitIdle() { Wait(_currentFence); }
+
+    ID3D12Fence* Fence() const { return _fence.Get(); }
+
+private:
+    ID3D12Device* _device;
+
+    ComPtr<ID3D12CommandQueue> _queue;
+    ComPtr<ID3D12GraphicsCommandList> _commandList;
+    ComPtr<ID3D12Fence> _fence;
+    uint64_t _currentFence = 0;
+
+    // Allocators stay alive until the batch recorded with them has completed.
+    std::deque<std::pair<uint64_t, ComPtr<ID3D12CommandAllocator>>> _allocators;
+    ComPtr<ID3D12CommandAllocator> _recordingAllocator;
+};
+
+using GpuUploadService = UploadService<CopyQueue>;
+
+// Lays out every subresource with the footprints the copy needs and enqueues them. Returns
+// the ticket of the last one, which completes no earlier than the others.
+UploadTicket UploadTexture(GpuUploadService& uploadService, ID3D12Device* device, ID3D12Resource* texture, uint32_t firstSubresource, uint32_t subresourceCount, const D3D12_SUBRESOURCE_DATA* data);
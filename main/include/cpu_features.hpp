@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+// What the SIMD kernels can count on. The copy kernels and the frustum culler each build a
+// version per instruction set and pick one at runtime from Detected().
+namespace CpuFeatures
+{
+    // Each one includes the ones before it, so they compare by width.
+    enum class Isa : uint32_t
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+    };
+
+    // Best the CPU and OS support, detected once.
+    Isa Detected();
+}
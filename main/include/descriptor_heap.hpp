@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "d3d12.h"
+#include "index_allocator.hpp"
+#include "ring_allocator.hpp"
+#include "util.hpp"
+#include "fwd.hpp"
+
+struct DescriptorHandle
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu{};
+    D3D12_GPU_DESCRIPTOR_HANDLE gpu{};
+    uint32_t page = 0;
+    uint32_t index = IndexAllocator::INVALID_INDEX;
+
+    explicit operator bool() const { return index != IndexAllocator::INVALID_INDEX; }
+};
+
+// Non shader visible descriptors for RTVs, DSVs and staging CBV/SRV/UAVs. Grows by whole
+// heaps when it runs out, individual descriptors are recycled through a bitmap per heap.
+class CpuDescriptorHeap
+{
+public:
+    CpuDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t descriptorsPerPage = 256);
+
+    NON_COPYABLE(CpuDescriptorHeap);
+    NON_MOVABLE(CpuDescriptorHeap);
+
+    DescriptorHandle Allocate();
+    void Free(DescriptorHandle& handle);
+
+private:
+    struct Page
+    {
+        Page(uint32_t capacity) : indices(capacity) {}
+
+        ComPtr<ID3D12DescriptorHeap> heap;
+        D3D12_CPU_DESCRIPTOR_HANDLE start;
+        IndexAllocator indices;
+    };
+
+    ID3D12Device* _device;
+    D3D12_DESCRIPTOR_HEAP_TYPE _type;
+    uint32_t _descriptorsPerPage;
+    uint32_t _descriptorSize;
+
+    std::vector<std::unique_ptr<Page>> _pages;
+};
+
+// The one shader visible CBV/SRV/UAV heap everything binds. The front holds long lived
+// descriptors (ImGui's font, textures) handed out from a bitmap, the back is a ring that
+// tables are copied into every frame and that is reclaimed once the frame's fence retires.
+class GpuDescriptorHeap
+{
+public:
+    GpuDescriptorHeap(ID3D12Device* device, uint32_t staticCount, uint32_t ringCount);
+
+    NON_COPYABLE(GpuDescriptorHeap);
+    NON_MOVABLE(GpuDescriptorHeap);
+
+    ID3D12DescriptorHeap* Heap() const { return _heap.Get(); }
+
+    // Throws when the static region is full, it's sized up front for everything long lived.
+    DescriptorHandle AllocateStatic();
+    void FreeStatic(DescriptorHandle& handle);
+
+    // Reserves a table in the ring and queues a copy of sources into it. The copies of every
+    // table staged this frame go out in a single CopyDescriptors call in FlushCopies, which
+    // has to happen before the command list referencing them is executed. Returns a null
+    // handle when the ring is full, waiting for OldestFence and retiring makes room.
+    D3D12_GPU_DESCRIPTOR_HANDLE StageTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count);
+    void FlushCopies();
+
+    void FinishFrame(uint64_t fenceValue) { _ring.FinishFrame(fenceValue); }
+    void Retire(uint64_t completedFence) { _ring.Retire(completedFence); }
+    uint64_t OldestFence() const { return _ring.OldestFence(); }
+
+private:
+    ID3D12Device* _device;
+    ComPtr<ID3D12DescriptorHeap> _heap;
+    D3D12_CPU_DESCRIPTOR_HANDLE _cpuStart;
+    D3D12_GPU_DESCRIPTOR_HANDLE _gpuStart;
+    uint32_t _descriptorSize;
+    uint32_t _staticCount;
+
+    IndexAllocator _staticIndices;
+    RingAllocator _ring;
+
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> _pendingDestStarts;
+    std::vector<uint32_t> _pendingDestSizes;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> _pendingSources;
+};
@@ -4,59 +4,190 @@
 #include <dxgi1_4.h>
 #include <cstdint>
 #include <directxmath.h>
+#include <functional>
+#include <map>
 #include <memory>
+#include <span>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include "math_helper.hpp"
-#include "upload_buffer.hpp"
+#include "command_state_filter.hpp"
+#include "copy_queue.hpp"
+#include "descriptor_heap.hpp"
+#include "frame_resource.hpp"
+#include "frame_ring.hpp"
+#include "frustum_culler.hpp"
+#include "gpu_heap_allocator.hpp"
+#include "instance_batcher.hpp"
+#include "job_system.hpp"
+#include "object_slots.hpp"
+#include "parallel_recorder.hpp"
+#include "pso_cache.hpp"
+#include "render_packet.hpp"
+#include "render_graph.hpp"
+#include "shader_cache.hpp"
+#include "shader_hot_reload.hpp"
+#include "upload_heap.hpp"
+#include "upload_ring.hpp"
+#include "vertex_packing.hpp"
 #include "fwd.hpp"
 
 constexpr uint32_t SWAP_CHAIN_BUFFER_COUNT = 2;
+constexpr uint32_t NUM_FRAME_RESOURCES = 3;
+constexpr uint64_t UPLOAD_RING_SIZE = 16 * 1024 * 1024;
+constexpr uint64_t UPLOAD_PAGE_SIZE = 4 * 1024 * 1024;
+constexpr uint32_t STATIC_DESCRIPTOR_COUNT = 1024;
+constexpr uint32_t DESCRIPTOR_RING_SIZE = 16 * 1024;
+constexpr uint32_t MAX_RECORDING_CHUNKS = 8;
+constexpr const wchar_t* CACHE_DIRECTORY = L"cache";
+constexpr uint32_t MIN_DRAWS_PER_CHUNK = 64;
+// Visible draw items per job when emitting render packets.
+constexpr uint32_t PACKET_CHUNK_SIZE = 4096;
+// Smallest object constants heap, grows in powers of two from there.
+constexpr uint64_t MIN_OBJECT_HEAP_SIZE = 64 * 1024;
+// Runs of dirty object slots at least this long go through the streaming copy kernels.
+constexpr uint32_t MIN_STREAMED_OBJECT_COUNT = 6;
+constexpr const wchar_t* SHADER_DIRECTORY = L"assets/shaders";
+// What scene meshes get cooked to, vs.hlsl reads this layout.
+constexpr uint32_t SCENE_VERTEX_FORMAT = VERTEX_FORMAT_PACKED_ATTRIBUTES | VERTEX_FORMAT_QUANTIZED_POSITIONS;
 
 class App;
+class Device;
 
-struct ObjectConstants
+struct D3D12CommandTraits
 {
-    XMFLOAT4X4 worldViewProj = MathHelper::Identity4x4();
+    using CommandList = ID3D12GraphicsCommandList;
+    using PipelineState = ID3D12PipelineState;
+    using RootSignature = ID3D12RootSignature;
+    using DescriptorHeap = ID3D12DescriptorHeap;
+    using VertexBufferView = D3D12_VERTEX_BUFFER_VIEW;
+    using IndexBufferView = D3D12_INDEX_BUFFER_VIEW;
+    using Viewport = D3D12_VIEWPORT;
+    using Rect = D3D12_RECT;
+    using CpuDescriptorHandle = D3D12_CPU_DESCRIPTOR_HANDLE;
+    using GpuDescriptorHandle = D3D12_GPU_DESCRIPTOR_HANDLE;
+    using GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS;
+    using PrimitiveTopology = D3D12_PRIMITIVE_TOPOLOGY;
+};
+
+using D3D12CommandFilter = CommandStateFilter<D3D12CommandTraits>;
+
+// Compiles through the shader cache and builds pipelines straight on the device. Reloaded
+// pipelines skip the pipeline cache, every edit would otherwise end up in the library.
+class DeviceShaderBackend
+{
+public:
+    using Blob = ComPtr<ID3DBlob>;
+    using Pipeline = ComPtr<ID3D12PipelineState>;
+
+    explicit DeviceShaderBackend(Device& device) : _device(device) {}
+
+    Blob Compile(const ShaderProgramDesc& desc);
+    Pipeline Build(uint32_t pipeline, std::span<const Blob> programs);
+
+private:
+    Device& _device;
+};
+
+struct RenderGraphPass
+{
+    // Serial passes record onto the shared list, passes with PASS_OWN_COMMAND_LISTS append
+    // lists of their own instead.
+    std::function<void(ID3D12GraphicsCommandList*)> record;
+    std::function<void(std::vector<ID3D12CommandList*>&)> recordLists;
+};
+
+struct DrawItem
+{
+    const MeshGeometry* geometry = nullptr;
+    SubmeshGeometry submesh;
+    // Shared by every draw item of the same submesh of the same geometry, the sort key groups
+    // draw items by it.
+    uint64_t mesh = 0;
+    uint32_t objectIndex = 0;
+    // Level picked last frame, the selection needs it for hysteresis.
+    uint32_t lod = 0;
+    FrustumCuller::Handle cullHandle = FrustumCuller::INVALID_HANDLE;
 };
 
 class Device
 {
 public:
-    Device(HWND hWnd, uint32_t clientWidth, uint32_t clientHeight);
+    Device(HWND hWnd, uint32_t clientWidth, uint32_t clientHeight, std::shared_ptr<JobSystem> jobSystem);
     ~Device();
 
     void Draw();
-    void SetMVP(XMMATRIX mvp)
+    // An object owns a world matrix, any number of draw items can draw with it.
+    uint32_t CreateObject();
+    uint32_t AddDrawItem(const MeshGeometry* geometry, const SubmeshGeometry& submesh, uint32_t objectIndex);
+    void SetObjectWorld(uint32_t objectIndex, const XMFLOAT4X4& world)
+    {
+        _objectWorlds[objectIndex] = world;
+        _objectSlots.MarkDirty(objectIndex);
+        _objectsMoved = true;
+    }
+    void SetViewProjection(XMMATRIX view, XMMATRIX projection)
     {
-        _mvp = mvp;
-        ObjectConstants constants;
-        XMStoreFloat4x4(&constants.worldViewProj, XMMatrixTranspose(mvp));
-        _uploadBuffer->CopyData(0, constants);
+        _view = view;
+        _projection = projection;
     }
 
+    std::span<const DrawItem> DrawItems() const { return _drawItems; }
+    uint32_t ClientWidth() const { return _clientWidth; }
+    uint32_t ClientHeight() const { return _clientHeight; }
+    // State calls of the last frame's scene pass, and how many of them were redundant.
+    const CommandFilterStats& SceneFilterStats() const { return _sceneFilterStats; }
+    // Runs inside every Draw's ImGui frame, for windows of the caller's. Empty to stop.
+    void SetOverlay(std::function<void()> overlay) { _overlay = std::move(overlay); }
+
 private:
     friend App;
+    friend DeviceShaderBackend;
 
     void EnableDebugLayer();
     void CreateDevice();
+    uint64_t AdapterFingerprint() const;
     void CreateFence();
     void QueryMSAA();
-    void QueryDescriptorSizes();
     void CreateCommandObjects();
+    void CreateUploadRing();
+    void CreateUploadService();
     void CreateSwapChain();
     void CreateDescriptorHeaps();
     void CreateRenderTargetViews();
     void CreateDepthStencilView();
     void SetViewport();
 
-    void BuildConstantBuffers();
+    void BuildFrameResources();
     void BuildRootSignature();
     void BuildShadersAndInputLayout();
     void BuildBoxGeometry();
     void BuildPSO();
+    void CreateShaderHotReload();
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC ScenePipelineDesc(ID3DBlob* vs, ID3DBlob* ps) const;
+
+    void UpdateConstantBuffers(FrameResource& frame);
+    void UpdateObjectConstants(FrameResource& frame);
+    void SelectLods();
+    void CullDrawItems();
+    void BuildInstanceBatches(FrameResource& frame);
+    void BuildRenderGraph(FrameResource& frame);
+    void ExecuteRenderGraph(FrameResource& frame, std::vector<ID3D12CommandList*>& cmdsList);
+    void RecordBarriers(ID3D12GraphicsCommandList* commandList, std::span<const RenderGraph::Barrier> barriers);
+    RenderGraph::ResourceId ImportGraphResource(std::string name, ID3D12Resource* resource, D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState, bool exported);
+    RenderGraph::PassId AddGraphPass(std::string name, uint32_t flags, RenderGraphPass pass);
+    void RecordDraws(D3D12CommandFilter& commands, FrameResource& frame, DrawRange range) const;
 
+    uint64_t Signal();
+    // Stages a table in the shader visible ring, waiting for old frames when it's full.
+    D3D12_GPU_DESCRIPTOR_HANDLE StageDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count);
+    // Same for the upload ring.
+    UploadAllocation AllocateUpload(uint64_t size, uint64_t alignment);
+    void WaitForFence(uint64_t fenceValue);
     void FlushCommandQueue();
+    void WaitForUpload(UploadTicket ticket);
     void OnResize();
 
     ID3D12Resource* CurrentBackBuffer() const;
@@ -67,32 +198,73 @@ private:
 
     ComPtr<IDXGIFactory4> _dxgiFactory;
     ComPtr<ID3D12Device> _device;
+    std::unique_ptr<GpuHeapAllocator> _gpuHeapAllocator;
+    std::unique_ptr<PsoCache> _psoCache;
+    std::unique_ptr<ShaderCache> _shaderCache;
 
-    uint64_t _currentFence;
+    uint64_t _currentFence{ 0 };
     ComPtr<ID3D12Fence1> _fence;
     
     ComPtr<ID3D12CommandQueue> _commandQueue;
     ComPtr<ID3D12CommandAllocator> _commandAllocator;
     ComPtr<ID3D12GraphicsCommandList> _commandList;
+    ComPtr<ID3D12GraphicsCommandList> _postCommandList;
+
+    std::shared_ptr<JobSystem> _jobSystem;
+    std::unique_ptr<ParallelRecorder> _recorder;
+    std::vector<ComPtr<ID3D12GraphicsCommandList>> _workerCommandLists;
+    std::vector<CommandFilterStats> _chunkFilterStats;
+    CommandFilterStats _sceneFilterStats;
+    std::function<void()> _overlay;
     
     ComPtr<IDXGISwapChain1> _swapChain;
     ComPtr<ID3D12Resource> _swapChainBuffer[SWAP_CHAIN_BUFFER_COUNT];
-    ComPtr<ID3D12Resource> _depthStencilBuffer;
-    ComPtr<ID3D12Resource> _offscreenRenderTargets[SWAP_CHAIN_BUFFER_COUNT];
+    GpuAllocation _depthStencilBuffer;
+    GpuAllocation _offscreenRenderTargets[SWAP_CHAIN_BUFFER_COUNT];
 
     ComPtr<ID3D12Resource> _vertexBuffer;
     ComPtr<ID3D12Resource> _indexBuffer;
 
-    ComPtr<ID3D12DescriptorHeap> _rtvHeap;
-    ComPtr<ID3D12DescriptorHeap> _rtvMsaaHeap;
-    ComPtr<ID3D12DescriptorHeap> _dsvHeap;
-    ComPtr<ID3D12DescriptorHeap> _srvHeap;
-    ComPtr<ID3D12DescriptorHeap> _cbvHeap;
+    std::unique_ptr<CpuDescriptorHeap> _rtvHeap;
+    std::unique_ptr<CpuDescriptorHeap> _dsvHeap;
+    std::unique_ptr<CpuDescriptorHeap> _stagingHeap;
+    std::unique_ptr<GpuDescriptorHeap> _shaderVisibleHeap;
+
+    DescriptorHandle _backBufferRtvs[SWAP_CHAIN_BUFFER_COUNT];
+    DescriptorHandle _msaaRtvs[SWAP_CHAIN_BUFFER_COUNT];
+    DescriptorHandle _dsv;
+    DescriptorHandle _imguiFontSrv;
+
+    std::unique_ptr<UploadHeap> _uploadHeap;
+    std::unique_ptr<UploadRing<UploadHeap>> _uploadRing;
 
-    const uint32_t _numElements{1};
-    std::unique_ptr<UploadBuffer<ObjectConstants>> _uploadBuffer;
+    std::unique_ptr<CopyQueue> _copyQueue;
+    std::unique_ptr<GpuUploadService> _uploadService;
+    uint64_t _copyFenceWaited{ 0 };
+
+    // Indexed by object slot, the frame resources each keep a copy of them as ObjectConstants.
+    ObjectSlots _objectSlots{ NUM_FRAME_RESOURCES };
+    std::vector<XMFLOAT4X4> _objectWorlds;
+    // Culling boxes are stale until the next CullDrawItems.
+    bool _objectsMoved{ false };
+    std::unique_ptr<FrameRing<FrameResource>> _frameResources;
     ComPtr<ID3D12RootSignature> _rootSignature;
+    uint64_t _rootSignatureHash{ 0 };
     std::unique_ptr<MeshGeometry> _boxGeo;
+    std::vector<DrawItem> _drawItems;
+    // Boxes of the draw items, culling leaves the indices of the visible ones.
+    FrustumCuller _culler;
+    std::vector<uint32_t> _visibleDrawItems;
+    // Geometry, first index and base vertex of every submesh drawn so far.
+    std::map<std::tuple<const MeshGeometry*, uint32_t, int32_t>, uint64_t> _meshes;
+    // Visible draw items as packets, sorted into the order the scene pass draws them.
+    RenderPacketStream _packets;
+    InstanceBatcher _instanceBatcher;
+
+    RenderGraph _renderGraph;
+    std::vector<ID3D12Resource*> _graphResources;
+    std::vector<RenderGraphPass> _graphPasses;
+    std::vector<D3D12_RESOURCE_BARRIER> _barrierScratch;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> _inputLayout;
     ComPtr<ID3DBlob> _vsByte;
@@ -100,13 +272,14 @@ private:
 
     ComPtr<ID3D12PipelineState> _pso;
 
+    std::unique_ptr<DeviceShaderBackend> _shaderBackend;
+    std::unique_ptr<ShaderHotReload<DeviceShaderBackend>> _shaderHotReload;
+    ShaderHotReload<DeviceShaderBackend>::PipelineId _scenePipeline{ 0 };
+
     HWND _hWnd;
     uint32_t _clientWidth;
     uint32_t _clientHeight;
 
-    uint32_t _rtvDescriptorSize;
-    uint32_t _dsvDescriptorSize;
-    uint32_t _cbvDescriptorSize;
     DXGI_FORMAT _backBufferFormat;
     DXGI_FORMAT _depthStencilFormat;
     
@@ -118,6 +291,7 @@ private:
     D3D12_VIEWPORT _screenViewport;
     RECT _scissorRect;
 
-    XMMATRIX _mvp;
+    XMMATRIX _view{ XMMatrixIdentity() };
+    XMMATRIX _projection{ XMMatrixIdentity() };
     const XMFLOAT4 backgroundColor{ 0.2f, 0.2f, 0.2f, 0.2f };
 };
\ No newline at end of file
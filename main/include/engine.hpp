@@ -3,23 +3,54 @@
 #include <memory>
 #include <entt/entity/registry.hpp>
 
+#include "aabb_tree.hpp"
 #include "math_helper.hpp"
+#include "transform_system.hpp"
 
 class Device;
+class JobSystem;
+
+// Where an entity's world bounds sit in the scene tree.
+struct SceneProxy
+{
+	AabbTree::NodeId node{ AabbTree::NULL_NODE };
+};
+
+// Entity drawn by the device's draw item of that index.
+struct Renderable
+{
+	uint32_t drawItem{ 0 };
+};
 
 class Engine
 {
 public:
-	Engine(std::shared_ptr<Device> device);
+	Engine(std::shared_ptr<Device> device, std::shared_ptr<JobSystem> jobSystem);
+	~Engine();
 
 	void Tick();
 	virtual void OnMouseMove(WPARAM buttonState, int x, int y);
 
+	// Closest entity under the given client pixel, entt::null if there is none.
+	entt::entity Pick(int x, int y) const;
+
 private:
+	// Ticks between checks whether the scene tree needs a rebuild.
+	static constexpr uint32_t SCENE_REBUILD_INTERVAL{ 60 };
+
+	void RegisterDrawItems();
+	void SyncTransforms();
+	// What's under the cursor, drawn into the device's ImGui frame.
+	void DrawOverlay() const;
+
 	std::shared_ptr<Device> _device;
+	std::shared_ptr<JobSystem> _jobSystem;
 	entt::registry _registry;
+	TransformSystem _transforms{ _registry };
+	AabbTree _sceneTree;
+	entt::entity _hoveredEntity{ entt::null };
+	uint32_t _tickCount{ 0 };
 
-	XMFLOAT4X4 _world{ MathHelper::Identity4x4() };
 	XMFLOAT4X4 _projection{ MathHelper::Identity4x4() };
 	XMFLOAT4X4 _view{ MathHelper::Identity4x4() };
 
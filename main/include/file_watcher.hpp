@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Watches a directory tree on a background thread, ReadDirectoryChangesW on Windows and
+// inotify on Linux. Changes are collected until somebody takes them.
+class FileWatcher
+{
+public:
+    explicit FileWatcher(std::filesystem::path directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool IsWatching() const { return _thread.joinable(); }
+
+    // Every file written, created or renamed into place since the last call, without duplicates.
+    std::vector<std::filesystem::path> TakeChanges();
+
+private:
+    void Run();
+    void AddChange(std::filesystem::path path);
+
+    std::filesystem::path _directory;
+    std::thread _thread;
+
+    std::mutex _mutex;
+    std::vector<std::filesystem::path> _changes;
+
+#if defined(_WIN32)
+    void* _directoryHandle = nullptr;
+    void* _stopEvent = nullptr;
+#else
+    void AddWatches(const std::filesystem::path& directory);
+
+    std::atomic<bool> _stop{ false };
+    int _inotify = -1;
+    std::unordered_map<int, std::filesystem::path> _watches;
+#endif
+};
@@ -1,15 +1,51 @@
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "d3d12.h"
+#include "descriptor_heap.hpp"
+#include "math_helper.hpp"
+#include "upload_buffer.hpp"
+#include "upload_heap.hpp"
+#include "upload_ring.hpp"
 #include "util.hpp"
 
+struct PassConstants
+{
+    XMFLOAT4X4 view = MathHelper::Identity4x4();
+    XMFLOAT4X4 proj = MathHelper::Identity4x4();
+    XMFLOAT4X4 viewProj = MathHelper::Identity4x4();
+};
+
+// Everything the CPU writes to while recording a frame. The GPU may still be reading
+// from it until `fence` has been reached, see FrameRing.
 struct FrameResource
 {
-    FrameResource(ID3D12Device* device, uint32_t passCount, uint32_t objectCount);
+    FrameResource(ID3D12Device* device, uint32_t passCount, uint32_t workerCount);
     ~FrameResource();
 
     NON_COPYABLE(FrameResource);
 
-     
+    // Carves this frame's constant buffers out of the upload ring. Only valid once the
+    // fence of the slot's previous use has retired.
+    void AllocateConstantBuffers(UploadRing<UploadHeap>& uploadRing);
+
+    ComPtr<ID3D12CommandAllocator> commandAllocator;
+    // One per recording chunk, so workers never share an allocator.
+    std::vector<ComPtr<ID3D12CommandAllocator>> workerAllocators;
+
+    UploadBuffer<PassConstants> passCB;
+    uint32_t passCount;
+    // InstanceData of this frame's instanced draws, in batch order.
+    UploadAllocation instances;
+    // ObjectConstants of every object slot. Kept from frame to frame, only slots that changed
+    // since this frame resource was last used get written.
+    std::unique_ptr<UploadHeap> objects;
+    // Staging SRV of objects, made along with the heap, and the table it got copied to in the
+    // shader visible ring this frame.
+    DescriptorHandle objectsSrv;
+    D3D12_GPU_DESCRIPTOR_HANDLE objectsTable{};
+
+    uint64_t fence = 0;
 };
@@ -0,0 +1,62 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Ring of per-frame slots for keeping several frames in flight. Each slot remembers the
+// fence value that was signalled after its commands were submitted, so the CPU only has
+// to wait when it wraps around to a slot the GPU hasn't finished with yet.
+// Slot only needs a public `uint64_t fence` member, which keeps this free of any API
+// specifics and lets it run against a simulated queue.
+template <typename Slot>
+class FrameRing
+{
+public:
+    template <typename... Args>
+    explicit FrameRing(uint32_t slotCount, Args&&... args)
+    {
+        assert(slotCount > 0);
+
+        _slots.reserve(slotCount);
+        for (uint32_t i = 0; i < slotCount; ++i)
+            _slots.emplace_back(std::make_unique<Slot>(args...));
+    }
+
+    uint32_t SlotCount() const { return static_cast<uint32_t>(_slots.size()); }
+    uint32_t CurrentIndex() const { return _currentIndex; }
+
+    Slot& Current() { return *_slots[_currentIndex]; }
+    const Slot& Current() const { return *_slots[_currentIndex]; }
+    Slot& operator[](uint32_t index) { return *_slots[index]; }
+    const Slot& operator[](uint32_t index) const { return *_slots[index]; }
+
+    // Moves to the next slot and returns the fence value the GPU has to reach before the
+    // CPU may touch that slot again. Zero means the slot has never been submitted.
+    uint64_t Advance()
+    {
+        _currentIndex = (_currentIndex + 1) % SlotCount();
+        return _slots[_currentIndex]->fence;
+    }
+
+    // Hands the current slot to the GPU until fenceValue completes.
+    void Submit(uint64_t fenceValue)
+    {
+        assert(fenceValue > _lastSubmitted && "Fence values must increase monotonically.");
+        _slots[_currentIndex]->fence = fenceValue;
+        _lastSubmitted = fenceValue;
+    }
+
+    bool IsRetired(uint32_t index, uint64_t completedFence) const
+    {
+        return _slots[index]->fence <= completedFence;
+    }
+
+    uint64_t LastSubmitted() const { return _lastSubmitted; }
+
+private:
+    std::vector<std::unique_ptr<Slot>> _slots;
+    uint32_t _currentIndex = 0;
+    uint64_t _lastSubmitted = 0;
+};
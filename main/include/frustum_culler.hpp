@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "cpu_features.hpp"
+
+class JobSystem;
+
+struct Frustum
+{
+    // Inside where a * x + b * y + c * z + d >= 0. Left, right, bottom, top, near, far, not
+    // normalized, the box test only looks at the sign.
+    float planes[6][4];
+
+    // Row vector matrix the way DirectXMath stores it, clip space z in [0, w].
+    static Frustum FromViewProjection(const float (&matrix)[4][4]);
+};
+
+// World space boxes of everything that might get drawn, in structure of arrays form so the
+// frustum test runs on 8 (AVX2) or 4 (SSE) of them at a time. Each box carries a payload,
+// culling writes the payloads of the visible ones in the order the boxes are stored.
+class FrustumCuller
+{
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = ~0u;
+    // Boxes per culling job.
+    static constexpr uint32_t CHUNK_SIZE = 4096;
+
+    Handle Add(const float center[3], const float extents[3], uint32_t payload);
+    void Update(Handle handle, const float center[3], const float extents[3]);
+    void SetPayload(Handle handle, uint32_t payload);
+    // Moves the last box into the hole, so the order of the boxes isn't stable.
+    void Remove(Handle handle);
+    void Clear();
+
+    uint32_t Count() const { return static_cast<uint32_t>(_payloads.size()); }
+
+    // Culls in parallel chunks and replaces visible with the payloads that survived.
+    void Cull(const Frustum& frustum, JobSystem& jobSystem, std::vector<uint32_t>& visible);
+
+    // What every chunk runs, on the calling thread. Writes the payloads of the visible boxes
+    // in [begin, end) to visible and returns how many there were.
+    uint32_t CullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* visible) const;
+
+    // The kernel every culler runs, the widest CpuFeatures::Detected() allows unless changed.
+    // All of them give the same result, selecting is there to compare them.
+    static CpuFeatures::Isa Kernel();
+    static void SelectKernel(CpuFeatures::Isa isa);
+
+private:
+    std::vector<float> _centerX;
+    std::vector<float> _centerY;
+    std::vector<float> _centerZ;
+    std::vector<float> _extentX;
+    std::vector<float> _extentY;
+    std::vector<float> _extentZ;
+    std::vector<uint32_t> _payloads;
+
+    // Handles stay put while boxes move around on removal.
+    std::vector<Handle> _slotHandles;
+    std::vector<uint32_t> _handleSlots;
+    std::vector<Handle> _freeHandles;
+
+    std::vector<uint32_t> _chunkVisible;
+    std::vector<uint32_t> _chunkCounts;
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "d3d12.h"
+#include <wrl/client.h>
+
+#include "tlsf_allocator.hpp"
+#include "fwd.hpp"
+
+enum class GpuHeapPool : uint32_t
+{
+    Buffers,
+    RenderTargets,
+    Textures,
+    Count,
+};
+
+struct GpuAllocation
+{
+    ComPtr<ID3D12Resource> resource;
+    // Small buffers share one placed resource, offset is where this one starts in it.
+    uint64_t offset = 0;
+    uint64_t size = 0;
+
+    ID3D12Resource* Get() const { return resource.Get(); }
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress() const { return resource->GetGPUVirtualAddress() + offset; }
+
+    // Bookkeeping for GpuHeapAllocator::Free.
+    uint32_t pool = ~0u;
+    uint32_t block = 0;
+    TlsfAllocator::Allocation range;
+};
+
+// Places resources in large ID3D12Heap blocks instead of giving each one its own committed
+// allocation. Blocks are split into buffer, render target/depth and texture pools so this
+// also works on resource heap tier 1. Buffers smaller than the 64 KiB placement alignment
+// are packed together into shared pages with 256 byte granularity.
+class GpuHeapAllocator
+{
+public:
+    static constexpr uint64_t DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+    static constexpr uint64_t SMALL_BUFFER_PAGE_SIZE = 4 * 1024 * 1024;
+
+    GpuHeapAllocator(ID3D12Device* device, uint64_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~GpuHeapAllocator();
+
+    GpuHeapAllocator(const GpuHeapAllocator&) = delete;
+    GpuHeapAllocator& operator=(const GpuHeapAllocator&) = delete;
+
+    // Buffers are created in the common state and rely on implicit promotion and decay.
+    GpuAllocation CreateBuffer(uint64_t size);
+    GpuAllocation CreateTexture(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue);
+
+    // The GPU must be done with the resource.
+    void Free(GpuAllocation& allocation);
+
+private:
+    struct Block
+    {
+        Block(uint64_t size) : allocator(size) {}
+
+        ComPtr<ID3D12Heap> heap;
+        TlsfAllocator allocator;
+        bool dedicated = false;
+    };
+
+    struct Pool
+    {
+        D3D12_HEAP_FLAGS flags;
+        uint64_t alignment;
+        std::vector<std::unique_ptr<Block>> blocks;
+    };
+
+    struct SmallBufferPage
+    {
+        SmallBufferPage(uint64_t size) : allocator(size) {}
+
+        GpuAllocation buffer;
+        TlsfAllocator allocator;
+    };
+
+    static constexpr uint32_t SMALL_BUFFER_POOL = static_cast<uint32_t>(GpuHeapPool::Count);
+
+    GpuAllocation PlaceResource(GpuHeapPool pool, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue);
+    GpuAllocation CreateSmallBuffer(uint64_t size);
+    uint32_t CreateBlock(Pool& pool, uint64_t size, bool dedicated);
+
+    ID3D12Device* _device;
+    uint64_t _blockSize;
+
+    std::array<Pool, static_cast<size_t>(GpuHeapPool::Count)> _pools;
+    std::vector<std::unique_ptr<SmallBufferPage>> _smallBufferPages;
+};
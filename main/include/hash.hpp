@@ -0,0 +1,102 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Fast non-cryptographic 64-bit hashing. Four independent lanes over 32 byte blocks keep
+// the multipliers busy, the result is the same on every platform for the same bytes.
+namespace Hash
+{
+    constexpr uint64_t PRIME0 = 0x9E3779B97F4A7C15ull;
+    constexpr uint64_t PRIME1 = 0xBF58476D1CE4E5B9ull;
+    constexpr uint64_t PRIME2 = 0x94D049BB133111EBull;
+
+    constexpr uint64_t Rotl(uint64_t value, int shift) { return (value << shift) | (value >> (64 - shift)); }
+
+    constexpr uint64_t Mix(uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= PRIME1;
+        value ^= value >> 27;
+        value *= PRIME2;
+        value ^= value >> 31;
+        return value;
+    }
+
+    inline uint64_t Load64(const uint8_t* bytes)
+    {
+        // Little endian regardless of the host, so hashes stored on disk stay valid.
+        uint64_t value{ 0 };
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            memcpy(&value, bytes, sizeof(value));
+        }
+        else
+        {
+            for (int i = 7; i >= 0; --i)
+                value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    inline uint64_t Bytes(const void* data, size_t size, uint64_t seed = 0)
+    {
+        const uint8_t* bytes{ static_cast<const uint8_t*>(data) };
+        uint64_t lanes[4]{ seed + PRIME0, seed ^ PRIME1, seed - PRIME0, seed ^ PRIME2 };
+
+        size_t offset{ 0 };
+        for (; offset + 32 <= size; offset += 32)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+                lanes[lane] = Rotl(lanes[lane] + Load64(bytes + offset + lane * 8) * PRIME1, 31) * PRIME0;
+        }
+
+        uint64_t hash{ Rotl(lanes[0], 1) + Rotl(lanes[1], 7) + Rotl(lanes[2], 12) + Rotl(lanes[3], 18) };
+        hash ^= static_cast<uint64_t>(size) * PRIME2;
+
+        for (; offset + 8 <= size; offset += 8)
+            hash = Rotl(hash ^ Mix(Load64(bytes + offset)), 27) * PRIME0;
+
+        uint64_t tail{ 0 };
+        for (size_t i = size; i > offset; --i)
+            tail = (tail << 8) | bytes[i - 1];
+        hash ^= Mix(tail + (size - offset));
+
+        return Mix(hash);
+    }
+
+    inline uint64_t String(std::string_view string, uint64_t seed = 0) { return Bytes(string.data(), string.size(), seed); }
+
+    constexpr uint64_t Combine(uint64_t seed, uint64_t value) { return Mix(seed ^ (value + PRIME0 + Rotl(seed, 6))); }
+}
+
+// Feeds values into a running hash one field at a time. Only hash fields explicitly, never
+// whole structs with padding in them.
+class Hasher
+{
+public:
+    explicit Hasher(uint64_t seed = 0) : _hash(seed) {}
+
+    Hasher& Add(uint64_t value)
+    {
+        _hash = Hash::Combine(_hash, value);
+        return *this;
+    }
+
+    Hasher& AddBytes(const void* data, size_t size)
+    {
+        return Add(Hash::Bytes(data, size));
+    }
+
+    Hasher& AddString(std::string_view string)
+    {
+        return Add(Hash::String(string));
+    }
+
+    uint64_t Value() const { return _hash; }
+
+private:
+    uint64_t _hash;
+};
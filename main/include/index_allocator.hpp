@@ -0,0 +1,61 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Hands out single indices in [0, capacity) from a bitmap, lowest free index first.
+// A word hint keeps the scan short when allocations cluster at the front.
+class IndexAllocator
+{
+public:
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+    explicit IndexAllocator(uint32_t capacity) : _capacity(capacity)
+    {
+        // Set bits mark free indices, bits past the capacity stay cleared.
+        _words.resize((capacity + 63) / 64, ~0ull);
+        if (capacity % 64 != 0)
+            _words.back() = (1ull << (capacity % 64)) - 1;
+    }
+
+    uint32_t Allocate()
+    {
+        for (uint32_t word = _firstFreeWord; word < _words.size(); ++word)
+        {
+            if (_words[word] == 0)
+                continue;
+
+            uint32_t bit{ static_cast<uint32_t>(std::countr_zero(_words[word])) };
+            _words[word] &= ~(1ull << bit);
+            _firstFreeWord = word;
+            ++_allocatedCount;
+
+            return word * 64 + bit;
+        }
+
+        _firstFreeWord = static_cast<uint32_t>(_words.size());
+        return INVALID_INDEX;
+    }
+
+    void Free(uint32_t index)
+    {
+        assert(index < _capacity && IsAllocated(index) && "Double free or foreign index.");
+
+        _words[index / 64] |= 1ull << (index % 64);
+        _firstFreeWord = std::min(_firstFreeWord, index / 64);
+        --_allocatedCount;
+    }
+
+    bool IsAllocated(uint32_t index) const { return (_words[index / 64] & (1ull << (index % 64))) == 0; }
+    uint32_t Capacity() const { return _capacity; }
+    uint32_t AllocatedCount() const { return _allocatedCount; }
+    bool IsFull() const { return _allocatedCount == _capacity; }
+
+private:
+    std::vector<uint64_t> _words;
+    uint32_t _capacity;
+    uint32_t _allocatedCount = 0;
+    uint32_t _firstFreeWord = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "render_packet.hpp"
+
+class JobSystem;
+
+// What the vertex shader reads per instance, the slot of the object constants to draw with.
+struct InstanceData
+{
+    uint32_t object;
+};
+
+// One instanced draw. Instances [firstInstance, firstInstance + instanceCount) of the
+// instance buffer, all drawn like the draw item drawItem.
+struct InstanceBatch
+{
+    uint64_t state;
+    uint32_t drawItem;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Turns sorted render packets into instanced draws. Packets already come ordered by state, so
+// every run of packets with the same SortKey::State is one batch and packet i is instance i.
+class InstanceBatcher
+{
+public:
+    // Instances per job when writing the buffer.
+    static constexpr uint32_t CHUNK_SIZE = 4096;
+
+    void Group(std::span<const RenderPacket> packets);
+
+    std::span<const InstanceBatch> Batches() const { return _batches; }
+    uint32_t InstanceCount() const { return _instanceCount; }
+
+    // Writes the object of every grouped packet to instances, which needs room for
+    // InstanceCount() of them.
+    void WriteInstances(std::span<const RenderPacket> packets, InstanceData* instances, JobSystem& jobSystem) const;
+
+private:
+    std::vector<InstanceBatch> _batches;
+    uint32_t _instanceCount{ 0 };
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_deque.hpp"
+
+// Counts outstanding jobs. Jobs scheduled against a counter increment it and decrement it
+// once they've run, waiting on it means waiting for all of them.
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return _value.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> _value{ 0 };
+};
+
+// Work stealing scheduler. Every worker owns a deque it pushes to and pops from, idle
+// workers steal from the others. The thread that creates the system is registered as
+// worker 0 and only runs jobs while it waits. Other threads submit through a shared queue.
+class JobSystem
+{
+public:
+    static constexpr uint32_t DEQUE_CAPACITY = 4096;
+
+    // workerCount includes the creating thread, zero picks one per hardware thread.
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t WorkerCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+    // Jobs must not throw, the counter would never reach zero.
+    void Schedule(std::function<void()> job, JobCounter& counter);
+
+    // Long running work that must not stall the frame. Only worker threads other than the
+    // creating one pick these up, and only once they have nothing else to do. With a single
+    // worker nobody would ever run it, callers should check WorkerCount() first.
+    void ScheduleBackground(std::function<void()> job, JobCounter& counter);
+
+    // Runs other jobs until counter reaches zero. Never background jobs, one of those could
+    // keep the waiting job from finishing for as long as it runs.
+    void Wait(JobCounter& counter);
+
+    // Calls body(i) for every i in [0, count), grain indices per job. Returns once all ran.
+    template <typename Body>
+    void ParallelFor(uint32_t count, uint32_t grain, Body&& body)
+    {
+        if (count == 0)
+            return;
+
+        grain = std::max(1u, grain);
+        if (count <= grain)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                body(i);
+            return;
+        }
+
+        JobCounter counter;
+        for (uint32_t begin = grain; begin < count; begin += grain)
+        {
+            uint32_t end{ std::min(count, begin + grain) };
+            Schedule([&body, begin, end] { for (uint32_t i = begin; i < end; ++i) body(i); }, counter);
+        }
+
+        // The first batch runs right here, the rest is up for grabs.
+        for (uint32_t i = 0; i < grain; ++i)
+            body(i);
+
+        Wait(counter);
+    }
+
+    // Calls body(element) for every element of range, for example an entt view. Ranges
+    // without random access iterators get gathered into a flat list first.
+    template <typename Range, typename Body>
+    void ParallelForEach(Range&& range, uint32_t grain, Body&& body)
+    {
+        using Iterator = decltype(std::begin(range));
+
+        if constexpr (std::random_access_iterator<Iterator>)
+        {
+            Iterator first{ std::begin(range) };
+            uint32_t count{ static_cast<uint32_t>(std::distance(first, std::end(range))) };
+            ParallelFor(count, grain, [&](uint32_t i) { body(first[i]); });
+        }
+        else
+        {
+            std::vector<std::iter_value_t<Iterator>> elements{ std::begin(range), std::end(range) };
+            ParallelFor(static_cast<uint32_t>(elements.size()), grain, [&](uint32_t i) { body(elements[i]); });
+        }
+    }
+
+private:
+    struct Job
+    {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    struct Worker
+    {
+        Worker() : deque(DEQUE_CAPACITY) {}
+
+        WorkStealingDeque<Job> deque;
+        std::thread thread;
+    };
+
+    void WorkerLoop(uint32_t index);
+    Job* FindJob(uint32_t index, uint64_t& seed, bool takeBackground);
+    void Execute(Job* job);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Submissions from threads that aren't workers.
+    std::mutex _injectedMutex;
+    std::deque<Job*> _injected;
+    std::atomic<uint32_t> _injectedCount{ 0 };
+
+    // Background submissions, never taken by worker 0.
+    std::mutex _backgroundMutex;
+    std::deque<Job*> _background;
+    std::atomic<uint32_t> _backgroundCount{ 0 };
+
+    // Idle workers sleep here until jobs are queued.
+    std::mutex _sleepMutex;
+    std::condition_variable _wake;
+    std::atomic<uint32_t> _queuedJobs{ 0 };
+    std::atomic<uint32_t> _sleepingWorkers{ 0 };
+    std::atomic<bool> _exit{ false };
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Just enough JSON to read asset descriptions like glTF. Lookups never fail, missing
+// members and out of range elements come back as null values.
+class JsonValue
+{
+public:
+    enum class Type : uint8_t
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    // Nullopt on malformed input.
+    static std::optional<JsonValue> Parse(std::string_view text);
+
+    Type GetType() const { return _type; }
+    bool IsNull() const { return _type == Type::Null; }
+    bool IsNumber() const { return _type == Type::Number; }
+    bool IsString() const { return _type == Type::String; }
+    bool IsArray() const { return _type == Type::Array; }
+    bool IsObject() const { return _type == Type::Object; }
+
+    bool AsBool(bool fallback = false) const { return _type == Type::Bool ? _bool : fallback; }
+    double AsNumber(double fallback = 0.0) const { return _type == Type::Number ? _number : fallback; }
+    const std::string& AsString() const { return _string; }
+
+    // Elements of an array or members of an object, zero for anything else.
+    size_t Size() const;
+
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](std::string_view key) const;
+
+    bool Contains(std::string_view key) const { return !(*this)[key].IsNull(); }
+
+    const std::vector<std::pair<std::string, JsonValue>>& Members() const { return _members; }
+
+private:
+    friend class JsonParser;
+
+    Type _type = Type::Null;
+    bool _bool = false;
+    double _number = 0.0;
+    std::string _string;
+    std::vector<JsonValue> _elements;
+    std::vector<std::pair<std::string, JsonValue>> _members;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+namespace LodSelection
+{
+    // How many pixels a level may be off from the full mesh before a finer one is needed.
+    constexpr float PIXEL_ERROR = 1.0f;
+    // Going coarser needs the error this much under PIXEL_ERROR, so an object sitting on a
+    // threshold doesn't flip between levels every frame.
+    constexpr float HYSTERESIS = 0.25f;
+
+    // Radius of a sphere on screen as a fraction of the viewport height. projectionScale is
+    // the projection's y scale, cot(fovY / 2).
+    inline float ScreenSize(float radius, float distance, float projectionScale)
+    {
+        // Inside the sphere it covers the screen.
+        return radius * projectionScale * 0.5f / std::max(distance, radius);
+    }
+
+    // errors holds each level's deviation from the full mesh in mesh units, level 0 first
+    // and zero. Picks the coarsest level whose error stays under pixelError on screen.
+    inline uint32_t Select(std::span<const float> errors, float radius, float screenSize, float viewportHeight, uint32_t current,
+        float pixelError = PIXEL_ERROR, float hysteresis = HYSTERESIS)
+    {
+        if (errors.size() < 2 || radius <= 0.0f)
+            return 0;
+
+        float pixelsPerUnit{ screenSize / radius * viewportHeight };
+        auto coarsest = [&](float threshold)
+        {
+            uint32_t level{ 0 };
+            while (level + 1 < errors.size() && errors[level + 1] * pixelsPerUnit <= threshold)
+                ++level;
+            return level;
+        };
+
+        uint32_t target{ coarsest(pixelError) };
+        if (current > target)
+            return target;
+
+        // Only step down as far as the tighter threshold allows, never finer than now.
+        return std::max(current, coarsest(pixelError * (1.0f - hysteresis)));
+    }
+}
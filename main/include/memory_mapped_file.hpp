@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// Read-only view of a whole file. Stays valid until the object is destroyed, so hand out
+// shared ownership when spans into it outlive the call that opened it.
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() = default;
+    ~MemoryMappedFile();
+
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return _data != nullptr; }
+    std::span<const uint8_t> Data() const { return { _data, _size }; }
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+
+#if defined(_WIN32)
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#else
+    int _file = -1;
+#endif
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "cooked_mesh.hpp"
+
+class JobSystem;
+
+// Same layout as the Vertex and ExtraVertex streams the device draws with.
+struct MeshVertex
+{
+    float position[3];
+    float tex0[2];
+    float tex1[2];
+};
+
+struct MeshExtraVertex
+{
+    float color[4];
+    float tangent[3];
+    float normal[3];
+};
+
+// Geometry on the CPU in the two stream layout, what the importers produce and the cooker
+// and loader consume. Submesh indices are relative to their baseVertexLocation.
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<MeshExtraVertex> extraVertices;
+    std::vector<uint32_t> indices;
+    std::vector<CookedSubmesh> submeshes;
+    // Empty until MeshletBuilder::BuildMeshlets runs, the submeshes point into it.
+    MeshletData meshlets;
+
+    // Views into this mesh, valid as long as it isn't modified.
+    CookedMeshDesc Describe() const;
+
+    // Fits every submesh's bounds around the vertices it references, in parallel.
+    void ComputeBounds(JobSystem& jobSystem);
+
+    // Area weighted vertex normals for sources that don't have any.
+    void GenerateNormals();
+};
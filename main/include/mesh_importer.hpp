@@ -0,0 +1,22 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+
+#include "mesh_data.hpp"
+
+class JobSystem;
+
+// Source format importers. Parsing is split across the job system, the result has both
+// vertex streams filled in and bounds computed for every submesh. Nullopt when the file is
+// missing, malformed or uses something that isn't supported.
+
+// Wavefront OBJ. Every o, g and usemtl starts a new submesh, polygons are fanned into
+// triangles and a vertex color after the position is picked up if present.
+std::optional<MeshData> ImportObj(const std::filesystem::path& path, JobSystem& jobSystem);
+
+// glTF 2.0, both .gltf with external or embedded buffers and .glb. Every triangle primitive
+// becomes a submesh named "mesh/primitive", in mesh space, node transforms aren't applied.
+std::optional<MeshData> ImportGltf(const std::filesystem::path& path, JobSystem& jobSystem);
+
+// Picks the importer from the extension.
+std::optional<MeshData> ImportMesh(const std::filesystem::path& path, JobSystem& jobSystem);
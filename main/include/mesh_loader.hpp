@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "cooked_mesh.hpp"
+#include "copy_queue.hpp"
+#include "gpu_heap_allocator.hpp"
+#include "mesh_data.hpp"
+#include "util.hpp"
+#include "fwd.hpp"
+
+// Uploads the streams described by desc straight into staging memory, no copy on the heap
+// in between. storage is whatever the streams point into, the geometry holds on to it for
+// CPU side access.
+std::unique_ptr<MeshGeometry> LoadMeshGeometry(const CookedMeshDesc& desc, std::shared_ptr<const void> storage, std::string name, GpuHeapAllocator& heapAllocator, GpuUploadService& uploadService);
+
+// A cooked mesh, uploaded out of its mapping.
+std::unique_ptr<MeshGeometry> LoadMeshGeometry(const CookedMesh& mesh, std::string name, GpuHeapAllocator& heapAllocator, GpuUploadService& uploadService);
+
+// Freshly imported geometry.
+std::unique_ptr<MeshGeometry> LoadMeshGeometry(std::shared_ptr<const MeshData> mesh, std::string name, GpuHeapAllocator& heapAllocator, GpuUploadService& uploadService);
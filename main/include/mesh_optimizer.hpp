@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+#include "mesh_data.hpp"
+
+class JobSystem;
+
+struct VertexCacheStatistics
+{
+    // Average cache miss ratio, vertex shader invocations per triangle. 0.5 is the best a
+    // regular grid gets, 3 means no reuse at all.
+    float acmr = 0.0f;
+    // Average transformed vertex ratio, invocations per unique vertex. 1 is perfect.
+    float atvr = 0.0f;
+};
+
+namespace MeshOptimizer
+{
+    // What the statistics assume, a FIFO about the size of current hardware's reuse window.
+    constexpr uint32_t SIMULATED_CACHE_SIZE = 16;
+
+    // Default ACMR the overdraw pass may give up, 5% worse than the cache optimized order.
+    constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    // Merges vertices that are identical in both streams. Indices become absolute and every
+    // submesh's baseVertexLocation zero, so the other passes can work on the whole mesh.
+    void WeldVertices(MeshData& mesh);
+
+    // Forsyth's linear speed vertex cache optimization, reorders triangles only.
+    void OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount);
+
+    // Splits the triangles into clusters at cache reset points and sorts the clusters so that
+    // outward facing ones on the outside draw first. threshold bounds how much ACMR can be
+    // traded for that, indices should be cache optimized already.
+    void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const MeshVertex> vertices, float threshold = OVERDRAW_THRESHOLD);
+
+    // Reorders both vertex streams into the order the indices first use them and drops
+    // unreferenced vertices. Expects absolute indices.
+    void OptimizeVertexFetch(MeshData& mesh);
+
+    VertexCacheStatistics AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = SIMULATED_CACHE_SIZE);
+
+    // The whole pipeline: weld, then cache and overdraw per submesh in parallel, then fetch.
+    void Optimize(MeshData& mesh, JobSystem& jobSystem);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "mesh_data.hpp"
+
+class JobSystem;
+
+struct SimplifyResult
+{
+    std::vector<uint32_t> indices;
+    // Largest distance a collapse moved the surface, in mesh units.
+    float error = 0.0f;
+};
+
+namespace MeshSimplifier
+{
+    // Each level aims for this fraction of the triangles of the one before.
+    constexpr float LOD_REDUCTION = 0.5f;
+    // Relative to the submesh's extent, how far any level may stray.
+    constexpr float LOD_MAX_ERROR = 0.05f;
+    // A level that removes less than this fraction isn't worth a draw of its own.
+    constexpr float LOD_MIN_REDUCTION = 0.1f;
+
+    // Garland-Heckbert edge collapse onto existing vertices, so the vertex streams stay as
+    // they are. Stops at targetIndexCount or once a collapse would move the surface further
+    // than targetError times the extent of the mesh. Vertices on borders and attribute
+    // seams never move, that keeps the outline and the UV layout intact.
+    SimplifyResult Simplify(std::span<const uint32_t> indices, std::span<const MeshVertex> vertices, uint32_t targetIndexCount, float targetError);
+
+    // Appends up to lodCount levels after every submesh, each simplified from the one before
+    // and cache optimized. Run after MeshOptimizer::Optimize, the levels reuse its vertices.
+    void GenerateLods(MeshData& mesh, JobSystem& jobSystem, uint32_t lodCount = MAX_SUBMESH_LODS);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// vertexOffset indexes MeshletData::vertices, triangleOffset counts triangles of three local
+// byte indices into MeshletData::triangles.
+struct Meshlet
+{
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+// Culling data of one meshlet in mesh space. The cluster faces away from every point p with
+// dot(normalize(coneApex - p), coneAxis) >= coneCutoff, a cutoff of 1 never culls.
+struct MeshletBounds
+{
+    float center[3];
+    float radius;
+    float coneApex[3];
+    float coneCutoff;
+    float coneAxis[3];
+    float reserved;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+    // Relative to the submesh's baseVertexLocation.
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+};
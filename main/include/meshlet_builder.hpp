@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+#include "mesh_data.hpp"
+#include "meshlet.hpp"
+
+class JobSystem;
+
+namespace MeshletBuilder
+{
+    // Limits that fit mesh shader output well, 124 keeps the primitive indices in 496 bytes.
+    constexpr uint32_t MAX_VERTICES = 64;
+    constexpr uint32_t MAX_TRIANGLES = 124;
+
+    // Grows meshlets greedily from the index order, preferring triangles that add no new
+    // vertices and face the same way as the meshlet so far. Works best on cache optimized
+    // indices. indices are relative to the start of vertices.
+    MeshletData Build(std::span<const uint32_t> indices, std::span<const MeshVertex> vertices, uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+    MeshletBounds ComputeBounds(const MeshletData& data, const Meshlet& meshlet, std::span<const MeshVertex> vertices);
+
+    // Builds every submesh in parallel into mesh.meshlets and points the submeshes at theirs.
+    void BuildMeshlets(MeshData& mesh, JobSystem& jobSystem);
+
+    inline bool IsBackfacing(const MeshletBounds& bounds, const float viewPosition[3])
+    {
+        float direction[3]{ bounds.coneApex[0] - viewPosition[0], bounds.coneApex[1] - viewPosition[1], bounds.coneApex[2] - viewPosition[2] };
+        float dot{ direction[0] * bounds.coneAxis[0] + direction[1] * bounds.coneAxis[1] + direction[2] * bounds.coneAxis[2] };
+        float lengthSquared{ direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2] };
+
+        // dot / length >= cutoff without the square root. Strict so a zero axis never culls.
+        return dot > 0.0f && dot * dot >= bounds.coneCutoff * bounds.coneCutoff * lengthSquared;
+    }
+}
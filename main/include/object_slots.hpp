@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <directxmath.h>
+#include <vector>
+
+#include "job_system.hpp"
+
+// What the vertex shader reads per object, the world matrix transposed to three rows so
+// each output coordinate is one dot product with (position, 1).
+struct ObjectConstants
+{
+    DirectX::XMFLOAT3X4 world;
+};
+
+// Slots of per-object constants that stay put from frame to frame. There is one copy of the
+// constants per frame in flight and every copy has its own dirty bits, so a change gets
+// written to each copy once, the next time its frame comes up, and nothing else does.
+class ObjectSlots
+{
+public:
+    // Slots per job when writing the dirty ones.
+    static constexpr uint32_t CHUNK_SIZE = 4096;
+
+    explicit ObjectSlots(uint32_t copyCount);
+
+    // Freed slots get reused first. A new slot starts out dirty in every copy.
+    uint32_t Allocate();
+    void Free(uint32_t slot);
+
+    void MarkDirty(uint32_t slot)
+    {
+        for (std::vector<uint64_t>& dirty : _dirty)
+            dirty[slot / 64] |= 1ull << (slot % 64);
+    }
+
+    // For a copy whose storage got replaced and has to be written from scratch.
+    void MarkAllDirty(uint32_t copy);
+
+    // One past the highest slot handed out so far, what every copy has to have room for.
+    uint32_t SlotCount() const { return _slotCount; }
+    uint32_t AllocatedCount() const { return _slotCount - static_cast<uint32_t>(_freeSlots.size()); }
+
+    // Calls write(firstSlot, count) for every run of slots dirty in copy and clears them, so
+    // neighbouring slots can be written in one go. Chunks of slots run in parallel. Returns
+    // how many slots were written.
+    template <typename Write>
+    uint32_t Flush(uint32_t copy, JobSystem& jobSystem, const Write& write)
+    {
+        std::vector<uint64_t>& dirty{ _dirty[copy] };
+        uint32_t wordCount{ static_cast<uint32_t>(dirty.size()) };
+        uint32_t chunkWords{ CHUNK_SIZE / 64 };
+        uint32_t chunkCount{ (wordCount + chunkWords - 1) / chunkWords };
+
+        _chunkCounts.assign(chunkCount, 0);
+        jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+        {
+            uint32_t end{ std::min(wordCount, (chunk + 1) * chunkWords) };
+            for (uint32_t word = chunk * chunkWords; word < end; ++word)
+            {
+                uint64_t bits{ dirty[word] };
+                if (bits == 0)
+                    continue;
+
+                dirty[word] = 0;
+                _chunkCounts[chunk] += std::popcount(bits);
+                while (bits != 0)
+                {
+                    uint32_t first{ static_cast<uint32_t>(std::countr_zero(bits)) };
+                    uint32_t count{ static_cast<uint32_t>(std::countr_one(bits >> first)) };
+                    write(word * 64 + first, count);
+                    bits &= count == 64 ? 0 : ~(((1ull << count) - 1) << first);
+                }
+            }
+        });
+
+        uint32_t written{ 0 };
+        for (uint32_t count : _chunkCounts)
+            written += count;
+        return written;
+    }
+
+private:
+    uint32_t _slotCount{ 0 };
+    std::vector<uint32_t> _freeSlots;
+    // Bit per slot, one bitset per copy.
+    std::vector<std::vector<uint64_t>> _dirty;
+    std::vector<uint32_t> _chunkCounts;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class JobSystem;
+
+struct DrawRange
+{
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    uint32_t Count() const { return end - begin; }
+};
+
+// Records command list chunks on the job system. The calling thread takes part as well,
+// so a single chunk runs inline.
+class ParallelRecorder
+{
+public:
+    explicit ParallelRecorder(JobSystem& jobSystem);
+
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+    uint32_t WorkerCount() const;
+
+    // Calls record(chunk) for every chunk in [0, chunkCount) and returns once all of them have
+    // finished. Which thread runs a chunk is unspecified, per chunk state must be indexed by it.
+    // The first exception thrown by a chunk is rethrown here.
+    void Run(uint32_t chunkCount, const std::function<void(uint32_t)>& record);
+
+    // Splits drawCount draws into at most maxChunks contiguous ranges of at least
+    // minDrawsPerChunk draws, sizes differ by one at most.
+    static std::vector<DrawRange> Partition(uint32_t drawCount, uint32_t maxChunks, uint32_t minDrawsPerChunk);
+
+private:
+    JobSystem& _jobSystem;
+
+    std::mutex _exceptionMutex;
+    std::exception_ptr _exception;
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+// Our side of the on-disk pipeline cache. Lists the pipelines stored in the driver's
+// pipeline library and identifies the library blob and the device it was built on, so a
+// stale or foreign library gets thrown away instead of handed to the driver.
+struct PipelineIndex
+{
+    static constexpr uint32_t MAGIC = 0x494F5350; // "PSOI"
+    static constexpr uint32_t VERSION = 1;
+
+    uint64_t deviceFingerprint = 0;
+    uint64_t libraryHash = 0;
+    uint64_t librarySize = 0;
+    std::unordered_set<uint64_t> pipelines;
+
+    std::vector<uint8_t> Serialize() const;
+    static std::optional<PipelineIndex> Deserialize(std::span<const uint8_t> data);
+};
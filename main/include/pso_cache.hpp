@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "d3d12.h"
+#include "pipeline_index.hpp"
+#include "util.hpp"
+#include "fwd.hpp"
+
+// Deduplicates graphics pipelines by a hash of their full description and keeps them in a
+// driver pipeline library that's written to disk, so later runs skip compilation.
+class PsoCache
+{
+public:
+    // deviceFingerprint identifies adapter and driver, a library from another one is dropped.
+    PsoCache(ID3D12Device* device, uint64_t deviceFingerprint, std::filesystem::path directory);
+    ~PsoCache();
+
+    NON_COPYABLE(PsoCache);
+    NON_MOVABLE(PsoCache);
+
+    // rootSignatureHash stands in for desc.pRootSignature, pointers don't survive a restart.
+    ID3D12PipelineState* GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+    // Writes the library and index if any pipeline got added since the last save.
+    void Save();
+
+    static uint64_t HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+private:
+    ID3D12Device* _device;
+    ComPtr<ID3D12Device1> _device1;
+
+    // The library reads from the blob it was created from, so it has to outlive it.
+    std::vector<uint8_t> _libraryBlob;
+    ComPtr<ID3D12PipelineLibrary> _library;
+
+    PipelineIndex _index;
+    std::filesystem::path _libraryPath;
+    std::filesystem::path _indexPath;
+    bool _dirty = false;
+
+    // Guards everything above as well. Pipelines are compiled without holding it, a key is in
+    // _compiling meanwhile so other threads asking for it wait instead of compiling it again.
+    std::mutex _mutex;
+    std::condition_variable _compiled;
+    std::unordered_set<uint64_t> _compiling;
+    std::unordered_map<uint64_t, ComPtr<ID3D12PipelineState>> _pipelines;
+};
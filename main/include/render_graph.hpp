@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Frame graph over imported resources. Passes are added in execution order and declare
+// which resources they read and write in which state. Compile culls passes that don't
+// contribute to an exported resource and works out the state transitions between them,
+// batched per pass. States are opaque bit masks, D3D12_RESOURCE_STATES on the renderer side.
+class RenderGraph
+{
+public:
+    using ResourceId = uint32_t;
+    using PassId = uint32_t;
+
+    enum PassFlags : uint32_t
+    {
+        PASS_NONE = 0,
+        // Never culled, e.g. it writes to something the graph doesn't know about.
+        PASS_SIDE_EFFECTS = 1 << 0,
+        // Records onto command lists of its own. The current list ends before it and a new one
+        // starts after, split barriers don't cross that boundary.
+        PASS_OWN_COMMAND_LISTS = 1 << 1,
+    };
+
+    enum class BarrierSplit : uint8_t
+    {
+        None,
+        Begin,
+        End,
+    };
+
+    struct Barrier
+    {
+        ResourceId resource;
+        uint32_t before;
+        uint32_t after;
+        BarrierSplit split;
+
+        bool operator==(const Barrier&) const = default;
+    };
+
+    struct Compiled
+    {
+        // Surviving passes in execution order.
+        std::vector<PassId> passes;
+        // Batch i is recorded right before passes[i], the last batch after the final pass.
+        std::vector<Barrier> barriers;
+        std::vector<uint32_t> batchOffsets;
+
+        uint32_t BatchCount() const { return static_cast<uint32_t>(batchOffsets.size()) - 1; }
+        std::span<const Barrier> Batch(uint32_t batch) const
+        {
+            return { barriers.data() + batchOffsets[batch], barriers.data() + batchOffsets[batch + 1] };
+        }
+    };
+
+    // Clears all passes and resources but keeps the allocations around for the next frame.
+    void Reset();
+
+    // The resource is in initialState when the frame starts and has to be in finalState once
+    // it ends. Passes only writing to resources that aren't exported get culled.
+    ResourceId ImportResource(std::string name, uint32_t initialState, uint32_t finalState, bool exported = true);
+
+    PassId AddPass(std::string name, uint32_t flags = PASS_NONE);
+    void Read(PassId pass, ResourceId resource, uint32_t state);
+    // Writes keep the previous contents, so they depend on earlier writers.
+    void Write(PassId pass, ResourceId resource, uint32_t state);
+
+    const Compiled& Compile();
+
+    uint32_t PassFlagsOf(PassId pass) const { return _passes[pass].flags; }
+    const std::string& PassName(PassId pass) const { return _passes[pass].name; }
+    const std::string& ResourceName(ResourceId resource) const { return _resources[resource].name; }
+
+private:
+    struct Access
+    {
+        PassId pass;
+        ResourceId resource;
+        uint32_t state;
+        bool write;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        uint32_t initialState;
+        uint32_t finalState;
+        bool exported;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        uint32_t flags;
+    };
+
+    struct PendingBarrier
+    {
+        uint32_t batch;
+        Barrier barrier;
+    };
+
+    void Cull();
+    void AddTransition(ResourceId resource, uint32_t before, uint32_t after, int32_t lastUse, uint32_t batch);
+
+    std::vector<Resource> _resources;
+    std::vector<Pass> _passes;
+    std::vector<Access> _accesses;
+
+    // Scratch, kept between compiles.
+    std::vector<bool> _kept;
+    std::vector<bool> _needed;
+    std::vector<uint32_t> _survivingIndex;
+    std::vector<uint32_t> _commandListOfBatch;
+    std::vector<Access> _sorted;
+    std::vector<PendingBarrier> _pending;
+
+    Compiled _compiled;
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class JobSystem;
+
+// One draw as the scene emits it. Everything the sort looks at is in the key, the rest
+// says what to draw and with which transform.
+struct RenderPacket
+{
+    uint64_t key;
+    uint32_t drawItem;
+    uint32_t object;
+};
+
+enum RenderPacketPass : uint32_t
+{
+    PACKET_PASS_SCENE = 0,
+};
+
+// 64-bit sort keys, most significant field first:
+//   opaque:      pass 4 | 0 | pipeline 10 | material 14 | mesh 16 | lod 3 | depth 16
+//   transparent: pass 4 | 1 | ~depth 16 | pipeline 10 | material 14 | mesh 16 | lod 3
+// Opaque packets sort by state and front to back within the same state, transparent ones
+// back to front first. Both end up in pass order with opaque before transparent.
+namespace SortKey
+{
+    constexpr uint32_t PASS_BITS = 4;
+    constexpr uint32_t PIPELINE_BITS = 10;
+    constexpr uint32_t MATERIAL_BITS = 14;
+    constexpr uint32_t MESH_BITS = 16;
+    constexpr uint32_t LOD_BITS = 3;
+    constexpr uint32_t DEPTH_BITS = 16;
+
+    constexpr uint64_t Field(uint64_t value, uint32_t bits, uint32_t shift)
+    {
+        return (value & ((1ull << bits) - 1)) << shift;
+    }
+
+    // Top half of the float's bits, which orders non-negative floats the same as the floats.
+    // Keeps 7 mantissa bits, plenty to sort by.
+    inline uint32_t Depth(float viewDepth)
+    {
+        return viewDepth > 0.0f ? std::bit_cast<uint32_t>(viewDepth) >> 16 : 0;
+    }
+
+    inline uint64_t Opaque(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t lod, float viewDepth)
+    {
+        return Field(pass, PASS_BITS, 60) | Field(pipeline, PIPELINE_BITS, 49) | Field(material, MATERIAL_BITS, 35) |
+            Field(mesh, MESH_BITS, 19) | Field(lod, LOD_BITS, 16) | Field(Depth(viewDepth), DEPTH_BITS, 0);
+    }
+
+    inline uint64_t Transparent(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t lod, float viewDepth)
+    {
+        return Field(pass, PASS_BITS, 60) | Field(1, 1, 59) | Field(~Depth(viewDepth), DEPTH_BITS, 43) |
+            Field(pipeline, PIPELINE_BITS, 33) | Field(material, MATERIAL_BITS, 19) | Field(mesh, MESH_BITS, 3) | Field(lod, LOD_BITS, 0);
+    }
+
+    constexpr bool IsTransparent(uint64_t key) { return (key >> 59) & 1; }
+
+    // The key without its depth. Neighbouring packets with the same state can be drawn as one.
+    constexpr uint64_t State(uint64_t key)
+    {
+        return IsTransparent(key) ? key & ~Field(~0ull, DEPTH_BITS, 43) : key & ~Field(~0ull, DEPTH_BITS, 0);
+    }
+}
+
+// Stable LSD radix sort by key, 8 bits per pass. Passes where every key has the same digit
+// are skipped, so keys that only use a few fields cost fewer passes. Blocks of packets
+// get counted and scattered in parallel. scratch ends up as big as packets.
+void SortRenderPackets(std::vector<RenderPacket>& packets, std::vector<RenderPacket>& scratch, JobSystem& jobSystem);
+
+// Packets collected from many jobs at once. Every writer is a linear buffer of its own that
+// only one job at a time appends to, Sort stitches them together in writer order and sorts.
+class RenderPacketStream
+{
+public:
+    // Empties every writer but keeps their memory.
+    void Reset(uint32_t writerCount);
+
+    void Emit(uint32_t writer, const RenderPacket& packet) { _writers[writer].packets.push_back(packet); }
+
+    std::span<const RenderPacket> Sort(JobSystem& jobSystem);
+    std::span<const RenderPacket> Sorted() const { return _sorted; }
+
+private:
+    // Padded so writers on different threads don't share a cache line.
+    struct alignas(64) Writer
+    {
+        std::vector<RenderPacket> packets;
+    };
+
+    std::vector<Writer> _writers;
+    std::vector<RenderPacket> _sorted;
+    std::vector<RenderPacket> _scratch;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Keeps objects alive until the GPU has passed the fence value of the last submission that
+// could still reference them, so they can be replaced without flushing the queue.
+template <typename T>
+class RetireQueue
+{
+public:
+    RetireQueue() = default;
+
+    RetireQueue(const RetireQueue&) = delete;
+    RetireQueue& operator=(const RetireQueue&) = delete;
+
+    // fenceValue is the last value signalled after work that may use object.
+    void Retire(T object, uint64_t fenceValue) { _retired.push_back({ std::move(object), fenceValue }); }
+
+    // Releases everything the GPU is done with. Fence values only grow, so it stops at the
+    // first entry still in flight.
+    void Collect(uint64_t completedFenceValue)
+    {
+        while (!_retired.empty() && _retired.front().second <= completedFenceValue)
+            _retired.pop_front();
+    }
+
+    size_t Size() const { return _retired.size(); }
+
+private:
+    std::deque<std::pair<T, uint64_t>> _retired;
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <deque>
+
+// Hands out aligned, contiguous ranges from a fixed-size circular region. Everything
+// allocated between two FinishFrame calls belongs to that frame and is given back in one
+// go once the fence it was tagged with has been retired. Only deals in offsets, so it can
+// sit on top of any kind of memory.
+class RingAllocator
+{
+public:
+    static constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+    explicit RingAllocator(uint64_t size) : _size(size) { assert(size > 0); }
+
+    // Returns INVALID_OFFSET when there isn't enough contiguous space left. Allocations
+    // never straddle the end of the ring, the tail end is skipped instead.
+    uint64_t Allocate(uint64_t size, uint64_t alignment)
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+        if (size == 0 || size > _size || _usedSize == _size)
+            return INVALID_OFFSET;
+
+        // Nothing in flight, start over from the beginning to keep allocations packed.
+        if (_usedSize == 0)
+        {
+            _head = 0;
+            _tail = 0;
+
+            // Any frame still pending is empty, make sure retiring it doesn't move the tail.
+            for (FrameMarker& frame : _frames)
+                frame.end = 0;
+        }
+
+        uint64_t alignedHead{ AlignUp(_head, alignment) };
+
+        if (_head >= _tail)
+        {
+            if (alignedHead + size <= _size)
+                return Commit(alignedHead, size, alignedHead + size - _head);
+
+            // Wrap around, offset zero satisfies every power of two alignment.
+            if (size <= _tail)
+                return Commit(0, size, (_size - _head) + size);
+        }
+        else if (alignedHead + size <= _tail)
+        {
+            return Commit(alignedHead, size, alignedHead + size - _head);
+        }
+
+        return INVALID_OFFSET;
+    }
+
+    // Tags everything allocated since the previous call with fenceValue.
+    void FinishFrame(uint64_t fenceValue)
+    {
+        assert((_frames.empty() || _frames.back().fence < fenceValue) && "Fence values must increase monotonically.");
+
+        _frames.push_back({ fenceValue, _head, _frameSize });
+        _frameSize = 0;
+    }
+
+    // Releases the space of every frame whose fence is at or below completedFence.
+    void Retire(uint64_t completedFence)
+    {
+        while (!_frames.empty() && _frames.front().fence <= completedFence)
+        {
+            _tail = _frames.front().end;
+            _usedSize -= _frames.front().size;
+            _frames.pop_front();
+        }
+    }
+
+    uint64_t Size() const { return _size; }
+    uint64_t UsedSize() const { return _usedSize; }
+    uint64_t FramesInFlight() const { return _frames.size(); }
+    // Fence of the oldest finished frame still holding space, zero if there is none. Waiting
+    // for it and retiring is how a full ring makes room.
+    uint64_t OldestFence() const { return _frames.empty() ? 0 : _frames.front().fence; }
+
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+private:
+    struct FrameMarker
+    {
+        uint64_t fence;
+        uint64_t end;
+        uint64_t size;
+    };
+
+    // consumed includes alignment padding and the skipped tail end when wrapping.
+    uint64_t Commit(uint64_t offset, uint64_t size, uint64_t consumed)
+    {
+        _head = offset + size;
+        _usedSize += consumed;
+        _frameSize += consumed;
+        return offset;
+    }
+
+    std::deque<FrameMarker> _frames;
+
+    uint64_t _size;
+    uint64_t _head = 0;
+    uint64_t _tail = 0;
+    uint64_t _usedSize = 0;
+    uint64_t _frameSize = 0;
+};
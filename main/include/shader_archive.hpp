@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "memory_mapped_file.hpp"
+
+// Everything that decides what a compiled shader looks like. The preprocessed source
+// already has every include expanded into it.
+struct ShaderKeyDesc
+{
+    std::string_view preprocessedSource;
+    std::span<const std::pair<std::string_view, std::string_view>> defines;
+    std::string_view entryPoint;
+    std::string_view target;
+    uint32_t flags = 0;
+};
+
+// Content addressed store of compiled shaders in a single memory mapped file. Lookups are a
+// binary search over a sorted table, hits point straight into the mapping.
+//
+// Layout, little endian:
+//   u32 magic, u32 version, u32 entryCount, u32 reserved
+//   entryCount x { u64 key, u64 offset, u64 size }, sorted by key
+//   blobs, each aligned to DATA_ALIGNMENT
+class ShaderArchive
+{
+public:
+    static constexpr uint32_t MAGIC = 0x41444853; // "SHDA"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t DATA_ALIGNMENT = 16;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t ENTRY_SIZE = 24;
+
+    using Entry = std::pair<uint64_t, std::span<const uint8_t>>;
+
+    // Fails on a missing or malformed file, the archive stays empty then.
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    // Empty when the key isn't stored.
+    std::span<const uint8_t> Find(uint64_t key) const;
+
+    uint32_t EntryCount() const { return _entryCount; }
+    Entry EntryAt(uint32_t index) const;
+
+    // Keeps the mapping alive for as long as anything points into it.
+    const std::shared_ptr<MemoryMappedFile>& File() const { return _file; }
+
+    // Later entries win over earlier ones with the same key.
+    static std::vector<uint8_t> Build(std::vector<Entry> entries);
+    static uint64_t Key(const ShaderKeyDesc& desc);
+
+private:
+    uint64_t KeyAt(uint32_t index) const;
+
+    std::shared_ptr<MemoryMappedFile> _file;
+    std::span<const uint8_t> _data;
+    uint32_t _entryCount = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "d3d12.h"
+#include "shader_archive.hpp"
+#include "util.hpp"
+#include "fwd.hpp"
+
+// Compiled shaders keyed by their preprocessed source, defines, entry point, target and
+// flags. Preprocessing is cheap next to compiling, hits are served straight out of the
+// mapped archive.
+class ShaderCache
+{
+public:
+    explicit ShaderCache(std::filesystem::path archivePath);
+
+    NON_COPYABLE(ShaderCache);
+    NON_MOVABLE(ShaderCache);
+
+    ComPtr<ID3DBlob> Compile(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entryPoint, const std::string& target);
+
+    // Writes an archive of everything compiled or hit since startup, entries nothing asked for
+    // are dropped. The archive in use is still mapped, so the new one is put next to it and
+    // swapped in on the next run.
+    void Save();
+
+private:
+    std::filesystem::path PendingPath() const;
+
+    std::filesystem::path _archivePath;
+    ShaderArchive _archive;
+
+    std::mutex _mutex;
+    std::unordered_map<uint64_t, ComPtr<ID3DBlob>> _compiled;
+    // Archive entries hit so far, the rest are stale.
+    std::unordered_set<uint64_t> _used;
+};
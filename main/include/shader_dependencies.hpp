@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Which shader programs have to be recompiled when a file changes. Every program depends
+// on its source file and everything it includes, directly or not.
+class ShaderDependencies
+{
+public:
+    using ProgramId = uint32_t;
+
+    // Replaces whatever the program depended on before, includes may have changed.
+    void SetFiles(ProgramId program, std::span<const std::filesystem::path> files);
+
+    // Programs depending on any of the changed files, sorted.
+    std::vector<ProgramId> Affected(std::span<const std::filesystem::path> changedFiles) const;
+
+    // The file itself followed by everything it pulls in through #include "..." or <...>.
+    // Includes resolve relative to the including file, ones that don't exist are skipped.
+    static std::vector<std::filesystem::path> ScanIncludes(const std::filesystem::path& file);
+
+    // Absolute and normalized, so paths from the watcher and the scanner compare equal.
+    static std::filesystem::path Normalize(const std::filesystem::path& path);
+
+private:
+    struct PathHash
+    {
+        size_t operator()(const std::filesystem::path& path) const { return std::filesystem::hash_value(path); }
+    };
+
+    std::unordered_map<std::filesystem::path, std::unordered_set<ProgramId>, PathHash> _programsByFile;
+    std::unordered_map<ProgramId, std::vector<std::filesystem::path>> _filesByProgram;
+};
@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "file_watcher.hpp"
+#include "job_system.hpp"
+#include "retire_queue.hpp"
+#include "shader_dependencies.hpp"
+
+struct ShaderProgramDesc
+{
+    std::filesystem::path file;
+    std::vector<std::pair<std::string, std::string>> defines;
+    std::string entryPoint;
+    std::string target;
+};
+
+// Recompiles shader programs whose source or includes changed on disk and rebuilds the
+// pipelines using them, all on background jobs. Update is called once per frame on the
+// render thread and is the only place results become visible, old pipelines are retired
+// against the fence of the last submitted frame instead of flushing the queue.
+//
+// Backend provides:
+//   Blob and Pipeline, copyable handles
+//   Blob Compile(const ShaderProgramDesc& desc)
+//   Pipeline Build(PipelineId pipeline, std::span<const Blob> programs)
+// Both are called from worker threads, possibly at the same time, and report failure by
+// throwing. A failed program or pipeline keeps its previous version.
+template <typename Backend>
+class ShaderHotReload
+{
+public:
+    using Blob = typename Backend::Blob;
+    using Pipeline = typename Backend::Pipeline;
+    using ProgramId = ShaderDependencies::ProgramId;
+    using PipelineId = uint32_t;
+
+    // An empty watchDirectory doesn't watch anything, changes then come from NotifyChanged.
+    ShaderHotReload(Backend& backend, JobSystem& jobSystem, const std::filesystem::path& watchDirectory) :
+        _backend(backend),
+        _jobSystem(jobSystem)
+    {
+        if (!watchDirectory.empty())
+            _watcher = std::make_unique<FileWatcher>(watchDirectory);
+    }
+
+    ~ShaderHotReload() { _jobSystem.Wait(_jobs); }
+
+    ShaderHotReload(const ShaderHotReload&) = delete;
+    ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+    // blob is the version compiled at startup.
+    ProgramId AddProgram(ShaderProgramDesc desc, Blob blob)
+    {
+        ProgramId id{ static_cast<ProgramId>(_programs.size()) };
+        _dependencies.SetFiles(id, ShaderDependencies::ScanIncludes(desc.file));
+        _programs.push_back({ std::move(desc), std::move(blob) });
+        return id;
+    }
+
+    const Blob& ProgramBlob(ProgramId program) const { return _programs[program].blob; }
+
+    // programs are handed to Backend::Build in this order.
+    PipelineId AddPipeline(std::vector<ProgramId> programs, Pipeline pipeline)
+    {
+        _pipelines.push_back({ std::move(programs), std::move(pipeline) });
+        return static_cast<PipelineId>(_pipelines.size() - 1);
+    }
+
+    const Pipeline& GetPipeline(PipelineId pipeline) const { return _pipelines[pipeline].pipeline; }
+
+    void NotifyChanged(std::span<const std::filesystem::path> files)
+    {
+        _changedFiles.insert(_changedFiles.end(), files.begin(), files.end());
+    }
+
+    bool IsIdle() const { return _state == State::Idle && _changedFiles.empty(); }
+
+    // Advances the reload by at most one step without blocking. lastSubmittedFence is the
+    // fence value signalled after the last frame that may use the current pipelines,
+    // completedFence what the GPU has reached. Returns true when pipelines were swapped.
+    bool Update(uint64_t lastSubmittedFence, uint64_t completedFence)
+    {
+        _retired.Collect(completedFence);
+
+        if (_watcher)
+            NotifyChanged(_watcher->TakeChanges());
+
+        if (!_jobs.IsDone())
+            return false;
+
+        switch (_state)
+        {
+        case State::Idle:
+            StartCompiles();
+            return false;
+        case State::Compiling:
+            FinishCompiles();
+            return false;
+        case State::Building:
+            return FinishBuilds(lastSubmittedFence);
+        }
+        return false;
+    }
+
+private:
+    enum class State
+    {
+        Idle,
+        Compiling,
+        Building
+    };
+
+    struct Program
+    {
+        ShaderProgramDesc desc;
+        Blob blob;
+    };
+
+    struct PipelineEntry
+    {
+        std::vector<ProgramId> programs;
+        Pipeline pipeline;
+    };
+
+    // Jobs only touch their own slot, the render thread reads it once the counter is done.
+    struct CompileSlot
+    {
+        ProgramId program;
+        ShaderProgramDesc desc;
+        std::vector<std::filesystem::path> files;
+        std::optional<Blob> blob;
+    };
+
+    struct BuildSlot
+    {
+        PipelineId pipeline;
+        std::vector<Blob> programs;
+        std::optional<Pipeline> result;
+    };
+
+    void StartCompiles()
+    {
+        if (_changedFiles.empty())
+            return;
+
+        std::vector<ProgramId> affected{ _dependencies.Affected(_changedFiles) };
+        _changedFiles.clear();
+        if (affected.empty())
+            return;
+
+        _compileSlots.clear();
+        for (ProgramId program : affected)
+            _compileSlots.push_back({ program, _programs[program].desc, {}, std::nullopt });
+
+        for (CompileSlot& slot : _compileSlots)
+        {
+            Run([this, &slot]
+            {
+                // Includes are rescanned even if compiling fails, fixing a new include has to
+                // trigger the next attempt.
+                slot.files = ShaderDependencies::ScanIncludes(slot.desc.file);
+                try
+                {
+                    slot.blob = _backend.Compile(slot.desc);
+                }
+                catch (...)
+                {
+                }
+            });
+        }
+
+        _state = State::Compiling;
+    }
+
+    void FinishCompiles()
+    {
+        std::vector<ProgramId> recompiled;
+        for (CompileSlot& slot : _compileSlots)
+        {
+            _dependencies.SetFiles(slot.program, slot.files);
+            if (!slot.blob)
+                continue;
+
+            _programs[slot.program].blob = std::move(*slot.blob);
+            recompiled.push_back(slot.program);
+        }
+        _compileSlots.clear();
+
+        _buildSlots.clear();
+        for (PipelineId id = 0; id < _pipelines.size(); ++id)
+        {
+            const std::vector<ProgramId>& programs{ _pipelines[id].programs };
+            bool affected{ std::any_of(programs.begin(), programs.end(),
+                [&](ProgramId program) { return std::binary_search(recompiled.begin(), recompiled.end(), program); }) };
+            if (!affected)
+                continue;
+
+            BuildSlot slot{ id, {}, std::nullopt };
+            for (ProgramId program : programs)
+                slot.programs.push_back(_programs[program].blob);
+            _buildSlots.push_back(std::move(slot));
+        }
+
+        if (_buildSlots.empty())
+        {
+            _state = State::Idle;
+            return;
+        }
+
+        for (BuildSlot& slot : _buildSlots)
+        {
+            Run([this, &slot]
+            {
+                try
+                {
+                    slot.result = _backend.Build(slot.pipeline, slot.programs);
+                }
+                catch (...)
+                {
+                }
+            });
+        }
+
+        _state = State::Building;
+    }
+
+    bool FinishBuilds(uint64_t lastSubmittedFence)
+    {
+        bool swapped{ false };
+        for (BuildSlot& slot : _buildSlots)
+        {
+            if (!slot.result)
+                continue;
+
+            Pipeline& current{ _pipelines[slot.pipeline].pipeline };
+            _retired.Retire(std::move(current), lastSubmittedFence);
+            current = std::move(*slot.result);
+            swapped = true;
+        }
+        _buildSlots.clear();
+
+        _state = State::Idle;
+        return swapped;
+    }
+
+    void Run(std::function<void()> job)
+    {
+        // Background jobs need a thread other than this one.
+        if (_jobSystem.WorkerCount() > 1)
+            _jobSystem.ScheduleBackground(std::move(job), _jobs);
+        else
+            job();
+    }
+
+    Backend& _backend;
+    JobSystem& _jobSystem;
+    std::unique_ptr<FileWatcher> _watcher;
+
+    ShaderDependencies _dependencies;
+    std::vector<Program> _programs;
+    std::vector<PipelineEntry> _pipelines;
+    std::vector<std::filesystem::path> _changedFiles;
+
+    State _state = State::Idle;
+    JobCounter _jobs;
+    std::vector<CompileSlot> _compileSlots;
+    std::vector<BuildSlot> _buildSlots;
+
+    RetireQueue<Pipeline> _retired;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract range of offsets. Allocation and
+// free are O(1): free blocks are bucketed by size class (a power of two split into
+// SL_COUNT linear steps) and two bitmaps locate the first non-empty bucket that is large
+// enough. Block metadata lives outside the managed range, so it works just as well for
+// GPU heaps as for anything else.
+class TlsfAllocator
+{
+public:
+    static constexpr uint32_t INVALID_NODE = ~0u;
+
+    struct Allocation
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t node = INVALID_NODE;
+
+        explicit operator bool() const { return node != INVALID_NODE; }
+    };
+
+    explicit TlsfAllocator(uint64_t size);
+
+    // Returns an empty allocation when no free block can hold the request.
+    Allocation Allocate(uint64_t size, uint64_t alignment = 1);
+    void Free(const Allocation& allocation);
+
+    uint64_t Size() const { return _size; }
+    uint64_t FreeSize() const { return _freeSize; }
+    uint32_t AllocationCount() const { return _allocationCount; }
+    uint32_t FreeBlockCount() const { return _freeBlockCount; }
+    uint64_t LargestFreeBlock() const;
+    bool IsEmpty() const { return _allocationCount == 0; }
+
+private:
+    static constexpr uint32_t SL_BITS = 4;
+    static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+    static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+    struct Node
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t prevPhysical = INVALID_NODE;
+        uint32_t nextPhysical = INVALID_NODE;
+        uint32_t prevFree = INVALID_NODE;
+        uint32_t nextFree = INVALID_NODE;
+        bool free = false;
+    };
+
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+    static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+    static void MappingSearch(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+    uint32_t FindFreeNode(uint64_t size) const;
+    void InsertFree(uint32_t node);
+    void RemoveFree(uint32_t node);
+    uint32_t Split(uint32_t node, uint64_t size);
+    void Merge(uint32_t node, uint32_t next);
+
+    uint32_t CreateNode();
+    void ReleaseNode(uint32_t node);
+
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _unusedNodes;
+
+    uint64_t _flBitmap = 0;
+    std::array<uint32_t, FL_COUNT> _slBitmaps{};
+    std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> _freeLists;
+
+    uint64_t _size;
+    uint64_t _freeSize;
+    uint32_t _allocationCount = 0;
+    uint32_t _freeBlockCount = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <directxmath.h>
+#include <span>
+#include <vector>
+#include <entt/entity/registry.hpp>
+
+class JobSystem;
+
+// Change it through registry.patch or registry.replace so the transform system hears about it.
+struct LocalTransform
+{
+    DirectX::XMFLOAT3 position{ 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+    DirectX::XMFLOAT3 scale{ 1.0f, 1.0f, 1.0f };
+};
+
+// Owned by the transform system, every entity with a LocalTransform gets one.
+struct WorldTransform
+{
+    DirectX::XMFLOAT4X4 matrix{
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f };
+};
+
+// Entities without one, or whose parent has no LocalTransform, are roots.
+struct Parent
+{
+    entt::entity entity{ entt::null };
+};
+
+// Computes WorldTransform = local * parent's world for every entity with a LocalTransform.
+// The transforms live in structure of arrays form sorted by depth, so each level only reads
+// the one above it and runs in parallel chunks. Only dirty entities and their descendants
+// get recomputed, a frame where nothing moved costs nothing. Hierarchy changes re-sort
+// everything on the next update.
+class TransformSystem
+{
+public:
+    static constexpr uint32_t NO_PARENT = ~0u;
+    // Transforms per job within a level.
+    static constexpr uint32_t CHUNK_SIZE = 1024;
+
+    explicit TransformSystem(entt::registry& registry);
+    ~TransformSystem();
+
+    TransformSystem(const TransformSystem&) = delete;
+    TransformSystem& operator=(const TransformSystem&) = delete;
+
+    void Update(JobSystem& jobSystem);
+
+    // Entities whose WorldTransform changed in the last update, parents before children.
+    std::span<const entt::entity> Updated() const { return _updated; }
+
+    uint32_t Count() const { return static_cast<uint32_t>(_entities.size()); }
+    uint32_t LevelCount() const { return _levelBegin.empty() ? 0 : static_cast<uint32_t>(_levelBegin.size() - 1); }
+
+private:
+    void OnLocalConstructed(entt::registry& registry, entt::entity entity);
+    void OnLocalUpdated(entt::registry& registry, entt::entity entity);
+    void OnLocalDestroyed(entt::registry& registry, entt::entity entity);
+    void OnHierarchyChanged(entt::registry& registry, entt::entity entity);
+
+    entt::entity ParentOf(entt::entity entity) const;
+    void RebuildHierarchy();
+    void UpdateRange(uint32_t begin, uint32_t end, entt::storage_for_t<WorldTransform>& worldTransforms);
+
+    entt::registry& _registry;
+    bool _hierarchyDirty = false;
+    bool _anyDirty = false;
+    uint32_t _firstDirtyLevel = 0;
+
+    // Level d holds slots [_levelBegin[d], _levelBegin[d + 1]).
+    std::vector<uint32_t> _levelBegin;
+    std::vector<entt::entity> _entities;
+    std::vector<uint32_t> _parents;
+    std::vector<DirectX::XMFLOAT3> _positions;
+    std::vector<DirectX::XMFLOAT4> _rotations;
+    std::vector<DirectX::XMFLOAT3> _scales;
+    std::vector<DirectX::XMFLOAT4X4A> _worlds;
+    std::vector<uint8_t> _dirty;
+    // Slot of every entity, by entity index.
+    std::vector<uint32_t> _slots;
+
+    std::vector<entt::entity> _updated;
+};
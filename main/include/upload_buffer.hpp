@@ -1,52 +1,52 @@
 #pragma once
+#include <cassert>
 #include <cstdint>
+#include <cstring>
 
+#include "copy_kernels.hpp"
 #include "d3d12.h"
-#include "d3dx12.h"
+#include "upload_ring.hpp"
 #include "util.hpp"
 #include "fwd.hpp"
 
+// Typed view over an array of T living in a chunk of the upload ring. Doesn't own any
+// memory, the chunk is reclaimed together with the frame it was allocated in.
 template <typename T>
 class UploadBuffer
 {
 public:
-    UploadBuffer(ID3D12Device* device, uint32_t elementCount, bool isConstantBuffer) : _isConstantBuffer(isConstantBuffer)
+    UploadBuffer() = default;
+
+    template <typename Memory>
+    UploadBuffer(UploadRing<Memory>& ring, uint32_t elementCount, bool isConstantBuffer) : _isConstantBuffer(isConstantBuffer)
     {
         _elementByteSize = _isConstantBuffer ? D3dUtil::CalcConstantBufferByteSize(sizeof(T)) : sizeof(T);
 
-        ThrowIfFailed(device->CreateCommittedResource(
-            &keep(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD)),
-            D3D12_HEAP_FLAG_NONE,
-            &keep(CD3DX12_RESOURCE_DESC::Buffer(_elementByteSize* elementCount)),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&_uploadBuffer)));
-
-        ThrowIfFailed(_uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&_mappedData)));
+        _allocation = _isConstantBuffer ?
+            ring.AllocateConstants(static_cast<uint64_t>(_elementByteSize) * elementCount) :
+            ring.Allocate(static_cast<uint64_t>(_elementByteSize) * elementCount, alignof(T));
+        assert(_allocation && "Upload ring is out of space.");
     }
 
-    ~UploadBuffer()
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress(uint32_t elementIndex = 0) const
     {
-        if (_uploadBuffer)
-            _uploadBuffer->Unmap(0, nullptr);
-
-        _mappedData = nullptr;
+        return _allocation.gpuAddress + static_cast<uint64_t>(elementIndex) * _elementByteSize;
     }
 
-    NON_COPYABLE(UploadBuffer);
-    NON_MOVABLE(UploadBuffer);
-
-    ID3D12Resource* Resource() const { return _uploadBuffer.Get(); }
+    // Upload memory is write-combined, write it through CopyKernels rather than piecemeal.
+    uint8_t* CpuAddress(uint32_t elementIndex = 0) const
+    {
+        return _allocation.cpuAddress + static_cast<uint64_t>(elementIndex) * _elementByteSize;
+    }
 
     void CopyData(uint32_t elementIndex, const T& data)
     {
-        memcpy(&_mappedData[elementIndex * _elementByteSize], &data, sizeof(T));
+        CopyKernels::StreamCopy(CpuAddress(elementIndex), &data, sizeof(T));
     }
 
 private:
-    ComPtr<ID3D12Resource> _uploadBuffer;
-    BYTE* _mappedData;
+    UploadAllocation _allocation;
 
-    uint32_t _elementByteSize;
-    bool _isConstantBuffer;
+    uint32_t _elementByteSize = 0;
+    bool _isConstantBuffer = false;
 };
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+#include "d3d12.h"
+#include "util.hpp"
+#include "fwd.hpp"
+
+// A single committed upload resource that stays mapped for its whole lifetime. Used as
+// the backing memory of UploadRing.
+class UploadHeap
+{
+public:
+    UploadHeap(ID3D12Device* device, uint64_t size);
+    ~UploadHeap();
+
+    NON_COPYABLE(UploadHeap);
+    NON_MOVABLE(UploadHeap);
+
+    uint8_t* CpuAddress() const { return _mappedData; }
+    uint64_t GpuAddress() const { return _resource->GetGPUVirtualAddress(); }
+    uint64_t Size() const { return _size; }
+
+    ID3D12Resource* Resource() const { return _resource.Get(); }
+
+private:
+    ComPtr<ID3D12Resource> _resource;
+    uint8_t* _mappedData = nullptr;
+    uint64_t _size;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+
+#include "ring_allocator.hpp"
+
+constexpr uint64_t CONSTANT_BUFFER_ALIGNMENT = 256;
+
+struct UploadAllocation
+{
+    uint8_t* cpuAddress = nullptr;
+    uint64_t gpuAddress = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+
+    explicit operator bool() const { return cpuAddress != nullptr; }
+};
+
+// Persistently mapped upload memory shared by every system that needs to get data to the
+// GPU. Space is handed out per frame and reclaimed once that frame's fence has retired.
+// Memory is the mapped backing, anything exposing CpuAddress(), GpuAddress() and Size()
+// works, so the ring can also run on plain system memory.
+template <typename Memory>
+class UploadRing
+{
+public:
+    explicit UploadRing(Memory& memory) : _memory(memory), _allocator(memory.Size()) {}
+
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    // Returns an empty allocation when the ring is full.
+    UploadAllocation Allocate(uint64_t size, uint64_t alignment)
+    {
+        uint64_t offset{ _allocator.Allocate(size, alignment) };
+        if (offset == RingAllocator::INVALID_OFFSET)
+            return {};
+
+        UploadAllocation allocation;
+        allocation.cpuAddress = _memory.CpuAddress() + offset;
+        allocation.gpuAddress = _memory.GpuAddress() + offset;
+        allocation.offset = offset;
+        allocation.size = size;
+
+        return allocation;
+    }
+
+    UploadAllocation AllocateConstants(uint64_t size)
+    {
+        return Allocate(RingAllocator::AlignUp(size, CONSTANT_BUFFER_ALIGNMENT), CONSTANT_BUFFER_ALIGNMENT);
+    }
+
+    void FinishFrame(uint64_t fenceValue) { _allocator.FinishFrame(fenceValue); }
+    void Retire(uint64_t completedFence) { _allocator.Retire(completedFence); }
+
+    Memory& Backing() { return _memory; }
+    const RingAllocator& Allocator() const { return _allocator; }
+
+private:
+    Memory& _memory;
+    RingAllocator _allocator;
+};
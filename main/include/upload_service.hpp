@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "copy_kernels.hpp"
+#include "ring_allocator.hpp"
+
+struct UploadTicket
+{
+    uint64_t id = 0;
+
+    explicit operator bool() const { return id != 0; }
+};
+
+// Collects upload requests from any thread into pooled staging pages and submits them in
+// batches on a dedicated queue. Every request gets a ticket that can be polled or waited on.
+//
+// Queue is the backend doing the actual copies. It has to provide:
+//   Page, with uint8_t* CpuAddress() and uint64_t Size()
+//   Destination, copyable description of where the data goes
+//   std::unique_ptr<Page> CreatePage(uint64_t size)
+//   void RecordCopy(const Page& page, uint64_t offset, const Destination& destination, uint64_t size)
+//   uint64_t Execute(), submits everything recorded so far and returns the fence signalled after it
+//   uint64_t CompletedValue() const
+//   void Wait(uint64_t fenceValue)
+template <typename Queue>
+class UploadService
+{
+public:
+    using Page = typename Queue::Page;
+    using Destination = typename Queue::Destination;
+
+    UploadService(Queue& queue, uint64_t pageSize) : _queue(queue), _pageSize(pageSize) {}
+
+    UploadService(const UploadService&) = delete;
+    UploadService& operator=(const UploadService&) = delete;
+
+    // write receives a pointer to size bytes of staging memory to fill in. It runs under the
+    // service's lock, so keep it to copying.
+    template <typename Writer>
+    UploadTicket Enqueue(const Destination& destination, uint64_t size, uint64_t alignment, Writer&& write)
+    {
+        std::lock_guard lock{ _mutex };
+
+        StagingPage& page{ AllocateStaging(size, alignment) };
+        uint64_t offset{ RingAllocator::AlignUp(page.used, alignment) };
+        page.used = offset + size;
+
+        write(page.page->CpuAddress() + offset);
+        _pending.push_back({ destination, page.page.get(), offset, size });
+
+        return UploadTicket{ ++_lastTicket };
+    }
+
+    UploadTicket Enqueue(const Destination& destination, const void* data, uint64_t size, uint64_t alignment = 16)
+    {
+        return Enqueue(destination, size, alignment, [data, size](uint8_t* staging) { CopyKernels::StreamCopy(staging, data, size); });
+    }
+
+    // Records every pending request into one batch and submits it.
+    void Flush()
+    {
+        std::lock_guard lock{ _mutex };
+        FlushLocked();
+    }
+
+    // Fence value of the batch that carries ticket, zero while it hasn't been submitted.
+    uint64_t FenceOf(UploadTicket ticket) const
+    {
+        std::lock_guard lock{ _mutex };
+        return FenceOfLocked(ticket);
+    }
+
+    bool IsComplete(UploadTicket ticket) const
+    {
+        uint64_t fence{ FenceOf(ticket) };
+        return fence != 0 && _queue.CompletedValue() >= fence;
+    }
+
+    void Wait(UploadTicket ticket)
+    {
+        uint64_t fence;
+        {
+            std::lock_guard lock{ _mutex };
+            if (ticket.id > _lastSubmittedTicket)
+                FlushLocked();
+
+            fence = FenceOfLocked(ticket);
+        }
+
+        _queue.Wait(fence);
+    }
+
+private:
+    struct StagingPage
+    {
+        std::unique_ptr<Page> page;
+        uint64_t used = 0;
+        uint64_t fence = 0;
+        bool dedicated = false;
+    };
+
+    struct PendingCopy
+    {
+        Destination destination;
+        const Page* page;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Batch
+    {
+        uint64_t lastTicket;
+        uint64_t fence;
+    };
+
+    StagingPage& AllocateStaging(uint64_t size, uint64_t alignment)
+    {
+        if (!_openPages.empty())
+        {
+            StagingPage& current{ *_openPages.back() };
+            if (!current.dedicated && RingAllocator::AlignUp(current.used, alignment) + size <= current.page->Size())
+                return current;
+        }
+
+        Retire();
+
+        // Requests that don't fit a regular page get one of their own that isn't pooled.
+        if (size > _pageSize)
+        {
+            auto page{ std::make_unique<StagingPage>() };
+            page->page = _queue.CreatePage(size);
+            page->dedicated = true;
+            _openPages.emplace_back(std::move(page));
+        }
+        else if (!_freePages.empty())
+        {
+            _openPages.emplace_back(std::move(_freePages.back()));
+            _freePages.pop_back();
+        }
+        else
+        {
+            auto page{ std::make_unique<StagingPage>() };
+            page->page = _queue.CreatePage(_pageSize);
+            _openPages.emplace_back(std::move(page));
+        }
+
+        return *_openPages.back();
+    }
+
+    void FlushLocked()
+    {
+        if (_pending.empty())
+            return;
+
+        for (const PendingCopy& copy : _pending)
+            _queue.RecordCopy(*copy.page, copy.offset, copy.destination, copy.size);
+        _pending.clear();
+
+        uint64_t fence{ _queue.Execute() };
+        _batches.push_back({ _lastTicket, fence });
+        _lastSubmittedTicket = _lastTicket;
+
+        for (auto& page : _openPages)
+        {
+            page->fence = fence;
+            _inFlightPages.emplace_back(std::move(page));
+        }
+        _openPages.clear();
+
+        Retire();
+    }
+
+    uint64_t FenceOfLocked(UploadTicket ticket) const
+    {
+        if (ticket.id > _lastSubmittedTicket)
+            return 0;
+
+        if (ticket.id <= _retiredTicket)
+            return _retiredFence;
+
+        auto batch{ std::lower_bound(_batches.begin(), _batches.end(), ticket.id,
+            [](const Batch& b, uint64_t id) { return b.lastTicket < id; }) };
+        assert(batch != _batches.end());
+
+        return batch->fence;
+    }
+
+    void Retire()
+    {
+        uint64_t completed{ _queue.CompletedValue() };
+
+        while (!_inFlightPages.empty() && _inFlightPages.front()->fence <= completed)
+        {
+            std::unique_ptr<StagingPage> page{ std::move(_inFlightPages.front()) };
+            _inFlightPages.pop_front();
+
+            if (page->dedicated)
+                continue;
+
+            page->used = 0;
+            _freePages.emplace_back(std::move(page));
+        }
+
+        while (!_batches.empty() && _batches.front().fence <= completed)
+        {
+            _retiredTicket = _batches.front().lastTicket;
+            _retiredFence = _batches.front().fence;
+            _batches.pop_front();
+        }
+    }
+
+    Queue& _queue;
+    uint64_t _pageSize;
+
+    mutable std::mutex _mutex;
+
+    std::vector<PendingCopy> _pending;
+    std::vector<std::unique_ptr<StagingPage>> _openPages;
+    std::vector<std::unique_ptr<StagingPage>> _freePages;
+    std::deque<std::unique_ptr<StagingPage>> _inFlightPages;
+
+    std::deque<Batch> _batches;
+    uint64_t _lastTicket = 0;
+    uint64_t _lastSubmittedTicket = 0;
+    uint64_t _retiredTicket = 0;
+    uint64_t _retiredFence = 0;
+};
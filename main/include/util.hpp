@@ -1,12 +1,22 @@
 #pragma once
 
 #include <DirectXCollision.h>
+#include <array>
+#include <memory>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <wrl/client.h>
 
+#include "cooked_mesh.hpp"
+#include "gpu_heap_allocator.hpp"
+#include "memory_mapped_file.hpp"
+#include "meshlet.hpp"
+#include "upload_service.hpp"
 #include "fwd.hpp"
 
+class CopyQueue;
+
 template <class T>
 constexpr auto& keep(T&& x) noexcept
 {
@@ -43,7 +53,7 @@ public:
 }
 #endif
 
-ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, uint64_t byteSize, ComPtr<ID3D12Resource>& uploadBuffer);
+GpuAllocation CreateDefaultBuffer(GpuHeapAllocator& heapAllocator, UploadService<CopyQueue>& uploadService, const void* initData, uint64_t byteSize, UploadTicket& ticket);
 
 #define NON_COPYABLE(classname) \
         classname(const classname&) = delete; \
@@ -73,8 +83,20 @@ public:
         return (byteSize + 255) & ~255;
     }
 
+    static uint32_t ShaderCompileFlags();
     static ComPtr<ID3DBlob> CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entryPoint, const std::string& target);
+
+    // Both return blobs pointing into a read-only mapping instead of a copy, don't write to them.
     static ComPtr<ID3DBlob> LoadBinary(const std::wstring& fileName);
+    static ComPtr<ID3DBlob> LoadBinary(std::shared_ptr<MemoryMappedFile> file, std::span<const uint8_t> data);
+};
+
+struct SubmeshLod
+{
+    uint32_t indexCount = 0;
+    uint32_t startIndexLocation = 0;
+    // Deviation from the full submesh in mesh units.
+    float error = 0.0f;
 };
 
 struct SubmeshGeometry
@@ -83,23 +105,46 @@ struct SubmeshGeometry
     uint32_t startIndexLocation = 0;
     int32_t baseVertexLocation = 0;
     BoundingBox bounds;
+    // Quantized positions dequantize to positionOffset + unorm * positionScale, the identity
+    // for float positions.
+    XMFLOAT3 positionOffset{ 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 positionScale{ 1.0f, 1.0f, 1.0f };
+
+    // Range in MeshGeometry::meshlets, empty when the mesh was cooked without them.
+    uint32_t meshletOffset = 0;
+    uint32_t meshletCount = 0;
+
+    // Index ranges over the same vertices from full to coarsest, lods[0] is the range above.
+    uint32_t lodCount = 1;
+    std::array<SubmeshLod, MAX_SUBMESH_LODS + 1> lods{};
 };
 
 struct MeshGeometry
 {
     std::string name;
-    ComPtr<ID3DBlob> vertexBufferCPU = nullptr;
-    ComPtr<ID3DBlob> extraVertexBufferCPU = nullptr;
-    ComPtr<ID3DBlob> indexBufferCPU = nullptr;
 
-    ComPtr<ID3D12Resource> vertexBufferGPU = nullptr;
-    ComPtr<ID3D12Resource> extraVertexBufferGPU = nullptr;
-    ComPtr<ID3D12Resource> indexBufferGPU = nullptr;
+    // The CPU side streams are views, cpuStorage keeps whatever they point into alive. For
+    // cooked meshes that is the mapped file.
+    std::shared_ptr<const void> cpuStorage;
+    std::span<const uint8_t> vertexBufferCPU;
+    std::span<const uint8_t> extraVertexBufferCPU;
+    std::span<const uint8_t> indexBufferCPU;
+
+    // Clusters for culling on the CPU before the draw, and later for mesh shaders.
+    std::span<const Meshlet> meshlets;
+    std::span<const MeshletBounds> meshletBounds;
+    std::span<const uint32_t> meshletVertices;
+    std::span<const uint8_t> meshletTriangles;
+
+    GpuAllocation vertexBufferGPU;
+    GpuAllocation extraVertexBufferGPU;
+    GpuAllocation indexBufferGPU;
 
-    ComPtr<ID3D12Resource> vertexBufferUploader = nullptr;
-    ComPtr<ID3D12Resource> extraVertexBufferUploader = nullptr;
-    ComPtr<ID3D12Resource> indexBufferUploader = nullptr;
+    // Ticket of the last buffer upload, the earlier ones are in the same or an earlier batch.
+    UploadTicket uploadTicket;
 
+    // VertexFormatFlags of the streams, pipelines drawing this need the matching input layout.
+    uint32_t vertexFormat = 0;
     uint32_t vertexByteStride = 0;
     uint32_t vertexBufferByteSize = 0;
     uint32_t extraVertexByteStride = 0;
@@ -112,7 +157,7 @@ struct MeshGeometry
     D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const
     {
         D3D12_VERTEX_BUFFER_VIEW vbv;
-        vbv.BufferLocation = vertexBufferGPU->GetGPUVirtualAddress();
+        vbv.BufferLocation = vertexBufferGPU.GpuAddress();
         vbv.StrideInBytes = vertexByteStride;
         vbv.SizeInBytes = vertexBufferByteSize;
 
@@ -121,7 +166,7 @@ struct MeshGeometry
     D3D12_VERTEX_BUFFER_VIEW ExtraVertexBufferView() const
     {
         D3D12_VERTEX_BUFFER_VIEW evbv;
-        evbv.BufferLocation = extraVertexBufferGPU->GetGPUVirtualAddress();
+        evbv.BufferLocation = extraVertexBufferGPU.GpuAddress();
         evbv.StrideInBytes = extraVertexByteStride;
         evbv.SizeInBytes = extraVertexBufferByteSize;
 
@@ -130,17 +175,10 @@ struct MeshGeometry
     D3D12_INDEX_BUFFER_VIEW IndexBufferView() const
     {
         D3D12_INDEX_BUFFER_VIEW ibv;
-        ibv.BufferLocation = indexBufferGPU->GetGPUVirtualAddress();
+        ibv.BufferLocation = indexBufferGPU.GpuAddress();
         ibv.Format = indexFormat;
         ibv.SizeInBytes = indexBufferByteSize;
 
         return ibv;
     }
-
-    void DisposeUploaders()
-    {
-        vertexBufferUploader = nullptr;
-        extraVertexBufferUploader = nullptr;
-        indexBufferUploader = nullptr;
-    }
 };
@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "mesh_data.hpp"
+
+class JobSystem;
+
+enum VertexFormatFlags : uint32_t
+{
+    // Full floats everywhere, MeshVertex and MeshExtraVertex as they are.
+    VERTEX_FORMAT_FULL = 0,
+    // Octahedral normals and tangents, half float UVs and RGBA8 color.
+    VERTEX_FORMAT_PACKED_ATTRIBUTES = 1 << 0,
+    // unorm16 positions inside the submesh's quantization box.
+    VERTEX_FORMAT_QUANTIZED_POSITIONS = 1 << 1,
+
+    VERTEX_FORMAT_ALL = VERTEX_FORMAT_PACKED_ATTRIBUTES | VERTEX_FORMAT_QUANTIZED_POSITIONS,
+};
+
+// What the shader sees is always float, these say how it's stored.
+enum class VertexElementFormat : uint8_t
+{
+    Float2,
+    Float3,
+    Float4,
+    Half2,
+    Unorm16x4,
+    Snorm16x2,
+    Unorm8x4,
+};
+
+struct VertexElement
+{
+    const char* semantic;
+    uint32_t semanticIndex;
+    VertexElementFormat format;
+    uint32_t slot;
+    uint32_t offset;
+};
+
+// Position and UVs in slot 0, color, tangent and normal in slot 1, in that order.
+struct VertexLayout
+{
+    uint32_t vertexStride = 0;
+    uint32_t extraVertexStride = 0;
+    std::array<VertexElement, 6> elements{};
+};
+
+// The extra stream with VERTEX_FORMAT_PACKED_ATTRIBUTES, 12 bytes instead of 40.
+struct PackedExtraVertex
+{
+    uint8_t color[4];
+    int16_t tangent[2];
+    int16_t normal[2];
+};
+
+struct PackedVertexStreams
+{
+    uint32_t format = VERTEX_FORMAT_FULL;
+    VertexLayout layout;
+    std::vector<uint8_t> vertices;
+    std::vector<uint8_t> extraVertices;
+
+    // mesh.Describe() with these streams in place of the float ones.
+    CookedMeshDesc Describe(const MeshData& mesh) const;
+};
+
+namespace VertexPacking
+{
+    VertexLayout Layout(uint32_t format);
+
+    // Packs both streams in parallel. With VERTEX_FORMAT_QUANTIZED_POSITIONS it first fits
+    // every submesh's quantization box. Submeshes that share vertices, like LODs and their
+    // full submesh, share one box, so each vertex has exactly one encoding.
+    PackedVertexStreams Pack(MeshData& mesh, uint32_t format, JobSystem& jobSystem);
+
+    // The batch kernels, SSE2 where available and the scalar conversions below otherwise.
+    // Both give bit identical results. Each writes one element per vertex, stride apart.
+    void PackPositions(std::span<const MeshVertex> vertices, const float offset[3], const float scale[3], uint8_t* out, uint32_t stride);
+    void PackTexCoords(std::span<const MeshVertex> vertices, uint8_t* out, uint32_t stride);
+    void PackExtraVertices(std::span<const MeshExtraVertex> extraVertices, PackedExtraVertex* out);
+
+    // Round to nearest even, overflow goes to infinity.
+    uint16_t FloatToHalf(float value);
+    float HalfToFloat(uint16_t value);
+
+    // Needn't be normalized, a zero vector encodes as +z.
+    void OctEncode(const float vector[3], int16_t encoded[2]);
+    void OctDecode(const int16_t encoded[2], float vector[3]);
+
+    // value = offset + unorm * scale, scale being the box's size.
+    uint16_t QuantizeUnorm16(float value, float offset, float scale);
+    float DequantizeUnorm16(uint16_t value, float offset, float scale);
+
+    uint8_t QuantizeUnorm8(float value);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+// Chase-Lev deque with a fixed power of two capacity. The owning thread pushes and pops at
+// the bottom, any other thread steals from the top. Push fails instead of growing, callers
+// fall back to running the item themselves.
+template <typename T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(uint32_t capacity) :
+        _mask(capacity - 1),
+        _buffer(std::make_unique<std::atomic<T*>[]>(capacity))
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0 && "Capacity must be a power of two.");
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    bool Push(T* item)
+    {
+        int64_t bottom{ _bottom.load(std::memory_order_relaxed) };
+        int64_t top{ _top.load(std::memory_order_acquire) };
+        if (bottom - top > static_cast<int64_t>(_mask))
+            return false;
+
+        _buffer[bottom & _mask].store(item, std::memory_order_relaxed);
+        _bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only, takes the most recently pushed item.
+    T* Pop()
+    {
+        int64_t bottom{ _bottom.load(std::memory_order_relaxed) - 1 };
+        // Has to be ordered before reading top, or a thief and the owner can both take the
+        // last item.
+        _bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top{ _top.load(std::memory_order_seq_cst) };
+
+        if (top > bottom)
+        {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item{ _buffer[bottom & _mask].load(std::memory_order_relaxed) };
+        if (top == bottom)
+        {
+            // Last item, race the thieves for it.
+            if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    // Any thread, takes the oldest item.
+    T* Steal()
+    {
+        int64_t top{ _top.load(std::memory_order_seq_cst) };
+        int64_t bottom{ _bottom.load(std::memory_order_seq_cst) };
+
+        if (top >= bottom)
+            return nullptr;
+
+        T* item{ _buffer[top & _mask].load(std::memory_order_relaxed) };
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+
+        return item;
+    }
+
+    bool Empty() const
+    {
+        return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> _top{ 0 };
+    alignas(64) std::atomic<int64_t> _bottom{ 0 };
+    int64_t _mask;
+    std::unique_ptr<std::atomic<T*>[]> _buffer;
+};
@@ -0,0 +1,531 @@
+#include "aabb_tree.hpp"
+
+#include <array>
+#include <cfloat>
+#include <cstring>
+
+#include "job_system.hpp"
+
+namespace
+{
+    constexpr uint32_t SAH_BIN_COUNT = 12;
+    // Past this depth the build splits at the median, which bounds the tree height even
+    // when SAH keeps peeling single leaves off a cluster.
+    constexpr uint32_t MAX_SAH_DEPTH = 64;
+    // Queries per job in the batches.
+    constexpr uint32_t QUERY_GRAIN = 8;
+
+    constexpr Aabb EMPTY_BOX{ { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+    float Centroid(const Aabb& box, int axis)
+    {
+        return 0.5f * (box.min[axis] + box.max[axis]);
+    }
+
+    bool SameBox(const Aabb& a, const Aabb& b)
+    {
+        return std::memcmp(&a, &b, sizeof(Aabb)) == 0;
+    }
+
+    // Each query collects into its own list, the lists get stitched together afterwards.
+    template <typename Query>
+    void RunBatch(size_t count, QueryResults& results, JobSystem& jobSystem, Query&& query)
+    {
+        std::vector<std::vector<uint32_t>> found(count);
+        jobSystem.ParallelFor(static_cast<uint32_t>(count), QUERY_GRAIN, [&](uint32_t i) { query(i, found[i]); });
+
+        results.offsets.resize(count + 1);
+        results.offsets[0] = 0;
+        for (size_t i = 0; i < count; ++i)
+            results.offsets[i + 1] = results.offsets[i] + static_cast<uint32_t>(found[i].size());
+
+        results.payloads.resize(results.offsets[count]);
+        for (size_t i = 0; i < count; ++i)
+            std::copy(found[i].begin(), found[i].end(), results.payloads.begin() + results.offsets[i]);
+    }
+}
+
+AabbTree::NodeId AabbTree::Insert(const Aabb& box, uint32_t payload)
+{
+    NodeId leaf{ AllocateNode() };
+    _nodes[leaf].box = Fatten(box);
+    _nodes[leaf].height = 0;
+    _nodes[leaf].payload = payload;
+    _tightBoxes[leaf] = box;
+    InsertLeaf(leaf);
+    ++_leafCount;
+    return leaf;
+}
+
+void AabbTree::Remove(NodeId leaf)
+{
+    assert(leaf >= 0 && leaf < static_cast<NodeId>(_nodes.size()) && _nodes[leaf].height == 0 && "Not a leaf.");
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    --_leafCount;
+}
+
+bool AabbTree::Move(NodeId leaf, const Aabb& box)
+{
+    assert(leaf >= 0 && leaf < static_cast<NodeId>(_nodes.size()) && _nodes[leaf].height == 0 && "Not a leaf.");
+    _tightBoxes[leaf] = box;
+    if (_nodes[leaf].box.Contains(box))
+        return false;
+
+    _nodes[leaf].box = Fatten(box);
+    Refit(_nodes[leaf].parent);
+    return true;
+}
+
+float AabbTree::Cost() const
+{
+    if (_root == NULL_NODE || _nodes[_root].IsLeaf())
+        return 0.0f;
+
+    float area{ 0.0f };
+    for (const Node& node : _nodes)
+    {
+        if (node.height > 0)
+            area += node.box.SurfaceArea();
+    }
+    return area / _nodes[_root].box.SurfaceArea();
+}
+
+void AabbTree::Rebuild()
+{
+    std::vector<NodeId> leaves;
+    leaves.reserve(_leafCount);
+    for (NodeId node = 0; node < static_cast<NodeId>(_nodes.size()); ++node)
+    {
+        if (_nodes[node].height == 0)
+            leaves.push_back(node);
+        else if (_nodes[node].height > 0)
+            FreeNode(node);
+    }
+
+    _root = NULL_NODE;
+    if (!leaves.empty())
+    {
+        _root = Build(leaves, 0);
+        _nodes[_root].parent = NULL_NODE;
+    }
+    _builtCost = _leafCount == 0 ? 0.0f : Cost() / _leafCount;
+}
+
+bool AabbTree::RebuildIfDegraded(float ratio)
+{
+    if (_leafCount < 2)
+        return false;
+
+    // Per leaf, so inserts growing the tree don't count as wear.
+    if (_builtCost > 0.0f && Cost() / _leafCount <= _builtCost * ratio)
+        return false;
+
+    Rebuild();
+    return true;
+}
+
+RayHit AabbTree::RayCast(const Ray& ray) const
+{
+    RayHit hit;
+    if (_root == NULL_NODE)
+        return hit;
+
+    float inverse[3];
+    for (int axis = 0; axis < 3; ++axis)
+        inverse[axis] = 1.0f / ray.direction[axis];
+
+    // Slab test, returns where the ray enters the box or infinity when it misses before limit.
+    auto enter = [&](const Aabb& box, float limit)
+    {
+        float entry{ 0.0f };
+        float exit{ limit };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t0{ (box.min[axis] - ray.origin[axis]) * inverse[axis] };
+            float t1{ (box.max[axis] - ray.origin[axis]) * inverse[axis] };
+            if (inverse[axis] < 0.0f)
+                std::swap(t0, t1);
+            entry = std::max(entry, t0);
+            exit = std::min(exit, t1);
+        }
+        return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+    };
+
+    struct Entry
+    {
+        NodeId node;
+        float distance;
+    };
+
+    float limit{ ray.maxDistance };
+    Entry stack[MAX_STACK_DEPTH];
+    uint32_t size{ 0 };
+    float rootDistance{ enter(_nodes[_root].box, limit) };
+    if (rootDistance <= limit)
+        stack[size++] = { _root, rootDistance };
+
+    while (size > 0)
+    {
+        Entry entry{ stack[--size] };
+        if (entry.distance > limit)
+            continue;
+
+        const Node& node{ _nodes[entry.node] };
+        if (node.IsLeaf())
+        {
+            float distance{ enter(_tightBoxes[entry.node], limit) };
+            if (distance <= limit)
+            {
+                limit = distance;
+                hit = { node.payload, distance };
+            }
+            continue;
+        }
+
+        // Nearer child on top so it gets searched first and tightens the limit for the other.
+        Entry first{ node.children[0], enter(_nodes[node.children[0]].box, limit) };
+        Entry second{ node.children[1], enter(_nodes[node.children[1]].box, limit) };
+        if (first.distance < second.distance)
+            std::swap(first, second);
+
+        assert(size + 2 <= MAX_STACK_DEPTH && "Tree too deep to traverse.");
+        if (first.distance <= limit)
+            stack[size++] = first;
+        if (second.distance <= limit)
+            stack[size++] = second;
+    }
+
+    return hit;
+}
+
+void AabbTree::QueryOverlapBatch(std::span<const Aabb> boxes, QueryResults& results, JobSystem& jobSystem) const
+{
+    RunBatch(boxes.size(), results, jobSystem, [&](uint32_t query, std::vector<uint32_t>& found)
+    {
+        QueryOverlap(boxes[query], [&](uint32_t payload) { found.push_back(payload); });
+    });
+}
+
+void AabbTree::QueryFrustumBatch(std::span<const Frustum> frustums, QueryResults& results, JobSystem& jobSystem) const
+{
+    RunBatch(frustums.size(), results, jobSystem, [&](uint32_t query, std::vector<uint32_t>& found)
+    {
+        QueryFrustum(frustums[query], [&](uint32_t payload) { found.push_back(payload); });
+    });
+}
+
+void AabbTree::RayCastBatch(std::span<const Ray> rays, std::span<RayHit> hits, JobSystem& jobSystem) const
+{
+    assert(hits.size() >= rays.size() && "Not enough room for the hits.");
+    jobSystem.ParallelFor(static_cast<uint32_t>(rays.size()), QUERY_GRAIN, [&](uint32_t i) { hits[i] = RayCast(rays[i]); });
+}
+
+bool AabbTree::IntersectsFrustum(const Frustum& frustum, const Aabb& box)
+{
+    float center[3];
+    float extents[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        center[axis] = 0.5f * (box.min[axis] + box.max[axis]);
+        extents[axis] = 0.5f * (box.max[axis] - box.min[axis]);
+    }
+
+    // Same test as FrustumCuller, outside once the most positive corner is behind a plane.
+    for (const auto& plane : frustum.planes)
+    {
+        float distance{ plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3] };
+        float radius{ std::fabs(plane[0]) * extents[0] + std::fabs(plane[1]) * extents[1] + std::fabs(plane[2]) * extents[2] };
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+AabbTree::NodeId AabbTree::AllocateNode()
+{
+    if (_freeList == NULL_NODE)
+    {
+        _nodes.emplace_back();
+        _tightBoxes.emplace_back();
+        _freeList = static_cast<NodeId>(_nodes.size() - 1);
+        _nodes[_freeList].parent = NULL_NODE;
+        _nodes[_freeList].height = -1;
+    }
+
+    // Free nodes chain through their parent.
+    NodeId node{ _freeList };
+    _freeList = _nodes[node].parent;
+    _nodes[node].parent = NULL_NODE;
+    _nodes[node].children[0] = NULL_NODE;
+    _nodes[node].children[1] = NULL_NODE;
+    _nodes[node].height = 0;
+    _nodes[node].payload = 0;
+    return node;
+}
+
+void AabbTree::FreeNode(NodeId node)
+{
+    _nodes[node].parent = _freeList;
+    _nodes[node].height = -1;
+    _freeList = node;
+}
+
+void AabbTree::InsertLeaf(NodeId leaf)
+{
+    if (_root == NULL_NODE)
+    {
+        _root = leaf;
+        _nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down towards the cheapest sibling. Pairing with a node costs the area of the new
+    // parent, every ancestor above it grows by the same box.
+    Aabb box{ _nodes[leaf].box };
+    NodeId sibling{ _root };
+    while (!_nodes[sibling].IsLeaf())
+    {
+        const Node& node{ _nodes[sibling] };
+        float area{ node.box.SurfaceArea() };
+        float combinedArea{ Aabb::Union(node.box, box).SurfaceArea() };
+        float cost{ 2.0f * combinedArea };
+        float inheritanceCost{ 2.0f * (combinedArea - area) };
+
+        float childCosts[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            const Node& child{ _nodes[node.children[i]] };
+            float childArea{ Aabb::Union(child.box, box).SurfaceArea() };
+            if (!child.IsLeaf())
+                childArea -= child.box.SurfaceArea();
+            childCosts[i] = childArea + inheritanceCost;
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+            break;
+        sibling = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+    }
+
+    NodeId oldParent{ _nodes[sibling].parent };
+    NodeId newParent{ AllocateNode() };
+    _nodes[newParent].parent = oldParent;
+    _nodes[newParent].box = Aabb::Union(box, _nodes[sibling].box);
+    _nodes[newParent].height = _nodes[sibling].height + 1;
+    _nodes[newParent].children[0] = sibling;
+    _nodes[newParent].children[1] = leaf;
+    _nodes[sibling].parent = newParent;
+    _nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_NODE)
+        _root = newParent;
+    else if (_nodes[oldParent].children[0] == sibling)
+        _nodes[oldParent].children[0] = newParent;
+    else
+        _nodes[oldParent].children[1] = newParent;
+
+    for (NodeId node = _nodes[leaf].parent; node != NULL_NODE; node = _nodes[node].parent)
+    {
+        node = Balance(node);
+        Node& current{ _nodes[node] };
+        current.height = 1 + std::max(_nodes[current.children[0]].height, _nodes[current.children[1]].height);
+        current.box = Aabb::Union(_nodes[current.children[0]].box, _nodes[current.children[1]].box);
+    }
+}
+
+void AabbTree::RemoveLeaf(NodeId leaf)
+{
+    if (leaf == _root)
+    {
+        _root = NULL_NODE;
+        return;
+    }
+
+    NodeId parent{ _nodes[leaf].parent };
+    NodeId grandParent{ _nodes[parent].parent };
+    NodeId sibling{ _nodes[parent].children[0] == leaf ? _nodes[parent].children[1] : _nodes[parent].children[0] };
+    FreeNode(parent);
+
+    _nodes[sibling].parent = grandParent;
+    if (grandParent == NULL_NODE)
+    {
+        _root = sibling;
+        return;
+    }
+
+    if (_nodes[grandParent].children[0] == parent)
+        _nodes[grandParent].children[0] = sibling;
+    else
+        _nodes[grandParent].children[1] = sibling;
+
+    for (NodeId node = grandParent; node != NULL_NODE; node = _nodes[node].parent)
+    {
+        node = Balance(node);
+        Node& current{ _nodes[node] };
+        current.height = 1 + std::max(_nodes[current.children[0]].height, _nodes[current.children[1]].height);
+        current.box = Aabb::Union(_nodes[current.children[0]].box, _nodes[current.children[1]].box);
+    }
+}
+
+AabbTree::NodeId AabbTree::Balance(NodeId a)
+{
+    // Rotates the taller child up when a's children differ in height by more than one,
+    // the way Box2D's dynamic tree does. Returns whatever now sits where a was.
+    Node& nodeA{ _nodes[a] };
+    if (nodeA.IsLeaf() || nodeA.height < 2)
+        return a;
+
+    int tallSide{ _nodes[nodeA.children[1]].height > _nodes[nodeA.children[0]].height ? 1 : 0 };
+    NodeId tall{ nodeA.children[tallSide] };
+    NodeId shortChild{ nodeA.children[1 - tallSide] };
+    if (_nodes[tall].height - _nodes[shortChild].height <= 1)
+        return a;
+
+    // tall takes a's place, a keeps shortChild and the lower of tall's children.
+    Node& nodeT{ _nodes[tall] };
+    nodeT.parent = nodeA.parent;
+    nodeA.parent = tall;
+    if (nodeT.parent == NULL_NODE)
+        _root = tall;
+    else if (_nodes[nodeT.parent].children[0] == a)
+        _nodes[nodeT.parent].children[0] = tall;
+    else
+        _nodes[nodeT.parent].children[1] = tall;
+
+    NodeId f{ nodeT.children[0] };
+    NodeId g{ nodeT.children[1] };
+    NodeId keep{ _nodes[f].height > _nodes[g].height ? f : g };
+    NodeId give{ keep == f ? g : f };
+
+    nodeT.children[0] = a;
+    nodeT.children[1] = keep;
+    nodeA.children[tallSide] = give;
+    _nodes[give].parent = a;
+
+    nodeA.box = Aabb::Union(_nodes[shortChild].box, _nodes[give].box);
+    nodeA.height = 1 + std::max(_nodes[shortChild].height, _nodes[give].height);
+    nodeT.box = Aabb::Union(nodeA.box, _nodes[keep].box);
+    nodeT.height = 1 + std::max(nodeA.height, _nodes[keep].height);
+    return tall;
+}
+
+void AabbTree::Refit(NodeId node)
+{
+    for (; node != NULL_NODE; node = _nodes[node].parent)
+    {
+        Node& current{ _nodes[node] };
+        Aabb box{ Aabb::Union(_nodes[current.children[0]].box, _nodes[current.children[1]].box) };
+        if (SameBox(box, current.box))
+            break;
+        current.box = box;
+    }
+}
+
+AabbTree::NodeId AabbTree::Build(std::span<NodeId> leaves, uint32_t depth)
+{
+    if (leaves.size() == 1)
+        return leaves[0];
+
+    Aabb centroids{ EMPTY_BOX };
+    for (NodeId leaf : leaves)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float centroid{ Centroid(_nodes[leaf].box, axis) };
+            centroids.min[axis] = std::min(centroids.min[axis], centroid);
+            centroids.max[axis] = std::max(centroids.max[axis], centroid);
+        }
+    }
+
+    int axis{ 0 };
+    for (int i = 1; i < 3; ++i)
+    {
+        if (centroids.max[i] - centroids.min[i] > centroids.max[axis] - centroids.min[axis])
+            axis = i;
+    }
+
+    float extent{ centroids.max[axis] - centroids.min[axis] };
+    size_t split{ 0 };
+    if (extent > 0.0f && depth < MAX_SAH_DEPTH)
+    {
+        float binScale{ SAH_BIN_COUNT / extent };
+        auto binOf = [&](NodeId leaf)
+        {
+            uint32_t bin{ static_cast<uint32_t>((Centroid(_nodes[leaf].box, axis) - centroids.min[axis]) * binScale) };
+            return std::min(bin, SAH_BIN_COUNT - 1);
+        };
+
+        std::array<Aabb, SAH_BIN_COUNT> binBoxes;
+        std::array<uint32_t, SAH_BIN_COUNT> binCounts{};
+        binBoxes.fill(EMPTY_BOX);
+        for (NodeId leaf : leaves)
+        {
+            uint32_t bin{ binOf(leaf) };
+            binBoxes[bin] = Aabb::Union(binBoxes[bin], _nodes[leaf].box);
+            ++binCounts[bin];
+        }
+
+        // Cost of splitting after bin i: area times leaf count on either side.
+        std::array<float, SAH_BIN_COUNT> rightCosts{};
+        Aabb right{ EMPTY_BOX };
+        uint32_t rightCount{ 0 };
+        for (uint32_t bin = SAH_BIN_COUNT - 1; bin > 0; --bin)
+        {
+            right = Aabb::Union(right, binBoxes[bin]);
+            rightCount += binCounts[bin];
+            rightCosts[bin - 1] = rightCount == 0 ? 0.0f : right.SurfaceArea() * rightCount;
+        }
+
+        Aabb left{ EMPTY_BOX };
+        uint32_t leftCount{ 0 };
+        uint32_t bestBin{ SAH_BIN_COUNT };
+        float bestCost{ std::numeric_limits<float>::max() };
+        for (uint32_t bin = 0; bin + 1 < SAH_BIN_COUNT; ++bin)
+        {
+            left = Aabb::Union(left, binBoxes[bin]);
+            leftCount += binCounts[bin];
+            if (leftCount == 0 || leftCount == leaves.size())
+                continue;
+
+            float cost{ left.SurfaceArea() * leftCount + rightCosts[bin] };
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestBin = bin;
+            }
+        }
+
+        if (bestBin < SAH_BIN_COUNT)
+        {
+            auto middle{ std::partition(leaves.begin(), leaves.end(), [&](NodeId leaf) { return binOf(leaf) <= bestBin; }) };
+            split = static_cast<size_t>(middle - leaves.begin());
+        }
+    }
+
+    if (split == 0 || split == leaves.size())
+    {
+        split = leaves.size() / 2;
+        std::nth_element(leaves.begin(), leaves.begin() + split, leaves.end(), [&](NodeId a, NodeId b)
+        {
+            return Centroid(_nodes[a].box, axis) < Centroid(_nodes[b].box, axis);
+        });
+    }
+
+    NodeId left{ Build(leaves.subspan(0, split), depth + 1) };
+    NodeId right{ Build(leaves.subspan(split), depth + 1) };
+
+    NodeId node{ AllocateNode() };
+    _nodes[node].children[0] = left;
+    _nodes[node].children[1] = right;
+    _nodes[node].box = Aabb::Union(_nodes[left].box, _nodes[right].box);
+    _nodes[node].height = 1 + std::max(_nodes[left].height, _nodes[right].height);
+    _nodes[left].parent = node;
+    _nodes[right].parent = node;
+    return node;
+}
+
+Aabb AabbTree::Fatten(const Aabb& box) const
+{
+    return { { box.min[0] - _margin, box.min[1] - _margin, box.min[2] - _margin },
+             { box.max[0] + _margin, box.max[1] + _margin, box.max[2] + _margin } };
+}
@@ -1,6 +1,7 @@
 #include "precomp.hpp"
 #include "app.hpp"
 #include "device.hpp"
+#include "job_system.hpp"
 #include <util.hpp>
 
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -16,8 +17,10 @@ App::App(HINSTANCE hInstance, int32_t showCommand)
         if (!InitWindowsApp(hInstance, showCommand))
             return;
 
-        _device = std::make_shared<Device>(_mainWnd, INITIAL_WIDTH, INITIAL_HEIGHT);
-        _engine = std::make_unique<Engine>(_device);
+        // Created on this thread, which makes it the job system's main thread.
+        _jobSystem = std::make_shared<JobSystem>();
+        _device = std::make_shared<Device>(_mainWnd, INITIAL_WIDTH, INITIAL_HEIGHT, _jobSystem);
+        _engine = std::make_unique<Engine>(_device, _jobSystem);
 
         _initialized = true;
 
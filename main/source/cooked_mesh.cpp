@@ -0,0 +1,266 @@
+#include "cooked_mesh.hpp"
+
+#include <bit>
+#include <cassert>
+
+#include "binary_io.hpp"
+#include "vertex_packing.hpp"
+
+// The meshlet streams are written and mapped as is.
+static_assert(sizeof(Meshlet) == 16 && sizeof(MeshletBounds) == 48);
+
+namespace
+{
+    bool ValidRange(uint64_t offset, uint64_t size, size_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset && offset % CookedMesh::STREAM_ALIGNMENT == 0;
+    }
+
+    // Streams start STREAM_ALIGNMENT aligned in a page aligned mapping, so they can be used in place.
+    template<typename T>
+    std::span<const T> Cast(std::span<const uint8_t> data, uint64_t offset, uint64_t size)
+    {
+        static_assert(alignof(T) <= CookedMesh::STREAM_ALIGNMENT);
+        return { reinterpret_cast<const T*>(data.data() + offset), static_cast<size_t>(size / sizeof(T)) };
+    }
+
+    template<typename T>
+    std::span<const uint8_t> Bytes(std::span<const T> span)
+    {
+        return { reinterpret_cast<const uint8_t*>(span.data()), span.size_bytes() };
+    }
+}
+
+bool CookedMesh::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    auto file{ std::make_shared<MemoryMappedFile>() };
+    if (!file->Open(path))
+        return false;
+
+    std::span<const uint8_t> data{ file->Data() };
+    BinaryReader reader{ data };
+    if (reader.ReadU32() != MAGIC || reader.ReadU32() != VERSION)
+        return false;
+
+    uint32_t vertexFormat{ reader.ReadU32() };
+    uint32_t vertexStride{ reader.ReadU32() };
+    uint32_t extraVertexStride{ reader.ReadU32() };
+    uint32_t vertexCount{ reader.ReadU32() };
+    uint32_t indexSize{ reader.ReadU32() };
+    uint32_t indexCount{ reader.ReadU32() };
+    uint32_t submeshCount{ reader.ReadU32() };
+
+    uint64_t ranges[STREAM_COUNT * 2];
+    for (uint64_t& value : ranges)
+        value = reader.ReadU64();
+
+    if (reader.Failed() || (indexSize != 2 && indexSize != 4) || reader.Remaining() / SUBMESH_SIZE < submeshCount)
+        return false;
+
+    if ((vertexFormat & ~VERTEX_FORMAT_ALL) != 0)
+        return false;
+    VertexLayout layout{ VertexPacking::Layout(vertexFormat) };
+    if (vertexStride != layout.vertexStride || extraVertexStride != layout.extraVertexStride)
+        return false;
+
+    // The streams have to hold exactly what the header claims, the loader trusts the counts.
+    for (size_t i = 0; i < STREAM_COUNT; ++i)
+    {
+        if (!ValidRange(ranges[i * 2], ranges[i * 2 + 1], data.size()))
+            return false;
+    }
+    if (ranges[1] != uint64_t{ vertexStride } * vertexCount || ranges[3] != uint64_t{ extraVertexStride } * vertexCount || ranges[5] != uint64_t{ indexSize } * indexCount)
+        return false;
+
+    uint64_t meshletCount{ ranges[7] / sizeof(Meshlet) };
+    if (ranges[7] % sizeof(Meshlet) != 0 || ranges[9] != meshletCount * sizeof(MeshletBounds) || ranges[11] % sizeof(uint32_t) != 0 || ranges[13] % 3 != 0)
+        return false;
+
+    auto meshlets{ Cast<Meshlet>(data, ranges[6], ranges[7]) };
+    for (const Meshlet& meshlet : meshlets)
+    {
+        if (meshlet.vertexOffset > ranges[11] / sizeof(uint32_t) || meshlet.vertexCount > ranges[11] / sizeof(uint32_t) - meshlet.vertexOffset ||
+            meshlet.triangleOffset > ranges[13] / 3 || meshlet.triangleCount > ranges[13] / 3 - meshlet.triangleOffset)
+            return false;
+    }
+
+    std::span<const uint8_t> submeshTable{ reader.ReadSpan(submeshCount * SUBMESH_SIZE) };
+    std::span<const uint8_t> names{ data.subspan(reader.Offset()) };
+
+    BinaryReader table{ submeshTable };
+    uint32_t previousLodLevel{ 0 };
+    for (uint32_t i = 0; i < submeshCount; ++i)
+    {
+        uint32_t nameOffset{ table.ReadU32() };
+        uint32_t nameLength{ table.ReadU32() };
+        uint32_t count{ table.ReadU32() };
+        uint32_t start{ table.ReadU32() };
+        table.Skip(28);
+        uint32_t firstMeshlet{ table.ReadU32() };
+        uint32_t submeshMeshlets{ table.ReadU32() };
+        uint32_t lodLevel{ table.ReadU32() };
+        table.Skip(32);
+
+        if (nameOffset > names.size() || nameLength > names.size() - nameOffset || start > indexCount || count > indexCount - start ||
+            firstMeshlet > meshletCount || submeshMeshlets > meshletCount - firstMeshlet || lodLevel > MAX_SUBMESH_LODS ||
+            (lodLevel > 0 && (i == 0 || lodLevel != previousLodLevel + 1)))
+            return false;
+        previousLodLevel = lodLevel;
+    }
+
+    _file = std::move(file);
+    _vertexFormat = vertexFormat;
+    _submeshTable = submeshTable;
+    _names = names;
+    _vertices = data.subspan(ranges[0], ranges[1]);
+    _extraVertices = data.subspan(ranges[2], ranges[3]);
+    _indices = data.subspan(ranges[4], ranges[5]);
+    _meshlets = meshlets;
+    _meshletBounds = Cast<MeshletBounds>(data, ranges[8], ranges[9]);
+    _meshletVertices = Cast<uint32_t>(data, ranges[10], ranges[11]);
+    _meshletTriangles = data.subspan(ranges[12], ranges[13]);
+    _vertexStride = vertexStride;
+    _extraVertexStride = extraVertexStride;
+    _vertexCount = vertexCount;
+    _indexSize = indexSize;
+    _indexCount = indexCount;
+    _submeshCount = submeshCount;
+    return true;
+}
+
+void CookedMesh::Close()
+{
+    *this = CookedMesh{};
+}
+
+CookedSubmesh CookedMesh::SubmeshAt(uint32_t index) const
+{
+    assert(index < _submeshCount && "Submesh index out of range.");
+
+    BinaryReader reader{ _submeshTable.subspan(index * SUBMESH_SIZE, SUBMESH_SIZE) };
+    uint32_t nameOffset{ reader.ReadU32() };
+    uint32_t nameLength{ reader.ReadU32() };
+
+    CookedSubmesh submesh;
+    submesh.name.assign(reinterpret_cast<const char*>(_names.data()) + nameOffset, nameLength);
+    submesh.indexCount = reader.ReadU32();
+    submesh.startIndexLocation = reader.ReadU32();
+    submesh.baseVertexLocation = static_cast<int32_t>(reader.ReadU32());
+    for (float& value : submesh.boundsCenter)
+        value = std::bit_cast<float>(reader.ReadU32());
+    for (float& value : submesh.boundsExtents)
+        value = std::bit_cast<float>(reader.ReadU32());
+    submesh.meshletOffset = reader.ReadU32();
+    submesh.meshletCount = reader.ReadU32();
+    submesh.lodLevel = reader.ReadU32();
+    submesh.lodError = std::bit_cast<float>(reader.ReadU32());
+    for (float& value : submesh.positionOffset)
+        value = std::bit_cast<float>(reader.ReadU32());
+    for (float& value : submesh.positionScale)
+        value = std::bit_cast<float>(reader.ReadU32());
+    return submesh;
+}
+
+CookedMeshDesc CookedMesh::Describe() const
+{
+    CookedMeshDesc desc;
+    desc.vertexFormat = _vertexFormat;
+    desc.vertexStride = _vertexStride;
+    desc.extraVertexStride = _extraVertexStride;
+    desc.indexSize = _indexSize;
+    desc.vertices = _vertices;
+    desc.extraVertices = _extraVertices;
+    desc.indices = _indices;
+    desc.meshlets = _meshlets;
+    desc.meshletBounds = _meshletBounds;
+    desc.meshletVertices = _meshletVertices;
+    desc.meshletTriangles = _meshletTriangles;
+    for (uint32_t i = 0; i < _submeshCount; ++i)
+        desc.submeshes.push_back(SubmeshAt(i));
+    return desc;
+}
+
+std::vector<uint8_t> CookedMesh::Build(const CookedMeshDesc& desc)
+{
+    assert((desc.indexSize == 2 || desc.indexSize == 4) && "Indices are 16 or 32 bit.");
+    assert(desc.vertexStride > 0 && desc.vertices.size() % desc.vertexStride == 0 && "Vertex stream isn't a whole number of vertices.");
+
+    uint32_t vertexCount{ static_cast<uint32_t>(desc.vertices.size() / desc.vertexStride) };
+    assert(desc.extraVertices.size() == uint64_t{ desc.extraVertexStride } * vertexCount && "Vertex streams disagree on the vertex count.");
+
+    std::string names;
+    for (const CookedSubmesh& submesh : desc.submeshes)
+        names += submesh.name;
+
+    assert(desc.meshletBounds.size() == desc.meshlets.size() && "Every meshlet needs bounds.");
+
+    std::span<const uint8_t> streams[STREAM_COUNT]{ desc.vertices, desc.extraVertices, desc.indices,
+        Bytes(desc.meshlets), Bytes(desc.meshletBounds), Bytes(desc.meshletVertices), desc.meshletTriangles };
+
+    size_t namesOffset{ HEADER_SIZE + desc.submeshes.size() * SUBMESH_SIZE };
+    auto alignUp = [](uint64_t value) { return (value + STREAM_ALIGNMENT - 1) / STREAM_ALIGNMENT * STREAM_ALIGNMENT; };
+    uint64_t offsets[STREAM_COUNT];
+    uint64_t end{ namesOffset + names.size() };
+    for (size_t i = 0; i < STREAM_COUNT; ++i)
+    {
+        offsets[i] = alignUp(end);
+        end = offsets[i] + streams[i].size();
+    }
+
+    BinaryWriter writer;
+    writer.WriteU32(MAGIC);
+    writer.WriteU32(VERSION);
+    writer.WriteU32(desc.vertexFormat);
+    writer.WriteU32(desc.vertexStride);
+    writer.WriteU32(desc.extraVertexStride);
+    writer.WriteU32(vertexCount);
+    writer.WriteU32(desc.indexSize);
+    writer.WriteU32(static_cast<uint32_t>(desc.indices.size() / desc.indexSize));
+    writer.WriteU32(static_cast<uint32_t>(desc.submeshes.size()));
+    for (size_t i = 0; i < STREAM_COUNT; ++i)
+    {
+        writer.WriteU64(offsets[i]);
+        writer.WriteU64(streams[i].size());
+    }
+
+    uint32_t nameOffset{ 0 };
+    for (const CookedSubmesh& submesh : desc.submeshes)
+    {
+        writer.WriteU32(nameOffset);
+        writer.WriteU32(static_cast<uint32_t>(submesh.name.size()));
+        writer.WriteU32(submesh.indexCount);
+        writer.WriteU32(submesh.startIndexLocation);
+        writer.WriteU32(static_cast<uint32_t>(submesh.baseVertexLocation));
+        for (float value : submesh.boundsCenter)
+            writer.WriteU32(std::bit_cast<uint32_t>(value));
+        for (float value : submesh.boundsExtents)
+            writer.WriteU32(std::bit_cast<uint32_t>(value));
+        writer.WriteU32(submesh.meshletOffset);
+        writer.WriteU32(submesh.meshletCount);
+        writer.WriteU32(submesh.lodLevel);
+        writer.WriteU32(std::bit_cast<uint32_t>(submesh.lodError));
+        for (float value : submesh.positionOffset)
+            writer.WriteU32(std::bit_cast<uint32_t>(value));
+        for (float value : submesh.positionScale)
+            writer.WriteU32(std::bit_cast<uint32_t>(value));
+        writer.WriteU32(0);
+        nameOffset += static_cast<uint32_t>(submesh.name.size());
+    }
+
+    writer.WriteBytes(names.data(), names.size());
+    for (std::span<const uint8_t> stream : streams)
+    {
+        writer.Align(STREAM_ALIGNMENT);
+        writer.WriteBytes(stream.data(), stream.size());
+    }
+
+    assert(writer.Size() == end && "Layout and writer disagree.");
+    return std::move(writer.Data());
+}
+
+bool CookMesh(const std::filesystem::path& path, const CookedMeshDesc& desc)
+{
+    return WriteWholeFile(path, CookedMesh::Build(desc));
+}
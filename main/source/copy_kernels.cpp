@@ -0,0 +1,292 @@
+#include "copy_kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define COPY_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2 kernels get built for AVX2 whatever the target, they only run once it's detected.
+#if defined(__GNUC__) || defined(__clang__)
+#define COPY_KERNELS_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define COPY_KERNELS_AVX2_TARGET
+#endif
+
+using namespace CopyKernels;
+using CpuFeatures::Isa;
+
+namespace
+{
+    constexpr size_t LINE_SIZE = 64;
+    // Packed strided copies gather this much in cached memory before streaming it out.
+    constexpr size_t GATHER_BLOCK_SIZE = 4096;
+    // Matrix writes smaller than this use plain stores.
+    constexpr size_t MIN_STREAMED_MATRIX_SIZE = 4 * LINE_SIZE;
+
+    struct Kernels
+    {
+        // destination is line aligned.
+        void (*copyLines)(uint8_t* destination, const uint8_t* source, size_t lineCount);
+        // destination is 16-byte aligned.
+        void (*store16)(uint8_t* destination, const uint8_t* source);
+        // Write rowCount rows of each transpose. The streaming one needs destination 16-byte
+        // aligned, the other one uses plain stores.
+        void (*streamTranspose)(float* destination, const float* source, size_t count, uint32_t rowCount);
+        void (*storeTranspose)(float* destination, const float* source, size_t count, uint32_t rowCount);
+        void (*fence)();
+    };
+
+    void CopyLinesScalar(uint8_t* destination, const uint8_t* source, size_t lineCount)
+    {
+        memcpy(destination, source, lineCount * LINE_SIZE);
+    }
+
+    void Store16Scalar(uint8_t* destination, const uint8_t* source)
+    {
+        memcpy(destination, source, 16);
+    }
+
+    void TransposeScalar(float* destination, const float* source, size_t count, uint32_t rowCount)
+    {
+        for (size_t matrix = 0; matrix < count; ++matrix, source += 16, destination += rowCount * 4)
+        {
+            // Transposed in cached memory first, the destination only sees whole rows.
+            float transposed[16];
+            for (uint32_t row = 0; row < rowCount; ++row)
+            {
+                for (uint32_t column = 0; column < 4; ++column)
+                    transposed[row * 4 + column] = source[column * 4 + row];
+            }
+            memcpy(destination, transposed, rowCount * 4 * sizeof(float));
+        }
+    }
+
+    void FenceScalar() {}
+
+#if COPY_KERNELS_X86
+    void CopyLinesSse2(uint8_t* destination, const uint8_t* source, size_t lineCount)
+    {
+        for (size_t line = 0; line < lineCount; ++line, destination += LINE_SIZE, source += LINE_SIZE)
+        {
+            __m128i a{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)) };
+            __m128i b{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16)) };
+            __m128i c{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 32)) };
+            __m128i d{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 48)) };
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 48), d);
+        }
+    }
+
+    void Store16Sse2(uint8_t* destination, const uint8_t* source)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination), _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+    }
+
+    template <bool Stream>
+    void TransposeSse2(float* destination, const float* source, size_t count, uint32_t rowCount)
+    {
+        for (size_t matrix = 0; matrix < count; ++matrix, source += 16, destination += rowCount * 4)
+        {
+            __m128 rows[4]{ _mm_loadu_ps(source), _mm_loadu_ps(source + 4), _mm_loadu_ps(source + 8), _mm_loadu_ps(source + 12) };
+            _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+
+            for (uint32_t row = 0; row < rowCount; ++row)
+            {
+                if constexpr (Stream)
+                    _mm_stream_ps(destination + row * 4, rows[row]);
+                else
+                    _mm_storeu_ps(destination + row * 4, rows[row]);
+            }
+        }
+    }
+
+    void FenceSse2()
+    {
+        _mm_sfence();
+    }
+
+    COPY_KERNELS_AVX2_TARGET void CopyLinesAvx2(uint8_t* destination, const uint8_t* source, size_t lineCount)
+    {
+        for (size_t line = 0; line < lineCount; ++line, destination += LINE_SIZE, source += LINE_SIZE)
+        {
+            __m256i a{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)) };
+            __m256i b{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 32)) };
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(destination), a);
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 32), b);
+        }
+    }
+#endif
+
+    const Kernels SCALAR_KERNELS{ CopyLinesScalar, Store16Scalar, TransposeScalar, TransposeScalar, FenceScalar };
+#if COPY_KERNELS_X86
+    const Kernels SSE2_KERNELS{ CopyLinesSse2, Store16Sse2, TransposeSse2<true>, TransposeSse2<false>, FenceSse2 };
+    // Matrix rows and single elements are 16 bytes, only whole lines gain from AVX2.
+    const Kernels AVX2_KERNELS{ CopyLinesAvx2, Store16Sse2, TransposeSse2<true>, TransposeSse2<false>, FenceSse2 };
+#endif
+
+    std::atomic<Isa>& SelectedIsa()
+    {
+        static std::atomic<Isa> isa{ CpuFeatures::Detected() };
+        return isa;
+    }
+
+    const Kernels& Active()
+    {
+        switch (SelectedIsa().load(std::memory_order_relaxed))
+        {
+#if COPY_KERNELS_X86
+        case Isa::Avx2:
+            return AVX2_KERNELS;
+        case Isa::Sse2:
+            return SSE2_KERNELS;
+#endif
+        default:
+            return SCALAR_KERNELS;
+        }
+    }
+
+    // Whole lines get streamed, the ragged ends written as is. Leaves the fence to the caller.
+    void Stream(const Kernels& kernels, uint8_t* destination, const uint8_t* source, size_t size)
+    {
+        if (size < LINE_SIZE)
+        {
+            memcpy(destination, source, size);
+            return;
+        }
+
+        size_t head{ (LINE_SIZE - reinterpret_cast<uintptr_t>(destination) % LINE_SIZE) % LINE_SIZE };
+        memcpy(destination, source, head);
+
+        size_t lineCount{ (size - head) / LINE_SIZE };
+        kernels.copyLines(destination + head, source + head, lineCount);
+
+        size_t copied{ head + lineCount * LINE_SIZE };
+        memcpy(destination + copied, source + copied, size - copied);
+    }
+
+    void Transpose(float* destination, const float* source, size_t count, uint32_t rowCount)
+    {
+        // Streaming stores need aligned rows, and only pay off once they fill lines. A few
+        // matrices go through the write-combining buffers just as well with plain stores.
+        const Kernels& kernels{ Active() };
+        if (reinterpret_cast<uintptr_t>(destination) % 16 == 0 && count * rowCount * 16 >= MIN_STREAMED_MATRIX_SIZE)
+            kernels.streamTranspose(destination, source, count, rowCount);
+        else
+            kernels.storeTranspose(destination, source, count, rowCount);
+    }
+
+    template <size_t Size>
+    void GatherFixed(uint8_t* block, const uint8_t* source, size_t sourceStride, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            memcpy(block + i * Size, source + i * sourceStride, Size);
+    }
+
+    void Gather(uint8_t* block, const uint8_t* source, size_t sourceStride, size_t elementSize, size_t count)
+    {
+        switch (elementSize)
+        {
+        case 4:
+            GatherFixed<4>(block, source, sourceStride, count);
+            break;
+        case 8:
+            GatherFixed<8>(block, source, sourceStride, count);
+            break;
+        case 16:
+            GatherFixed<16>(block, source, sourceStride, count);
+            break;
+        default:
+            for (size_t i = 0; i < count; ++i)
+                memcpy(block + i * elementSize, source + i * sourceStride, elementSize);
+            break;
+        }
+    }
+}
+
+Isa CopyKernels::Selected()
+{
+    return SelectedIsa().load(std::memory_order_relaxed);
+}
+
+void CopyKernels::Select(Isa isa)
+{
+    assert(isa <= CpuFeatures::Detected() && "The CPU doesn't support these kernels.");
+    SelectedIsa().store(std::min(isa, CpuFeatures::Detected()), std::memory_order_relaxed);
+}
+
+void CopyKernels::Fence()
+{
+    Active().fence();
+}
+
+void CopyKernels::StreamCopy(void* destination, const void* source, size_t size)
+{
+    const Kernels& kernels{ Active() };
+    Stream(kernels, static_cast<uint8_t*>(destination), static_cast<const uint8_t*>(source), size);
+    kernels.fence();
+}
+
+void CopyKernels::StreamTransposed4x4(float* destination, const float* source, size_t count)
+{
+    Transpose(destination, source, count, 4);
+}
+
+void CopyKernels::StreamTransposed3x4(float* destination, const float* source, size_t count)
+{
+    Transpose(destination, source, count, 3);
+}
+
+void CopyKernels::StridedCopy(void* destination, size_t destinationStride, const void* source, size_t sourceStride, size_t elementSize, size_t count)
+{
+    uint8_t* dst{ static_cast<uint8_t*>(destination) };
+    const uint8_t* src{ static_cast<const uint8_t*>(source) };
+    const Kernels& kernels{ Active() };
+
+    if (destinationStride == elementSize && sourceStride == elementSize)
+    {
+        Stream(kernels, dst, src, count * elementSize);
+    }
+    else if (destinationStride == elementSize && elementSize <= GATHER_BLOCK_SIZE)
+    {
+        // Small elements are gathered in cached memory first, so the destination only sees
+        // whole lines.
+        alignas(LINE_SIZE) uint8_t block[GATHER_BLOCK_SIZE];
+        size_t blockCount{ GATHER_BLOCK_SIZE / elementSize };
+        for (size_t first = 0; first < count; first += blockCount)
+        {
+            size_t gathered{ std::min(blockCount, count - first) };
+            Gather(block, src + first * sourceStride, sourceStride, elementSize, gathered);
+            Stream(kernels, dst + first * elementSize, block, gathered * elementSize);
+        }
+    }
+    else
+    {
+        // Scattered elements stream on their own if they span lines, or if they are made of
+        // aligned 16-byte pieces.
+        bool aligned{ elementSize % 16 == 0 && destinationStride % 16 == 0 && reinterpret_cast<uintptr_t>(dst) % 16 == 0 };
+        for (size_t i = 0; i < count; ++i, dst += destinationStride, src += sourceStride)
+        {
+            if (elementSize >= LINE_SIZE)
+            {
+                Stream(kernels, dst, src, elementSize);
+            }
+            else if (aligned)
+            {
+                for (size_t offset = 0; offset < elementSize; offset += 16)
+                    kernels.store16(dst + offset, src + offset);
+            }
+            else
+            {
+                memcpy(dst, src, elementSize);
+            }
+        }
+    }
+    kernels.fence();
+}
@@ -0,0 +1,133 @@
+#include "precomp.hpp"
+#include "copy_queue.hpp"
+
+#include "copy_kernels.hpp"
+
+CopyQueue::CopyQueue(ID3D12Device* device) : _device(device)
+{
+    D3D12_COMMAND_QUEUE_DESC queueDesc{};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    ThrowIfFailed(_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(_queue.GetAddressOf())));
+    _queue->SetName(L"Copy command queue");
+
+    ThrowIfFailed(_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(_fence.GetAddressOf())));
+}
+
+CopyQueue::~CopyQueue()
+{
+    WaitIdle();
+}
+
+std::unique_ptr<UploadHeap> CopyQueue::CreatePage(uint64_t size)
+{
+    return std::make_unique<UploadHeap>(_device, size);
+}
+
+void CopyQueue::RecordCopy(const UploadHeap& page, uint64_t offset, const CopyDestination& destination, uint64_t size)
+{
+    if (!_recordingAllocator)
+    {
+        if (!_allocators.empty() && _allocators.front().first <= CompletedValue())
+        {
+            _recordingAllocator = _allocators.front().second;
+            _allocators.pop_front();
+            ThrowIfFailed(_recordingAllocator->Reset());
+        }
+        else
+        {
+            ThrowIfFailed(_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(_recordingAllocator.GetAddressOf())));
+        }
+
+        if (!_commandList)
+        {
+            ThrowIfFailed(_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, _recordingAllocator.Get(), nullptr, IID_PPV_ARGS(_commandList.GetAddressOf())));
+            _commandList->SetName(L"Copy command list");
+        }
+        else
+        {
+            ThrowIfFailed(_commandList->Reset(_recordingAllocator.Get(), nullptr));
+        }
+    }
+
+    if (destination.isTexture)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint{ destination.footprint };
+        footprint.Offset = offset;
+
+        CD3DX12_TEXTURE_COPY_LOCATION dst{ destination.resource, destination.subresource };
+        CD3DX12_TEXTURE_COPY_LOCATION src{ page.Resource(), footprint };
+        _commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+    }
+    else
+    {
+        _commandList->CopyBufferRegion(destination.resource, destination.offset, page.Resource(), offset, size);
+    }
+}
+
+uint64_t CopyQueue::Execute()
+{
+    if (!_recordingAllocator)
+        return _currentFence;
+
+    ThrowIfFailed(_commandList->Close());
+
+    ID3D12CommandList* cmdLists[] = { _commandList.Get() };
+    _queue->ExecuteCommandLists(static_cast<uint32_t>(std::size(cmdLists)), cmdLists);
+
+    _currentFence++;
+    ThrowIfFailed(_queue->Signal(_fence.Get(), _currentFence));
+
+    _allocators.emplace_back(_currentFence, std::move(_recordingAllocator));
+    _recordingAllocator = nullptr;
+
+    return _currentFence;
+}
+
+void CopyQueue::Wait(uint64_t fenceValue)
+{
+    if (fenceValue != 0 && _fence->GetCompletedValue() < fenceValue)
+    {
+        HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
+
+        ThrowIfFailed(_fence->SetEventOnCompletion(fenceValue, eventHandle));
+        WaitForSingleObject(eventHandle, INFINITE);
+        CloseHandle(eventHandle);
+    }
+}
+
+UploadTicket UploadTexture(GpuUploadService& uploadService, ID3D12Device* device, ID3D12Resource* texture, uint32_t firstSubresource, uint32_t subresourceCount, const D3D12_SUBRESOURCE_DATA* data)
+{
+    D3D12_RESOURCE_DESC desc{ texture->GetDesc() };
+    UploadTicket ticket;
+
+    for (uint32_t i = 0; i < subresourceCount; ++i)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        uint32_t numRows;
+        uint64_t rowSizeInBytes;
+        uint64_t totalBytes;
+        device->GetCopyableFootprints(&desc, firstSubresource + i, 1, 0, &footprint, &numRows, &rowSizeInBytes, &totalBytes);
+
+        CopyDestination destination;
+        destination.resource = texture;
+        destination.isTexture = true;
+        destination.subresource = firstSubresource + i;
+        destination.footprint = footprint;
+
+        const D3D12_SUBRESOURCE_DATA& source{ data[i] };
+        ticket = uploadService.Enqueue(destination, totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, [&](uint8_t* staging)
+        {
+            // Staging rows are padded to the footprint's pitch, the source rows are packed.
+            for (uint32_t slice = 0; slice < footprint.Footprint.Depth; ++slice)
+            {
+                uint8_t* dstSlice{ staging + static_cast<uint64_t>(footprint.Footprint.RowPitch) * numRows * slice };
+                const uint8_t* srcSlice{ static_cast<const uint8_t*>(source.pData) + source.SlicePitch * slice };
+
+                CopyKernels::StridedCopy(dstSlice, footprint.Footprint.RowPitch, srcSlice, source.RowPitch, rowSizeInBytes, numRows);
+            }
+        });
+    }
+
+    return ticket;
+}
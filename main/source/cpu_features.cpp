@@ -0,0 +1,41 @@
+#include "cpu_features.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define CPU_FEATURES_X86 1
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+using CpuFeatures::Isa;
+
+namespace
+{
+    Isa Detect()
+    {
+#if !CPU_FEATURES_X86
+        return Isa::Scalar;
+#elif defined(_MSC_VER)
+        // AVX2 needs the CPU to have it and the OS to save the YMM registers.
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return Isa::Sse2;
+
+        __cpuid(info, 1);
+        bool osSavesYmm{ (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6 };
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) ? Isa::Avx2 : Isa::Sse2;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? Isa::Avx2 : Isa::Sse2;
+#endif
+    }
+}
+
+Isa CpuFeatures::Detected()
+{
+    static const Isa isa{ Detect() };
+    return isa;
+}
@@ -0,0 +1,125 @@
+#include "precomp.hpp"
+#include "descriptor_heap.hpp"
+
+CpuDescriptorHeap::CpuDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t descriptorsPerPage) :
+    _device(device),
+    _type(type),
+    _descriptorsPerPage(descriptorsPerPage),
+    _descriptorSize(device->GetDescriptorHandleIncrementSize(type))
+{
+}
+
+DescriptorHandle CpuDescriptorHeap::Allocate()
+{
+    DescriptorHandle handle;
+
+    for (uint32_t i = 0; i < _pages.size() && !handle; ++i)
+    {
+        if (_pages[i]->indices.IsFull())
+            continue;
+
+        handle.page = i;
+        handle.index = _pages[i]->indices.Allocate();
+    }
+
+    if (!handle)
+    {
+        auto page{ std::make_unique<Page>(_descriptorsPerPage) };
+
+        D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+        heapDesc.NumDescriptors = _descriptorsPerPage;
+        heapDesc.Type = _type;
+        heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        heapDesc.NodeMask = 0;
+        ThrowIfFailed(_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(page->heap.GetAddressOf())));
+        page->start = page->heap->GetCPUDescriptorHandleForHeapStart();
+
+        handle.page = static_cast<uint32_t>(_pages.size());
+        handle.index = page->indices.Allocate();
+        _pages.emplace_back(std::move(page));
+    }
+
+    handle.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE{ _pages[handle.page]->start, static_cast<int32_t>(handle.index), _descriptorSize };
+
+    return handle;
+}
+
+void CpuDescriptorHeap::Free(DescriptorHandle& handle)
+{
+    if (!handle)
+        return;
+
+    _pages[handle.page]->indices.Free(handle.index);
+    handle = DescriptorHandle{};
+}
+
+GpuDescriptorHeap::GpuDescriptorHeap(ID3D12Device* device, uint32_t staticCount, uint32_t ringCount) :
+    _device(device),
+    _descriptorSize(device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)),
+    _staticCount(staticCount),
+    _staticIndices(staticCount),
+    _ring(ringCount)
+{
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+    heapDesc.NumDescriptors = staticCount + ringCount;
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(_heap.GetAddressOf())));
+    _heap->SetName(L"Shader visible descriptor heap");
+
+    _cpuStart = _heap->GetCPUDescriptorHandleForHeapStart();
+    _gpuStart = _heap->GetGPUDescriptorHandleForHeapStart();
+}
+
+DescriptorHandle GpuDescriptorHeap::AllocateStatic()
+{
+    DescriptorHandle handle;
+    handle.index = _staticIndices.Allocate();
+    if (!handle)
+        throw DxException(E_OUTOFMEMORY, L"GpuDescriptorHeap::AllocateStatic", AnsiToWString(__FILE__), __LINE__);
+
+    handle.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE{ _cpuStart, static_cast<int32_t>(handle.index), _descriptorSize };
+    handle.gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE{ _gpuStart, static_cast<int32_t>(handle.index), _descriptorSize };
+
+    return handle;
+}
+
+void GpuDescriptorHeap::FreeStatic(DescriptorHandle& handle)
+{
+    if (!handle)
+        return;
+
+    _staticIndices.Free(handle.index);
+    handle = DescriptorHandle{};
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE GpuDescriptorHeap::StageTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count)
+{
+    uint64_t offset{ _ring.Allocate(count, 1) };
+    if (offset == RingAllocator::INVALID_OFFSET)
+        return {};
+
+    int32_t index{ static_cast<int32_t>(_staticCount + offset) };
+    _pendingDestStarts.push_back(CD3DX12_CPU_DESCRIPTOR_HANDLE{ _cpuStart, index, _descriptorSize });
+    _pendingDestSizes.push_back(count);
+    _pendingSources.insert(_pendingSources.end(), sources, sources + count);
+
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE{ _gpuStart, index, _descriptorSize };
+}
+
+void GpuDescriptorHeap::FlushCopies()
+{
+    if (_pendingDestStarts.empty())
+        return;
+
+    // Sources are scattered over the staging heaps, a null size array means ranges of one.
+    _device->CopyDescriptors(
+        static_cast<uint32_t>(_pendingDestStarts.size()), _pendingDestStarts.data(), _pendingDestSizes.data(),
+        static_cast<uint32_t>(_pendingSources.size()), _pendingSources.data(), nullptr,
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    _pendingDestStarts.clear();
+    _pendingDestSizes.clear();
+    _pendingSources.clear();
+}
@@ -3,6 +3,13 @@
 
 
 #include "util.hpp"
+#include "copy_kernels.hpp"
+#include "hash.hpp"
+#include "lod_selection.hpp"
+#include "mesh_loader.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
 
 
 struct Vertex
@@ -19,7 +26,41 @@ struct ExtraVertex
     XMFLOAT3 normal;
 };
 
-Device::Device(HWND hWnd, uint32_t clientWidth, uint32_t clientHeight) :
+// Imported and cooked meshes are written in these layouts without the DirectXMath types.
+static_assert(sizeof(Vertex) == sizeof(MeshVertex) && offsetof(Vertex, tex1) == offsetof(MeshVertex, tex1));
+static_assert(sizeof(ExtraVertex) == sizeof(MeshExtraVertex) && offsetof(ExtraVertex, normal) == offsetof(MeshExtraVertex, normal));
+
+namespace
+{
+    DXGI_FORMAT ToDxgiFormat(VertexElementFormat format)
+    {
+        switch (format)
+        {
+        case VertexElementFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+        case VertexElementFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+        case VertexElementFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case VertexElementFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+        case VertexElementFormat::Unorm16x4: return DXGI_FORMAT_R16G16B16A16_UNORM;
+        case VertexElementFormat::Snorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+        case VertexElementFormat::Unorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+
+        assert(false && "Unhandled vertex element format.");
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    // Root constants of every instanced draw, cbDraw in vs.hlsl.
+    struct DrawConstants
+    {
+        XMFLOAT3 positionOffset;
+        uint32_t instanceBase;
+        XMFLOAT3 positionScale;
+        uint32_t padding;
+    };
+}
+
+Device::Device(HWND hWnd, uint32_t clientWidth, uint32_t clientHeight, std::shared_ptr<JobSystem> jobSystem) :
+    _jobSystem(jobSystem),
     _hWnd(hWnd),
     _clientWidth(clientWidth),
     _clientHeight(clientHeight),
@@ -50,8 +91,9 @@ Device::Device(HWND hWnd, uint32_t clientWidth, uint32_t clientHeight) :
     CreateDevice();
     CreateFence();
     QueryMSAA();
-    QueryDescriptorSizes();
     CreateCommandObjects();
+    CreateUploadRing();
+    CreateUploadService();
     CreateSwapChain();
     CreateDescriptorHeaps();
     CreateRenderTargetViews();
@@ -60,20 +102,21 @@ Device::Device(HWND hWnd, uint32_t clientWidth, uint32_t clientHeight) :
 
     ThrowIfFailed(_commandList->Reset(_commandAllocator.Get(), nullptr));
 
-    BuildConstantBuffers();
+    BuildFrameResources();
     BuildRootSignature();
     BuildShadersAndInputLayout();
     BuildBoxGeometry();
     BuildPSO();
+    CreateShaderHotReload();
 
     ImGui_ImplWin32_Init(_hWnd);
-    ImGui_ImplDX12_Init(_device.Get(), SWAP_CHAIN_BUFFER_COUNT, _backBufferFormat, _srvHeap.Get(), _srvHeap->GetCPUDescriptorHandleForHeapStart(), _srvHeap->GetGPUDescriptorHandleForHeapStart());
+    ImGui_ImplDX12_Init(_device.Get(), NUM_FRAME_RESOURCES, _backBufferFormat, _shaderVisibleHeap->Heap(), _imguiFontSrv.cpu, _imguiFontSrv.gpu);
 
 
     ThrowIfFailed(_commandList->Close());
     ID3D12CommandList* cmdLists[] = { _commandList.Get() };
     _commandQueue->ExecuteCommandLists(std::size(cmdLists), cmdLists);
-    
+    _uploadRing->FinishFrame(Signal());
 
     FlushCommandQueue();
 }
@@ -85,90 +128,257 @@ Device::~Device()
     ImGui::DestroyContext();
  
     FlushCommandQueue();
+    // The upload service is destroyed before the copy queue and takes its staging pages with
+    // it, copies still reading them have to be done by then.
+    _copyQueue->WaitIdle();
+    _shaderVisibleHeap->FreeStatic(_imguiFontSrv);
 }
 #pragma comment( lib, "dxguid.lib") 
 void Device::Draw()
 {
-    ThrowIfFailed(_commandAllocator->Reset());
-    ThrowIfFailed(_commandList->Reset(_commandAllocator.Get(), _pso.Get()));
+    // Only blocks when the GPU is still using the frame resource we wrap around to.
+    WaitForFence(_frameResources->Advance());
+    FrameResource& frame{ _frameResources->Current() };
 
-    _commandList->RSSetViewports(1, &_screenViewport);
-    _commandList->RSSetScissorRects(1, &_scissorRect);
+    uint64_t completedFence{ _fence->GetCompletedValue() };
+    _uploadRing->Retire(completedFence);
+    _shaderVisibleHeap->Retire(completedFence);
+
+    // Frames already submitted keep the old pipeline alive through the retire queue.
+    if (_shaderHotReload->Update(_currentFence, completedFence))
+        _pso = _shaderHotReload->GetPipeline(_scenePipeline);
+
+    frame.AllocateConstantBuffers(*_uploadRing);
+    UpdateConstantBuffers(frame);
+    UpdateObjectConstants(frame);
+    SelectLods();
+    CullDrawItems();
+    BuildInstanceBatches(frame);
+
+    // Submit whatever got queued since the last frame, the copies overlap with recording.
+    _uploadService->Flush();
+
+    ThrowIfFailed(frame.commandAllocator->Reset());
+    for (auto& allocator : frame.workerAllocators)
+        ThrowIfFailed(allocator->Reset());
 
     ImGui_ImplDX12_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
-    // Do Imgui stuff.
+    if (_overlay)
+        _overlay();
     ImGui::Render();
-    
-    _commandList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER::Transition(
-        CurrentBackBuffer(),
-        D3D12_RESOURCE_STATE_PRESENT,
-        D3D12_RESOURCE_STATE_RESOLVE_DEST)));
 
-    _commandList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER::Transition(
-        _offscreenRenderTargets[_currentBackBuffer].Get(),
-        D3D12_RESOURCE_STATE_RESOLVE_SOURCE, 
-        D3D12_RESOURCE_STATE_RENDER_TARGET)));
+    BuildRenderGraph(frame);
 
-    _commandList->ClearRenderTargetView(CurrentMsaaBackBufferView(), &backgroundColor.x, 0, nullptr);
-    _commandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-  
-    _commandList->OMSetRenderTargets(1, 
-                                     &keep(CurrentMsaaBackBufferView()), 
-                                     true, 
-                                     &keep(DepthStencilView()));
+    std::vector<ID3D12CommandList*> cmdsList;
+    ExecuteRenderGraph(frame, cmdsList);
+    _shaderVisibleHeap->FlushCopies();
 
+    const MeshGeometry* waitedGeometry{ nullptr };
+    for (const DrawItem& item : _drawItems)
+    {
+        if (item.geometry != waitedGeometry)
+            WaitForUpload(item.geometry->uploadTicket);
+        waitedGeometry = item.geometry;
+    }
 
+    _commandQueue->ExecuteCommandLists(static_cast<uint32_t>(cmdsList.size()), cmdsList.data());
 
+    ThrowIfFailed(_swapChain->Present(0, 0));
+    _currentBackBuffer = (_currentBackBuffer + 1) % SWAP_CHAIN_BUFFER_COUNT;
+
+    uint64_t fence{ Signal() };
+    _frameResources->Submit(fence);
+    _uploadRing->FinishFrame(fence);
+    _shaderVisibleHeap->FinishFrame(fence);
+}
 
-    _commandList->SetDescriptorHeaps(1, _cbvHeap.GetAddressOf());
-    _commandList->SetGraphicsRootSignature(_rootSignature.Get());
-    _commandList->IASetVertexBuffers(0, 1, &keep(_boxGeo->VertexBufferView()));
-    _commandList->IASetVertexBuffers(1, 1, &keep(_boxGeo->ExtraVertexBufferView()));
-    _commandList->IASetIndexBuffer(&keep(_boxGeo->IndexBufferView()));
-    _commandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+void Device::BuildRenderGraph(FrameResource& frame)
+{
+    _renderGraph.Reset();
+    _graphResources.clear();
+    _graphPasses.clear();
 
-    _commandList->SetGraphicsRootDescriptorTable(0, _cbvHeap->GetGPUDescriptorHandleForHeapStart());
+    // The MSAA target sits in RESOLVE_SOURCE between frames, the back buffer in PRESENT.
+    RenderGraph::ResourceId msaaTarget{ ImportGraphResource("MSAA target", _offscreenRenderTargets[_currentBackBuffer].Get(), D3D12_RESOURCE_STATE_RESOLVE_SOURCE, D3D12_RESOURCE_STATE_RESOLVE_SOURCE, false) };
+    RenderGraph::ResourceId depthStencil{ ImportGraphResource("Depth stencil", _depthStencilBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_WRITE, false) };
+    RenderGraph::ResourceId backBuffer{ ImportGraphResource("Back buffer", CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT, true) };
 
-    _commandList->DrawIndexedInstanced(_boxGeo->drawArgs["box"].indexCount, 1, 0, 0, 0);
+    RenderGraph::PassId clear{ AddGraphPass("Clear", RenderGraph::PASS_NONE, { [this](ID3D12GraphicsCommandList* commandList)
+    {
+        commandList->ClearRenderTargetView(CurrentMsaaBackBufferView(), &backgroundColor.x, 0, nullptr);
+        commandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    } }) };
+    _renderGraph.Write(clear, msaaTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    _renderGraph.Write(clear, depthStencil, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // Scene draws are split into chunks, each recorded on its own list and allocator.
+    RenderGraph::PassId scene{ AddGraphPass("Scene", RenderGraph::PASS_OWN_COMMAND_LISTS, { nullptr, [this, &frame](std::vector<ID3D12CommandList*>& cmdsList)
+    {
+        std::vector<DrawRange> chunks{ ParallelRecorder::Partition(static_cast<uint32_t>(_instanceBatcher.Batches().size()), static_cast<uint32_t>(_workerCommandLists.size()), MIN_DRAWS_PER_CHUNK) };
+        _chunkFilterStats.assign(chunks.size(), {});
+        _recorder->Run(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunk)
+        {
+            ID3D12GraphicsCommandList* commandList{ _workerCommandLists[chunk].Get() };
+            ThrowIfFailed(commandList->Reset(frame.workerAllocators[chunk].Get(), _pso.Get()));
+            D3D12CommandFilter commands{ commandList, _pso.Get() };
+            RecordDraws(commands, frame, chunks[chunk]);
+            _chunkFilterStats[chunk] = commands.Stats();
+            ThrowIfFailed(commandList->Close());
+        });
+
+        _sceneFilterStats = {};
+        for (const CommandFilterStats& stats : _chunkFilterStats)
+            _sceneFilterStats += stats;
+
+        for (size_t chunk = 0; chunk < chunks.size(); ++chunk)
+            cmdsList.push_back(_workerCommandLists[chunk].Get());
+    } }) };
+    _renderGraph.Write(scene, msaaTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    _renderGraph.Write(scene, depthStencil, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    RenderGraph::PassId resolve{ AddGraphPass("Resolve", RenderGraph::PASS_NONE, { [this](ID3D12GraphicsCommandList* commandList)
+    {
+        commandList->ResolveSubresource(CurrentBackBuffer(), 0, _offscreenRenderTargets[_currentBackBuffer].Get(), 0, _backBufferFormat);
+    } }) };
+    _renderGraph.Read(resolve, msaaTarget, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+    _renderGraph.Write(resolve, backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST);
 
+    RenderGraph::PassId imgui{ AddGraphPass("ImGui", RenderGraph::PASS_NONE, { [this](ID3D12GraphicsCommandList* commandList)
+    {
+        commandList->OMSetRenderTargets(1,
+                                        &keep(CurrentBackBufferView()),
+                                        true,
+                                        nullptr);
+
+        ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
+    } }) };
+    _renderGraph.Write(imgui, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+}
 
-    _commandList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER::Transition(
-        _offscreenRenderTargets[_currentBackBuffer].Get(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET,
-        D3D12_RESOURCE_STATE_RESOLVE_SOURCE)));
+void Device::ExecuteRenderGraph(FrameResource& frame, std::vector<ID3D12CommandList*>& cmdsList)
+{
+    const RenderGraph::Compiled& compiled{ _renderGraph.Compile() };
 
-    _commandList->ResolveSubresource(CurrentBackBuffer(), 0, _offscreenRenderTargets[_currentBackBuffer].Get(), 0, _backBufferFormat);
+    // Serial passes share these, one after the other. Only one of them is open at a time, so
+    // they can all use the frame's allocator.
+    ID3D12GraphicsCommandList* serialLists[] = { _commandList.Get(), _postCommandList.Get() };
+    uint32_t serialList{ 0 };
 
-    _commandList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER::Transition(
-        CurrentBackBuffer(),
-        D3D12_RESOURCE_STATE_RESOLVE_DEST,
-        D3D12_RESOURCE_STATE_RENDER_TARGET)));
+    auto beginSerialList = [&]()
+    {
+        assert(serialList < std::size(serialLists) && "Render graph needs more serial command lists.");
+        ThrowIfFailed(serialLists[serialList]->Reset(frame.commandAllocator.Get(), nullptr));
 
-    _commandList->OMSetRenderTargets(1,
-                                     &keep(CurrentBackBufferView()),
-                                     true,
-                                     nullptr);
+        ID3D12DescriptorHeap* descriptorHeaps[] = { _shaderVisibleHeap->Heap() };
+        serialLists[serialList]->SetDescriptorHeaps(static_cast<uint32_t>(std::size(descriptorHeaps)), descriptorHeaps);
+    };
 
-    _commandList->SetDescriptorHeaps(1, _srvHeap.GetAddressOf());
-    ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), _commandList.Get());
+    auto endSerialList = [&]()
+    {
+        ThrowIfFailed(serialLists[serialList]->Close());
+        cmdsList.push_back(serialLists[serialList]);
+        serialList++;
+    };
 
+    beginSerialList();
+    for (uint32_t i = 0; i < compiled.passes.size(); ++i)
+    {
+        RenderGraph::PassId pass{ compiled.passes[i] };
+        RecordBarriers(serialLists[serialList], compiled.Batch(i));
+
+        if (_renderGraph.PassFlagsOf(pass) & RenderGraph::PASS_OWN_COMMAND_LISTS)
+        {
+            endSerialList();
+            _graphPasses[pass].recordLists(cmdsList);
+            beginSerialList();
+        }
+        else
+        {
+            _graphPasses[pass].record(serialLists[serialList]);
+        }
+    }
 
-    _commandList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER::Transition(
-        CurrentBackBuffer(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET,
-        D3D12_RESOURCE_STATE_PRESENT)));
+    RecordBarriers(serialLists[serialList], compiled.Batch(compiled.BatchCount() - 1));
+    endSerialList();
+}
 
-    ThrowIfFailed(_commandList->Close());
+void Device::RecordBarriers(ID3D12GraphicsCommandList* commandList, std::span<const RenderGraph::Barrier> barriers)
+{
+    if (barriers.empty())
+        return;
 
-    ID3D12CommandList* cmdsList[] = { _commandList.Get() };
-    _commandQueue->ExecuteCommandLists(std::size(cmdsList), cmdsList);
+    _barrierScratch.clear();
+    for (const RenderGraph::Barrier& barrier : barriers)
+    {
+        D3D12_RESOURCE_BARRIER_FLAGS flags{ D3D12_RESOURCE_BARRIER_FLAG_NONE };
+        if (barrier.split == RenderGraph::BarrierSplit::Begin)
+            flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+        else if (barrier.split == RenderGraph::BarrierSplit::End)
+            flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+
+        _barrierScratch.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+            _graphResources[barrier.resource],
+            static_cast<D3D12_RESOURCE_STATES>(barrier.before),
+            static_cast<D3D12_RESOURCE_STATES>(barrier.after),
+            D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            flags));
+    }
 
-    ThrowIfFailed(_swapChain->Present(0, 0));
-    _currentBackBuffer = (_currentBackBuffer + 1) % SWAP_CHAIN_BUFFER_COUNT;
+    commandList->ResourceBarrier(static_cast<uint32_t>(_barrierScratch.size()), _barrierScratch.data());
+}
 
-    FlushCommandQueue();
+RenderGraph::ResourceId Device::ImportGraphResource(std::string name, ID3D12Resource* resource, D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState, bool exported)
+{
+    _graphResources.push_back(resource);
+    return _renderGraph.ImportResource(std::move(name), initialState, finalState, exported);
+}
+
+RenderGraph::PassId Device::AddGraphPass(std::string name, uint32_t flags, RenderGraphPass pass)
+{
+    _graphPasses.push_back(std::move(pass));
+    return _renderGraph.AddPass(std::move(name), flags);
+}
+
+void Device::RecordDraws(D3D12CommandFilter& commands, FrameResource& frame, DrawRange range) const
+{
+    // Every list starts out with default state, so each chunk sets up the whole pass.
+    commands.RSSetViewports(1, &_screenViewport);
+    commands.RSSetScissorRects(1, &_scissorRect);
+
+    ID3D12DescriptorHeap* descriptorHeaps[] = { _shaderVisibleHeap->Heap() };
+    commands.SetDescriptorHeaps(static_cast<uint32_t>(std::size(descriptorHeaps)), descriptorHeaps);
+
+    commands.OMSetRenderTargets(1, 
+                                &keep(CurrentMsaaBackBufferView()), 
+                                true, 
+                                &keep(DepthStencilView()));
+
+    commands.SetGraphicsRootSignature(_rootSignature.Get());
+    commands.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    commands.SetGraphicsRootConstantBufferView(1, frame.passCB.GpuAddress());
+    commands.SetGraphicsRootShaderResourceView(2, frame.instances.gpuAddress);
+    commands.SetGraphicsRootDescriptorTable(3, frame.objectsTable);
+
+    // SV_InstanceID starts at zero whatever the start instance, so the batch's offset into the
+    // instance buffer goes in with the root constants. Batches of the same mesh come one after
+    // the other, the filter drops their buffer bindings and unchanged constants.
+    std::span<const InstanceBatch> batches{ _instanceBatcher.Batches() };
+    for (uint32_t i = range.begin; i < range.end; ++i)
+    {
+        const InstanceBatch& batch{ batches[i] };
+        const DrawItem& item{ _drawItems[batch.drawItem] };
+        D3D12_VERTEX_BUFFER_VIEW vertexBuffers[] = { item.geometry->VertexBufferView(), item.geometry->ExtraVertexBufferView() };
+        commands.IASetVertexBuffers(0, static_cast<uint32_t>(std::size(vertexBuffers)), vertexBuffers);
+        commands.IASetIndexBuffer(&keep(item.geometry->IndexBufferView()));
+
+        DrawConstants constants{ item.submesh.positionOffset, batch.firstInstance, item.submesh.positionScale, 0 };
+        commands.SetGraphicsRoot32BitConstants(0, sizeof(DrawConstants) / 4, &constants, 0);
+
+        const SubmeshLod& lod{ item.submesh.lods[item.lod] };
+        commands.DrawIndexedInstanced(lod.indexCount, batch.instanceCount, lod.startIndexLocation, item.submesh.baseVertexLocation, 0);
+    }
 }
 
 void Device::EnableDebugLayer()
@@ -191,6 +401,28 @@ void Device::CreateDevice()
 
         ThrowIfFailed(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(_device.GetAddressOf())));
     }
+
+    _gpuHeapAllocator = std::make_unique<GpuHeapAllocator>(_device.Get());
+    _psoCache = std::make_unique<PsoCache>(_device.Get(), AdapterFingerprint(), CACHE_DIRECTORY);
+    _shaderCache = std::make_unique<ShaderCache>(std::filesystem::path{ CACHE_DIRECTORY } / "shaders.bin");
+}
+
+uint64_t Device::AdapterFingerprint() const
+{
+    // Same GPU model and driver version, anything cached against it is still valid.
+    ComPtr<IDXGIAdapter1> adapter;
+    ThrowIfFailed(_dxgiFactory->EnumAdapterByLuid(_device->GetAdapterLuid(), IID_PPV_ARGS(adapter.GetAddressOf())));
+
+    DXGI_ADAPTER_DESC1 desc;
+    ThrowIfFailed(adapter->GetDesc1(&desc));
+
+    LARGE_INTEGER driverVersion{};
+    adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
+    Hasher hasher;
+    hasher.Add(desc.VendorId).Add(desc.DeviceId).Add(desc.SubSysId).Add(desc.Revision);
+    hasher.Add(static_cast<uint64_t>(driverVersion.QuadPart));
+    return hasher.Value();
 }
 
 void Device::CreateFence()
@@ -211,13 +443,6 @@ void Device::QueryMSAA()
     assert(_4xMsaaQuality > 0 && "Unexpected MSAA quality level!");
 }
 
-void Device::QueryDescriptorSizes()
-{
-    _rtvDescriptorSize = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-    _dsvDescriptorSize = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
-    _cbvDescriptorSize = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-}
-
 void Device::CreateCommandObjects()
 {
     D3D12_COMMAND_QUEUE_DESC queueDesc{};
@@ -238,6 +463,33 @@ void Device::CreateCommandObjects()
     _commandList->SetName(L"Main command list");
 
     _commandList->Close();
+
+    ThrowIfFailed(_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _commandAllocator.Get(), nullptr, IID_PPV_ARGS(_postCommandList.GetAddressOf())));
+    _postCommandList->SetName(L"Post command list");
+    _postCommandList->Close();
+
+    // Scene draws get recorded on these, one list per chunk.
+    _recorder = std::make_unique<ParallelRecorder>(*_jobSystem);
+
+    _workerCommandLists.resize(std::min(_recorder->WorkerCount(), MAX_RECORDING_CHUNKS));
+    for (auto& commandList : _workerCommandLists)
+    {
+        ThrowIfFailed(_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, _commandAllocator.Get(), nullptr, IID_PPV_ARGS(commandList.GetAddressOf())));
+        commandList->SetName(L"Worker command list");
+        commandList->Close();
+    }
+}
+
+void Device::CreateUploadRing()
+{
+    _uploadHeap = std::make_unique<UploadHeap>(_device.Get(), UPLOAD_RING_SIZE);
+    _uploadRing = std::make_unique<UploadRing<UploadHeap>>(*_uploadHeap);
+}
+
+void Device::CreateUploadService()
+{
+    _copyQueue = std::make_unique<CopyQueue>(_device.Get());
+    _uploadService = std::make_unique<GpuUploadService>(*_copyQueue, UPLOAD_PAGE_SIZE);
 }
 
 void Device::CreateSwapChain()
@@ -271,55 +523,31 @@ void Device::CreateSwapChain()
 
 void Device::CreateDescriptorHeaps()
 {
-    D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-    rtvHeapDesc.NumDescriptors = SWAP_CHAIN_BUFFER_COUNT;
-    rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    rtvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(_rtvHeap.GetAddressOf())));
-
-    D3D12_DESCRIPTOR_HEAP_DESC rtvMsaaHeapDesc;
-    rtvMsaaHeapDesc.NumDescriptors = SWAP_CHAIN_BUFFER_COUNT;
-    rtvMsaaHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtvMsaaHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    rtvMsaaHeapDesc.NodeMask = 0;
-    ThrowIfFailed(_device->CreateDescriptorHeap(&rtvMsaaHeapDesc, IID_PPV_ARGS(_rtvMsaaHeap.GetAddressOf())));
-
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc;
-    dsvHeapDesc.NumDescriptors = 1;
-    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    dsvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(_dsvHeap.GetAddressOf())));
-
-    D3D12_DESCRIPTOR_HEAP_DESC srvDesc = {};
-    srvDesc.NumDescriptors = 1;
-    srvDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    srvDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    dsvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(_device->CreateDescriptorHeap(&srvDesc, IID_PPV_ARGS(_srvHeap.GetAddressOf())));
-
-    D3D12_DESCRIPTOR_HEAP_DESC cbvDesc;
-    cbvDesc.NumDescriptors = 1;
-    cbvDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    cbvDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    cbvDesc.NodeMask = 0;
-    ThrowIfFailed(_device->CreateDescriptorHeap(&cbvDesc, IID_PPV_ARGS(_cbvHeap.GetAddressOf())));
+    _rtvHeap = std::make_unique<CpuDescriptorHeap>(_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    _dsvHeap = std::make_unique<CpuDescriptorHeap>(_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+    _stagingHeap = std::make_unique<CpuDescriptorHeap>(_device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    _shaderVisibleHeap = std::make_unique<GpuDescriptorHeap>(_device.Get(), STATIC_DESCRIPTOR_COUNT, DESCRIPTOR_RING_SIZE);
+
+    for (uint32_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
+    {
+        _backBufferRtvs[i] = _rtvHeap->Allocate();
+        _msaaRtvs[i] = _rtvHeap->Allocate();
+    }
+    _dsv = _dsvHeap->Allocate();
+
+    _imguiFontSrv = _shaderVisibleHeap->AllocateStatic();
 }
 
 void Device::CreateRenderTargetViews()
 {
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle{ _rtvHeap->GetCPUDescriptorHandleForHeapStart() };
     for(uint32_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
     {
         ThrowIfFailed(_swapChain->GetBuffer(i, IID_PPV_ARGS(&_swapChainBuffer[i])));
-        _device->CreateRenderTargetView(_swapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
+        _device->CreateRenderTargetView(_swapChainBuffer[i].Get(), nullptr, _backBufferRtvs[i].cpu);
 
         std::wstring name{ L"Render Target " };
         name.append(std::to_wstring(i));
         _swapChainBuffer[i]->SetName(name.c_str());
-
-        rtvHeapHandle.Offset(1, _rtvDescriptorSize);
     }
 }
 
@@ -342,17 +570,11 @@ void Device::CreateDepthStencilView()
     optClear.Format = _depthStencilFormat;
     optClear.DepthStencil.Depth = 1.0f;
     optClear.DepthStencil.Stencil = 0;
-    auto heapProperties{ CD3DX12_HEAP_PROPERTIES{ D3D12_HEAP_TYPE_DEFAULT } };
-    ThrowIfFailed(_device->CreateCommittedResource(
-        &heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &depthStencilDesc,
-        D3D12_RESOURCE_STATE_COMMON,
-        &optClear,
-        IID_PPV_ARGS(_depthStencilBuffer.GetAddressOf())));
+    _gpuHeapAllocator->Free(_depthStencilBuffer);
+    _depthStencilBuffer = _gpuHeapAllocator->CreateTexture(depthStencilDesc, D3D12_RESOURCE_STATE_COMMON, &optClear);
 
     _device->CreateDepthStencilView(_depthStencilBuffer.Get(), nullptr, DepthStencilView());
-    _depthStencilBuffer->SetName(L"Depths/stencil buffer");
+    _depthStencilBuffer.resource->SetName(L"Depths/stencil buffer");
 
     auto barrier{ CD3DX12_RESOURCE_BARRIER::Transition(
         _depthStencilBuffer.Get(),
@@ -368,25 +590,16 @@ void Device::CreateDepthStencilView()
     msaaOptimizedClearValue.Format = _backBufferFormat;
     memcpy(msaaOptimizedClearValue.Color, &backgroundColor.x, sizeof(float) * 4);
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle{ _rtvMsaaHeap->GetCPUDescriptorHandleForHeapStart() };
     for(size_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
     {
-        ThrowIfFailed(_device->CreateCommittedResource(
-            &heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &msaaRTDesc,
-            D3D12_RESOURCE_STATE_RESOLVE_SOURCE,
-            &msaaOptimizedClearValue,
-            IID_PPV_ARGS(_offscreenRenderTargets[i].ReleaseAndGetAddressOf()))
-        );
+        _gpuHeapAllocator->Free(_offscreenRenderTargets[i]);
+        _offscreenRenderTargets[i] = _gpuHeapAllocator->CreateTexture(msaaRTDesc, D3D12_RESOURCE_STATE_RESOLVE_SOURCE, &msaaOptimizedClearValue);
 
-        _device->CreateRenderTargetView(_offscreenRenderTargets[i].Get(), nullptr, rtvHeapHandle);
+        _device->CreateRenderTargetView(_offscreenRenderTargets[i].Get(), nullptr, _msaaRtvs[i].cpu);
 
         std::wstring name{ L"Msaa Render Target " };
         name.append(std::to_wstring(i));
-        _offscreenRenderTargets[i]->SetName(name.c_str());
-
-        rtvHeapHandle.Offset(1, _rtvDescriptorSize);
+        _offscreenRenderTargets[i].resource->SetName(name.c_str());
     }
 }
 
@@ -396,35 +609,27 @@ void Device::SetViewport()
     _commandList->RSSetScissorRects(1, &_scissorRect);
 }
 
-void Device::BuildConstantBuffers()
+void Device::BuildFrameResources()
 {
-    _uploadBuffer = std::make_unique<UploadBuffer<ObjectConstants>>(_device.Get(), _numElements, true);
-
-    std::uint32_t objCBByteSize = D3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-
-    D3D12_GPU_VIRTUAL_ADDRESS cbAddress = _uploadBuffer->Resource()->GetGPUVirtualAddress();
-
-    std::int32_t boxCBufferIndex = 0;
-    cbAddress += boxCBufferIndex * objCBByteSize;
-
-    D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-    cbvDesc.BufferLocation = cbAddress;
-    cbvDesc.SizeInBytes = objCBByteSize;
-
-
-    _device->CreateConstantBufferView(&cbvDesc, _cbvHeap->GetCPUDescriptorHandleForHeapStart());
+    _frameResources = std::make_unique<FrameRing<FrameResource>>(NUM_FRAME_RESOURCES, _device.Get(), 1u, static_cast<uint32_t>(_workerCommandLists.size()));
 }
 
 void Device::BuildRootSignature()
 {
-    CD3DX12_ROOT_PARAMETER slotRootParameter[1];
-
-    CD3DX12_DESCRIPTOR_RANGE cbvTable;
-    cbvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+    // Root descriptors for what lives in the upload ring, every frame resource has its own pass
+    // constants and instance buffer so the addresses change from frame to frame. The object
+    // constants are a table, staged into the shader visible ring every frame. What changes
+    // between draws fits in root constants.
+    CD3DX12_DESCRIPTOR_RANGE objectsRange;
+    objectsRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
 
-    slotRootParameter[0].InitAsDescriptorTable(1, &cbvTable);
+    CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+    slotRootParameter[0].InitAsConstants(sizeof(DrawConstants) / 4, 0);
+    slotRootParameter[1].InitAsConstantBufferView(1);
+    slotRootParameter[2].InitAsShaderResourceView(0);
+    slotRootParameter[3].InitAsDescriptorTable(1, &objectsRange);
 
-    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc{ 1, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
+    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc{ static_cast<uint32_t>(std::size(slotRootParameter)), slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT };
 
     ComPtr<ID3DBlob> serializedRootSig{ nullptr };
     ComPtr<ID3DBlob> errorBlob{ nullptr };
@@ -438,12 +643,13 @@ void Device::BuildRootSignature()
     ThrowIfFailed(hr);
 
     ThrowIfFailed(_device->CreateRootSignature(0, serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize(), IID_PPV_ARGS(&_rootSignature)));
+    _rootSignatureHash = Hash::Bytes(serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize());
 }
 
 void Device::BuildShadersAndInputLayout()
 {
-    _vsByte = D3dUtil::CompileShader(L"assets\\shaders\\vs.hlsl", nullptr, "VS", "vs_5_0");
-    _psByte = D3dUtil::CompileShader(L"assets\\shaders\\vs.hlsl", nullptr, "PS", "ps_5_0");
+    _vsByte = _shaderCache->Compile(L"assets\\shaders\\vs.hlsl", nullptr, "VS", "vs_5_0");
+    _psByte = _shaderCache->Compile(L"assets\\shaders\\vs.hlsl", nullptr, "PS", "ps_5_0");
 
     /*_inputLayout = 
     {
@@ -454,16 +660,9 @@ void Device::BuildShadersAndInputLayout()
         { "TEX",      1, DXGI_FORMAT_R32G32_FLOAT,       0, offsetof(Vertex, tex1),     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, offsetof(Vertex, color),    D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };*/
-    _inputLayout = 
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, offsetof(Vertex, position), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEX",      0, DXGI_FORMAT_R32G32_FLOAT,       0, offsetof(Vertex, tex0),     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEX",      1, DXGI_FORMAT_R32G32_FLOAT,       0, offsetof(Vertex, tex1),     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-
-        { "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(ExtraVertex, color),    D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT,    1, offsetof(ExtraVertex, tangent),  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    1, offsetof(ExtraVertex, normal),   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    };
+    _inputLayout.clear();
+    for (const VertexElement& element : VertexPacking::Layout(SCENE_VERTEX_FORMAT).elements)
+        _inputLayout.push_back({ element.semantic, element.semanticIndex, ToDxgiFormat(element.format), element.slot, element.offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
 }
 
 void Device::BuildBoxGeometry()
@@ -504,49 +703,95 @@ void Device::BuildBoxGeometry()
         4, 3, 7,
     };
 
-    const uint32_t vbByteSize = vertices.size() * sizeof(Vertex);
-    const uint32_t evbByteSize = extraVertexData.size() * sizeof(ExtraVertex);
-    const uint32_t ibByteSize = indices.size() * sizeof(uint16_t);
+    // Named after what goes into it, so editing the box or the vertex format cooks it again
+    // instead of loading a stale file.
+    Hasher hasher;
+    hasher.AddBytes(vertices.data(), sizeof(vertices)).AddBytes(extraVertexData.data(), sizeof(extraVertexData));
+    hasher.AddBytes(indices.data(), sizeof(indices)).Add(SCENE_VERTEX_FORMAT).Add(CookedMesh::VERSION);
 
-    _boxGeo = std::make_unique<MeshGeometry>();
-    _boxGeo->name = "boxGeo";
+    wchar_t meshName[32];
+    swprintf_s(meshName, L"box_%016llx.mesh", static_cast<unsigned long long>(hasher.Value()));
 
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &_boxGeo->vertexBufferCPU));
-    CopyMemory(_boxGeo->vertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+    std::filesystem::path meshPath{ std::filesystem::path{ CACHE_DIRECTORY } / "meshes" / meshName };
+    CookedMesh mesh;
+    if (!mesh.Open(meshPath))
+    {
+        // The box is the one mesh that starts out in code. The first time around it goes
+        // through the same optimize and cook steps as imported ones.
+        MeshData box;
+        box.vertices.resize(vertices.size());
+        box.extraVertices.resize(extraVertexData.size());
+        memcpy(box.vertices.data(), vertices.data(), sizeof(vertices));
+        memcpy(box.extraVertices.data(), extraVertexData.data(), sizeof(extraVertexData));
+        box.indices.assign(indices.begin(), indices.end());
+
+        CookedSubmesh submesh;
+        submesh.name = "box";
+        submesh.indexCount = static_cast<uint32_t>(indices.size());
+        box.submeshes.push_back(std::move(submesh));
+
+        MeshOptimizer::Optimize(box, *_jobSystem);
+        MeshSimplifier::GenerateLods(box, *_jobSystem);
+        MeshletBuilder::BuildMeshlets(box, *_jobSystem);
+        box.ComputeBounds(*_jobSystem);
+        PackedVertexStreams packed{ VertexPacking::Pack(box, SCENE_VERTEX_FORMAT, *_jobSystem) };
+
+        if (!CookMesh(meshPath, packed.Describe(box)))
+            throw DxException(HRESULT_FROM_WIN32(ERROR_WRITE_FAULT), L"CookMesh " + meshPath.wstring(), AnsiToWString(__FILE__), __LINE__);
+        // Just written, so a failure here means the cooker and the reader disagree.
+        if (!mesh.Open(meshPath))
+            throw DxException(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT), L"CookedMesh::Open " + meshPath.wstring(), AnsiToWString(__FILE__), __LINE__);
+    }
 
-    ThrowIfFailed(D3DCreateBlob(evbByteSize, &_boxGeo->extraVertexBufferCPU));
-    CopyMemory(_boxGeo->extraVertexBufferCPU->GetBufferPointer(), extraVertexData.data(), evbByteSize);
+    _boxGeo = LoadMeshGeometry(mesh, "boxGeo", *_gpuHeapAllocator, *_uploadService);
+    assert(_boxGeo->vertexFormat == SCENE_VERTEX_FORMAT && "Box was cooked for a different input layout.");
+    const SubmeshGeometry& submesh{ _boxGeo->drawArgs.at("box") };
 
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &_boxGeo->indexBufferCPU));
-    CopyMemory(_boxGeo->indexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+    AddDrawItem(_boxGeo.get(), submesh, CreateObject());
+}
 
-    _boxGeo->vertexBufferGPU = CreateDefaultBuffer(_device.Get(), _commandList.Get(), vertices.data(), vbByteSize, _boxGeo->vertexBufferUploader);
-    _boxGeo->extraVertexBufferGPU = CreateDefaultBuffer(_device.Get(), _commandList.Get(), extraVertexData.data(), evbByteSize, _boxGeo->extraVertexBufferUploader);
-    _boxGeo->indexBufferGPU = CreateDefaultBuffer(_device.Get(), _commandList.Get(), indices.data(), ibByteSize, _boxGeo->indexBufferUploader);
+uint32_t Device::CreateObject()
+{
+    uint32_t slot{ _objectSlots.Allocate() };
+    _objectWorlds.resize(_objectSlots.SlotCount());
+    _objectWorlds[slot] = MathHelper::Identity4x4();
+    return slot;
+}
 
-    _boxGeo->vertexByteStride = sizeof(Vertex);
-    _boxGeo->vertexBufferByteSize = vbByteSize;
-    _boxGeo->extraVertexByteStride = sizeof(ExtraVertex);
-    _boxGeo->extraVertexBufferByteSize = evbByteSize;
-    _boxGeo->indexFormat = DXGI_FORMAT_R16_UINT;
-    _boxGeo->indexBufferByteSize = ibByteSize;
+uint32_t Device::AddDrawItem(const MeshGeometry* geometry, const SubmeshGeometry& submesh, uint32_t objectIndex)
+{
+    assert(objectIndex < _objectWorlds.size() && "Unknown object.");
+    uint32_t index{ static_cast<uint32_t>(_drawItems.size()) };
 
-    SubmeshGeometry submesh;
-    submesh.indexCount = indices.size();
-    submesh.startIndexLocation = 0;
-    submesh.baseVertexLocation = 0;
+    // Mesh ids past the sort key's field would wrap onto other meshes and get batched with
+    // their geometry, so that is an error in every build.
+    auto mesh{ _meshes.try_emplace({ geometry, submesh.lods[0].startIndexLocation, submesh.baseVertexLocation }, _meshes.size()).first };
+    if (mesh->second >= (1ull << SortKey::MESH_BITS))
+    {
+        _meshes.erase(mesh);
+        throw DxException(E_OUTOFMEMORY, L"Device::AddDrawItem too many meshes for the sort key", AnsiToWString(__FILE__), __LINE__);
+    }
+
+    DrawItem item{ geometry, submesh };
+    item.mesh = mesh->second;
+    item.objectIndex = objectIndex;
 
-    _boxGeo->drawArgs["box"] = submesh;
+    // Bounds start out in object space, the object's world is identity until it gets set.
+    BoundingBox bounds;
+    submesh.bounds.Transform(bounds, XMLoadFloat4x4(&_objectWorlds[objectIndex]));
+    item.cullHandle = _culler.Add(&bounds.Center.x, &bounds.Extents.x, index);
+    _drawItems.push_back(item);
+    return index;
 }
 
-void Device::BuildPSO()
+D3D12_GRAPHICS_PIPELINE_STATE_DESC Device::ScenePipelineDesc(ID3DBlob* vs, ID3DBlob* ps) const
 {
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
     ZeroMemory(&psoDesc, sizeof(psoDesc));
     psoDesc.InputLayout = { _inputLayout.data(), static_cast<uint32_t>(_inputLayout.size()) };
     psoDesc.pRootSignature = _rootSignature.Get();
-    psoDesc.VS = { reinterpret_cast<BYTE*>(_vsByte->GetBufferPointer()), _vsByte->GetBufferSize() };
-    psoDesc.PS = { reinterpret_cast<BYTE*>(_psByte->GetBufferPointer()), _psByte->GetBufferSize() };
+    psoDesc.VS = { reinterpret_cast<BYTE*>(vs->GetBufferPointer()), vs->GetBufferSize() };
+    psoDesc.PS = { reinterpret_cast<BYTE*>(ps->GetBufferPointer()), ps->GetBufferSize() };
     psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC{
         D3D12_FILL_MODE_SOLID,
         D3D12_CULL_MODE_BACK,
@@ -570,25 +815,263 @@ void Device::BuildPSO()
     psoDesc.SampleDesc.Quality = _4xMsaaQuality - 1;
     psoDesc.DSVFormat = _depthStencilFormat;
 
-    ThrowIfFailed(_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&_pso)));
+    return psoDesc;
 }
 
-void Device::FlushCommandQueue()
+void Device::BuildPSO()
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{ ScenePipelineDesc(_vsByte.Get(), _psByte.Get()) };
+    _pso = _psoCache->GetOrCreate(psoDesc, _rootSignatureHash);
+
+    // Every shader and pipeline is built at startup, so this is the point to persist them.
+    _shaderCache->Save();
+    _psoCache->Save();
+}
+
+void Device::CreateShaderHotReload()
+{
+    _shaderBackend = std::make_unique<DeviceShaderBackend>(*this);
+    _shaderHotReload = std::make_unique<ShaderHotReload<DeviceShaderBackend>>(*_shaderBackend, *_jobSystem, SHADER_DIRECTORY);
+
+    ShaderDependencies::ProgramId vs{ _shaderHotReload->AddProgram({ "assets/shaders/vs.hlsl", {}, "VS", "vs_5_0" }, _vsByte) };
+    ShaderDependencies::ProgramId ps{ _shaderHotReload->AddProgram({ "assets/shaders/vs.hlsl", {}, "PS", "ps_5_0" }, _psByte) };
+    _scenePipeline = _shaderHotReload->AddPipeline({ vs, ps }, _pso);
+}
+
+DeviceShaderBackend::Blob DeviceShaderBackend::Compile(const ShaderProgramDesc& desc)
+{
+    std::vector<D3D_SHADER_MACRO> defines;
+    for (const auto& [name, definition] : desc.defines)
+        defines.push_back({ name.c_str(), definition.c_str() });
+    defines.push_back({ nullptr, nullptr });
+
+    return _device._shaderCache->Compile(desc.file.wstring(), defines.data(), desc.entryPoint, desc.target);
+}
+
+DeviceShaderBackend::Pipeline DeviceShaderBackend::Build(uint32_t pipeline, std::span<const Blob> programs)
+{
+    assert(pipeline == _device._scenePipeline && programs.size() == 2 && "Only the scene pipeline is reloadable.");
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{ _device.ScenePipelineDesc(programs[0].Get(), programs[1].Get()) };
+
+    Pipeline pso;
+    ThrowIfFailed(_device._device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
+    return pso;
+}
+
+void Device::UpdateConstantBuffers(FrameResource& frame)
+{
+    // Row-major here, the transpose happens on the way into upload memory.
+    PassConstants passConstants;
+    XMStoreFloat4x4(&passConstants.view, _view);
+    XMStoreFloat4x4(&passConstants.proj, _projection);
+    XMStoreFloat4x4(&passConstants.viewProj, _view * _projection);
+    static_assert(sizeof(PassConstants) == 3 * sizeof(XMFLOAT4X4));
+    CopyKernels::StreamTransposed4x4(reinterpret_cast<float*>(frame.passCB.CpuAddress()), &passConstants.view.m[0][0], 3);
+    CopyKernels::Fence();
+}
+
+void Device::UpdateObjectConstants(FrameResource& frame)
+{
+    // The frame resource is retired, so a heap that got too small can be replaced outright.
+    // The new one starts out empty and gets every slot written.
+    uint32_t copy{ _frameResources->CurrentIndex() };
+    uint64_t size{ static_cast<uint64_t>(_objectSlots.SlotCount()) * sizeof(ObjectConstants) };
+    if (!frame.objects || frame.objects->Size() < size)
+    {
+        frame.objects = std::make_unique<UploadHeap>(_device.Get(), std::bit_ceil(std::max(size, MIN_OBJECT_HEAP_SIZE)));
+        _objectSlots.MarkAllDirty(copy);
+
+        // Staging descriptors are only read when copied, the old one can go right away.
+        _stagingHeap->Free(frame.objectsSrv);
+        frame.objectsSrv = _stagingHeap->Allocate();
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+        srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.NumElements = static_cast<uint32_t>(frame.objects->Size() / sizeof(ObjectConstants));
+        srvDesc.Buffer.StructureByteStride = sizeof(ObjectConstants);
+        _device->CreateShaderResourceView(frame.objects->Resource(), &srvDesc, frame.objectsSrv.cpu);
+    }
+    frame.objectsTable = StageDescriptorTable(&frame.objectsSrv.cpu, 1);
+
+    ObjectConstants* objects{ reinterpret_cast<ObjectConstants*>(frame.objects->CpuAddress()) };
+    _objectSlots.Flush(copy, *_jobSystem, [&](uint32_t firstSlot, uint32_t count)
+    {
+        // Scattered slots are mostly lone ones, written inline they don't pay for a call.
+        if (count < MIN_STREAMED_OBJECT_COUNT)
+        {
+            for (uint32_t slot = firstSlot; slot < firstSlot + count; ++slot)
+                XMStoreFloat3x4(&objects[slot].world, XMLoadFloat4x4(&_objectWorlds[slot]));
+        }
+        else
+        {
+            CopyKernels::StreamTransposed3x4(&objects[firstSlot].world.m[0][0], &_objectWorlds[firstSlot].m[0][0], count);
+        }
+    });
+    CopyKernels::Fence();
+}
+
+void Device::SelectLods()
+{
+    XMVECTOR eye{ XMMatrixInverse(nullptr, _view).r[3] };
+    float projectionScale{ XMVectorGetY(_projection.r[1]) };
+
+    std::array<float, MAX_SUBMESH_LODS + 1> errors;
+    for (DrawItem& item : _drawItems)
+    {
+        const SubmeshGeometry& submesh{ item.submesh };
+        if (submesh.lodCount < 2)
+            continue;
+
+        for (uint32_t level = 0; level < submesh.lodCount; ++level)
+            errors[level] = submesh.lods[level].error;
+
+        BoundingBox bounds;
+        submesh.bounds.Transform(bounds, XMLoadFloat4x4(&_objectWorlds[item.objectIndex]));
+        float radius{ XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents))) };
+        float distance{ XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&bounds.Center), eye))) };
+        float screenSize{ LodSelection::ScreenSize(radius, distance, projectionScale) };
+        item.lod = LodSelection::Select({ errors.data(), submesh.lodCount }, radius, screenSize, static_cast<float>(_clientHeight), item.lod);
+    }
+}
+
+void Device::CullDrawItems()
+{
+    if (_objectsMoved)
+    {
+        for (const DrawItem& item : _drawItems)
+        {
+            BoundingBox bounds;
+            item.submesh.bounds.Transform(bounds, XMLoadFloat4x4(&_objectWorlds[item.objectIndex]));
+            _culler.Update(item.cullHandle, &bounds.Center.x, &bounds.Extents.x);
+        }
+        _objectsMoved = false;
+    }
+
+    XMFLOAT4X4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, _view * _projection);
+    _culler.Cull(Frustum::FromViewProjection(viewProjection.m), *_jobSystem, _visibleDrawItems);
+}
+
+void Device::BuildInstanceBatches(FrameResource& frame)
+{
+    // Every visible draw item becomes a packet. Chunks write to their own part of the stream,
+    // the sort puts draw items differing only in their object next to each other.
+    uint32_t visibleCount{ static_cast<uint32_t>(_visibleDrawItems.size()) };
+    uint32_t chunkCount{ (visibleCount + PACKET_CHUNK_SIZE - 1) / PACKET_CHUNK_SIZE };
+    _packets.Reset(chunkCount);
+    _jobSystem->ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+    {
+        uint32_t end{ std::min(visibleCount, (chunk + 1) * PACKET_CHUNK_SIZE) };
+        for (uint32_t i = chunk * PACKET_CHUNK_SIZE; i < end; ++i)
+        {
+            uint32_t index{ _visibleDrawItems[i] };
+            const DrawItem& item{ _drawItems[index] };
+            XMMATRIX worldView{ XMLoadFloat4x4(&_objectWorlds[item.objectIndex]) * _view };
+            float viewDepth{ XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&item.submesh.bounds.Center), worldView)) };
+            uint64_t key{ SortKey::Opaque(PACKET_PASS_SCENE, _scenePipeline, 0, static_cast<uint32_t>(item.mesh), item.lod, viewDepth) };
+            _packets.Emit(chunk, { key, index, item.objectIndex });
+        }
+    });
+
+    std::span<const RenderPacket> packets{ _packets.Sort(*_jobSystem) };
+    _instanceBatcher.Group(packets);
+
+    frame.instances = {};
+    if (visibleCount == 0)
+        return;
+
+    frame.instances = AllocateUpload(static_cast<uint64_t>(visibleCount) * sizeof(InstanceData), alignof(InstanceData));
+    _instanceBatcher.WriteInstances(packets, reinterpret_cast<InstanceData*>(frame.instances.cpuAddress), *_jobSystem);
+}
+
+uint64_t Device::Signal()
 {
     _currentFence++;
 
     ThrowIfFailed(_commandQueue->Signal(_fence.Get(), _currentFence));
 
-    if (_fence->GetCompletedValue() < _currentFence)
+    return _currentFence;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Device::StageDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t count)
+{
+    // A full ring gets room by waiting for the oldest frame still holding some of it. With
+    // nothing left to wait for the table is bigger than the whole ring.
+    D3D12_GPU_DESCRIPTOR_HANDLE table{ _shaderVisibleHeap->StageTable(sources, count) };
+    while (table.ptr == 0)
+    {
+        uint64_t oldestFence{ _shaderVisibleHeap->OldestFence() };
+        if (oldestFence == 0)
+            throw DxException(E_OUTOFMEMORY, L"Device::StageDescriptorTable", AnsiToWString(__FILE__), __LINE__);
+
+        WaitForFence(oldestFence);
+        _shaderVisibleHeap->Retire(oldestFence);
+        table = _shaderVisibleHeap->StageTable(sources, count);
+    }
+
+    return table;
+}
+
+UploadAllocation Device::AllocateUpload(uint64_t size, uint64_t alignment)
+{
+    // Same as the descriptor ring, wait for the oldest frame holding upload space until
+    // there is room. Nothing left to wait for means it doesn't fit the ring at all.
+    UploadAllocation allocation{ _uploadRing->Allocate(size, alignment) };
+    while (!allocation)
+    {
+        uint64_t oldestFence{ _uploadRing->Allocator().OldestFence() };
+        if (oldestFence == 0)
+            throw DxException(E_OUTOFMEMORY, L"Device::AllocateUpload", AnsiToWString(__FILE__), __LINE__);
+
+        WaitForFence(oldestFence);
+        _uploadRing->Retire(oldestFence);
+        allocation = _uploadRing->Allocate(size, alignment);
+    }
+
+    return allocation;
+}
+
+void Device::WaitForFence(uint64_t fenceValue)
+{
+    if (fenceValue != 0 && _fence->GetCompletedValue() < fenceValue)
     {
         HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
 
-        ThrowIfFailed(_fence->SetEventOnCompletion(_currentFence, eventHandle));
+        ThrowIfFailed(_fence->SetEventOnCompletion(fenceValue, eventHandle));
         WaitForSingleObject(eventHandle, INFINITE);
         CloseHandle(eventHandle);
     }
 }
 
+void Device::FlushCommandQueue()
+{
+    WaitForFence(Signal());
+}
+
+void Device::WaitForUpload(UploadTicket ticket)
+{
+    if (!ticket)
+        return;
+
+    uint64_t fence{ _uploadService->FenceOf(ticket) };
+    if (fence == 0)
+    {
+        _uploadService->Flush();
+        fence = _uploadService->FenceOf(ticket);
+    }
+
+    // GPU side wait, only issued the first time a batch is needed. The copy fence only moves
+    // forward, so everything up to the last waited value is already ordered before this queue.
+    if (fence > _copyFenceWaited)
+    {
+        ThrowIfFailed(_commandQueue->Wait(_copyQueue->Fence(), fence));
+        _copyFenceWaited = fence;
+    }
+}
+
 void Device::OnResize()
 {
     assert(_device);
@@ -601,7 +1084,7 @@ void Device::OnResize()
 
     for (size_t i = 0; i < SWAP_CHAIN_BUFFER_COUNT; ++i)
         _swapChainBuffer[i].Reset();
-    _depthStencilBuffer.Reset();
+    _gpuHeapAllocator->Free(_depthStencilBuffer);
 
     ThrowIfFailed(_swapChain->ResizeBuffers(SWAP_CHAIN_BUFFER_COUNT, _clientWidth, _clientHeight, _backBufferFormat, DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
 
@@ -634,23 +1117,15 @@ ID3D12Resource* Device::CurrentBackBuffer() const
 
 D3D12_CPU_DESCRIPTOR_HANDLE Device::CurrentBackBufferView() const
 {
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(
-        _rtvHeap->GetCPUDescriptorHandleForHeapStart(),
-        _currentBackBuffer,
-        _rtvDescriptorSize
-    );
+    return _backBufferRtvs[_currentBackBuffer].cpu;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE Device::CurrentMsaaBackBufferView() const
 {
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(
-        _rtvMsaaHeap->GetCPUDescriptorHandleForHeapStart(),
-        _currentBackBuffer,
-        _rtvDescriptorSize
-    );
+    return _msaaRtvs[_currentBackBuffer].cpu;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE Device::DepthStencilView() const
 {
-    return _dsvHeap->GetCPUDescriptorHandleForHeapStart();
+    return _dsv.cpu;
 }
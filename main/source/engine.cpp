@@ -2,12 +2,60 @@
 #include "engine.hpp"
 
 #include "device.hpp"
+#include "job_system.hpp"
 
-Engine::Engine(std::shared_ptr<Device> device) : _device(device)
+Engine::Engine(std::shared_ptr<Device> device, std::shared_ptr<JobSystem> jobSystem) : _device(device), _jobSystem(jobSystem)
 {
     
     DirectX::XMMATRIX projection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 1920.0f / 1080.0f, 0.1f, 100.0f);
     DirectX::XMStoreFloat4x4(&_projection, projection);
+
+    RegisterDrawItems();
+    _device->SetOverlay([this] { DrawOverlay(); });
+}
+
+Engine::~Engine()
+{
+    // The device may outlive the engine, the overlay must not.
+    _device->SetOverlay(nullptr);
+}
+
+void Engine::RegisterDrawItems()
+{
+    std::span<const DrawItem> drawItems{ _device->DrawItems() };
+    for (uint32_t i = 0; i < drawItems.size(); ++i)
+    {
+        // Identity transform to start with, the bounds are where the mesh put them.
+        const DirectX::BoundingBox& bounds{ drawItems[i].submesh.bounds };
+
+        entt::entity entity{ _registry.create() };
+        AabbTree::NodeId node{ _sceneTree.Insert(Aabb::FromCenterExtents(&bounds.Center.x, &bounds.Extents.x), entt::to_integral(entity)) };
+        _registry.emplace<SceneProxy>(entity, node);
+        _registry.emplace<Renderable>(entity, i);
+        _registry.emplace<LocalTransform>(entity);
+    }
+    _sceneTree.Rebuild();
+}
+
+void Engine::SyncTransforms()
+{
+    _transforms.Update(*_jobSystem);
+
+    std::span<const DrawItem> drawItems{ _device->DrawItems() };
+    for (entt::entity entity : _transforms.Updated())
+    {
+        const Renderable* renderable{ _registry.try_get<Renderable>(entity) };
+        if (renderable == nullptr)
+            continue;
+
+        const DrawItem& item{ drawItems[renderable->drawItem] };
+        const DirectX::XMFLOAT4X4& world{ _registry.get<WorldTransform>(entity).matrix };
+        _device->SetObjectWorld(item.objectIndex, world);
+
+        DirectX::BoundingBox bounds;
+        item.submesh.bounds.Transform(bounds, DirectX::XMLoadFloat4x4(&world));
+        _sceneTree.Move(_registry.get<SceneProxy>(entity).node, Aabb::FromCenterExtents(&bounds.Center.x, &bounds.Extents.x));
+    }
 }
 
 void Engine::Tick() 
@@ -23,15 +71,54 @@ void Engine::Tick()
     DirectX::XMMATRIX view{ DirectX::XMMatrixLookAtLH(pos, target, up) };
     DirectX::XMStoreFloat4x4(&_view, view);
 
-    DirectX::XMMATRIX world{ DirectX::XMLoadFloat4x4(&_world) };
     DirectX::XMMATRIX projection{ DirectX::XMLoadFloat4x4(&_projection) };
+    _device->SetViewProjection(view, projection);
+
+    SyncTransforms();
 
-    DirectX::XMMATRIX mvp{ world * view * projection };
-    _device->SetMVP(mvp);
+    if (++_tickCount % SCENE_REBUILD_INTERVAL == 0)
+        _sceneTree.RebuildIfDegraded();
 
     _device->Draw();
 }
 
+void Engine::DrawOverlay() const
+{
+    ImGui::Begin("Scene");
+    const Renderable* renderable{ _registry.valid(_hoveredEntity) ? _registry.try_get<Renderable>(_hoveredEntity) : nullptr };
+    if (renderable == nullptr)
+    {
+        ImGui::TextUnformatted("Hovered: nothing");
+    }
+    else
+    {
+        const DrawItem& item{ _device->DrawItems()[renderable->drawItem] };
+        ImGui::Text("Hovered: entity %u", static_cast<uint32_t>(entt::to_integral(_hoveredEntity)));
+        ImGui::Text("%s, draw item %u, LOD %u of %u", item.geometry->name.c_str(), renderable->drawItem, item.lod, item.submesh.lodCount);
+    }
+    ImGui::End();
+}
+
+entt::entity Engine::Pick(int x, int y) const
+{
+    // Unproject the pixel onto the near and far planes, the ray runs between the two.
+    float ndcX{ 2.0f * (static_cast<float>(x) + 0.5f) / _device->ClientWidth() - 1.0f };
+    float ndcY{ 1.0f - 2.0f * (static_cast<float>(y) + 0.5f) / _device->ClientHeight() };
+
+    DirectX::XMMATRIX viewProjection{ DirectX::XMLoadFloat4x4(&_view) * DirectX::XMLoadFloat4x4(&_projection) };
+    DirectX::XMMATRIX inverse{ DirectX::XMMatrixInverse(nullptr, viewProjection) };
+    DirectX::XMVECTOR nearPoint{ DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverse) };
+    DirectX::XMVECTOR farPoint{ DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverse) };
+
+    Ray ray;
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(ray.origin), nearPoint);
+    DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(ray.direction), DirectX::XMVectorSubtract(farPoint, nearPoint));
+    ray.maxDistance = 1.0f;
+
+    RayHit hit{ _sceneTree.RayCast(ray) };
+    return hit ? entt::entity{ hit.payload } : entt::null;
+}
+
 void Engine::OnMouseMove(WPARAM buttonState, int x, int y)
 {
     if ((buttonState & MK_LBUTTON) != 0)
@@ -52,6 +139,10 @@ void Engine::OnMouseMove(WPARAM buttonState, int x, int y)
         _radius += dx - dy;
         _radius = std::clamp(_radius, 3.0f, 15.0f);
     }
+    else
+    {
+        _hoveredEntity = Pick(x, y);
+    }
 
     _lastMousePosition.x = x;
     _lastMousePosition.y = y;
@@ -0,0 +1,183 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+std::vector<std::filesystem::path> FileWatcher::TakeChanges()
+{
+    std::vector<std::filesystem::path> changes;
+    {
+        std::lock_guard lock{ _mutex };
+        changes.swap(_changes);
+    }
+
+    // Editors tend to touch a file several times per save.
+    std::sort(changes.begin(), changes.end());
+    changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+    return changes;
+}
+
+void FileWatcher::AddChange(std::filesystem::path path)
+{
+    std::lock_guard lock{ _mutex };
+    _changes.push_back(path.lexically_normal());
+}
+
+#if defined(_WIN32)
+
+FileWatcher::FileWatcher(std::filesystem::path directory) : _directory(std::move(directory))
+{
+    HANDLE handle{ CreateFileW(_directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr) };
+    if (handle == INVALID_HANDLE_VALUE)
+        return;
+
+    _directoryHandle = handle;
+    _stopEvent = CreateEventW(nullptr, true, false, nullptr);
+    _thread = std::thread{ [this] { Run(); } };
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (_thread.joinable())
+    {
+        SetEvent(_stopEvent);
+        _thread.join();
+    }
+
+    if (_stopEvent)
+        CloseHandle(_stopEvent);
+    if (_directoryHandle)
+        CloseHandle(_directoryHandle);
+}
+
+void FileWatcher::Run()
+{
+    alignas(DWORD) uint8_t buffer[16 * 1024];
+
+    OVERLAPPED overlapped{};
+    overlapped.hEvent = CreateEventW(nullptr, true, false, nullptr);
+
+    constexpr DWORD filter{ FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE };
+
+    while (true)
+    {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(_directoryHandle, buffer, sizeof(buffer), true, filter, nullptr, &overlapped, nullptr))
+            break;
+
+        HANDLE events[] = { overlapped.hEvent, _stopEvent };
+        DWORD signalled{ WaitForMultipleObjects(static_cast<DWORD>(std::size(events)), events, false, INFINITE) };
+
+        DWORD bytes{ 0 };
+        if (signalled != WAIT_OBJECT_0)
+        {
+            CancelIo(_directoryHandle);
+            GetOverlappedResult(_directoryHandle, &overlapped, &bytes, true);
+            break;
+        }
+
+        // Zero bytes means the buffer overflowed and the changes are lost, nothing to report.
+        if (!GetOverlappedResult(_directoryHandle, &overlapped, &bytes, false) || bytes == 0)
+            continue;
+
+        for (uint8_t* entry = buffer;;)
+        {
+            const FILE_NOTIFY_INFORMATION& info{ *reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry) };
+            if (info.Action != FILE_ACTION_REMOVED && info.Action != FILE_ACTION_RENAMED_OLD_NAME)
+                AddChange(_directory / std::wstring{ info.FileName, info.FileNameLength / sizeof(WCHAR) });
+
+            if (info.NextEntryOffset == 0)
+                break;
+            entry += info.NextEntryOffset;
+        }
+    }
+
+    CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+FileWatcher::FileWatcher(std::filesystem::path directory) : _directory(std::move(directory))
+{
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify < 0)
+        return;
+
+    AddWatches(_directory);
+    if (_watches.empty())
+        return;
+
+    _thread = std::thread{ [this] { Run(); } };
+}
+
+FileWatcher::~FileWatcher()
+{
+    _stop.store(true, std::memory_order_relaxed);
+    if (_thread.joinable())
+        _thread.join();
+
+    if (_inotify >= 0)
+        close(_inotify);
+}
+
+void FileWatcher::AddWatches(const std::filesystem::path& directory)
+{
+    // inotify isn't recursive, every directory in the tree gets a watch of its own.
+    constexpr uint32_t mask{ IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE };
+
+    int watch{ inotify_add_watch(_inotify, directory.c_str(), mask) };
+    if (watch < 0)
+        return;
+    _watches[watch] = directory;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator{ directory, error })
+    {
+        if (entry.is_directory(error))
+            AddWatches(entry.path());
+    }
+}
+
+void FileWatcher::Run()
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    while (!_stop.load(std::memory_order_relaxed))
+    {
+        // Wake up regularly to notice the stop flag.
+        pollfd descriptor{ _inotify, POLLIN, 0 };
+        if (poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        ssize_t length{ read(_inotify, buffer, sizeof(buffer)) };
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event& event{ *reinterpret_cast<const inotify_event*>(buffer + offset) };
+            offset += sizeof(inotify_event) + event.len;
+
+            auto watch{ _watches.find(event.wd) };
+            if (watch == _watches.end() || event.len == 0)
+                continue;
+
+            std::filesystem::path path{ watch->second / event.name };
+            if (event.mask & IN_ISDIR)
+            {
+                if (event.mask & IN_CREATE)
+                    AddWatches(path);
+                continue;
+            }
+
+            AddChange(std::move(path));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,19 @@
+#include "precomp.hpp"
+#include "frame_resource.hpp"
+
+FrameResource::FrameResource(ID3D12Device* device, uint32_t passCount, uint32_t workerCount) :
+    passCount(passCount)
+{
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(commandAllocator.GetAddressOf())));
+
+    workerAllocators.resize(workerCount);
+    for (auto& allocator : workerAllocators)
+        ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(allocator.GetAddressOf())));
+}
+
+FrameResource::~FrameResource() = default;
+
+void FrameResource::AllocateConstantBuffers(UploadRing<UploadHeap>& uploadRing)
+{
+    passCB = UploadBuffer<PassConstants>{ uploadRing, passCount, true };
+}
@@ -0,0 +1,312 @@
+#include "frustum_culler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "job_system.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FRUSTUM_CULLER_X86 1
+#include <immintrin.h>
+#endif
+
+// Like the copy kernels, the AVX2 one gets built for AVX2 whatever the target and only runs
+// once CpuFeatures::Detected() has found it.
+#if defined(__GNUC__) || defined(__clang__)
+#define FRUSTUM_CULLER_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define FRUSTUM_CULLER_AVX2_TARGET
+#endif
+
+namespace
+{
+    // The plane terms every box needs, split up so the SIMD loops can broadcast them.
+    struct PlaneTerms
+    {
+        float normal[6][3];
+        float absoluteNormal[6][3];
+        float distance[6];
+
+        explicit PlaneTerms(const Frustum& frustum)
+        {
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    normal[plane][axis] = frustum.planes[plane][axis];
+                    absoluteNormal[plane][axis] = std::fabs(frustum.planes[plane][axis]);
+                }
+                distance[plane] = frustum.planes[plane][3];
+            }
+        }
+    };
+
+    struct Boxes
+    {
+        const float* centerX;
+        const float* centerY;
+        const float* centerZ;
+        const float* extentX;
+        const float* extentY;
+        const float* extentZ;
+        const uint32_t* payloads;
+    };
+
+    // A box is outside once its most positive corner is behind any plane:
+    // dot(n, center) + dot(|n|, extents) + d < 0. Every kernel adds up the terms in the same
+    // order, so they agree on boxes that touch a plane too. Writes the visible payloads
+    // after the visibleCount already there and returns the new count.
+    uint32_t CullScalar(const PlaneTerms& terms, const Boxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible, uint32_t visibleCount)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            bool outside{ false };
+            for (int plane = 0; plane < 6 && !outside; ++plane)
+            {
+                float distance{ (terms.normal[plane][0] * boxes.centerX[i] + terms.normal[plane][1] * boxes.centerY[i]) + (terms.normal[plane][2] * boxes.centerZ[i] + terms.distance[plane]) };
+                float radius{ (terms.absoluteNormal[plane][0] * boxes.extentX[i] + terms.absoluteNormal[plane][1] * boxes.extentY[i]) + terms.absoluteNormal[plane][2] * boxes.extentZ[i] };
+                outside = distance + radius < 0.0f;
+            }
+
+            if (!outside)
+                visible[visibleCount++] = boxes.payloads[i];
+        }
+
+        return visibleCount;
+    }
+
+#if FRUSTUM_CULLER_X86
+    uint32_t CullSse(const PlaneTerms& terms, const Boxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible)
+    {
+        uint32_t visibleCount{ 0 };
+        uint32_t i{ begin };
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 cx{ _mm_loadu_ps(boxes.centerX + i) };
+            __m128 cy{ _mm_loadu_ps(boxes.centerY + i) };
+            __m128 cz{ _mm_loadu_ps(boxes.centerZ + i) };
+            __m128 ex{ _mm_loadu_ps(boxes.extentX + i) };
+            __m128 ey{ _mm_loadu_ps(boxes.extentY + i) };
+            __m128 ez{ _mm_loadu_ps(boxes.extentZ + i) };
+
+            __m128 outside{ _mm_setzero_ps() };
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                __m128 distance{ _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(terms.normal[plane][0]), cx), _mm_mul_ps(_mm_set1_ps(terms.normal[plane][1]), cy)),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(terms.normal[plane][2]), cz), _mm_set1_ps(terms.distance[plane]))) };
+                __m128 radius{ _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(terms.absoluteNormal[plane][0]), ex), _mm_mul_ps(_mm_set1_ps(terms.absoluteNormal[plane][1]), ey)),
+                    _mm_mul_ps(_mm_set1_ps(terms.absoluteNormal[plane][2]), ez)) };
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+
+            for (uint32_t mask = ~_mm_movemask_ps(outside) & 0xfu; mask != 0; mask &= mask - 1)
+                visible[visibleCount++] = boxes.payloads[i + std::countr_zero(mask)];
+        }
+
+        return CullScalar(terms, boxes, i, end, visible, visibleCount);
+    }
+
+    FRUSTUM_CULLER_AVX2_TARGET uint32_t CullAvx2(const PlaneTerms& terms, const Boxes& boxes, uint32_t begin, uint32_t end, uint32_t* visible)
+    {
+        uint32_t visibleCount{ 0 };
+        uint32_t i{ begin };
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 cx{ _mm256_loadu_ps(boxes.centerX + i) };
+            __m256 cy{ _mm256_loadu_ps(boxes.centerY + i) };
+            __m256 cz{ _mm256_loadu_ps(boxes.centerZ + i) };
+            __m256 ex{ _mm256_loadu_ps(boxes.extentX + i) };
+            __m256 ey{ _mm256_loadu_ps(boxes.extentY + i) };
+            __m256 ez{ _mm256_loadu_ps(boxes.extentZ + i) };
+
+            __m256 outside{ _mm256_setzero_ps() };
+            for (int plane = 0; plane < 6; ++plane)
+            {
+                __m256 distance{ _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(terms.normal[plane][0]), cx), _mm256_mul_ps(_mm256_set1_ps(terms.normal[plane][1]), cy)),
+                    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(terms.normal[plane][2]), cz), _mm256_set1_ps(terms.distance[plane]))) };
+                __m256 radius{ _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(terms.absoluteNormal[plane][0]), ex), _mm256_mul_ps(_mm256_set1_ps(terms.absoluteNormal[plane][1]), ey)),
+                    _mm256_mul_ps(_mm256_set1_ps(terms.absoluteNormal[plane][2]), ez)) };
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+
+            for (uint32_t mask = ~_mm256_movemask_ps(outside) & 0xffu; mask != 0; mask &= mask - 1)
+                visible[visibleCount++] = boxes.payloads[i + std::countr_zero(mask)];
+        }
+
+        return CullScalar(terms, boxes, i, end, visible, visibleCount);
+    }
+#endif
+
+    std::atomic<CpuFeatures::Isa>& SelectedKernel()
+    {
+        static std::atomic<CpuFeatures::Isa> isa{ CpuFeatures::Detected() };
+        return isa;
+    }
+}
+
+Frustum Frustum::FromViewProjection(const float (&matrix)[4][4])
+{
+    // Gribb and Hartmann, with row vectors the clip coordinates are the matrix's columns.
+    auto column = [&](int index, float* out)
+    {
+        for (int row = 0; row < 4; ++row)
+            out[row] = matrix[row][index];
+    };
+
+    float x[4];
+    float y[4];
+    float z[4];
+    float w[4];
+    column(0, x);
+    column(1, y);
+    column(2, z);
+    column(3, w);
+
+    Frustum frustum;
+    for (int i = 0; i < 4; ++i)
+    {
+        frustum.planes[0][i] = w[i] + x[i];
+        frustum.planes[1][i] = w[i] - x[i];
+        frustum.planes[2][i] = w[i] + y[i];
+        frustum.planes[3][i] = w[i] - y[i];
+        frustum.planes[4][i] = z[i];
+        frustum.planes[5][i] = w[i] - z[i];
+    }
+    return frustum;
+}
+
+FrustumCuller::Handle FrustumCuller::Add(const float center[3], const float extents[3], uint32_t payload)
+{
+    Handle handle;
+    if (_freeHandles.empty())
+    {
+        handle = static_cast<Handle>(_handleSlots.size());
+        _handleSlots.push_back(0);
+    }
+    else
+    {
+        handle = _freeHandles.back();
+        _freeHandles.pop_back();
+    }
+
+    _handleSlots[handle] = Count();
+    _slotHandles.push_back(handle);
+    _centerX.push_back(center[0]);
+    _centerY.push_back(center[1]);
+    _centerZ.push_back(center[2]);
+    _extentX.push_back(extents[0]);
+    _extentY.push_back(extents[1]);
+    _extentZ.push_back(extents[2]);
+    _payloads.push_back(payload);
+    return handle;
+}
+
+void FrustumCuller::Update(Handle handle, const float center[3], const float extents[3])
+{
+    uint32_t slot{ _handleSlots[handle] };
+    assert(slot < Count() && _slotHandles[slot] == handle && "Stale culling handle.");
+
+    _centerX[slot] = center[0];
+    _centerY[slot] = center[1];
+    _centerZ[slot] = center[2];
+    _extentX[slot] = extents[0];
+    _extentY[slot] = extents[1];
+    _extentZ[slot] = extents[2];
+}
+
+void FrustumCuller::SetPayload(Handle handle, uint32_t payload)
+{
+    uint32_t slot{ _handleSlots[handle] };
+    assert(slot < Count() && _slotHandles[slot] == handle && "Stale culling handle.");
+    _payloads[slot] = payload;
+}
+
+void FrustumCuller::Remove(Handle handle)
+{
+    uint32_t slot{ _handleSlots[handle] };
+    uint32_t last{ Count() - 1 };
+    assert(slot < Count() && _slotHandles[slot] == handle && "Stale culling handle.");
+
+    auto moveLast = [&](auto& values)
+    {
+        values[slot] = values[last];
+        values.pop_back();
+    };
+    moveLast(_centerX);
+    moveLast(_centerY);
+    moveLast(_centerZ);
+    moveLast(_extentX);
+    moveLast(_extentY);
+    moveLast(_extentZ);
+    moveLast(_payloads);
+    moveLast(_slotHandles);
+
+    if (slot != last)
+        _handleSlots[_slotHandles[slot]] = slot;
+    _freeHandles.push_back(handle);
+}
+
+void FrustumCuller::Clear()
+{
+    *this = FrustumCuller{};
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, JobSystem& jobSystem, std::vector<uint32_t>& visible)
+{
+    uint32_t count{ Count() };
+    uint32_t chunkCount{ (count + CHUNK_SIZE - 1) / CHUNK_SIZE };
+
+    // Every chunk compacts into its own stretch of the scratch list, the stretches get
+    // stitched together afterwards.
+    _chunkVisible.resize(count);
+    _chunkCounts.resize(chunkCount);
+    jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+    {
+        uint32_t begin{ chunk * CHUNK_SIZE };
+        _chunkCounts[chunk] = CullRange(frustum, begin, std::min(count, begin + CHUNK_SIZE), _chunkVisible.data() + begin);
+    });
+
+    visible.clear();
+    for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        const uint32_t* first{ _chunkVisible.data() + chunk * CHUNK_SIZE };
+        visible.insert(visible.end(), first, first + _chunkCounts[chunk]);
+    }
+}
+
+uint32_t FrustumCuller::CullRange(const Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* visible) const
+{
+    PlaneTerms terms{ frustum };
+    Boxes boxes{ _centerX.data(), _centerY.data(), _centerZ.data(), _extentX.data(), _extentY.data(), _extentZ.data(), _payloads.data() };
+
+    switch (SelectedKernel().load(std::memory_order_relaxed))
+    {
+#if FRUSTUM_CULLER_X86
+    case CpuFeatures::Isa::Avx2:
+        return CullAvx2(terms, boxes, begin, end, visible);
+    case CpuFeatures::Isa::Sse2:
+        return CullSse(terms, boxes, begin, end, visible);
+#endif
+    default:
+        return CullScalar(terms, boxes, begin, end, visible, 0);
+    }
+}
+
+CpuFeatures::Isa FrustumCuller::Kernel()
+{
+    return SelectedKernel().load(std::memory_order_relaxed);
+}
+
+void FrustumCuller::SelectKernel(CpuFeatures::Isa isa)
+{
+    assert(isa <= CpuFeatures::Detected() && "The CPU doesn't support this kernel.");
+    SelectedKernel().store(std::min(isa, CpuFeatures::Detected()), std::memory_order_relaxed);
+}
@@ -0,0 +1,488 @@
+#include "mesh_importer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "job_system.hpp"
+#include "json.hpp"
+#include "memory_mapped_file.hpp"
+
+namespace
+{
+    constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+    constexpr uint32_t COMPONENT_BYTE = 5120;
+    constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+    constexpr uint32_t COMPONENT_SHORT = 5122;
+    constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+    constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+    constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+    constexpr uint32_t MODE_TRIANGLES = 4;
+
+    // Vertices per job when de-interleaving a primitive.
+    constexpr uint32_t VERTEX_GRAIN = 16 * 1024;
+
+    struct Buffer
+    {
+        std::shared_ptr<MemoryMappedFile> file;
+        std::vector<uint8_t> decoded;
+        std::span<const uint8_t> data;
+        bool loaded = false;
+    };
+
+    struct Accessor
+    {
+        const uint8_t* data = nullptr;
+        uint32_t stride = 0;
+        uint32_t count = 0;
+        uint32_t componentType = 0;
+        uint32_t components = 0;
+        bool normalized = false;
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    struct Primitive
+    {
+        std::string name;
+        Accessor position;
+        Accessor normal;
+        Accessor tangent;
+        Accessor texcoord0;
+        Accessor texcoord1;
+        Accessor color;
+        Accessor indices;
+        uint32_t vertexBase = 0;
+        uint32_t indexBase = 0;
+    };
+
+    // Largest integer a double holds exactly, JSON numbers past it aren't sizes anymore.
+    constexpr double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+    // Size or offset stored in a JSON number, fallback when it's missing. Nullopt for negative,
+    // fractional or huge numbers, casting those to an integer would be undefined.
+    std::optional<uint64_t> SizeOf(const JsonValue& value, uint64_t fallback = 0)
+    {
+        double number{ value.AsNumber(static_cast<double>(fallback)) };
+        if (!(number >= 0.0 && number <= MAX_EXACT_INTEGER) || number != static_cast<double>(static_cast<uint64_t>(number)))
+            return std::nullopt;
+        return static_cast<uint64_t>(number);
+    }
+
+    // Array index stored in a JSON number, SIZE_MAX when it isn't one.
+    size_t IndexOf(const JsonValue& value)
+    {
+        std::optional<uint64_t> index{ SizeOf(value, UINT64_MAX) };
+        return index && *index < SIZE_MAX ? static_cast<size_t>(*index) : SIZE_MAX;
+    }
+
+    uint32_t ComponentSize(uint32_t componentType)
+    {
+        switch (componentType)
+        {
+        case COMPONENT_BYTE:
+        case COMPONENT_UNSIGNED_BYTE:
+            return 1;
+        case COMPONENT_SHORT:
+        case COMPONENT_UNSIGNED_SHORT:
+            return 2;
+        case COMPONENT_UNSIGNED_INT:
+        case COMPONENT_FLOAT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t ComponentCount(std::string_view type)
+    {
+        if (type == "SCALAR")
+            return 1;
+        if (type == "VEC2")
+            return 2;
+        if (type == "VEC3")
+            return 3;
+        if (type == "VEC4")
+            return 4;
+        return 0;
+    }
+
+    std::optional<std::vector<uint8_t>> DecodeBase64(std::string_view text)
+    {
+        auto value = [](char c) -> int
+        {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        };
+
+        while (!text.empty() && text.back() == '=')
+            text.remove_suffix(1);
+
+        std::vector<uint8_t> bytes;
+        bytes.reserve(text.size() * 3 / 4);
+
+        uint32_t bits{ 0 };
+        int bitCount{ 0 };
+        for (char c : text)
+        {
+            int sextet{ value(c) };
+            if (sextet < 0)
+                return std::nullopt;
+
+            bits = (bits << 6) | static_cast<uint32_t>(sextet);
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+            }
+        }
+        return bytes;
+    }
+
+    // Relative file URIs may be percent encoded.
+    std::string DecodeUri(std::string_view uri)
+    {
+        std::string decoded;
+        for (size_t i = 0; i < uri.size(); ++i)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size())
+            {
+                auto hex = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+                decoded += static_cast<char>(hex(uri[i + 1]) * 16 + hex(uri[i + 2]));
+                i += 2;
+            }
+            else
+            {
+                decoded += uri[i];
+            }
+        }
+        return decoded;
+    }
+
+    bool LoadBuffer(const JsonValue& description, const std::filesystem::path& directory, std::span<const uint8_t> glbBinary, Buffer& buffer)
+    {
+        std::optional<uint64_t> byteLength{ SizeOf(description["byteLength"]) };
+        if (!byteLength)
+            return false;
+
+        if (!description.Contains("uri"))
+        {
+            // Only the first buffer of a .glb may leave out the uri, it's the binary chunk.
+            buffer.data = glbBinary;
+        }
+        else if (std::string_view uri{ description["uri"].AsString() }; uri.starts_with("data:"))
+        {
+            size_t comma{ uri.find(";base64,") };
+            if (comma == std::string_view::npos)
+                return false;
+
+            std::optional<std::vector<uint8_t>> decoded{ DecodeBase64(uri.substr(comma + 8)) };
+            if (!decoded)
+                return false;
+
+            buffer.decoded = std::move(*decoded);
+            buffer.data = buffer.decoded;
+        }
+        else
+        {
+            std::string name{ DecodeUri(uri) };
+            buffer.file = std::make_shared<MemoryMappedFile>();
+            if (!buffer.file->Open(directory / std::u8string{ name.begin(), name.end() }))
+                return false;
+
+            buffer.data = buffer.file->Data();
+        }
+
+        if (buffer.data.size() < *byteLength)
+            return false;
+
+        buffer.data = buffer.data.first(static_cast<size_t>(*byteLength));
+        return true;
+    }
+
+    // Checks the accessor fits its buffer view once, reads after that aren't checked.
+    bool ResolveAccessor(const JsonValue& document, const std::vector<Buffer>& buffers, const JsonValue& indexValue, Accessor& accessor)
+    {
+        if (indexValue.IsNull())
+            return true;
+
+        const JsonValue& description{ document["accessors"][IndexOf(indexValue)] };
+        const JsonValue& view{ document["bufferViews"][IndexOf(description["bufferView"])] };
+
+        // Sparse accessors and ones without a view are all zeroes plus patches, not supported.
+        if (!description.IsObject() || !view.IsObject() || description.Contains("sparse"))
+            return false;
+
+        size_t bufferIndex{ IndexOf(view["buffer"]) };
+        if (bufferIndex >= buffers.size())
+            return false;
+
+        std::optional<uint64_t> componentType{ SizeOf(description["componentType"]) };
+        uint32_t components{ ComponentCount(description["type"].AsString()) };
+        uint32_t elementSize{ componentType && *componentType <= UINT32_MAX ? ComponentSize(static_cast<uint32_t>(*componentType)) * components : 0 };
+        if (elementSize == 0)
+            return false;
+
+        std::optional<uint64_t> viewOffset{ SizeOf(view["byteOffset"]) };
+        std::optional<uint64_t> viewLength{ SizeOf(view["byteLength"]) };
+        std::optional<uint64_t> offset{ SizeOf(description["byteOffset"]) };
+        std::optional<uint64_t> count{ SizeOf(description["count"]) };
+        std::optional<uint64_t> stride{ SizeOf(view["byteStride"], elementSize) };
+        if (!viewOffset || !viewLength || !offset || !count || !stride)
+            return false;
+
+        // Checked piece by piece, offset + stride * (count - 1) itself can overflow.
+        std::span<const uint8_t> data{ buffers[bufferIndex].data };
+        if (*count == 0 || *count > UINT32_MAX || *stride < elementSize || *stride > UINT32_MAX ||
+            *viewOffset > data.size() || *viewLength > data.size() - *viewOffset ||
+            *offset > *viewLength || elementSize > *viewLength - *offset ||
+            *count - 1 > (*viewLength - *offset - elementSize) / *stride)
+            return false;
+
+        accessor.data = data.data() + *viewOffset + *offset;
+        accessor.stride = static_cast<uint32_t>(*stride);
+        accessor.count = static_cast<uint32_t>(*count);
+        accessor.componentType = static_cast<uint32_t>(*componentType);
+        accessor.components = components;
+        accessor.normalized = description["normalized"].AsBool();
+        return true;
+    }
+
+    float ReadComponent(const uint8_t* data, uint32_t componentType, bool normalized)
+    {
+        // glTF data is little endian, so is every platform we run on.
+        switch (componentType)
+        {
+        case COMPONENT_FLOAT:
+            return std::bit_cast<float>(static_cast<uint32_t>(data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24));
+        case COMPONENT_UNSIGNED_BYTE:
+            return normalized ? data[0] / 255.0f : data[0];
+        case COMPONENT_BYTE:
+            return normalized ? std::max(static_cast<int8_t>(data[0]) / 127.0f, -1.0f) : static_cast<int8_t>(data[0]);
+        case COMPONENT_UNSIGNED_SHORT:
+        {
+            uint16_t value{ static_cast<uint16_t>(data[0] | data[1] << 8) };
+            return normalized ? value / 65535.0f : value;
+        }
+        case COMPONENT_SHORT:
+        {
+            int16_t value{ static_cast<int16_t>(data[0] | data[1] << 8) };
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        case COMPONENT_UNSIGNED_INT:
+            return static_cast<float>(data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24);
+        default:
+            return 0.0f;
+        }
+    }
+
+    // Reads up to count components of one element, the rest of values is left alone.
+    void ReadFloats(const Accessor& accessor, uint32_t element, float* values, uint32_t count)
+    {
+        const uint8_t* data{ accessor.data + static_cast<size_t>(accessor.stride) * element };
+        uint32_t componentSize{ ComponentSize(accessor.componentType) };
+        for (uint32_t i = 0; i < std::min(count, accessor.components); ++i)
+            values[i] = ReadComponent(data + i * componentSize, accessor.componentType, accessor.normalized);
+    }
+
+    uint32_t ReadIndex(const Accessor& accessor, uint32_t element)
+    {
+        const uint8_t* data{ accessor.data + static_cast<size_t>(accessor.stride) * element };
+        switch (accessor.componentType)
+        {
+        case COMPONENT_UNSIGNED_BYTE:
+            return data[0];
+        case COMPONENT_UNSIGNED_SHORT:
+            return data[0] | data[1] << 8;
+        default:
+            return data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24;
+        }
+    }
+
+    // Splits a .glb into its JSON and binary chunk.
+    bool ParseGlb(std::span<const uint8_t> data, std::string_view& json, std::span<const uint8_t>& binary)
+    {
+        BinaryReader reader{ data };
+        if (reader.ReadU32() != GLB_MAGIC || reader.ReadU32() != 2)
+            return false;
+        reader.Skip(4);
+
+        while (!reader.Failed() && reader.Remaining() >= 8)
+        {
+            uint32_t length{ reader.ReadU32() };
+            uint32_t type{ reader.ReadU32() };
+            std::span<const uint8_t> chunk{ reader.ReadSpan(length) };
+            if (type == GLB_CHUNK_JSON && json.empty())
+                json = { reinterpret_cast<const char*>(chunk.data()), chunk.size() };
+            else if (type == GLB_CHUNK_BIN && binary.empty())
+                binary = chunk;
+        }
+
+        return !reader.Failed() && !json.empty();
+    }
+}
+
+std::optional<MeshData> ImportGltf(const std::filesystem::path& path, JobSystem& jobSystem)
+{
+    MemoryMappedFile file;
+    if (!file.Open(path))
+        return std::nullopt;
+
+    std::string_view json{ reinterpret_cast<const char*>(file.Data().data()), file.Data().size() };
+    std::span<const uint8_t> glbBinary;
+    if (file.Data().size() >= 4 && BinaryReader{ file.Data() }.ReadU32() == GLB_MAGIC)
+    {
+        json = {};
+        if (!ParseGlb(file.Data(), json, glbBinary))
+            return std::nullopt;
+    }
+
+    std::optional<JsonValue> document{ JsonValue::Parse(json) };
+    if (!document || !(*document)["asset"]["version"].AsString().starts_with("2."))
+        return std::nullopt;
+
+    // Buffers are the slow part, files to map and base64 to decode.
+    const JsonValue& bufferDescriptions{ (*document)["buffers"] };
+    std::vector<Buffer> buffers(bufferDescriptions.Size());
+    jobSystem.ParallelFor(static_cast<uint32_t>(buffers.size()), 1, [&](uint32_t index)
+    {
+        buffers[index].loaded = LoadBuffer(bufferDescriptions[index], path.parent_path(), index == 0 ? glbBinary : std::span<const uint8_t>{}, buffers[index]);
+    });
+    if (!std::all_of(buffers.begin(), buffers.end(), [](const Buffer& buffer) { return buffer.loaded; }))
+        return std::nullopt;
+
+    // Wide enough that adding up primitives can't wrap before the limits below are checked.
+    std::vector<Primitive> primitives;
+    uint64_t vertexCount{ 0 };
+    uint64_t indexCount{ 0 };
+    bool hasNormals{ false };
+
+    const JsonValue& meshes{ (*document)["meshes"] };
+    for (size_t meshIndex = 0; meshIndex < meshes.Size(); ++meshIndex)
+    {
+        const JsonValue& mesh{ meshes[meshIndex] };
+        std::string meshName{ mesh["name"].IsString() ? mesh["name"].AsString() : "mesh" + std::to_string(meshIndex) };
+
+        for (size_t primitiveIndex = 0; primitiveIndex < mesh["primitives"].Size(); ++primitiveIndex)
+        {
+            const JsonValue& description{ mesh["primitives"][primitiveIndex] };
+            if (description["mode"].AsNumber(MODE_TRIANGLES) != MODE_TRIANGLES)
+                continue;
+
+            const JsonValue& attributes{ description["attributes"] };
+            Primitive primitive;
+            primitive.name = meshName + "/" + std::to_string(primitiveIndex);
+            if (!attributes.Contains("POSITION") ||
+                !ResolveAccessor(*document, buffers, attributes["POSITION"], primitive.position) ||
+                !ResolveAccessor(*document, buffers, attributes["NORMAL"], primitive.normal) ||
+                !ResolveAccessor(*document, buffers, attributes["TANGENT"], primitive.tangent) ||
+                !ResolveAccessor(*document, buffers, attributes["TEXCOORD_0"], primitive.texcoord0) ||
+                !ResolveAccessor(*document, buffers, attributes["TEXCOORD_1"], primitive.texcoord1) ||
+                !ResolveAccessor(*document, buffers, attributes["COLOR_0"], primitive.color) ||
+                !ResolveAccessor(*document, buffers, description["indices"], primitive.indices))
+                return std::nullopt;
+
+            uint32_t count{ primitive.position.count };
+            for (const Accessor* attribute : { &primitive.normal, &primitive.tangent, &primitive.texcoord0, &primitive.texcoord1, &primitive.color })
+            {
+                if (*attribute && attribute->count != count)
+                    return std::nullopt;
+            }
+
+            primitive.vertexBase = static_cast<uint32_t>(vertexCount);
+            primitive.indexBase = static_cast<uint32_t>(indexCount);
+            vertexCount += count;
+            indexCount += primitive.indices ? primitive.indices.count : count;
+
+            // Submeshes address indices with 32 bits and vertices with a signed base vertex.
+            if (indexCount > UINT32_MAX || vertexCount > INT32_MAX)
+                return std::nullopt;
+            hasNormals |= static_cast<bool>(primitive.normal);
+            primitives.push_back(std::move(primitive));
+        }
+    }
+
+    MeshData mesh;
+    mesh.vertices.resize(vertexCount);
+    mesh.extraVertices.resize(vertexCount);
+    mesh.indices.resize(indexCount);
+    mesh.submeshes.resize(primitives.size());
+
+    std::vector<uint8_t> indicesValid(primitives.size(), 1);
+    jobSystem.ParallelFor(static_cast<uint32_t>(primitives.size()), 1, [&](uint32_t index)
+    {
+        const Primitive& primitive{ primitives[index] };
+        uint32_t count{ primitive.position.count };
+
+        jobSystem.ParallelFor((count + VERTEX_GRAIN - 1) / VERTEX_GRAIN, 1, [&](uint32_t block)
+        {
+            uint32_t end{ std::min(count, (block + 1) * VERTEX_GRAIN) };
+            for (uint32_t i = block * VERTEX_GRAIN; i < end; ++i)
+            {
+                MeshVertex& vertex{ mesh.vertices[primitive.vertexBase + i] };
+                MeshExtraVertex& extra{ mesh.extraVertices[primitive.vertexBase + i] };
+                vertex = {};
+                extra = { { 1.0f, 1.0f, 1.0f, 1.0f }, {}, {} };
+
+                ReadFloats(primitive.position, i, vertex.position, 3);
+                if (primitive.texcoord0)
+                    ReadFloats(primitive.texcoord0, i, vertex.tex0, 2);
+                if (primitive.texcoord1)
+                    ReadFloats(primitive.texcoord1, i, vertex.tex1, 2);
+                if (primitive.color)
+                    ReadFloats(primitive.color, i, extra.color, 4);
+                if (primitive.normal)
+                    ReadFloats(primitive.normal, i, extra.normal, 3);
+
+                // The fourth tangent component is the bitangent sign, our layout has no room.
+                if (primitive.tangent)
+                    ReadFloats(primitive.tangent, i, extra.tangent, 3);
+            }
+        });
+
+        uint32_t* indices{ mesh.indices.data() + primitive.indexBase };
+        if (primitive.indices)
+        {
+            for (uint32_t i = 0; i < primitive.indices.count; ++i)
+            {
+                indices[i] = ReadIndex(primitive.indices, i);
+                if (indices[i] >= count)
+                    indicesValid[index] = 0;
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                indices[i] = i;
+        }
+
+        CookedSubmesh& submesh{ mesh.submeshes[index] };
+        submesh.name = primitive.name;
+        submesh.indexCount = primitive.indices ? primitive.indices.count : count;
+        submesh.startIndexLocation = primitive.indexBase;
+        submesh.baseVertexLocation = static_cast<int32_t>(primitive.vertexBase);
+    });
+
+    if (std::find(indicesValid.begin(), indicesValid.end(), 0) != indicesValid.end())
+        return std::nullopt;
+
+    // Normals are only generated when the file has none at all, so authored ones survive.
+    if (!hasNormals)
+        mesh.GenerateNormals();
+    mesh.ComputeBounds(jobSystem);
+    return mesh;
+}
@@ -0,0 +1,165 @@
+#include "precomp.hpp"
+#include "gpu_heap_allocator.hpp"
+
+#include "util.hpp"
+
+GpuHeapAllocator::GpuHeapAllocator(ID3D12Device* device, uint64_t blockSize) :
+    _device(device),
+    _blockSize(blockSize)
+{
+    _pools[static_cast<size_t>(GpuHeapPool::Buffers)].flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    _pools[static_cast<size_t>(GpuHeapPool::Buffers)].alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    // MSAA targets need the larger placement alignment, so the whole heap has to have it.
+    _pools[static_cast<size_t>(GpuHeapPool::RenderTargets)].flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    _pools[static_cast<size_t>(GpuHeapPool::RenderTargets)].alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    _pools[static_cast<size_t>(GpuHeapPool::Textures)].flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    _pools[static_cast<size_t>(GpuHeapPool::Textures)].alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+}
+
+GpuHeapAllocator::~GpuHeapAllocator()
+{
+    // Pages are resources placed in the buffer pool, release them before the heaps go.
+    _smallBufferPages.clear();
+}
+
+GpuAllocation GpuHeapAllocator::CreateBuffer(uint64_t size)
+{
+    if (size < D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+        return CreateSmallBuffer(size);
+
+    return PlaceResource(GpuHeapPool::Buffers, CD3DX12_RESOURCE_DESC::Buffer(size), D3D12_RESOURCE_STATE_COMMON, nullptr);
+}
+
+GpuAllocation GpuHeapAllocator::CreateTexture(const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+    bool isTarget{ (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0 };
+
+    return PlaceResource(isTarget ? GpuHeapPool::RenderTargets : GpuHeapPool::Textures, desc, initialState, clearValue);
+}
+
+void GpuHeapAllocator::Free(GpuAllocation& allocation)
+{
+    if (!allocation.resource)
+        return;
+
+    allocation.resource.Reset();
+
+    if (allocation.pool == SMALL_BUFFER_POOL)
+    {
+        _smallBufferPages[allocation.block]->allocator.Free(allocation.range);
+    }
+    else
+    {
+        Pool& pool{ _pools[allocation.pool] };
+        std::unique_ptr<Block>& block{ pool.blocks[allocation.block] };
+        block->allocator.Free(allocation.range);
+
+        // Dedicated blocks only ever hold one resource. The slot stays so indices remain stable.
+        if (block->dedicated)
+            block.reset();
+    }
+
+    allocation = GpuAllocation{};
+}
+
+GpuAllocation GpuHeapAllocator::PlaceResource(GpuHeapPool poolType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+    Pool& pool{ _pools[static_cast<size_t>(poolType)] };
+    D3D12_RESOURCE_ALLOCATION_INFO info{ _device->GetResourceAllocationInfo(0, 1, &desc) };
+
+    GpuAllocation allocation;
+    allocation.pool = static_cast<uint32_t>(poolType);
+    allocation.size = info.SizeInBytes;
+
+    // Anything bigger than half a block would mostly waste the rest, so it gets its own heap.
+    if (info.SizeInBytes > _blockSize / 2)
+    {
+        uint64_t heapSize{ (info.SizeInBytes + pool.alignment - 1) & ~(pool.alignment - 1) };
+        allocation.block = CreateBlock(pool, heapSize, true);
+        allocation.range = pool.blocks[allocation.block]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < pool.blocks.size() && !allocation.range; ++i)
+        {
+            if (!pool.blocks[i] || pool.blocks[i]->dedicated)
+                continue;
+
+            allocation.block = i;
+            allocation.range = pool.blocks[i]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+        }
+
+        if (!allocation.range)
+        {
+            allocation.block = CreateBlock(pool, _blockSize, false);
+            allocation.range = pool.blocks[allocation.block]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+        }
+    }
+    assert(allocation.range && "Resource doesn't fit in a fresh heap block.");
+
+    ThrowIfFailed(_device->CreatePlacedResource(
+        pool.blocks[allocation.block]->heap.Get(),
+        allocation.range.offset,
+        &desc,
+        initialState,
+        clearValue,
+        IID_PPV_ARGS(allocation.resource.GetAddressOf())));
+
+    return allocation;
+}
+
+GpuAllocation GpuHeapAllocator::CreateSmallBuffer(uint64_t size)
+{
+    GpuAllocation allocation;
+    allocation.pool = SMALL_BUFFER_POOL;
+    allocation.size = size;
+
+    for (uint32_t i = 0; i < _smallBufferPages.size() && !allocation.range; ++i)
+    {
+        allocation.block = i;
+        allocation.range = _smallBufferPages[i]->allocator.Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+    }
+
+    if (!allocation.range)
+    {
+        auto page{ std::make_unique<SmallBufferPage>(SMALL_BUFFER_PAGE_SIZE) };
+        page->buffer = PlaceResource(GpuHeapPool::Buffers, CD3DX12_RESOURCE_DESC::Buffer(SMALL_BUFFER_PAGE_SIZE), D3D12_RESOURCE_STATE_COMMON, nullptr);
+        page->buffer.resource->SetName(L"Small buffer page");
+
+        allocation.block = static_cast<uint32_t>(_smallBufferPages.size());
+        allocation.range = page->allocator.Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+        _smallBufferPages.emplace_back(std::move(page));
+    }
+
+    allocation.resource = _smallBufferPages[allocation.block]->buffer.resource;
+    allocation.offset = allocation.range.offset;
+
+    return allocation;
+}
+
+uint32_t GpuHeapAllocator::CreateBlock(Pool& pool, uint64_t size, bool dedicated)
+{
+    auto block{ std::make_unique<Block>(size) };
+    block->dedicated = dedicated;
+
+    D3D12_HEAP_DESC heapDesc{};
+    heapDesc.SizeInBytes = size;
+    heapDesc.Properties = CD3DX12_HEAP_PROPERTIES{ D3D12_HEAP_TYPE_DEFAULT };
+    heapDesc.Alignment = pool.alignment;
+    heapDesc.Flags = pool.flags;
+    ThrowIfFailed(_device->CreateHeap(&heapDesc, IID_PPV_ARGS(block->heap.GetAddressOf())));
+
+    for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+    {
+        if (!pool.blocks[i])
+        {
+            pool.blocks[i] = std::move(block);
+            return i;
+        }
+    }
+
+    pool.blocks.emplace_back(std::move(block));
+    return static_cast<uint32_t>(pool.blocks.size() - 1);
+}
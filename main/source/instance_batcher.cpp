@@ -0,0 +1,34 @@
+#include "instance_batcher.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "copy_kernels.hpp"
+#include "job_system.hpp"
+
+void InstanceBatcher::Group(std::span<const RenderPacket> packets)
+{
+    _batches.clear();
+    _instanceCount = static_cast<uint32_t>(packets.size());
+
+    for (uint32_t i = 0; i < _instanceCount; ++i)
+    {
+        uint64_t state{ SortKey::State(packets[i].key) };
+        if (_batches.empty() || _batches.back().state != state)
+            _batches.push_back({ state, packets[i].drawItem, i, 0 });
+        ++_batches.back().instanceCount;
+    }
+}
+
+void InstanceBatcher::WriteInstances(std::span<const RenderPacket> packets, InstanceData* instances, JobSystem& jobSystem) const
+{
+    assert(packets.size() == _instanceCount && "Packets don't match the grouped ones.");
+
+    uint32_t chunkCount{ (_instanceCount + CHUNK_SIZE - 1) / CHUNK_SIZE };
+    jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+    {
+        uint32_t begin{ chunk * CHUNK_SIZE };
+        uint32_t end{ std::min(_instanceCount, begin + CHUNK_SIZE) };
+        CopyKernels::StridedCopy(&instances[begin].object, sizeof(InstanceData), &packets[begin].object, sizeof(RenderPacket), sizeof(uint32_t), end - begin);
+    });
+}
@@ -0,0 +1,214 @@
+#include "job_system.hpp"
+
+#include <cassert>
+
+namespace
+{
+    constexpr uint32_t NOT_A_WORKER = ~0u;
+    constexpr uint32_t SPINS_BEFORE_SLEEP = 64;
+
+    thread_local uint32_t workerIndex{ NOT_A_WORKER };
+    thread_local const void* workerOwner{ nullptr };
+
+    uint32_t NextRandom(uint64_t& seed)
+    {
+        // xorshift, only used to pick a victim to steal from.
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return static_cast<uint32_t>(seed);
+    }
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    _workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i)
+        _workers.emplace_back(std::make_unique<Worker>());
+
+    workerIndex = 0;
+    workerOwner = this;
+
+    for (uint32_t i = 1; i < workerCount; ++i)
+        _workers[i]->thread = std::thread{ [this, i] { WorkerLoop(i); } };
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock{ _sleepMutex };
+        _exit.store(true, std::memory_order_relaxed);
+    }
+    _wake.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+
+    if (workerOwner == this)
+    {
+        workerIndex = NOT_A_WORKER;
+        workerOwner = nullptr;
+    }
+
+    assert(_queuedJobs.load() == 0 && "Job system destroyed with jobs still queued.");
+}
+
+void JobSystem::Schedule(std::function<void()> job, JobCounter& counter)
+{
+    counter._value.fetch_add(1, std::memory_order_relaxed);
+    Job* entry{ new Job{ std::move(job), &counter } };
+
+    bool isWorker{ workerOwner == this && workerIndex != NOT_A_WORKER };
+    if (isWorker && !_workers[workerIndex]->deque.Push(entry))
+    {
+        // Our deque is full, run it now rather than growing.
+        Execute(entry);
+        return;
+    }
+
+    _queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+    if (!isWorker)
+    {
+        std::lock_guard lock{ _injectedMutex };
+        _injected.push_back(entry);
+        _injectedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    if (_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        // Taking the lock orders this with a worker that's about to sleep.
+        std::lock_guard lock{ _sleepMutex };
+        _wake.notify_one();
+    }
+}
+
+void JobSystem::ScheduleBackground(std::function<void()> job, JobCounter& counter)
+{
+    assert(WorkerCount() > 1 && "Background jobs need a worker thread to run on.");
+
+    counter._value.fetch_add(1, std::memory_order_relaxed);
+    Job* entry{ new Job{ std::move(job), &counter } };
+
+    _queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+    {
+        std::lock_guard lock{ _backgroundMutex };
+        _background.push_back(entry);
+        _backgroundCount.fetch_add(1, std::memory_order_release);
+    }
+
+    if (_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard lock{ _sleepMutex };
+        _wake.notify_one();
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    uint32_t index{ workerOwner == this ? workerIndex : NOT_A_WORKER };
+    uint64_t seed{ reinterpret_cast<uintptr_t>(&counter) | 1 };
+
+    while (!counter.IsDone())
+    {
+        if (Job* job{ FindJob(index, seed, false) })
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(uint32_t index)
+{
+    workerIndex = index;
+    workerOwner = this;
+
+    uint64_t seed{ 0x9E3779B97F4A7C15ull * (index + 1) };
+    uint32_t idleSpins{ 0 };
+
+    while (!_exit.load(std::memory_order_relaxed))
+    {
+        if (Job* job{ FindJob(index, seed, true) })
+        {
+            Execute(job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < SPINS_BEFORE_SLEEP)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lock{ _sleepMutex };
+        _sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        _wake.wait(lock, [this] { return _exit.load(std::memory_order_relaxed) || _queuedJobs.load(std::memory_order_seq_cst) > 0; });
+        _sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        idleSpins = 0;
+    }
+}
+
+JobSystem::Job* JobSystem::FindJob(uint32_t index, uint64_t& seed, bool takeBackground)
+{
+    Job* job{ nullptr };
+
+    if (index != NOT_A_WORKER)
+        job = _workers[index]->deque.Pop();
+
+    if (!job && _injectedCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard lock{ _injectedMutex };
+        if (!_injected.empty())
+        {
+            job = _injected.front();
+            _injected.pop_front();
+            _injectedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!job)
+    {
+        uint32_t workerCount{ WorkerCount() };
+        uint32_t start{ NextRandom(seed) % workerCount };
+        for (uint32_t i = 0; i < workerCount && !job; ++i)
+        {
+            uint32_t victim{ (start + i) % workerCount };
+            if (victim != index)
+                job = _workers[victim]->deque.Steal();
+        }
+    }
+
+    // Only from the worker loop, a worker inside Wait is in the middle of another job.
+    if (!job && takeBackground && index != 0 && index != NOT_A_WORKER && _backgroundCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard lock{ _backgroundMutex };
+        if (!_background.empty())
+        {
+            job = _background.front();
+            _background.pop_front();
+            _backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (job)
+        _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+    return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    job->function();
+
+    JobCounter* counter{ job->counter };
+    delete job;
+    counter->_value.fetch_sub(1, std::memory_order_release);
+}
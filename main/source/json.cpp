@@ -0,0 +1,285 @@
+#include "json.hpp"
+
+#include <charconv>
+
+namespace
+{
+    const JsonValue NULL_VALUE{};
+
+    // Nesting is bounded so hostile files can't run us out of stack.
+    constexpr uint32_t MAX_DEPTH = 256;
+
+    void AppendUtf8(std::string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+}
+
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string_view text) : _text(text) {}
+
+    bool ParseDocument(JsonValue& value)
+    {
+        if (!ParseValue(value, 0))
+            return false;
+
+        SkipWhitespace();
+        return _position == _text.size();
+    }
+
+private:
+    bool ParseValue(JsonValue& value, uint32_t depth)
+    {
+        if (depth > MAX_DEPTH)
+            return false;
+
+        SkipWhitespace();
+        if (_position == _text.size())
+            return false;
+
+        switch (_text[_position])
+        {
+        case '{':
+            return ParseObject(value, depth);
+        case '[':
+            return ParseArray(value, depth);
+        case '"':
+            value._type = JsonValue::Type::String;
+            return ParseString(value._string);
+        case 't':
+            value._type = JsonValue::Type::Bool;
+            value._bool = true;
+            return Consume("true");
+        case 'f':
+            value._type = JsonValue::Type::Bool;
+            return Consume("false");
+        case 'n':
+            return Consume("null");
+        default:
+            return ParseNumber(value);
+        }
+    }
+
+    bool ParseObject(JsonValue& value, uint32_t depth)
+    {
+        value._type = JsonValue::Type::Object;
+        ++_position;
+
+        SkipWhitespace();
+        if (Peek('}'))
+            return true;
+
+        do
+        {
+            SkipWhitespace();
+            std::string key;
+            if (!ParseString(key))
+                return false;
+
+            SkipWhitespace();
+            if (!Peek(':'))
+                return false;
+
+            JsonValue member;
+            if (!ParseValue(member, depth + 1))
+                return false;
+            value._members.emplace_back(std::move(key), std::move(member));
+
+            SkipWhitespace();
+        } while (Peek(','));
+
+        return Peek('}');
+    }
+
+    bool ParseArray(JsonValue& value, uint32_t depth)
+    {
+        value._type = JsonValue::Type::Array;
+        ++_position;
+
+        SkipWhitespace();
+        if (Peek(']'))
+            return true;
+
+        do
+        {
+            JsonValue& element{ value._elements.emplace_back() };
+            if (!ParseValue(element, depth + 1))
+                return false;
+
+            SkipWhitespace();
+        } while (Peek(','));
+
+        return Peek(']');
+    }
+
+    bool ParseString(std::string& out)
+    {
+        if (!Peek('"'))
+            return false;
+
+        while (_position < _text.size())
+        {
+            char c{ _text[_position++] };
+            if (c == '"')
+                return true;
+            if (static_cast<unsigned char>(c) < 0x20)
+                return false;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+
+            if (_position == _text.size())
+                return false;
+
+            switch (_text[_position++])
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint{ 0 };
+                if (!ParseHex4(codePoint))
+                    return false;
+
+                // Surrogate pairs encode everything outside the basic plane.
+                if (codePoint >= 0xD800 && codePoint < 0xDC00)
+                {
+                    uint32_t low{ 0 };
+                    if (!Consume("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000)
+                        return false;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                AppendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    bool ParseHex4(uint32_t& value)
+    {
+        if (_text.size() - _position < 4)
+            return false;
+
+        const char* begin{ _text.data() + _position };
+        auto [end, error] { std::from_chars(begin, begin + 4, value, 16) };
+        _position += 4;
+        return error == std::errc{} && end == begin + 4;
+    }
+
+    bool ParseNumber(JsonValue& value)
+    {
+        value._type = JsonValue::Type::Number;
+
+        const char* begin{ _text.data() + _position };
+        const char* end{ _text.data() + _text.size() };
+        auto [next, error] { std::from_chars(begin, end, value._number) };
+        if (error != std::errc{} || next == begin)
+            return false;
+
+        _position += next - begin;
+        return true;
+    }
+
+    bool Consume(std::string_view literal)
+    {
+        if (_text.substr(_position, literal.size()) != literal)
+            return false;
+
+        _position += literal.size();
+        return true;
+    }
+
+    bool Peek(char c)
+    {
+        if (_position == _text.size() || _text[_position] != c)
+            return false;
+
+        ++_position;
+        return true;
+    }
+
+    void SkipWhitespace()
+    {
+        while (_position < _text.size() && (_text[_position] == ' ' || _text[_position] == '\t' || _text[_position] == '\n' || _text[_position] == '\r'))
+            ++_position;
+    }
+
+    std::string_view _text;
+    size_t _position = 0;
+};
+
+std::optional<JsonValue> JsonValue::Parse(std::string_view text)
+{
+    JsonValue value;
+    JsonParser parser{ text };
+    if (!parser.ParseDocument(value))
+        return std::nullopt;
+
+    return value;
+}
+
+size_t JsonValue::Size() const
+{
+    if (_type == Type::Array)
+        return _elements.size();
+    if (_type == Type::Object)
+        return _members.size();
+    return 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    if (_type != Type::Array || index >= _elements.size())
+        return NULL_VALUE;
+
+    return _elements[index];
+}
+
+const JsonValue& JsonValue::operator[](std::string_view key) const
+{
+    // Objects in asset files are small, a linear search beats building a map.
+    for (const auto& [name, value] : _members)
+    {
+        if (name == key)
+            return value;
+    }
+
+    return NULL_VALUE;
+}
@@ -0,0 +1,109 @@
+#include "memory_mapped_file.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+#if defined(_WIN32)
+
+bool MemoryMappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    _file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    _mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping)
+    {
+        Close();
+        return false;
+    }
+
+    _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!_data)
+    {
+        Close();
+        return false;
+    }
+
+    _size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+
+    _data = nullptr;
+    _size = 0;
+    _mapping = nullptr;
+    _file = nullptr;
+}
+
+#else
+
+bool MemoryMappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    _file = open(path.c_str(), O_RDONLY);
+    if (_file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(_file, &status) != 0 || status.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* data{ mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, _file, 0) };
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(status.st_size);
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if (_data)
+        munmap(const_cast<uint8_t*>(_data), _size);
+    if (_file >= 0)
+        close(_file);
+
+    _data = nullptr;
+    _size = 0;
+    _file = -1;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "mesh_data.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "job_system.hpp"
+
+CookedMeshDesc MeshData::Describe() const
+{
+    CookedMeshDesc desc;
+    desc.vertexStride = sizeof(MeshVertex);
+    desc.extraVertexStride = sizeof(MeshExtraVertex);
+    desc.indexSize = sizeof(uint32_t);
+    desc.vertices = { reinterpret_cast<const uint8_t*>(vertices.data()), vertices.size() * sizeof(MeshVertex) };
+    desc.extraVertices = { reinterpret_cast<const uint8_t*>(extraVertices.data()), extraVertices.size() * sizeof(MeshExtraVertex) };
+    desc.indices = { reinterpret_cast<const uint8_t*>(indices.data()), indices.size() * sizeof(uint32_t) };
+    desc.submeshes = submeshes;
+    desc.meshlets = meshlets.meshlets;
+    desc.meshletBounds = meshlets.bounds;
+    desc.meshletVertices = meshlets.vertices;
+    desc.meshletTriangles = meshlets.triangles;
+    return desc;
+}
+
+void MeshData::ComputeBounds(JobSystem& jobSystem)
+{
+    jobSystem.ParallelFor(static_cast<uint32_t>(submeshes.size()), 1, [this](uint32_t index)
+    {
+        CookedSubmesh& submesh{ submeshes[index] };
+        if (submesh.indexCount == 0)
+            return;
+
+        float minimum[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        float maximum[3]{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        for (uint32_t i = 0; i < submesh.indexCount; ++i)
+        {
+            const MeshVertex& vertex{ vertices[submesh.baseVertexLocation + indices[submesh.startIndexLocation + i]] };
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+                maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+            }
+        }
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            submesh.boundsCenter[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+            submesh.boundsExtents[axis] = (maximum[axis] - minimum[axis]) * 0.5f;
+        }
+    });
+}
+
+void MeshData::GenerateNormals()
+{
+    for (MeshExtraVertex& extra : extraVertices)
+        std::fill(std::begin(extra.normal), std::end(extra.normal), 0.0f);
+
+    for (const CookedSubmesh& submesh : submeshes)
+    {
+        for (uint32_t i = 0; i + 2 < submesh.indexCount; i += 3)
+        {
+            uint32_t corners[3];
+            for (int c = 0; c < 3; ++c)
+                corners[c] = submesh.baseVertexLocation + indices[submesh.startIndexLocation + i + c];
+
+            const float* p0{ vertices[corners[0]].position };
+            const float* p1{ vertices[corners[1]].position };
+            const float* p2{ vertices[corners[2]].position };
+            float e0[3]{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e1[3]{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+            // The unnormalized cross product is weighted by the triangle's area already.
+            float normal[3]{ e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            for (uint32_t corner : corners)
+            {
+                for (int axis = 0; axis < 3; ++axis)
+                    extraVertices[corner].normal[axis] += normal[axis];
+            }
+        }
+    }
+
+    for (MeshExtraVertex& extra : extraVertices)
+    {
+        float length{ std::sqrt(extra.normal[0] * extra.normal[0] + extra.normal[1] * extra.normal[1] + extra.normal[2] * extra.normal[2]) };
+        if (length > 0.0f)
+        {
+            for (float& value : extra.normal)
+                value /= length;
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#include "mesh_importer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+std::optional<MeshData> ImportMesh(const std::filesystem::path& path, JobSystem& jobSystem)
+{
+    std::string extension{ path.extension().string() };
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+    if (extension == ".obj")
+        return ImportObj(path, jobSystem);
+    if (extension == ".gltf" || extension == ".glb")
+        return ImportGltf(path, jobSystem);
+    return std::nullopt;
+}
@@ -0,0 +1,67 @@
+#include "precomp.hpp"
+#include "mesh_loader.hpp"
+
+std::unique_ptr<MeshGeometry> LoadMeshGeometry(const CookedMeshDesc& desc, std::shared_ptr<const void> storage, std::string name, GpuHeapAllocator& heapAllocator, GpuUploadService& uploadService)
+{
+    auto geometry{ std::make_unique<MeshGeometry>() };
+    geometry->name = std::move(name);
+
+    geometry->cpuStorage = std::move(storage);
+    geometry->vertexBufferCPU = desc.vertices;
+    geometry->extraVertexBufferCPU = desc.extraVertices;
+    geometry->indexBufferCPU = desc.indices;
+    geometry->meshlets = desc.meshlets;
+    geometry->meshletBounds = desc.meshletBounds;
+    geometry->meshletVertices = desc.meshletVertices;
+    geometry->meshletTriangles = desc.meshletTriangles;
+
+    geometry->vertexBufferGPU = CreateDefaultBuffer(heapAllocator, uploadService, desc.vertices.data(), desc.vertices.size(), geometry->uploadTicket);
+    geometry->extraVertexBufferGPU = CreateDefaultBuffer(heapAllocator, uploadService, desc.extraVertices.data(), desc.extraVertices.size(), geometry->uploadTicket);
+    geometry->indexBufferGPU = CreateDefaultBuffer(heapAllocator, uploadService, desc.indices.data(), desc.indices.size(), geometry->uploadTicket);
+
+    geometry->vertexFormat = desc.vertexFormat;
+    geometry->vertexByteStride = desc.vertexStride;
+    geometry->vertexBufferByteSize = static_cast<uint32_t>(desc.vertices.size());
+    geometry->extraVertexByteStride = desc.extraVertexStride;
+    geometry->extraVertexBufferByteSize = static_cast<uint32_t>(desc.extraVertices.size());
+    geometry->indexFormat = desc.indexSize == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+    geometry->indexBufferByteSize = static_cast<uint32_t>(desc.indices.size());
+
+    SubmeshGeometry* full{ nullptr };
+    for (const CookedSubmesh& cooked : desc.submeshes)
+    {
+        // LODs come right after their full submesh and draw with its vertices.
+        if (cooked.lodLevel > 0)
+        {
+            assert(full && full->lodCount == cooked.lodLevel && "LOD levels out of order.");
+            full->lods[full->lodCount++] = SubmeshLod{ cooked.indexCount, cooked.startIndexLocation, cooked.lodError };
+            continue;
+        }
+
+        SubmeshGeometry submesh;
+        submesh.indexCount = cooked.indexCount;
+        submesh.startIndexLocation = cooked.startIndexLocation;
+        submesh.baseVertexLocation = cooked.baseVertexLocation;
+        submesh.bounds = BoundingBox{ XMFLOAT3{ cooked.boundsCenter }, XMFLOAT3{ cooked.boundsExtents } };
+        submesh.positionOffset = XMFLOAT3{ cooked.positionOffset };
+        submesh.positionScale = XMFLOAT3{ cooked.positionScale };
+        submesh.meshletOffset = cooked.meshletOffset;
+        submesh.meshletCount = cooked.meshletCount;
+        submesh.lods[0] = SubmeshLod{ cooked.indexCount, cooked.startIndexLocation, 0.0f };
+        full = &(geometry->drawArgs[cooked.name] = submesh);
+    }
+
+    return geometry;
+}
+
+std::unique_ptr<MeshGeometry> LoadMeshGeometry(const CookedMesh& mesh, std::string name, GpuHeapAllocator& heapAllocator, GpuUploadService& uploadService)
+{
+    assert(mesh.IsOpen() && "Loading geometry from a mesh that isn't open.");
+    return LoadMeshGeometry(mesh.Describe(), mesh.File(), std::move(name), heapAllocator, uploadService);
+}
+
+std::unique_ptr<MeshGeometry> LoadMeshGeometry(std::shared_ptr<const MeshData> mesh, std::string name, GpuHeapAllocator& heapAllocator, GpuUploadService& uploadService)
+{
+    CookedMeshDesc desc{ mesh->Describe() };
+    return LoadMeshGeometry(desc, std::move(mesh), std::move(name), heapAllocator, uploadService);
+}
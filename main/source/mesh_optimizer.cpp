@@ -0,0 +1,466 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.hpp"
+#include "job_system.hpp"
+
+namespace
+{
+    // Forsyth's scoring, the cache is an LRU of this many vertices.
+    constexpr uint32_t CACHE_SIZE = 32;
+    constexpr uint32_t MAX_VALENCE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    struct ScoreTables
+    {
+        ScoreTables()
+        {
+            for (uint32_t position = 0; position < CACHE_SIZE; ++position)
+            {
+                // The last triangle's vertices get a fixed score, so it doesn't matter which
+                // order they went in.
+                cache[position] = position < 3 ? LAST_TRIANGLE_SCORE :
+                    std::pow(1.0f - static_cast<float>(position - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+            }
+
+            valence[0] = 0.0f;
+            for (uint32_t count = 1; count <= MAX_VALENCE; ++count)
+                valence[count] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(count), -VALENCE_BOOST_POWER);
+        }
+
+        // Vertices outside the cache have position -1.
+        float Score(int32_t position, uint32_t liveTriangles) const
+        {
+            if (liveTriangles == 0)
+                return -1.0f;
+
+            float score{ position >= 0 ? cache[position] : 0.0f };
+            return score + valence[std::min(liveTriangles, MAX_VALENCE)];
+        }
+
+        float cache[CACHE_SIZE];
+        float valence[MAX_VALENCE + 1];
+    };
+
+    const ScoreTables SCORES{};
+
+    // Approximate FIFO through timestamps, returns how many of the triangle's vertices missed.
+    uint32_t UpdateCache(const uint32_t* triangle, std::vector<uint32_t>& timestamps, uint32_t& time, uint32_t cacheSize)
+    {
+        uint32_t misses{ 0 };
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex{ triangle[corner] };
+            if (time - timestamps[vertex] > cacheSize)
+            {
+                timestamps[vertex] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void Subtract(const float* a, const float* b, float* result)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            result[axis] = a[axis] - b[axis];
+    }
+
+    void Flatten(MeshData& mesh)
+    {
+        for (CookedSubmesh& submesh : mesh.submeshes)
+        {
+            if (submesh.baseVertexLocation == 0)
+                continue;
+
+            for (uint32_t i = 0; i < submesh.indexCount; ++i)
+                mesh.indices[submesh.startIndexLocation + i] += submesh.baseVertexLocation;
+            submesh.baseVertexLocation = 0;
+        }
+    }
+}
+
+void MeshOptimizer::WeldVertices(MeshData& mesh)
+{
+    Flatten(mesh);
+
+    struct Key
+    {
+        const MeshVertex* vertex;
+        const MeshExtraVertex* extra;
+
+        bool operator==(const Key& other) const
+        {
+            return memcmp(vertex, other.vertex, sizeof(MeshVertex)) == 0 && memcmp(extra, other.extra, sizeof(MeshExtraVertex)) == 0;
+        }
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return static_cast<size_t>(Hash::Bytes(key.extra, sizeof(MeshExtraVertex), Hash::Bytes(key.vertex, sizeof(MeshVertex))));
+        }
+    };
+
+    // Bitwise equality, -0 and +0 stay apart but that's harmless.
+    size_t vertexCount{ mesh.vertices.size() };
+    std::vector<uint32_t> remap(vertexCount);
+    std::unordered_map<Key, uint32_t, KeyHash> unique;
+    unique.reserve(vertexCount);
+
+    // Each vertex moves down to the first free slot before it's looked up, so the keys always
+    // point at the kept slots below uniqueCount. Moving down never overwrites a vertex that's
+    // still to be looked at, or one a key points to.
+    uint32_t uniqueCount{ 0 };
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        mesh.vertices[uniqueCount] = mesh.vertices[i];
+        mesh.extraVertices[uniqueCount] = mesh.extraVertices[i];
+        auto [it, inserted] { unique.try_emplace(Key{ &mesh.vertices[uniqueCount], &mesh.extraVertices[uniqueCount] }, uniqueCount) };
+        if (inserted)
+            ++uniqueCount;
+        remap[i] = it->second;
+    }
+
+    // The map keys point into the streams, drop it before they shrink.
+    unique.clear();
+    mesh.vertices.resize(uniqueCount);
+    mesh.extraVertices.resize(uniqueCount);
+
+    for (uint32_t& index : mesh.indices)
+        index = remap[index];
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount)
+{
+    uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+    if (triangleCount < 2)
+        return;
+
+    // Triangles using each vertex, in one flat list.
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices.first(triangleCount * 3))
+        ++liveTriangles[index];
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+                adjacency[cursor[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        vertexScore[vertex] = SCORES.Score(-1, liveTriangles[vertex]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    uint32_t bestTriangle{ 0 };
+    for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const uint32_t* corners{ &indices[triangle * 3] };
+        triangleScore[triangle] = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+        if (triangleScore[triangle] > triangleScore[bestTriangle])
+            bestTriangle = triangle;
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t cache[CACHE_SIZE + 3];
+    uint32_t cacheCount{ 0 };
+    uint32_t scanCursor{ 0 };
+    std::vector<uint32_t> deadEnds;
+
+    while (output.size() < triangleCount * 3)
+    {
+        if (bestTriangle == UINT32_MAX)
+        {
+            // Dead end. Jumping somewhere random leaves islands behind, so go back to the most
+            // recently used vertex that still has triangles, as Tipsify does.
+            while (!deadEnds.empty() && bestTriangle == UINT32_MAX)
+            {
+                uint32_t vertex{ deadEnds.back() };
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                    bestTriangle = adjacency[adjacencyOffsets[vertex]];
+            }
+
+            while (bestTriangle == UINT32_MAX)
+            {
+                if (!emitted[scanCursor])
+                    bestTriangle = scanCursor;
+                ++scanCursor;
+            }
+        }
+
+        uint32_t corners[3]{ indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+        output.insert(output.end(), corners, corners + 3);
+        deadEnds.insert(deadEnds.end(), corners, corners + 3);
+        emitted[bestTriangle] = 1;
+
+        for (uint32_t vertex : corners)
+        {
+            // Swap remove the triangle from the vertex's live list.
+            uint32_t* begin{ &adjacency[adjacencyOffsets[vertex]] };
+            uint32_t* end{ begin + liveTriangles[vertex] };
+            *std::find(begin, end, bestTriangle) = *(end - 1);
+            --liveTriangles[vertex];
+        }
+
+        // The new triangle goes to the front, everything else moves back by up to three.
+        uint32_t newCache[CACHE_SIZE + 3];
+        uint32_t newCount{ 0 };
+        for (uint32_t vertex : corners)
+        {
+            if (std::find(newCache, newCache + newCount, vertex) == newCache + newCount)
+                newCache[newCount++] = vertex;
+        }
+        uint32_t emittedCount{ newCount };
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            if (std::find(newCache, newCache + emittedCount, cache[i]) == newCache + emittedCount)
+                newCache[newCount++] = cache[i];
+        }
+
+        // Rescore everything that was or is in the cache, then their live triangles. Whatever
+        // got pushed past the end drops out with position -1.
+        for (uint32_t i = 0; i < newCount; ++i)
+        {
+            uint32_t vertex{ newCache[i] };
+            cachePosition[vertex] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+            vertexScore[vertex] = SCORES.Score(cachePosition[vertex], liveTriangles[vertex]);
+        }
+
+        bestTriangle = UINT32_MAX;
+        float bestScore{ -1.0f };
+        for (uint32_t i = 0; i < newCount; ++i)
+        {
+            uint32_t vertex{ newCache[i] };
+            for (uint32_t j = 0; j < liveTriangles[vertex]; ++j)
+            {
+                uint32_t triangle{ adjacency[adjacencyOffsets[vertex] + j] };
+                const uint32_t* triangleCorners{ &indices[triangle * 3] };
+                float score{ vertexScore[triangleCorners[0]] + vertexScore[triangleCorners[1]] + vertexScore[triangleCorners[2]] };
+                triangleScore[triangle] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, CACHE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const MeshVertex> vertices, float threshold)
+{
+    uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+    if (triangleCount < 2)
+        return;
+
+    std::vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t time{ SIMULATED_CACHE_SIZE + 1 };
+
+    // Hard boundaries, where every vertex of a triangle misses the cache a new patch starts.
+    std::vector<uint32_t> hardClusters;
+    for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        if (UpdateCache(&indices[triangle * 3], timestamps, time, SIMULATED_CACHE_SIZE) == 3 || triangle == 0)
+            hardClusters.push_back(triangle);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries split hard clusters wherever the running ACMR is already good enough.
+    std::vector<uint32_t> clusters;
+    for (size_t hard = 0; hard + 1 < hardClusters.size(); ++hard)
+    {
+        uint32_t start{ hardClusters[hard] };
+        uint32_t end{ hardClusters[hard + 1] };
+
+        time += SIMULATED_CACHE_SIZE + 1;
+        uint32_t clusterMisses{ 0 };
+        for (uint32_t triangle = start; triangle < end; ++triangle)
+            clusterMisses += UpdateCache(&indices[triangle * 3], timestamps, time, SIMULATED_CACHE_SIZE);
+        float clusterThreshold{ threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start) };
+
+        size_t first{ clusters.size() };
+        clusters.push_back(start);
+
+        time += SIMULATED_CACHE_SIZE + 1;
+        uint32_t runningMisses{ 0 };
+        uint32_t runningTriangles{ 0 };
+        for (uint32_t triangle = start; triangle < end; ++triangle)
+        {
+            runningMisses += UpdateCache(&indices[triangle * 3], timestamps, time, SIMULATED_CACHE_SIZE);
+            ++runningTriangles;
+
+            if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold && triangle + 1 < end)
+            {
+                clusters.push_back(triangle + 1);
+                time += SIMULATED_CACHE_SIZE + 1;
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+
+        // The tail rarely reaches the target, fold it into the cluster before it.
+        if (runningTriangles > 0 && clusters.size() - first > 1)
+            clusters.pop_back();
+    }
+    clusters.push_back(triangleCount);
+
+    // Sort key is how far out the cluster sits along its own facing direction.
+    float meshCentroid[3]{};
+    for (uint32_t index : indices)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            meshCentroid[axis] += vertices[index].position[axis];
+    }
+    for (float& value : meshCentroid)
+        value /= static_cast<float>(indices.size());
+
+    size_t clusterCount{ clusters.size() - 1 };
+    std::vector<float> keys(clusterCount);
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        float centroid[3]{};
+        float normal[3]{};
+        float area{ 0.0f };
+        for (uint32_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; ++triangle)
+        {
+            const float* p0{ vertices[indices[triangle * 3]].position };
+            const float* p1{ vertices[indices[triangle * 3 + 1]].position };
+            const float* p2{ vertices[indices[triangle * 3 + 2]].position };
+
+            float e0[3], e1[3];
+            Subtract(p1, p0, e0);
+            Subtract(p2, p0, e1);
+            float cross[3]{ e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+            float triangleArea{ std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]) };
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.0f * triangleArea;
+                normal[axis] += cross[axis];
+            }
+            area += triangleArea;
+        }
+
+        float normalLength{ std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]) };
+        if (area <= 0.0f || normalLength <= 0.0f)
+            continue;
+
+        float offset[3];
+        for (int axis = 0; axis < 3; ++axis)
+            offset[axis] = centroid[axis] / area - meshCentroid[axis];
+        keys[cluster] = (offset[0] * normal[0] + offset[1] * normal[1] + offset[2] * normal[2]) / normalLength;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (uint32_t cluster : order)
+        output.insert(output.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh)
+{
+    assert(std::all_of(mesh.submeshes.begin(), mesh.submeshes.end(), [](const CookedSubmesh& submesh) { return submesh.baseVertexLocation == 0; }) &&
+        "Fetch optimization needs absolute indices, weld first.");
+
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<MeshVertex> vertices;
+    std::vector<MeshExtraVertex> extraVertices;
+    vertices.reserve(mesh.vertices.size());
+    extraVertices.reserve(mesh.extraVertices.size());
+
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+            extraVertices.push_back(mesh.extraVertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices = std::move(vertices);
+    mesh.extraVertices = std::move(extraVertices);
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+    if (indices.size() < 3)
+        return statistics;
+
+    // A real FIFO, not the timestamp approximation the passes use.
+    std::vector<uint32_t> fifo;
+    std::vector<uint8_t> used(vertexCount, 0);
+    uint32_t misses{ 0 };
+    uint32_t uniqueVertices{ 0 };
+    for (uint32_t index : indices)
+    {
+        uniqueVertices += used[index] ? 0 : 1;
+        used[index] = 1;
+
+        if (std::find(fifo.begin(), fifo.end(), index) != fifo.end())
+            continue;
+
+        ++misses;
+        fifo.push_back(index);
+        if (fifo.size() > cacheSize)
+            fifo.erase(fifo.begin());
+    }
+
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return statistics;
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh, JobSystem& jobSystem)
+{
+    WeldVertices(mesh);
+
+    // Submeshes own disjoint index ranges, so they can be reordered independently.
+    uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+    jobSystem.ParallelFor(static_cast<uint32_t>(mesh.submeshes.size()), 1, [&](uint32_t index)
+    {
+        const CookedSubmesh& submesh{ mesh.submeshes[index] };
+        std::span<uint32_t> indices{ mesh.indices.data() + submesh.startIndexLocation, submesh.indexCount };
+        OptimizeVertexCache(indices, vertexCount);
+        OptimizeOverdraw(indices, mesh.vertices);
+    });
+
+    OptimizeVertexFetch(mesh);
+}
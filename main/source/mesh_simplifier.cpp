@@ -0,0 +1,346 @@
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hash.hpp"
+#include "job_system.hpp"
+#include "mesh_optimizer.hpp"
+
+namespace
+{
+    // Sum of squared distances to a set of planes, weighted by triangle area. Doubles, the
+    // terms cancel badly in float on anything far from the origin.
+    struct Quadric
+    {
+        double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+        double b2 = 0.0, bc = 0.0, bd = 0.0;
+        double c2 = 0.0, cd = 0.0;
+        double d2 = 0.0;
+        double weight = 0.0;
+
+        void AddPlane(const double* normal, double distance, double area)
+        {
+            double a{ normal[0] }, b{ normal[1] }, c{ normal[2] }, d{ distance };
+            a2 += a * a * area; ab += a * b * area; ac += a * c * area; ad += a * d * area;
+            b2 += b * b * area; bc += b * c * area; bd += b * d * area;
+            c2 += c * c * area; cd += c * d * area;
+            d2 += d * d * area;
+            weight += area;
+        }
+
+        void Add(const Quadric& other)
+        {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+        }
+
+        // Mean squared distance from the planes.
+        double Error(const float* position) const
+        {
+            double x{ position[0] }, y{ position[1] }, z{ position[2] };
+            double sum{ a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+                2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z) };
+            return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+
+    void Cross(const float* p0, const float* p1, const float* p2, double* result)
+    {
+        double e0[3]{ double{ p1[0] } - p0[0], double{ p1[1] } - p0[1], double{ p1[2] } - p0[2] };
+        double e1[3]{ double{ p2[0] } - p0[0], double{ p2[1] } - p0[1], double{ p2[2] } - p0[2] };
+        result[0] = e0[1] * e1[2] - e0[2] * e1[1];
+        result[1] = e0[2] * e1[0] - e0[0] * e1[2];
+        result[2] = e0[0] * e1[1] - e0[1] * e1[0];
+    }
+
+    uint64_t EdgeKey(uint32_t from, uint32_t to)
+    {
+        return (uint64_t{ from } << 32) | to;
+    }
+}
+
+SimplifyResult MeshSimplifier::Simplify(std::span<const uint32_t> indices, std::span<const MeshVertex> vertices, uint32_t targetIndexCount, float targetError)
+{
+    SimplifyResult result;
+    uint32_t vertexCount{ static_cast<uint32_t>(vertices.size()) };
+
+    result.indices.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        if (indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2])
+            result.indices.insert(result.indices.end(), { indices[i], indices[i + 1], indices[i + 2] });
+    }
+    if (result.indices.size() <= targetIndexCount)
+        return result;
+
+    // Vertices that only differ in attributes share a position, and so a quadric.
+    struct PositionHash
+    {
+        size_t operator()(const MeshVertex* vertex) const { return static_cast<size_t>(Hash::Bytes(vertex->position, sizeof(vertex->position))); }
+    };
+    struct PositionEqual
+    {
+        bool operator()(const MeshVertex* a, const MeshVertex* b) const { return std::equal(a->position, a->position + 3, b->position); }
+    };
+    std::unordered_map<const MeshVertex*, uint32_t, PositionHash, PositionEqual> positions;
+    std::vector<uint32_t> positionId(vertexCount);
+    std::vector<uint32_t> wedgeCount;
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        auto [it, inserted] { positions.try_emplace(&vertices[vertex], static_cast<uint32_t>(wedgeCount.size())) };
+        if (inserted)
+            wedgeCount.push_back(0);
+        positionId[vertex] = it->second;
+        ++wedgeCount[it->second];
+    }
+
+    // An edge without its twin is on the border.
+    std::unordered_set<uint64_t> edges;
+    edges.reserve(result.indices.size());
+    for (size_t i = 0; i < result.indices.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+            edges.insert(EdgeKey(positionId[result.indices[i + corner]], positionId[result.indices[i + (corner + 1) % 3]]));
+    }
+
+    std::vector<uint8_t> lockedPosition(wedgeCount.size(), 0);
+    for (uint32_t position = 0; position < wedgeCount.size(); ++position)
+        lockedPosition[position] = wedgeCount[position] > 1;
+    for (uint64_t edge : edges)
+    {
+        uint32_t from{ static_cast<uint32_t>(edge >> 32) };
+        uint32_t to{ static_cast<uint32_t>(edge) };
+        if (!edges.contains(EdgeKey(to, from)))
+            lockedPosition[from] = lockedPosition[to] = 1;
+    }
+    edges = {};
+
+    std::vector<Quadric> quadrics(wedgeCount.size());
+    float minimum[3]{ vertices[result.indices[0]].position[0], vertices[result.indices[0]].position[1], vertices[result.indices[0]].position[2] };
+    float maximum[3]{ minimum[0], minimum[1], minimum[2] };
+    for (size_t i = 0; i < result.indices.size(); i += 3)
+    {
+        const float* p0{ vertices[result.indices[i]].position };
+        double normal[3];
+        Cross(p0, vertices[result.indices[i + 1]].position, vertices[result.indices[i + 2]].position, normal);
+        double length{ std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]) };
+        if (length > 0.0)
+        {
+            for (double& value : normal)
+                value /= length;
+
+            double distance{ -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]) };
+            for (int corner = 0; corner < 3; ++corner)
+                quadrics[positionId[result.indices[i + corner]]].AddPlane(normal, distance, length * 0.5);
+        }
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const float* position{ vertices[result.indices[i + corner]].position };
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                minimum[axis] = std::min(minimum[axis], position[axis]);
+                maximum[axis] = std::max(maximum[axis], position[axis]);
+            }
+        }
+    }
+
+    float extent{ std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] }) };
+    float errorLimit{ targetError * extent };
+    float errorLimitSquared{ errorLimit * errorLimit };
+    float maxErrorSquared{ 0.0f };
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    // Each pass collapses the cheapest edges that don't share a vertex, then rebuilds.
+    while (result.indices.size() > targetIndexCount)
+    {
+        uint32_t triangleCount{ static_cast<uint32_t>(result.indices.size() / 3) };
+
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result.indices)
+            ++adjacencyOffsets[index + 1];
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.indices.size());
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+            {
+                for (int corner = 0; corner < 3; ++corner)
+                    adjacency[cursor[result.indices[triangle * 3 + corner]]++] = triangle;
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.indices.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                uint32_t a{ result.indices[i + corner] };
+                uint32_t b{ result.indices[i + (corner + 1) % 3] };
+                Quadric merged{ quadrics[positionId[a]] };
+                merged.Add(quadrics[positionId[b]]);
+
+                if (!lockedPosition[positionId[a]])
+                    collapses.push_back({ a, b, static_cast<float>(merged.Error(vertices[b].position)) });
+                if (!lockedPosition[positionId[b]])
+                    collapses.push_back({ b, a, static_cast<float>(merged.Error(vertices[a].position)) });
+            }
+        }
+
+        std::erase_if(collapses, [&](const Collapse& collapse) { return collapse.cost > errorLimitSquared; });
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // Every collapse takes out about two triangles, don't overshoot the target by much.
+        uint32_t budget{ std::max((triangleCount - targetIndexCount / 3) / 2, 1u) };
+        uint32_t collapsed{ 0 };
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapsed == budget)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // Reject collapses that would turn a remaining triangle over.
+            bool flips{ false };
+            for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1] && !flips; ++j)
+            {
+                uint32_t corners[3];
+                for (int corner = 0; corner < 3; ++corner)
+                    corners[corner] = remap[result.indices[adjacency[j] * 3 + corner]];
+
+                if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2] ||
+                    std::find(corners, corners + 3, collapse.to) != corners + 3)
+                    continue;
+
+                const float* before[3];
+                const float* after[3];
+                for (int corner = 0; corner < 3; ++corner)
+                {
+                    before[corner] = vertices[corners[corner]].position;
+                    after[corner] = corners[corner] == collapse.from ? vertices[collapse.to].position : before[corner];
+                }
+
+                double n0[3], n1[3];
+                Cross(before[0], before[1], before[2], n0);
+                Cross(after[0], after[1], after[2], n1);
+                flips = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0;
+            }
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[positionId[collapse.to]].Add(quadrics[positionId[collapse.from]]);
+            touched[collapse.from] = touched[collapse.to] = 1;
+            maxErrorSquared = std::max(maxErrorSquared, collapse.cost);
+            ++collapsed;
+        }
+
+        if (collapsed == 0)
+            break;
+
+        size_t write{ 0 };
+        for (size_t i = 0; i < result.indices.size(); i += 3)
+        {
+            uint32_t a{ remap[result.indices[i]] }, b{ remap[result.indices[i + 1]] }, c{ remap[result.indices[i + 2]] };
+            if (a == b || b == c || a == c)
+                continue;
+
+            result.indices[write++] = a;
+            result.indices[write++] = b;
+            result.indices[write++] = c;
+        }
+        result.indices.resize(write);
+    }
+
+    result.error = std::sqrt(maxErrorSquared);
+    return result;
+}
+
+void MeshSimplifier::GenerateLods(MeshData& mesh, JobSystem& jobSystem, uint32_t lodCount)
+{
+    assert(lodCount <= MAX_SUBMESH_LODS && "More levels than a submesh can carry.");
+    assert(std::none_of(mesh.submeshes.begin(), mesh.submeshes.end(), [](const CookedSubmesh& submesh) { return submesh.lodLevel != 0; }) &&
+        "The mesh already has LODs.");
+
+    struct Level
+    {
+        std::vector<uint32_t> indices;
+        float error;
+    };
+    std::vector<std::vector<Level>> chains(mesh.submeshes.size());
+
+    jobSystem.ParallelFor(static_cast<uint32_t>(mesh.submeshes.size()), 1, [&](uint32_t index)
+    {
+        const CookedSubmesh& submesh{ mesh.submeshes[index] };
+        std::span<const uint32_t> indices{ mesh.indices.data() + submesh.startIndexLocation, submesh.indexCount };
+        if (indices.empty())
+            return;
+
+        uint32_t vertexCount{ *std::max_element(indices.begin(), indices.end()) + 1 };
+        std::span<const MeshVertex> vertices{ std::span<const MeshVertex>{ mesh.vertices }.subspan(submesh.baseVertexLocation, vertexCount) };
+
+        // Simplifying the previous level is much cheaper than starting over every time, the
+        // errors add up instead.
+        std::span<const uint32_t> previous{ indices };
+        float error{ 0.0f };
+        for (uint32_t level = 1; level <= lodCount; ++level)
+        {
+            uint32_t target{ static_cast<uint32_t>(previous.size() / 3 * LOD_REDUCTION) * 3 };
+            SimplifyResult simplified{ Simplify(previous, vertices, target, LOD_MAX_ERROR) };
+            if (simplified.indices.empty() || simplified.indices.size() > previous.size() * (1.0f - LOD_MIN_REDUCTION))
+                break;
+
+            MeshOptimizer::OptimizeVertexCache(simplified.indices, vertexCount);
+            error += simplified.error;
+            chains[index].push_back({ std::move(simplified.indices), error });
+            previous = chains[index].back().indices;
+        }
+    });
+
+    std::vector<CookedSubmesh> submeshes;
+    for (size_t index = 0; index < chains.size(); ++index)
+    {
+        const CookedSubmesh full{ mesh.submeshes[index] };
+        submeshes.push_back(full);
+        for (uint32_t level = 1; level <= chains[index].size(); ++level)
+        {
+            const Level& lod{ chains[index][level - 1] };
+
+            CookedSubmesh submesh{ full };
+            submesh.name = full.name + "_lod" + std::to_string(level);
+            submesh.indexCount = static_cast<uint32_t>(lod.indices.size());
+            submesh.startIndexLocation = static_cast<uint32_t>(mesh.indices.size());
+            submesh.meshletOffset = 0;
+            submesh.meshletCount = 0;
+            submesh.lodLevel = level;
+            submesh.lodError = lod.error;
+            mesh.indices.insert(mesh.indices.end(), lod.indices.begin(), lod.indices.end());
+            submeshes.push_back(std::move(submesh));
+        }
+    }
+    mesh.submeshes = std::move(submeshes);
+}
@@ -0,0 +1,301 @@
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "job_system.hpp"
+
+namespace
+{
+    // Cones this wide are almost never culled, not worth the test on the GPU.
+    constexpr float MIN_CONE_DOT = 0.1f;
+
+    float Dot(const float* a, const float* b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // Unit normal of the triangle, zero when it's degenerate.
+    void TriangleNormal(const float* p0, const float* p1, const float* p2, float* normal)
+    {
+        float e0[3]{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e1[3]{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+        normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+        normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+        float length{ std::sqrt(Dot(normal, normal)) };
+        float scale{ length > 0.0f ? 1.0f / length : 0.0f };
+        for (int axis = 0; axis < 3; ++axis)
+            normal[axis] *= scale;
+    }
+}
+
+MeshletData MeshletBuilder::Build(std::span<const uint32_t> indices, std::span<const MeshVertex> vertices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    assert(maxVertices >= 3 && maxVertices <= 256 && "Local indices are a byte.");
+    assert(maxTriangles >= 1 && "Meshlets need room for a triangle.");
+
+    MeshletData data;
+    uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+    uint32_t vertexCount{ static_cast<uint32_t>(vertices.size()) };
+    if (triangleCount == 0)
+        return data;
+
+    // Triangles using each vertex that aren't in a meshlet yet, same flat lists as the cache optimizer.
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices.first(triangleCount * 3))
+        ++liveTriangles[index];
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+                adjacency[cursor[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<float> normals(triangleCount * 3);
+    for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        TriangleNormal(vertices[indices[triangle * 3]].position, vertices[indices[triangle * 3 + 1]].position,
+            vertices[indices[triangle * 3 + 2]].position, &normals[triangle * 3]);
+    }
+
+    // Position of each vertex in the current meshlet, UINT8_MAX + 1 when it's not in there.
+    constexpr uint32_t NOT_IN_MESHLET = 256;
+    std::vector<uint32_t> localIndex(vertexCount, NOT_IN_MESHLET);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+
+    Meshlet current{};
+    float normalSum[3]{};
+    uint32_t scanCursor{ 0 };
+
+    auto newVertices = [&](uint32_t triangle)
+    {
+        uint32_t count{ 0 };
+        for (int corner = 0; corner < 3; ++corner)
+            count += localIndex[indices[triangle * 3 + corner]] == NOT_IN_MESHLET ? 1 : 0;
+        return count;
+    };
+
+    auto flush = [&]()
+    {
+        if (current.triangleCount == 0)
+            return;
+
+        for (uint32_t i = 0; i < current.vertexCount; ++i)
+            localIndex[data.vertices[current.vertexOffset + i]] = NOT_IN_MESHLET;
+
+        data.meshlets.push_back(current);
+        current = Meshlet{ static_cast<uint32_t>(data.vertices.size()), static_cast<uint32_t>(data.triangles.size() / 3), 0, 0 };
+        normalSum[0] = normalSum[1] = normalSum[2] = 0.0f;
+    };
+
+    for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        // The neighbour that adds the fewest vertices, among those facing the same way as the
+        // meshlet so far. Only triangles sharing a vertex are looked at, that keeps it local.
+        uint32_t best{ UINT32_MAX };
+        uint32_t bestNew{ 4 };
+        float bestDot{ -std::numeric_limits<float>::max() };
+        for (uint32_t i = 0; i < current.vertexCount; ++i)
+        {
+            uint32_t vertex{ data.vertices[current.vertexOffset + i] };
+            for (uint32_t j = 0; j < liveTriangles[vertex]; ++j)
+            {
+                uint32_t triangle{ adjacency[adjacencyOffsets[vertex] + j] };
+                uint32_t added{ newVertices(triangle) };
+                if (current.vertexCount + added > maxVertices)
+                    continue;
+
+                float dot{ Dot(&normals[triangle * 3], normalSum) };
+                if (added < bestNew || (added == bestNew && dot > bestDot))
+                {
+                    best = triangle;
+                    bestNew = added;
+                    bestDot = dot;
+                }
+            }
+        }
+
+        if (best == UINT32_MAX)
+        {
+            // Nothing connected fits, carry on from the index order, which the cache optimizer
+            // left spatially coherent. A full meshlet starts over.
+            while (emitted[scanCursor])
+                ++scanCursor;
+            best = scanCursor;
+
+            if (current.vertexCount + newVertices(best) > maxVertices)
+                flush();
+        }
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex{ indices[best * 3 + corner] };
+            if (localIndex[vertex] == NOT_IN_MESHLET)
+            {
+                localIndex[vertex] = current.vertexCount++;
+                data.vertices.push_back(vertex);
+            }
+            data.triangles.push_back(static_cast<uint8_t>(localIndex[vertex]));
+
+            // Swap remove the triangle from the vertex's live list.
+            uint32_t* begin{ &adjacency[adjacencyOffsets[vertex]] };
+            uint32_t* end{ begin + liveTriangles[vertex] };
+            *std::find(begin, end, best) = *(end - 1);
+            --liveTriangles[vertex];
+        }
+
+        emitted[best] = 1;
+        ++current.triangleCount;
+        for (int axis = 0; axis < 3; ++axis)
+            normalSum[axis] += normals[best * 3 + axis];
+
+        if (current.triangleCount == maxTriangles)
+            flush();
+    }
+    flush();
+
+    data.bounds.reserve(data.meshlets.size());
+    for (const Meshlet& meshlet : data.meshlets)
+        data.bounds.push_back(ComputeBounds(data, meshlet, vertices));
+
+    return data;
+}
+
+MeshletBounds MeshletBuilder::ComputeBounds(const MeshletData& data, const Meshlet& meshlet, std::span<const MeshVertex> vertices)
+{
+    MeshletBounds bounds{};
+    if (meshlet.triangleCount == 0)
+        return bounds;
+
+    float minimum[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float maximum[3]{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    {
+        const float* position{ vertices[data.vertices[meshlet.vertexOffset + i]].position };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            minimum[axis] = std::min(minimum[axis], position[axis]);
+            maximum[axis] = std::max(maximum[axis], position[axis]);
+        }
+    }
+
+    float radiusSquared{ 0.0f };
+    for (int axis = 0; axis < 3; ++axis)
+        bounds.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    {
+        const float* position{ vertices[data.vertices[meshlet.vertexOffset + i]].position };
+        float offset[3]{ position[0] - bounds.center[0], position[1] - bounds.center[1], position[2] - bounds.center[2] };
+        radiusSquared = std::max(radiusSquared, Dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+
+    // Defaults to a cone that never culls.
+    std::copy(bounds.center, bounds.center + 3, bounds.coneApex);
+    bounds.coneCutoff = 1.0f;
+
+    std::vector<float> normals(meshlet.triangleCount * 3);
+    float axis[3]{};
+    for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+    {
+        const uint8_t* corners{ &data.triangles[(meshlet.triangleOffset + triangle) * 3] };
+        TriangleNormal(vertices[data.vertices[meshlet.vertexOffset + corners[0]]].position,
+            vertices[data.vertices[meshlet.vertexOffset + corners[1]]].position,
+            vertices[data.vertices[meshlet.vertexOffset + corners[2]]].position, &normals[triangle * 3]);
+        for (int i = 0; i < 3; ++i)
+            axis[i] += normals[triangle * 3 + i];
+    }
+
+    float axisLength{ std::sqrt(Dot(axis, axis)) };
+    if (axisLength <= 0.0f)
+        return bounds;
+    for (float& value : axis)
+        value /= axisLength;
+
+    // The widest angle between the axis and any triangle decides the cone, degenerate
+    // triangles have no say.
+    float minimumDot{ 1.0f };
+    for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+    {
+        const float* normal{ &normals[triangle * 3] };
+        if (Dot(normal, normal) > 0.0f)
+            minimumDot = std::min(minimumDot, Dot(normal, axis));
+    }
+    if (minimumDot <= MIN_CONE_DOT)
+        return bounds;
+
+    // Pull the apex back along the axis until it's behind every triangle's plane, then any
+    // point inside the cone sees every triangle from the back. center - axis * t is behind
+    // a plane through p0 once t >= dot(center - p0, normal) / dot(axis, normal).
+    float maximumT{ 0.0f };
+    for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+    {
+        const float* normal{ &normals[triangle * 3] };
+        if (Dot(normal, normal) == 0.0f)
+            continue;
+
+        const float* p0{ vertices[data.vertices[meshlet.vertexOffset + data.triangles[(meshlet.triangleOffset + triangle) * 3]]].position };
+        float offset[3]{ bounds.center[0] - p0[0], bounds.center[1] - p0[1], bounds.center[2] - p0[2] };
+        maximumT = std::max(maximumT, Dot(offset, normal) / Dot(axis, normal));
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        bounds.coneApex[i] = bounds.center[i] - axis[i] * maximumT;
+        bounds.coneAxis[i] = axis[i];
+    }
+    bounds.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+    return bounds;
+}
+
+void MeshletBuilder::BuildMeshlets(MeshData& mesh, JobSystem& jobSystem)
+{
+    std::vector<MeshletData> built(mesh.submeshes.size());
+    jobSystem.ParallelFor(static_cast<uint32_t>(mesh.submeshes.size()), 1, [&](uint32_t index)
+    {
+        const CookedSubmesh& submesh{ mesh.submeshes[index] };
+        std::span<const uint32_t> indices{ mesh.indices.data() + submesh.startIndexLocation, submesh.indexCount };
+        if (indices.empty())
+            return;
+
+        // Only as many vertices as the submesh reaches, keeps the scratch small for meshes
+        // with many parts.
+        uint32_t vertexCount{ *std::max_element(indices.begin(), indices.end()) + 1 };
+        built[index] = Build(indices, std::span<const MeshVertex>{ mesh.vertices }.subspan(submesh.baseVertexLocation, vertexCount));
+    });
+
+    MeshletData& meshlets{ mesh.meshlets };
+    meshlets = MeshletData{};
+    for (size_t index = 0; index < built.size(); ++index)
+    {
+        const MeshletData& part{ built[index] };
+        CookedSubmesh& submesh{ mesh.submeshes[index] };
+        submesh.meshletOffset = static_cast<uint32_t>(meshlets.meshlets.size());
+        submesh.meshletCount = static_cast<uint32_t>(part.meshlets.size());
+
+        uint32_t vertexBase{ static_cast<uint32_t>(meshlets.vertices.size()) };
+        uint32_t triangleBase{ static_cast<uint32_t>(meshlets.triangles.size() / 3) };
+        for (Meshlet meshlet : part.meshlets)
+        {
+            meshlet.vertexOffset += vertexBase;
+            meshlet.triangleOffset += triangleBase;
+            meshlets.meshlets.push_back(meshlet);
+        }
+        meshlets.bounds.insert(meshlets.bounds.end(), part.bounds.begin(), part.bounds.end());
+        meshlets.vertices.insert(meshlets.vertices.end(), part.vertices.begin(), part.vertices.end());
+        meshlets.triangles.insert(meshlets.triangles.end(), part.triangles.begin(), part.triangles.end());
+    }
+}
@@ -0,0 +1,373 @@
+#include "mesh_importer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.hpp"
+#include "job_system.hpp"
+#include "memory_mapped_file.hpp"
+
+namespace
+{
+    // Bytes of text per parse job, split at line ends.
+    constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+    // References are zero based once resolved, -1 when the face didn't give one.
+    struct Corner
+    {
+        int32_t position;
+        int32_t texcoord;
+        int32_t normal;
+
+        bool operator==(const Corner&) const = default;
+    };
+
+    struct CornerHash
+    {
+        size_t operator()(const Corner& corner) const
+        {
+            uint64_t packed{ static_cast<uint64_t>(static_cast<uint32_t>(corner.position)) << 32 | static_cast<uint32_t>(corner.texcoord) };
+            return static_cast<size_t>(Hash::Combine(Hash::Mix(packed), static_cast<uint32_t>(corner.normal)));
+        }
+    };
+
+    struct Group
+    {
+        uint32_t triangle;
+        std::string name;
+    };
+
+    struct Chunk
+    {
+        std::string_view text;
+
+        // Positions carry a color, white when the file has none.
+        std::vector<float> positions;
+        std::vector<float> texcoords;
+        std::vector<float> normals;
+
+        // Three per triangle. Negative OBJ indices count back from the end of what has been
+        // read so far, which is only known relative to the chunk until every chunk is parsed.
+        std::vector<Corner> corners;
+        std::vector<uint8_t> relative;
+        std::vector<Group> groups;
+
+        std::vector<Corner> uniqueCorners;
+        std::vector<uint32_t> indices;
+
+        uint32_t positionBase = 0;
+        uint32_t texcoordBase = 0;
+        uint32_t normalBase = 0;
+        uint32_t triangleBase = 0;
+        uint32_t vertexBase = 0;
+        bool failed = false;
+    };
+
+    constexpr uint8_t RELATIVE_POSITION = 1;
+    constexpr uint8_t RELATIVE_TEXCOORD = 2;
+    constexpr uint8_t RELATIVE_NORMAL = 4;
+
+    bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    std::string_view NextToken(std::string_view& line)
+    {
+        size_t begin{ 0 };
+        while (begin < line.size() && IsSpace(line[begin]))
+            ++begin;
+
+        size_t end{ begin };
+        while (end < line.size() && !IsSpace(line[end]))
+            ++end;
+
+        std::string_view token{ line.substr(begin, end - begin) };
+        line.remove_prefix(end);
+        return token;
+    }
+
+    // Reads up to count floats, returns how many were there.
+    size_t ParseFloats(std::string_view line, float* values, size_t count)
+    {
+        size_t parsed{ 0 };
+        for (; parsed < count; ++parsed)
+        {
+            std::string_view token{ NextToken(line) };
+            if (token.empty() || std::from_chars(token.data(), token.data() + token.size(), values[parsed]).ec != std::errc{})
+                break;
+        }
+        return parsed;
+    }
+
+    // One of v, v/vt, v//vn or v/vt/vn.
+    bool ParseCorner(std::string_view token, const Chunk& chunk, Corner& corner, uint8_t& relative)
+    {
+        int32_t* targets[3]{ &corner.position, &corner.texcoord, &corner.normal };
+        size_t counts[3]{ chunk.positions.size() / 6, chunk.texcoords.size() / 2, chunk.normals.size() / 3 };
+        uint8_t relativeFlags[3]{ RELATIVE_POSITION, RELATIVE_TEXCOORD, RELATIVE_NORMAL };
+
+        corner = { -1, -1, -1 };
+        relative = 0;
+        for (int i = 0; i < 3 && !token.empty(); ++i)
+        {
+            size_t slash{ token.find('/') };
+            std::string_view part{ token.substr(0, slash) };
+            token = slash == std::string_view::npos ? std::string_view{} : token.substr(slash + 1);
+
+            if (part.empty())
+            {
+                if (i == 0)
+                    return false;
+                continue;
+            }
+
+            int32_t index{ 0 };
+            if (std::from_chars(part.data(), part.data() + part.size(), index).ec != std::errc{} || index == 0)
+                return false;
+
+            if (index > 0)
+            {
+                *targets[i] = index - 1;
+            }
+            else
+            {
+                *targets[i] = static_cast<int32_t>(counts[i]) + index;
+                relative |= relativeFlags[i];
+            }
+        }
+        return true;
+    }
+
+    void ParseChunk(Chunk& chunk)
+    {
+        std::string_view text{ chunk.text };
+        Corner polygon[3];
+        uint8_t polygonRelative[3];
+
+        while (!text.empty() && !chunk.failed)
+        {
+            size_t end{ text.find('\n') };
+            std::string_view line{ text.substr(0, end) };
+            text = end == std::string_view::npos ? std::string_view{} : text.substr(end + 1);
+
+            std::string_view keyword{ NextToken(line) };
+            if (keyword == "v")
+            {
+                float values[6]{ 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+                size_t count{ ParseFloats(line, values, 6) };
+                chunk.failed = count < 3;
+
+                // Four values is a position with a weight, only six carry a color.
+                if (count != 6)
+                    std::fill(values + 3, values + 6, 1.0f);
+                chunk.positions.insert(chunk.positions.end(), values, values + 6);
+            }
+            else if (keyword == "vt")
+            {
+                float values[2]{};
+                chunk.failed = ParseFloats(line, values, 2) < 1;
+                chunk.texcoords.insert(chunk.texcoords.end(), values, values + 2);
+            }
+            else if (keyword == "vn")
+            {
+                float values[3]{};
+                chunk.failed = ParseFloats(line, values, 3) < 3;
+                chunk.normals.insert(chunk.normals.end(), values, values + 3);
+            }
+            else if (keyword == "f")
+            {
+                // Fan triangulation, corner 0 is shared by every triangle of the polygon.
+                uint32_t cornerCount{ 0 };
+                for (std::string_view token{ NextToken(line) }; !token.empty(); token = NextToken(line), ++cornerCount)
+                {
+                    Corner corner;
+                    uint8_t relative;
+                    if (!ParseCorner(token, chunk, corner, relative))
+                    {
+                        chunk.failed = true;
+                        break;
+                    }
+
+                    if (cornerCount < 3)
+                    {
+                        polygon[cornerCount] = corner;
+                        polygonRelative[cornerCount] = relative;
+                    }
+                    else
+                    {
+                        polygon[1] = polygon[2];
+                        polygonRelative[1] = polygonRelative[2];
+                        polygon[2] = corner;
+                        polygonRelative[2] = relative;
+                    }
+
+                    if (cornerCount >= 2)
+                    {
+                        chunk.corners.insert(chunk.corners.end(), polygon, polygon + 3);
+                        chunk.relative.insert(chunk.relative.end(), polygonRelative, polygonRelative + 3);
+                    }
+                }
+            }
+            else if (keyword == "o" || keyword == "g" || keyword == "usemtl")
+            {
+                std::string_view name{ NextToken(line) };
+                chunk.groups.push_back({ static_cast<uint32_t>(chunk.corners.size() / 3), std::string{ name.empty() ? keyword : name } });
+            }
+        }
+    }
+
+    // Resolves references to the whole file and welds identical corners within the chunk.
+    // Corners shared across chunks end up duplicated, that's left to the mesh optimizer.
+    void ResolveChunk(Chunk& chunk, uint32_t positionCount, uint32_t texcoordCount, uint32_t normalCount)
+    {
+        std::unordered_map<Corner, uint32_t, CornerHash> lookup;
+        lookup.reserve(chunk.corners.size() / 2);
+        chunk.indices.reserve(chunk.corners.size());
+
+        for (size_t i = 0; i < chunk.corners.size(); ++i)
+        {
+            Corner corner{ chunk.corners[i] };
+            uint8_t relative{ chunk.relative[i] };
+            if (relative & RELATIVE_POSITION)
+                corner.position += chunk.positionBase;
+            if (relative & RELATIVE_TEXCOORD)
+                corner.texcoord += chunk.texcoordBase;
+            if (relative & RELATIVE_NORMAL)
+                corner.normal += chunk.normalBase;
+
+            if (corner.position < 0 || static_cast<uint32_t>(corner.position) >= positionCount ||
+                corner.texcoord < -1 || (corner.texcoord >= 0 && static_cast<uint32_t>(corner.texcoord) >= texcoordCount) ||
+                corner.normal < -1 || (corner.normal >= 0 && static_cast<uint32_t>(corner.normal) >= normalCount))
+            {
+                chunk.failed = true;
+                return;
+            }
+
+            auto [it, inserted] { lookup.try_emplace(corner, static_cast<uint32_t>(chunk.uniqueCorners.size())) };
+            if (inserted)
+                chunk.uniqueCorners.push_back(corner);
+            chunk.indices.push_back(it->second);
+        }
+    }
+}
+
+std::optional<MeshData> ImportObj(const std::filesystem::path& path, JobSystem& jobSystem)
+{
+    MemoryMappedFile file;
+    if (!file.Open(path))
+        return std::nullopt;
+
+    std::string_view text{ reinterpret_cast<const char*>(file.Data().data()), file.Data().size() };
+
+    std::vector<Chunk> chunks;
+    while (!text.empty())
+    {
+        size_t end{ text.size() <= CHUNK_SIZE ? std::string_view::npos : text.find('\n', CHUNK_SIZE) };
+        end = end == std::string_view::npos ? text.size() : end + 1;
+        chunks.emplace_back().text = text.substr(0, end);
+        text.remove_prefix(end);
+    }
+
+    jobSystem.ParallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t index) { ParseChunk(chunks[index]); });
+
+    uint32_t positionCount{ 0 };
+    uint32_t texcoordCount{ 0 };
+    uint32_t normalCount{ 0 };
+    uint32_t triangleCount{ 0 };
+    for (Chunk& chunk : chunks)
+    {
+        if (chunk.failed)
+            return std::nullopt;
+
+        chunk.positionBase = positionCount;
+        chunk.texcoordBase = texcoordCount;
+        chunk.normalBase = normalCount;
+        chunk.triangleBase = triangleCount;
+        positionCount += static_cast<uint32_t>(chunk.positions.size() / 6);
+        texcoordCount += static_cast<uint32_t>(chunk.texcoords.size() / 2);
+        normalCount += static_cast<uint32_t>(chunk.normals.size() / 3);
+        triangleCount += static_cast<uint32_t>(chunk.corners.size() / 3);
+    }
+
+    // Gather the attribute pools, faces may reference anything read before them.
+    std::vector<float> positions(positionCount * 6);
+    std::vector<float> texcoords(texcoordCount * 2);
+    std::vector<float> normals(normalCount * 3);
+    jobSystem.ParallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t index)
+    {
+        Chunk& chunk{ chunks[index] };
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 6);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoordBase * 2);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+        ResolveChunk(chunk, positionCount, texcoordCount, normalCount);
+    });
+
+    uint32_t vertexCount{ 0 };
+    for (Chunk& chunk : chunks)
+    {
+        if (chunk.failed)
+            return std::nullopt;
+
+        chunk.vertexBase = vertexCount;
+        vertexCount += static_cast<uint32_t>(chunk.uniqueCorners.size());
+    }
+
+    MeshData mesh;
+    mesh.vertices.resize(vertexCount);
+    mesh.extraVertices.resize(vertexCount);
+    mesh.indices.resize(triangleCount * 3);
+
+    // De-interleave into the two streams.
+    jobSystem.ParallelFor(static_cast<uint32_t>(chunks.size()), 1, [&](uint32_t index)
+    {
+        const Chunk& chunk{ chunks[index] };
+        for (size_t i = 0; i < chunk.uniqueCorners.size(); ++i)
+        {
+            const Corner& corner{ chunk.uniqueCorners[i] };
+            MeshVertex& vertex{ mesh.vertices[chunk.vertexBase + i] };
+            MeshExtraVertex& extra{ mesh.extraVertices[chunk.vertexBase + i] };
+
+            const float* position{ &positions[corner.position * 6] };
+            vertex = { { position[0], position[1], position[2] }, {}, {} };
+            extra = { { position[3], position[4], position[5], 1.0f }, {}, {} };
+
+            if (corner.texcoord >= 0)
+            {
+                // OBJ puts the origin bottom left, D3D top left.
+                vertex.tex0[0] = texcoords[corner.texcoord * 2];
+                vertex.tex0[1] = 1.0f - texcoords[corner.texcoord * 2 + 1];
+            }
+            if (corner.normal >= 0)
+                std::copy_n(&normals[corner.normal * 3], 3, extra.normal);
+        }
+
+        for (size_t i = 0; i < chunk.indices.size(); ++i)
+            mesh.indices[chunk.triangleBase * 3 + i] = chunk.vertexBase + chunk.indices[i];
+    });
+
+    CookedSubmesh current;
+    current.name = "default";
+    auto closeSubmesh = [&](uint32_t endTriangle)
+    {
+        current.indexCount = endTriangle * 3 - current.startIndexLocation;
+        if (current.indexCount > 0)
+            mesh.submeshes.push_back(current);
+    };
+    for (const Chunk& chunk : chunks)
+    {
+        for (const Group& group : chunk.groups)
+        {
+            closeSubmesh(chunk.triangleBase + group.triangle);
+            current.name = group.name;
+            current.startIndexLocation = (chunk.triangleBase + group.triangle) * 3;
+        }
+    }
+    closeSubmesh(triangleCount);
+
+    if (normalCount == 0)
+        mesh.GenerateNormals();
+    mesh.ComputeBounds(jobSystem);
+    return mesh;
+}
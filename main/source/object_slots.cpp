@@ -0,0 +1,49 @@
+#include "object_slots.hpp"
+
+#include <cassert>
+
+ObjectSlots::ObjectSlots(uint32_t copyCount) : _dirty(copyCount)
+{
+    assert(copyCount > 0 && "Object constants need at least one copy.");
+}
+
+uint32_t ObjectSlots::Allocate()
+{
+    uint32_t slot;
+    if (!_freeSlots.empty())
+    {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        slot = _slotCount++;
+        for (std::vector<uint64_t>& dirty : _dirty)
+            dirty.resize((_slotCount + 63) / 64, 0);
+    }
+
+    MarkDirty(slot);
+    return slot;
+}
+
+void ObjectSlots::Free(uint32_t slot)
+{
+    assert(slot < _slotCount && std::find(_freeSlots.begin(), _freeSlots.end(), slot) == _freeSlots.end() && "Double free or foreign slot.");
+
+    // Nothing reads a free slot, there's no point writing it.
+    for (std::vector<uint64_t>& dirty : _dirty)
+        dirty[slot / 64] &= ~(1ull << (slot % 64));
+    _freeSlots.push_back(slot);
+}
+
+void ObjectSlots::MarkAllDirty(uint32_t copy)
+{
+    std::vector<uint64_t>& dirty{ _dirty[copy] };
+    std::fill(dirty.begin(), dirty.end(), ~0ull);
+    if (_slotCount % 64 != 0)
+        dirty.back() = (1ull << (_slotCount % 64)) - 1;
+
+    // Free slots stay clean.
+    for (uint32_t slot : _freeSlots)
+        dirty[slot / 64] &= ~(1ull << (slot % 64));
+}
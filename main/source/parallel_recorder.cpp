@@ -0,0 +1,58 @@
+#include "parallel_recorder.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "job_system.hpp"
+
+ParallelRecorder::ParallelRecorder(JobSystem& jobSystem) : _jobSystem(jobSystem)
+{
+}
+
+uint32_t ParallelRecorder::WorkerCount() const
+{
+    return _jobSystem.WorkerCount();
+}
+
+void ParallelRecorder::Run(uint32_t chunkCount, const std::function<void(uint32_t)>& record)
+{
+    // Jobs can't throw, so exceptions are carried back to this thread.
+    _jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+    {
+        try
+        {
+            record(chunk);
+        }
+        catch (...)
+        {
+            std::lock_guard lock{ _exceptionMutex };
+            if (!_exception)
+                _exception = std::current_exception();
+        }
+    });
+
+    if (_exception)
+        std::rethrow_exception(std::exchange(_exception, nullptr));
+}
+
+std::vector<DrawRange> ParallelRecorder::Partition(uint32_t drawCount, uint32_t maxChunks, uint32_t minDrawsPerChunk)
+{
+    std::vector<DrawRange> ranges;
+    if (drawCount == 0)
+        return ranges;
+
+    uint32_t chunkCount{ std::max(1u, std::min(maxChunks, drawCount / std::max(1u, minDrawsPerChunk))) };
+    uint32_t base{ drawCount / chunkCount };
+    uint32_t remainder{ drawCount % chunkCount };
+
+    ranges.reserve(chunkCount);
+    uint32_t begin{ 0 };
+    for (uint32_t i = 0; i < chunkCount; ++i)
+    {
+        uint32_t count{ base + (i < remainder ? 1 : 0) };
+        ranges.push_back({ begin, begin + count });
+        begin += count;
+    }
+
+    return ranges;
+}
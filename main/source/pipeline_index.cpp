@@ -0,0 +1,46 @@
+#include "pipeline_index.hpp"
+
+#include <algorithm>
+
+#include "binary_io.hpp"
+
+std::vector<uint8_t> PipelineIndex::Serialize() const
+{
+    // Sorted, so the same set always produces the same file.
+    std::vector<uint64_t> sorted{ pipelines.begin(), pipelines.end() };
+    std::sort(sorted.begin(), sorted.end());
+
+    BinaryWriter writer;
+    writer.WriteU32(MAGIC);
+    writer.WriteU32(VERSION);
+    writer.WriteU64(deviceFingerprint);
+    writer.WriteU64(libraryHash);
+    writer.WriteU64(librarySize);
+    writer.WriteU32(static_cast<uint32_t>(sorted.size()));
+    for (uint64_t pipeline : sorted)
+        writer.WriteU64(pipeline);
+
+    return std::move(writer.Data());
+}
+
+std::optional<PipelineIndex> PipelineIndex::Deserialize(std::span<const uint8_t> data)
+{
+    BinaryReader reader{ data };
+    if (reader.ReadU32() != MAGIC || reader.ReadU32() != VERSION)
+        return std::nullopt;
+
+    PipelineIndex index;
+    index.deviceFingerprint = reader.ReadU64();
+    index.libraryHash = reader.ReadU64();
+    index.librarySize = reader.ReadU64();
+
+    uint32_t count{ reader.ReadU32() };
+    if (reader.Failed() || reader.Remaining() != static_cast<size_t>(count) * sizeof(uint64_t))
+        return std::nullopt;
+
+    index.pipelines.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+        index.pipelines.insert(reader.ReadU64());
+
+    return index;
+}
@@ -0,0 +1,204 @@
+#include "precomp.hpp"
+#include "pso_cache.hpp"
+
+#include <bit>
+
+#include "binary_io.hpp"
+#include "hash.hpp"
+
+namespace
+{
+    void HashShader(Hasher& hasher, const D3D12_SHADER_BYTECODE& shader)
+    {
+        hasher.Add(shader.BytecodeLength);
+        if (shader.BytecodeLength > 0)
+            hasher.AddBytes(shader.pShaderBytecode, shader.BytecodeLength);
+    }
+
+    std::wstring PipelineName(uint64_t key)
+    {
+        wchar_t name[17];
+        swprintf_s(name, L"%016llx", static_cast<unsigned long long>(key));
+        return name;
+    }
+}
+
+PsoCache::PsoCache(ID3D12Device* device, uint64_t deviceFingerprint, std::filesystem::path directory) :
+    _device(device),
+    _libraryPath(directory / "pipelines.bin"),
+    _indexPath(directory / "pipelines.idx")
+{
+    // Without pipeline libraries we still deduplicate, just nothing persists.
+    if (FAILED(_device->QueryInterface(IID_PPV_ARGS(_device1.GetAddressOf()))))
+        return;
+
+    std::optional<std::vector<uint8_t>> indexData{ ReadWholeFile(_indexPath) };
+    std::optional<std::vector<uint8_t>> libraryData{ ReadWholeFile(_libraryPath) };
+    if (indexData && libraryData)
+    {
+        std::optional<PipelineIndex> index{ PipelineIndex::Deserialize(*indexData) };
+        if (index && index->deviceFingerprint == deviceFingerprint && index->librarySize == libraryData->size() &&
+            index->libraryHash == Hash::Bytes(libraryData->data(), libraryData->size()))
+        {
+            _libraryBlob = std::move(*libraryData);
+            _index = std::move(*index);
+        }
+    }
+
+    HRESULT hr{ E_FAIL };
+    if (!_libraryBlob.empty())
+        hr = _device1->CreatePipelineLibrary(_libraryBlob.data(), _libraryBlob.size(), IID_PPV_ARGS(_library.GetAddressOf()));
+
+    // Nothing usable on disk, or the driver rejected it after an update. Start over.
+    if (FAILED(hr))
+    {
+        _library = nullptr;
+        _libraryBlob.clear();
+        _index = PipelineIndex{};
+
+        if (FAILED(_device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(_library.GetAddressOf()))))
+            _library = nullptr;
+    }
+
+    _index.deviceFingerprint = deviceFingerprint;
+}
+
+PsoCache::~PsoCache() = default;
+
+ID3D12PipelineState* PsoCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+    uint64_t key{ HashDesc(desc, rootSignatureHash) };
+
+    std::unique_lock lock{ _mutex };
+    _compiled.wait(lock, [&] { return !_compiling.contains(key); });
+    if (auto it{ _pipelines.find(key) }; it != _pipelines.end())
+        return it->second.Get();
+
+    bool stored{ _library && _index.pipelines.contains(key) };
+    _compiling.insert(key);
+    lock.unlock();
+
+    ComPtr<ID3D12PipelineState> pso;
+    std::wstring name{ PipelineName(key) };
+    bool created{ false };
+
+    try
+    {
+        // Fails with E_INVALIDARG when the stored pipeline doesn't match after all, then it's
+        // compiled like any other. The library synchronizes itself, only loading the same
+        // pipeline twice at once isn't allowed and _compiling rules that out.
+        if (stored)
+        {
+            if (FAILED(_library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(pso.GetAddressOf()))))
+                pso = nullptr;
+        }
+
+        if (!pso)
+        {
+            ThrowIfFailed(_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso.GetAddressOf())));
+            created = true;
+        }
+    }
+    catch (...)
+    {
+        lock.lock();
+        _compiling.erase(key);
+        _compiled.notify_all();
+        throw;
+    }
+
+    lock.lock();
+
+    // Stored under the lock so Save never writes a library and index that disagree.
+    if (created && _library && SUCCEEDED(_library->StorePipeline(name.c_str(), pso.Get())))
+    {
+        _index.pipelines.insert(key);
+        _dirty = true;
+    }
+
+    _compiling.erase(key);
+    _compiled.notify_all();
+    return _pipelines.emplace(key, std::move(pso)).first->second.Get();
+}
+
+void PsoCache::Save()
+{
+    std::lock_guard lock{ _mutex };
+    if (!_library || !_dirty)
+        return;
+
+    std::vector<uint8_t> blob(_library->GetSerializedSize());
+    ThrowIfFailed(_library->Serialize(blob.data(), blob.size()));
+
+    _index.libraryHash = Hash::Bytes(blob.data(), blob.size());
+    _index.librarySize = blob.size();
+
+    // The index goes last, a library without a matching index is ignored on the next run.
+    if (WriteWholeFile(_libraryPath, blob) && WriteWholeFile(_indexPath, _index.Serialize()))
+        _dirty = false;
+}
+
+uint64_t PsoCache::HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+    Hasher hasher;
+    hasher.Add(rootSignatureHash);
+
+    HashShader(hasher, desc.VS);
+    HashShader(hasher, desc.PS);
+    HashShader(hasher, desc.DS);
+    HashShader(hasher, desc.HS);
+    HashShader(hasher, desc.GS);
+
+    hasher.Add(desc.StreamOutput.NumEntries).Add(desc.StreamOutput.NumStrides).Add(desc.StreamOutput.RasterizedStream);
+    for (uint32_t i = 0; i < desc.StreamOutput.NumEntries; ++i)
+    {
+        const D3D12_SO_DECLARATION_ENTRY& entry{ desc.StreamOutput.pSODeclaration[i] };
+        hasher.Add(entry.Stream).AddString(entry.SemanticName ? entry.SemanticName : "").Add(entry.SemanticIndex);
+        hasher.Add(entry.StartComponent).Add(entry.ComponentCount).Add(entry.OutputSlot);
+    }
+    for (uint32_t i = 0; i < desc.StreamOutput.NumStrides; ++i)
+        hasher.Add(desc.StreamOutput.pBufferStrides[i]);
+
+    // Field by field, the blend and depth stencil descs have padding in them.
+    const D3D12_BLEND_DESC& blend{ desc.BlendState };
+    hasher.Add(blend.AlphaToCoverageEnable).Add(blend.IndependentBlendEnable);
+    for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+    {
+        hasher.Add(target.BlendEnable).Add(target.LogicOpEnable);
+        hasher.Add(target.SrcBlend).Add(target.DestBlend).Add(target.BlendOp);
+        hasher.Add(target.SrcBlendAlpha).Add(target.DestBlendAlpha).Add(target.BlendOpAlpha);
+        hasher.Add(target.LogicOp).Add(target.RenderTargetWriteMask);
+    }
+
+    hasher.Add(desc.SampleMask);
+
+    const D3D12_RASTERIZER_DESC& rasterizer{ desc.RasterizerState };
+    hasher.Add(rasterizer.FillMode).Add(rasterizer.CullMode).Add(rasterizer.FrontCounterClockwise);
+    hasher.Add(static_cast<uint32_t>(rasterizer.DepthBias));
+    hasher.Add(std::bit_cast<uint32_t>(rasterizer.DepthBiasClamp)).Add(std::bit_cast<uint32_t>(rasterizer.SlopeScaledDepthBias));
+    hasher.Add(rasterizer.DepthClipEnable).Add(rasterizer.MultisampleEnable).Add(rasterizer.AntialiasedLineEnable);
+    hasher.Add(rasterizer.ForcedSampleCount).Add(rasterizer.ConservativeRaster);
+
+    const D3D12_DEPTH_STENCIL_DESC& depth{ desc.DepthStencilState };
+    hasher.Add(depth.DepthEnable).Add(depth.DepthWriteMask).Add(depth.DepthFunc);
+    hasher.Add(depth.StencilEnable).Add(depth.StencilReadMask).Add(depth.StencilWriteMask);
+    for (const D3D12_DEPTH_STENCILOP_DESC& face : { depth.FrontFace, depth.BackFace })
+        hasher.Add(face.StencilFailOp).Add(face.StencilDepthFailOp).Add(face.StencilPassOp).Add(face.StencilFunc);
+
+    hasher.Add(desc.InputLayout.NumElements);
+    for (uint32_t i = 0; i < desc.InputLayout.NumElements; ++i)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& element{ desc.InputLayout.pInputElementDescs[i] };
+        hasher.AddString(element.SemanticName).Add(element.SemanticIndex).Add(element.Format);
+        hasher.Add(element.InputSlot).Add(element.AlignedByteOffset).Add(element.InputSlotClass).Add(element.InstanceDataStepRate);
+    }
+
+    hasher.Add(desc.IBStripCutValue).Add(desc.PrimitiveTopologyType);
+    hasher.Add(desc.NumRenderTargets);
+    for (uint32_t i = 0; i < desc.NumRenderTargets; ++i)
+        hasher.Add(desc.RTVFormats[i]);
+    hasher.Add(desc.DSVFormat).Add(desc.SampleDesc.Count).Add(desc.SampleDesc.Quality);
+    hasher.Add(desc.NodeMask).Add(desc.Flags);
+
+    return hasher.Value();
+}
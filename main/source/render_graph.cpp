@@ -0,0 +1,201 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    constexpr uint32_t CULLED = ~0u;
+}
+
+void RenderGraph::Reset()
+{
+    _resources.clear();
+    _passes.clear();
+    _accesses.clear();
+}
+
+RenderGraph::ResourceId RenderGraph::ImportResource(std::string name, uint32_t initialState, uint32_t finalState, bool exported)
+{
+    _resources.push_back({ std::move(name), initialState, finalState, exported });
+    return static_cast<ResourceId>(_resources.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::AddPass(std::string name, uint32_t flags)
+{
+    _passes.push_back({ std::move(name), flags });
+    return static_cast<PassId>(_passes.size() - 1);
+}
+
+void RenderGraph::Read(PassId pass, ResourceId resource, uint32_t state)
+{
+    assert(pass < _passes.size() && resource < _resources.size());
+    _accesses.push_back({ pass, resource, state, false });
+}
+
+void RenderGraph::Write(PassId pass, ResourceId resource, uint32_t state)
+{
+    assert(pass < _passes.size() && resource < _resources.size());
+    _accesses.push_back({ pass, resource, state, true });
+}
+
+const RenderGraph::Compiled& RenderGraph::Compile()
+{
+    _sorted = _accesses;
+    std::stable_sort(_sorted.begin(), _sorted.end(), [](const Access& a, const Access& b) { return a.pass < b.pass; });
+
+    Cull();
+
+    _compiled.passes.clear();
+    _commandListOfBatch.clear();
+    _survivingIndex.assign(_passes.size(), CULLED);
+
+    uint32_t commandList{ 0 };
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        if (!_kept[pass])
+            continue;
+
+        _survivingIndex[pass] = static_cast<uint32_t>(_compiled.passes.size());
+        _compiled.passes.push_back(pass);
+
+        // The batch in front of a pass with its own lists still goes on the current list.
+        _commandListOfBatch.push_back(commandList);
+        if (_passes[pass].flags & PASS_OWN_COMMAND_LISTS)
+            commandList++;
+    }
+    _commandListOfBatch.push_back(commandList);
+
+    // Surviving accesses per resource in execution order, one per pass and resource.
+    std::erase_if(_sorted, [this](const Access& access) { return _survivingIndex[access.pass] == CULLED; });
+    for (Access& access : _sorted)
+        access.pass = _survivingIndex[access.pass];
+
+    std::stable_sort(_sorted.begin(), _sorted.end(), [](const Access& a, const Access& b)
+    {
+        return a.resource != b.resource ? a.resource < b.resource : a.pass < b.pass;
+    });
+
+    // Fold every access a pass makes to the same resource into one.
+    size_t merged{ 0 };
+    for (size_t i = 0; i < _sorted.size(); ++i)
+    {
+        if (merged > 0 && _sorted[merged - 1].resource == _sorted[i].resource && _sorted[merged - 1].pass == _sorted[i].pass)
+        {
+            _sorted[merged - 1].state |= _sorted[i].state;
+            _sorted[merged - 1].write |= _sorted[i].write;
+            continue;
+        }
+
+        _sorted[merged++] = _sorted[i];
+    }
+    _sorted.resize(merged);
+
+    _pending.clear();
+    uint32_t finalBatch{ static_cast<uint32_t>(_compiled.passes.size()) };
+
+    size_t next{ 0 };
+    for (ResourceId resource = 0; resource < _resources.size(); ++resource)
+    {
+        uint32_t state{ _resources[resource].initialState };
+        int32_t lastUse{ -1 };
+        bool readOnly{ false };
+
+        while (next < _sorted.size() && _sorted[next].resource == resource)
+        {
+            const Access& access{ _sorted[next] };
+
+            if (access.write)
+            {
+                if (access.state != state)
+                    AddTransition(resource, state, access.state, lastUse, access.pass);
+
+                state = access.state;
+                readOnly = false;
+                lastUse = static_cast<int32_t>(access.pass);
+                ++next;
+                continue;
+            }
+
+            // Consecutive reads share one combined state, so they need one transition at most.
+            uint32_t combined{ 0 };
+            size_t last{ next };
+            for (; last < _sorted.size() && _sorted[last].resource == resource && !_sorted[last].write; ++last)
+                combined |= _sorted[last].state;
+
+            bool covered{ state == combined || (readOnly && (state & combined) == combined) };
+            if (!covered)
+            {
+                AddTransition(resource, state, combined, lastUse, access.pass);
+                state = combined;
+            }
+
+            readOnly = true;
+            lastUse = static_cast<int32_t>(_sorted[last - 1].pass);
+            next = last;
+        }
+
+        if (state != _resources[resource].finalState)
+            AddTransition(resource, state, _resources[resource].finalState, lastUse, finalBatch);
+    }
+
+    // Bucket the barriers by batch, keeping their order within a batch.
+    _compiled.batchOffsets.assign(finalBatch + 2, 0);
+    for (const PendingBarrier& pending : _pending)
+        _compiled.batchOffsets[pending.batch + 1]++;
+    for (uint32_t batch = 1; batch < _compiled.batchOffsets.size(); ++batch)
+        _compiled.batchOffsets[batch] += _compiled.batchOffsets[batch - 1];
+
+    _compiled.barriers.resize(_pending.size());
+    std::vector<uint32_t>& cursor{ _commandListOfBatch };
+    cursor.assign(_compiled.batchOffsets.begin(), _compiled.batchOffsets.end() - 1);
+    for (const PendingBarrier& pending : _pending)
+        _compiled.barriers[cursor[pending.batch]++] = pending.barrier;
+
+    return _compiled;
+}
+
+void RenderGraph::Cull()
+{
+    _kept.assign(_passes.size(), false);
+    _needed.assign(_resources.size(), false);
+    for (ResourceId resource = 0; resource < _resources.size(); ++resource)
+        _needed[resource] = _resources[resource].exported;
+
+    // Walk backwards, a pass survives when something later depends on what it writes.
+    size_t end{ _sorted.size() };
+    for (PassId pass = static_cast<PassId>(_passes.size()); pass-- > 0;)
+    {
+        size_t begin{ end };
+        while (begin > 0 && _sorted[begin - 1].pass == pass)
+            --begin;
+
+        bool kept{ (_passes[pass].flags & PASS_SIDE_EFFECTS) != 0 };
+        for (size_t i = begin; i < end && !kept; ++i)
+            kept = _sorted[i].write && _needed[_sorted[i].resource];
+
+        if (kept)
+        {
+            _kept[pass] = true;
+            for (size_t i = begin; i < end; ++i)
+                _needed[_sorted[i].resource] = true;
+        }
+
+        end = begin;
+    }
+}
+
+void RenderGraph::AddTransition(ResourceId resource, uint32_t before, uint32_t after, int32_t lastUse, uint32_t batch)
+{
+    // Start the transition right after the last use when there's work in between, as long as
+    // both halves end up on the same command list.
+    uint32_t begin{ static_cast<uint32_t>(lastUse + 1) };
+    if (begin < batch && _commandListOfBatch[begin] == _commandListOfBatch[batch])
+    {
+        _pending.push_back({ begin, { resource, before, after, BarrierSplit::Begin } });
+        _pending.push_back({ batch, { resource, before, after, BarrierSplit::End } });
+        return;
+    }
+
+    _pending.push_back({ batch, { resource, before, after, BarrierSplit::None } });
+}
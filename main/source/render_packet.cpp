@@ -0,0 +1,114 @@
+#include "render_packet.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "job_system.hpp"
+
+namespace
+{
+    constexpr uint32_t RADIX_BITS = 8;
+    constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+    constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+    // Packets per job, counted and scattered by the same job in every pass.
+    constexpr uint32_t SORT_BLOCK_SIZE = 16384;
+
+    using Histogram = std::array<uint32_t, RADIX_SIZE>;
+
+    uint32_t Digit(uint64_t key, uint32_t pass)
+    {
+        return static_cast<uint32_t>(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+    }
+}
+
+void SortRenderPackets(std::vector<RenderPacket>& packets, std::vector<RenderPacket>& scratch, JobSystem& jobSystem)
+{
+    uint32_t count{ static_cast<uint32_t>(packets.size()) };
+    scratch.resize(count);
+    if (count < 2)
+        return;
+
+    uint32_t blockCount{ (count + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE };
+    auto blockEnd = [&](uint32_t block) { return std::min(count, (block + 1) * SORT_BLOCK_SIZE); };
+
+    // Bits that differ from the first key anywhere. Digits without any of them are the same
+    // for every packet and their pass wouldn't move anything.
+    std::vector<uint64_t> blockVarying(blockCount);
+    uint64_t firstKey{ packets[0].key };
+    jobSystem.ParallelFor(blockCount, 1, [&](uint32_t block)
+    {
+        uint64_t varying{ 0 };
+        for (uint32_t i = block * SORT_BLOCK_SIZE; i < blockEnd(block); ++i)
+            varying |= packets[i].key ^ firstKey;
+        blockVarying[block] = varying;
+    });
+
+    uint64_t varying{ 0 };
+    for (uint64_t blockBits : blockVarying)
+        varying |= blockBits;
+
+    RenderPacket* source{ packets.data() };
+    RenderPacket* destination{ scratch.data() };
+    std::vector<Histogram> histograms(blockCount);
+    for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        if (Digit(varying, pass) == 0)
+            continue;
+
+        jobSystem.ParallelFor(blockCount, 1, [&](uint32_t block)
+        {
+            Histogram& histogram{ histograms[block] };
+            histogram.fill(0);
+            for (uint32_t i = block * SORT_BLOCK_SIZE; i < blockEnd(block); ++i)
+                ++histogram[Digit(source[i].key, pass)];
+        });
+
+        // Each block's first slot per digit: every smaller digit, then earlier blocks' share
+        // of this one. Keeps equal digits in their old order.
+        uint32_t offset{ 0 };
+        for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            for (Histogram& histogram : histograms)
+            {
+                uint32_t digitCount{ histogram[digit] };
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+        }
+
+        jobSystem.ParallelFor(blockCount, 1, [&](uint32_t block)
+        {
+            Histogram& slots{ histograms[block] };
+            for (uint32_t i = block * SORT_BLOCK_SIZE; i < blockEnd(block); ++i)
+                destination[slots[Digit(source[i].key, pass)]++] = source[i];
+        });
+
+        std::swap(source, destination);
+    }
+
+    if (source != packets.data())
+        packets.swap(scratch);
+}
+
+void RenderPacketStream::Reset(uint32_t writerCount)
+{
+    _writers.resize(writerCount);
+    for (Writer& writer : _writers)
+        writer.packets.clear();
+}
+
+std::span<const RenderPacket> RenderPacketStream::Sort(JobSystem& jobSystem)
+{
+    std::vector<uint32_t> offsets(_writers.size() + 1, 0);
+    for (size_t writer = 0; writer < _writers.size(); ++writer)
+        offsets[writer + 1] = offsets[writer] + static_cast<uint32_t>(_writers[writer].packets.size());
+
+    _sorted.resize(offsets.back());
+    jobSystem.ParallelFor(static_cast<uint32_t>(_writers.size()), 1, [&](uint32_t writer)
+    {
+        std::copy(_writers[writer].packets.begin(), _writers[writer].packets.end(), _sorted.begin() + offsets[writer]);
+    });
+
+    SortRenderPackets(_sorted, _scratch, jobSystem);
+    return _sorted;
+}
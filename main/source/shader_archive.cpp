@@ -0,0 +1,149 @@
+#include "shader_archive.hpp"
+
+#include <algorithm>
+
+#include "binary_io.hpp"
+#include "hash.hpp"
+
+namespace
+{
+    // Bumped whenever the key or the compiler changes in a way the inputs don't capture.
+    constexpr uint64_t KEY_VERSION = 1;
+}
+
+bool ShaderArchive::Open(const std::filesystem::path& path)
+{
+    Close();
+
+    auto file{ std::make_shared<MemoryMappedFile>() };
+    if (!file->Open(path))
+        return false;
+
+    std::span<const uint8_t> data{ file->Data() };
+    BinaryReader reader{ data };
+    if (reader.ReadU32() != MAGIC || reader.ReadU32() != VERSION)
+        return false;
+
+    uint32_t entryCount{ reader.ReadU32() };
+    reader.Skip(4);
+    if (reader.Failed() || reader.Remaining() / ENTRY_SIZE < entryCount)
+        return false;
+
+    // Validate the table once, so lookups don't have to.
+    uint64_t previousKey{ 0 };
+    for (uint32_t i = 0; i < entryCount; ++i)
+    {
+        uint64_t key{ reader.ReadU64() };
+        uint64_t offset{ reader.ReadU64() };
+        uint64_t size{ reader.ReadU64() };
+
+        if ((i > 0 && key <= previousKey) || offset > data.size() || size > data.size() - offset)
+            return false;
+        previousKey = key;
+    }
+
+    _file = std::move(file);
+    _data = data;
+    _entryCount = entryCount;
+    return true;
+}
+
+void ShaderArchive::Close()
+{
+    _file = nullptr;
+    _data = {};
+    _entryCount = 0;
+}
+
+std::span<const uint8_t> ShaderArchive::Find(uint64_t key) const
+{
+    uint32_t first{ 0 };
+    uint32_t count{ _entryCount };
+    while (count > 0)
+    {
+        uint32_t step{ count / 2 };
+        if (KeyAt(first + step) < key)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+
+    if (first == _entryCount || KeyAt(first) != key)
+        return {};
+
+    return EntryAt(first).second;
+}
+
+ShaderArchive::Entry ShaderArchive::EntryAt(uint32_t index) const
+{
+    BinaryReader reader{ _data.subspan(HEADER_SIZE + static_cast<size_t>(index) * ENTRY_SIZE, ENTRY_SIZE) };
+    uint64_t key{ reader.ReadU64() };
+    uint64_t offset{ reader.ReadU64() };
+    uint64_t size{ reader.ReadU64() };
+
+    return { key, _data.subspan(offset, size) };
+}
+
+uint64_t ShaderArchive::KeyAt(uint32_t index) const
+{
+    return Hash::Load64(_data.data() + HEADER_SIZE + static_cast<size_t>(index) * ENTRY_SIZE);
+}
+
+std::vector<uint8_t> ShaderArchive::Build(std::vector<Entry> entries)
+{
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.first < b.first; });
+
+    // Keep the last of each run of equal keys.
+    std::vector<Entry> unique;
+    unique.reserve(entries.size());
+    for (const Entry& entry : entries)
+    {
+        if (!unique.empty() && unique.back().first == entry.first)
+            unique.back() = entry;
+        else
+            unique.push_back(entry);
+    }
+
+    uint64_t offset{ HEADER_SIZE + unique.size() * ENTRY_SIZE };
+
+    BinaryWriter writer;
+    writer.WriteU32(MAGIC);
+    writer.WriteU32(VERSION);
+    writer.WriteU32(static_cast<uint32_t>(unique.size()));
+    writer.WriteU32(0);
+
+    for (const Entry& entry : unique)
+    {
+        offset = (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+        writer.WriteU64(entry.first);
+        writer.WriteU64(offset);
+        writer.WriteU64(entry.second.size());
+        offset += entry.second.size();
+    }
+
+    for (const Entry& entry : unique)
+    {
+        writer.Align(DATA_ALIGNMENT);
+        writer.WriteBytes(entry.second.data(), entry.second.size());
+    }
+
+    return std::move(writer.Data());
+}
+
+uint64_t ShaderArchive::Key(const ShaderKeyDesc& desc)
+{
+    Hasher hasher{ KEY_VERSION };
+    hasher.AddString(desc.preprocessedSource);
+
+    hasher.Add(desc.defines.size());
+    for (const auto& [name, value] : desc.defines)
+        hasher.AddString(name).AddString(value);
+
+    hasher.AddString(desc.entryPoint).AddString(desc.target).Add(desc.flags);
+    return hasher.Value();
+}
@@ -0,0 +1,88 @@
+#include "precomp.hpp"
+#include "shader_cache.hpp"
+
+#include <utility>
+#include <vector>
+
+#include "binary_io.hpp"
+
+ShaderCache::ShaderCache(std::filesystem::path archivePath) : _archivePath(std::move(archivePath))
+{
+    std::error_code error;
+    if (std::filesystem::exists(PendingPath(), error))
+        std::filesystem::rename(PendingPath(), _archivePath, error);
+
+    _archive.Open(_archivePath);
+}
+
+ComPtr<ID3DBlob> ShaderCache::Compile(const std::wstring& fileName, const D3D_SHADER_MACRO* defines, const std::string& entryPoint, const std::string& target)
+{
+    // Anything going wrong here is left to the real compile, it reports errors properly.
+    std::optional<std::vector<uint8_t>> source{ ReadWholeFile(fileName) };
+    if (!source)
+        return D3dUtil::CompileShader(fileName, defines, entryPoint, target);
+
+    std::string sourceName{ std::filesystem::path{ fileName }.string() };
+    ComPtr<ID3DBlob> preprocessed;
+    ComPtr<ID3DBlob> errors;
+    if (FAILED(D3DPreprocess(source->data(), source->size(), sourceName.c_str(), defines, D3D_COMPILE_STANDARD_FILE_INCLUDE, &preprocessed, &errors)))
+        return D3dUtil::CompileShader(fileName, defines, entryPoint, target);
+
+    std::vector<std::pair<std::string_view, std::string_view>> defineList;
+    for (const D3D_SHADER_MACRO* define = defines; define && define->Name; ++define)
+        defineList.emplace_back(define->Name, define->Definition ? define->Definition : "");
+
+    ShaderKeyDesc keyDesc;
+    keyDesc.preprocessedSource = { static_cast<const char*>(preprocessed->GetBufferPointer()), preprocessed->GetBufferSize() };
+    keyDesc.defines = defineList;
+    keyDesc.entryPoint = entryPoint;
+    keyDesc.target = target;
+    keyDesc.flags = D3dUtil::ShaderCompileFlags();
+    uint64_t key{ ShaderArchive::Key(keyDesc) };
+
+    {
+        std::lock_guard lock{ _mutex };
+        if (std::span<const uint8_t> hit{ _archive.Find(key) }; !hit.empty())
+        {
+            _used.insert(key);
+            return D3dUtil::LoadBinary(_archive.File(), hit);
+        }
+
+        if (auto it{ _compiled.find(key) }; it != _compiled.end())
+            return it->second;
+    }
+
+    ComPtr<ID3DBlob> byteCode{ D3dUtil::CompileShader(fileName, defines, entryPoint, target) };
+
+    std::lock_guard lock{ _mutex };
+    _compiled.emplace(key, byteCode);
+    return byteCode;
+}
+
+void ShaderCache::Save()
+{
+    std::lock_guard lock{ _mutex };
+    if (_compiled.empty() && _used.size() == _archive.EntryCount())
+        return;
+
+    // Old versions of edited shaders and variants nothing uses anymore would pile up otherwise.
+    std::vector<ShaderArchive::Entry> entries;
+    entries.reserve(_used.size() + _compiled.size());
+    for (uint32_t i = 0; i < _archive.EntryCount(); ++i)
+    {
+        ShaderArchive::Entry entry{ _archive.EntryAt(i) };
+        if (_used.contains(entry.first))
+            entries.push_back(entry);
+    }
+    for (const auto& [key, blob] : _compiled)
+        entries.push_back({ key, { static_cast<const uint8_t*>(blob->GetBufferPointer()), blob->GetBufferSize() } });
+
+    WriteWholeFile(PendingPath(), ShaderArchive::Build(std::move(entries)));
+}
+
+std::filesystem::path ShaderCache::PendingPath() const
+{
+    std::filesystem::path pending{ _archivePath };
+    pending += ".pending";
+    return pending;
+}
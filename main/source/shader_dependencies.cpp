@@ -0,0 +1,87 @@
+#include "shader_dependencies.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+void ShaderDependencies::SetFiles(ProgramId program, std::span<const std::filesystem::path> files)
+{
+    for (const std::filesystem::path& file : _filesByProgram[program])
+    {
+        auto it{ _programsByFile.find(file) };
+        if (it == _programsByFile.end())
+            continue;
+
+        it->second.erase(program);
+        if (it->second.empty())
+            _programsByFile.erase(it);
+    }
+
+    std::vector<std::filesystem::path>& programFiles{ _filesByProgram[program] };
+    programFiles.clear();
+    for (const std::filesystem::path& file : files)
+    {
+        std::filesystem::path normalized{ Normalize(file) };
+        _programsByFile[normalized].insert(program);
+        programFiles.push_back(std::move(normalized));
+    }
+}
+
+std::vector<ShaderDependencies::ProgramId> ShaderDependencies::Affected(std::span<const std::filesystem::path> changedFiles) const
+{
+    std::vector<ProgramId> affected;
+    for (const std::filesystem::path& file : changedFiles)
+    {
+        auto it{ _programsByFile.find(Normalize(file)) };
+        if (it != _programsByFile.end())
+            affected.insert(affected.end(), it->second.begin(), it->second.end());
+    }
+
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+    return affected;
+}
+
+std::vector<std::filesystem::path> ShaderDependencies::ScanIncludes(const std::filesystem::path& file)
+{
+    std::vector<std::filesystem::path> files{ Normalize(file) };
+
+    // files doubles as the work list, everything before index has been scanned.
+    for (size_t index = 0; index < files.size(); ++index)
+    {
+        std::ifstream stream{ files[index] };
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            size_t position{ line.find_first_not_of(" \t") };
+            if (position == std::string::npos || line[position] != '#')
+                continue;
+
+            position = line.find_first_not_of(" \t", position + 1);
+            if (position == std::string::npos || line.compare(position, 7, "include") != 0)
+                continue;
+
+            size_t open{ line.find_first_of("\"<", position + 7) };
+            if (open == std::string::npos)
+                continue;
+
+            size_t close{ line.find(line[open] == '"' ? '"' : '>', open + 1) };
+            if (close == std::string::npos)
+                continue;
+
+            std::filesystem::path include{ Normalize(files[index].parent_path() / line.substr(open + 1, close - open - 1)) };
+            std::error_code error;
+            if (std::filesystem::exists(include, error) && std::find(files.begin(), files.end(), include) == files.end())
+                files.push_back(std::move(include));
+        }
+    }
+
+    return files;
+}
+
+std::filesystem::path ShaderDependencies::Normalize(const std::filesystem::path& path)
+{
+    std::error_code error;
+    std::filesystem::path absolute{ std::filesystem::absolute(path, error) };
+    return (error ? path : absolute).lexically_normal();
+}
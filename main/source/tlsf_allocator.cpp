@@ -0,0 +1,260 @@
+#include "tlsf_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+TlsfAllocator::TlsfAllocator(uint64_t size) : _size(size), _freeSize(size)
+{
+    assert(size > 0);
+
+    for (auto& lists : _freeLists)
+        lists.fill(INVALID_NODE);
+
+    uint32_t node{ CreateNode() };
+    _nodes[node].offset = 0;
+    _nodes[node].size = size;
+    InsertFree(node);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+    if (size == 0 || size > _freeSize)
+        return {};
+
+    // Try the plain size class first, its first block is usually aligned already. If not,
+    // over-allocate by the worst case padding so whatever block we find can be aligned.
+    uint32_t node{ FindFreeNode(size) };
+    if (node == INVALID_NODE || AlignUp(_nodes[node].offset, alignment) + size > _nodes[node].offset + _nodes[node].size)
+    {
+        uint64_t searchSize{ size + alignment - 1 };
+        if (searchSize < size)
+            return {};
+
+        node = FindFreeNode(searchSize);
+        if (node == INVALID_NODE)
+            return {};
+    }
+
+    RemoveFree(node);
+
+    uint64_t offset{ _nodes[node].offset };
+    uint64_t padding{ AlignUp(offset, alignment) - offset };
+    if (padding > 0)
+    {
+        // Give the padding back as its own free block in front of the allocation.
+        uint32_t aligned{ Split(node, padding) };
+        InsertFree(node);
+        node = aligned;
+    }
+
+    uint32_t remainder{ Split(node, size) };
+    if (remainder != INVALID_NODE)
+        InsertFree(remainder);
+
+    _nodes[node].free = false;
+    _freeSize -= size;
+    ++_allocationCount;
+
+    Allocation allocation;
+    allocation.offset = _nodes[node].offset;
+    allocation.size = size;
+    allocation.node = node;
+
+    return allocation;
+}
+
+void TlsfAllocator::Free(const Allocation& allocation)
+{
+    uint32_t node{ allocation.node };
+    assert(node < _nodes.size() && !_nodes[node].free && "Double free or foreign allocation.");
+
+    _freeSize += _nodes[node].size;
+    --_allocationCount;
+
+    uint32_t prev{ _nodes[node].prevPhysical };
+    if (prev != INVALID_NODE && _nodes[prev].free)
+    {
+        RemoveFree(prev);
+        Merge(prev, node);
+        node = prev;
+    }
+
+    uint32_t next{ _nodes[node].nextPhysical };
+    if (next != INVALID_NODE && _nodes[next].free)
+    {
+        RemoveFree(next);
+        Merge(node, next);
+    }
+
+    InsertFree(node);
+}
+
+uint64_t TlsfAllocator::LargestFreeBlock() const
+{
+    if (_flBitmap == 0)
+        return 0;
+
+    uint32_t fl{ 63u - static_cast<uint32_t>(std::countl_zero(_flBitmap)) };
+    uint32_t sl{ 31u - static_cast<uint32_t>(std::countl_zero(_slBitmaps[fl])) };
+
+    uint64_t largest{ 0 };
+    for (uint32_t node = _freeLists[fl][sl]; node != INVALID_NODE; node = _nodes[node].nextFree)
+        largest = std::max(largest, _nodes[node].size);
+
+    return largest;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SL_COUNT)
+    {
+        fl = 0;
+        sl = static_cast<uint32_t>(size);
+        return;
+    }
+
+    uint32_t msb{ 63u - static_cast<uint32_t>(std::countl_zero(size)) };
+    fl = msb - SL_BITS + 1;
+    sl = static_cast<uint32_t>(size >> (msb - SL_BITS)) ^ SL_COUNT;
+}
+
+void TlsfAllocator::MappingSearch(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    // Round up to the next size class so every block in the resulting bucket fits.
+    if (size >= SL_COUNT)
+    {
+        uint32_t msb{ 63u - static_cast<uint32_t>(std::countl_zero(size)) };
+        uint64_t round{ (1ull << (msb - SL_BITS)) - 1 };
+        if (size + round > size)
+            size += round;
+    }
+
+    Mapping(size, fl, sl);
+}
+
+uint32_t TlsfAllocator::FindFreeNode(uint64_t size) const
+{
+    uint32_t fl;
+    uint32_t sl;
+    MappingSearch(size, fl, sl);
+
+    if (fl >= FL_COUNT)
+        return INVALID_NODE;
+
+    uint32_t slMap{ _slBitmaps[fl] & (~0u << sl) };
+    if (slMap == 0)
+    {
+        uint64_t flMap{ fl + 1 < 64 ? _flBitmap & (~0ull << (fl + 1)) : 0 };
+        if (flMap == 0)
+            return INVALID_NODE;
+
+        fl = static_cast<uint32_t>(std::countr_zero(flMap));
+        slMap = _slBitmaps[fl];
+    }
+
+    sl = static_cast<uint32_t>(std::countr_zero(slMap));
+    return _freeLists[fl][sl];
+}
+
+void TlsfAllocator::InsertFree(uint32_t node)
+{
+    uint32_t fl;
+    uint32_t sl;
+    Mapping(_nodes[node].size, fl, sl);
+
+    uint32_t head{ _freeLists[fl][sl] };
+    _nodes[node].free = true;
+    _nodes[node].prevFree = INVALID_NODE;
+    _nodes[node].nextFree = head;
+    if (head != INVALID_NODE)
+        _nodes[head].prevFree = node;
+
+    _freeLists[fl][sl] = node;
+    _slBitmaps[fl] |= 1u << sl;
+    _flBitmap |= 1ull << fl;
+    ++_freeBlockCount;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t node)
+{
+    uint32_t fl;
+    uint32_t sl;
+    Mapping(_nodes[node].size, fl, sl);
+
+    Node& n{ _nodes[node] };
+    if (n.prevFree != INVALID_NODE)
+        _nodes[n.prevFree].nextFree = n.nextFree;
+    else
+        _freeLists[fl][sl] = n.nextFree;
+
+    if (n.nextFree != INVALID_NODE)
+        _nodes[n.nextFree].prevFree = n.prevFree;
+
+    if (_freeLists[fl][sl] == INVALID_NODE)
+    {
+        _slBitmaps[fl] &= ~(1u << sl);
+        if (_slBitmaps[fl] == 0)
+            _flBitmap &= ~(1ull << fl);
+    }
+
+    n.free = false;
+    n.prevFree = INVALID_NODE;
+    n.nextFree = INVALID_NODE;
+    --_freeBlockCount;
+}
+
+uint32_t TlsfAllocator::Split(uint32_t node, uint64_t size)
+{
+    if (_nodes[node].size == size)
+        return INVALID_NODE;
+
+    uint32_t remainder{ CreateNode() };
+
+    // CreateNode may have grown the vector, only take references afterwards.
+    Node& n{ _nodes[node] };
+    Node& r{ _nodes[remainder] };
+    r.offset = n.offset + size;
+    r.size = n.size - size;
+    r.prevPhysical = node;
+    r.nextPhysical = n.nextPhysical;
+    if (r.nextPhysical != INVALID_NODE)
+        _nodes[r.nextPhysical].prevPhysical = remainder;
+
+    n.size = size;
+    n.nextPhysical = remainder;
+
+    return remainder;
+}
+
+void TlsfAllocator::Merge(uint32_t node, uint32_t next)
+{
+    Node& n{ _nodes[node] };
+    n.size += _nodes[next].size;
+    n.nextPhysical = _nodes[next].nextPhysical;
+    if (n.nextPhysical != INVALID_NODE)
+        _nodes[n.nextPhysical].prevPhysical = node;
+
+    ReleaseNode(next);
+}
+
+uint32_t TlsfAllocator::CreateNode()
+{
+    if (!_unusedNodes.empty())
+    {
+        uint32_t node{ _unusedNodes.back() };
+        _unusedNodes.pop_back();
+        return node;
+    }
+
+    _nodes.emplace_back();
+    return static_cast<uint32_t>(_nodes.size() - 1);
+}
+
+void TlsfAllocator::ReleaseNode(uint32_t node)
+{
+    _nodes[node] = Node{};
+    _unusedNodes.push_back(node);
+}
@@ -0,0 +1,205 @@
+#include "transform_system.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "job_system.hpp"
+
+using namespace DirectX;
+
+TransformSystem::TransformSystem(entt::registry& registry) : _registry(registry)
+{
+    _registry.on_construct<LocalTransform>().connect<&TransformSystem::OnLocalConstructed>(*this);
+    _registry.on_update<LocalTransform>().connect<&TransformSystem::OnLocalUpdated>(*this);
+    _registry.on_destroy<LocalTransform>().connect<&TransformSystem::OnLocalDestroyed>(*this);
+    _registry.on_construct<Parent>().connect<&TransformSystem::OnHierarchyChanged>(*this);
+    _registry.on_update<Parent>().connect<&TransformSystem::OnHierarchyChanged>(*this);
+    _registry.on_destroy<Parent>().connect<&TransformSystem::OnHierarchyChanged>(*this);
+
+    // Entities from before the system missed the construct signal.
+    for (entt::entity entity : _registry.view<LocalTransform>())
+        _registry.emplace_or_replace<WorldTransform>(entity);
+    _hierarchyDirty = !_registry.view<LocalTransform>().empty();
+}
+
+TransformSystem::~TransformSystem()
+{
+    _registry.on_construct<LocalTransform>().disconnect(this);
+    _registry.on_update<LocalTransform>().disconnect(this);
+    _registry.on_destroy<LocalTransform>().disconnect(this);
+    _registry.on_construct<Parent>().disconnect(this);
+    _registry.on_update<Parent>().disconnect(this);
+    _registry.on_destroy<Parent>().disconnect(this);
+}
+
+void TransformSystem::Update(JobSystem& jobSystem)
+{
+    _updated.clear();
+    if (_hierarchyDirty)
+        RebuildHierarchy();
+    if (!_anyDirty)
+        return;
+
+    // Levels run one after the other, so a level's parents are final before it reads them.
+    auto& worldTransforms{ _registry.storage<WorldTransform>() };
+    for (uint32_t level = _firstDirtyLevel; level < LevelCount(); ++level)
+    {
+        uint32_t begin{ _levelBegin[level] };
+        uint32_t end{ _levelBegin[level + 1] };
+        uint32_t chunkCount{ (end - begin + CHUNK_SIZE - 1) / CHUNK_SIZE };
+        jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+        {
+            uint32_t chunkBegin{ begin + chunk * CHUNK_SIZE };
+            UpdateRange(chunkBegin, std::min(end, chunkBegin + CHUNK_SIZE), worldTransforms);
+        });
+    }
+
+    for (uint32_t slot = _levelBegin[_firstDirtyLevel]; slot < Count(); ++slot)
+    {
+        if (_dirty[slot])
+        {
+            _updated.push_back(_entities[slot]);
+            _dirty[slot] = 0;
+        }
+    }
+    _anyDirty = false;
+}
+
+void TransformSystem::UpdateRange(uint32_t begin, uint32_t end, entt::storage_for_t<WorldTransform>& worldTransforms)
+{
+    for (uint32_t slot = begin; slot < end; ++slot)
+    {
+        uint32_t parent{ _parents[slot] };
+        if (parent != NO_PARENT)
+            _dirty[slot] |= _dirty[parent];
+        if (!_dirty[slot])
+            continue;
+
+        XMMATRIX world{ XMMatrixAffineTransformation(XMLoadFloat3(&_scales[slot]), XMVectorZero(), XMLoadFloat4(&_rotations[slot]), XMLoadFloat3(&_positions[slot])) };
+        if (parent != NO_PARENT)
+            world = XMMatrixMultiply(world, XMLoadFloat4x4A(&_worlds[parent]));
+
+        XMStoreFloat4x4A(&_worlds[slot], world);
+        XMStoreFloat4x4(&worldTransforms.get(_entities[slot]).matrix, world);
+    }
+}
+
+void TransformSystem::OnLocalConstructed(entt::registry& registry, entt::entity entity)
+{
+    registry.emplace_or_replace<WorldTransform>(entity);
+    _hierarchyDirty = true;
+}
+
+void TransformSystem::OnLocalUpdated(entt::registry& registry, entt::entity entity)
+{
+    // A pending re-sort copies every local anyway.
+    if (_hierarchyDirty)
+        return;
+
+    uint32_t slot{ _slots[entt::to_entity(entity)] };
+    const LocalTransform& local{ registry.get<LocalTransform>(entity) };
+    _positions[slot] = local.position;
+    _rotations[slot] = local.rotation;
+    _scales[slot] = local.scale;
+    _dirty[slot] = 1;
+
+    uint32_t level{ static_cast<uint32_t>(std::upper_bound(_levelBegin.begin(), _levelBegin.end(), slot) - _levelBegin.begin()) - 1 };
+    _firstDirtyLevel = _anyDirty ? std::min(_firstDirtyLevel, level) : level;
+    _anyDirty = true;
+}
+
+void TransformSystem::OnLocalDestroyed(entt::registry& registry, entt::entity entity)
+{
+    registry.remove<WorldTransform>(entity);
+    _hierarchyDirty = true;
+}
+
+void TransformSystem::OnHierarchyChanged(entt::registry&, entt::entity)
+{
+    _hierarchyDirty = true;
+}
+
+entt::entity TransformSystem::ParentOf(entt::entity entity) const
+{
+    const Parent* parent{ _registry.try_get<Parent>(entity) };
+    if (parent == nullptr || !_registry.valid(parent->entity) || !_registry.all_of<LocalTransform>(parent->entity))
+        return entt::null;
+    return parent->entity;
+}
+
+void TransformSystem::RebuildHierarchy()
+{
+    auto view{ _registry.view<LocalTransform>() };
+    uint32_t count{ static_cast<uint32_t>(view.size()) };
+
+    uint32_t indexCount{ 0 };
+    for (entt::entity entity : view)
+        indexCount = std::max(indexCount, static_cast<uint32_t>(entt::to_entity(entity)) + 1);
+
+    // Depths by entity index. Each chain gets walked up to the first known depth and filled
+    // in on the way back, so every entity is visited once.
+    std::vector<uint32_t> depths(indexCount, NO_PARENT);
+    std::vector<entt::entity> chain;
+    uint32_t levelCount{ 0 };
+    for (entt::entity entity : view)
+    {
+        chain.clear();
+        uint32_t depth{ NO_PARENT };
+        for (entt::entity current{ entity }; current != entt::null; current = ParentOf(current))
+        {
+            uint32_t known{ depths[entt::to_entity(current)] };
+            if (known != NO_PARENT)
+            {
+                depth = known;
+                break;
+            }
+
+            chain.push_back(current);
+            assert(chain.size() <= count && "Transform hierarchy has a cycle.");
+            if (chain.size() > count)
+                break;
+        }
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+            depths[entt::to_entity(*it)] = ++depth;
+        levelCount = std::max(levelCount, depth + 1);
+    }
+
+    // Counting sort by depth.
+    _levelBegin.assign(levelCount + 1, 0);
+    for (entt::entity entity : view)
+        ++_levelBegin[depths[entt::to_entity(entity)] + 1];
+    for (uint32_t level = 0; level < levelCount; ++level)
+        _levelBegin[level + 1] += _levelBegin[level];
+
+    std::vector<uint32_t> next{ _levelBegin.begin(), _levelBegin.end() - 1 };
+    _entities.resize(count);
+    _slots.assign(indexCount, NO_PARENT);
+    for (entt::entity entity : view)
+    {
+        uint32_t slot{ next[depths[entt::to_entity(entity)]]++ };
+        _entities[slot] = entity;
+        _slots[entt::to_entity(entity)] = slot;
+    }
+
+    _parents.resize(count);
+    _positions.resize(count);
+    _rotations.resize(count);
+    _scales.resize(count);
+    _worlds.resize(count);
+    _dirty.assign(count, 1);
+    for (uint32_t slot = 0; slot < count; ++slot)
+    {
+        entt::entity parent{ ParentOf(_entities[slot]) };
+        _parents[slot] = parent == entt::null ? NO_PARENT : _slots[entt::to_entity(parent)];
+
+        const LocalTransform& local{ view.get<LocalTransform>(_entities[slot]) };
+        _positions[slot] = local.position;
+        _rotations[slot] = local.rotation;
+        _scales[slot] = local.scale;
+    }
+
+    _hierarchyDirty = false;
+    _anyDirty = count > 0;
+    _firstDirtyLevel = 0;
+}
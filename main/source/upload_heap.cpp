@@ -0,0 +1,25 @@
+#include "precomp.hpp"
+#include "upload_heap.hpp"
+
+UploadHeap::UploadHeap(ID3D12Device* device, uint64_t size) : _size(size)
+{
+    ThrowIfFailed(device->CreateCommittedResource(
+        &keep(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD)),
+        D3D12_HEAP_FLAG_NONE,
+        &keep(CD3DX12_RESOURCE_DESC::Buffer(_size)),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(_resource.GetAddressOf())));
+    _resource->SetName(L"Upload heap");
+
+    // Upload heaps may stay mapped while the GPU reads from them, we only ever write.
+    ThrowIfFailed(_resource->Map(0, &keep(CD3DX12_RANGE(0, 0)), reinterpret_cast<void**>(&_mappedData)));
+}
+
+UploadHeap::~UploadHeap()
+{
+    if (_resource)
+        _resource->Unmap(0, nullptr);
+
+    _mappedData = nullptr;
+}
@@ -1,5 +1,53 @@
 #include "precomp.hpp"
 #include "util.hpp"
+#include "copy_queue.hpp"
+
+#include <atomic>
+
+namespace
+{
+    // ID3DBlob over memory somebody else owns. Holding on to the file keeps the mapping alive
+    // for as long as the blob is.
+    class MappedBlob final : public ID3DBlob
+    {
+    public:
+        MappedBlob(std::shared_ptr<MemoryMappedFile> file, std::span<const uint8_t> data) : _file(std::move(file)), _data(data) {}
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (!object)
+                return E_POINTER;
+
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3DBlob))
+            {
+                *object = static_cast<ID3DBlob*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override { return ++_refCount; }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            ULONG refCount{ --_refCount };
+            if (refCount == 0)
+                delete this;
+            return refCount;
+        }
+
+        LPVOID STDMETHODCALLTYPE GetBufferPointer() override { return const_cast<uint8_t*>(_data.data()); }
+        SIZE_T STDMETHODCALLTYPE GetBufferSize() override { return _data.size(); }
+
+    private:
+        std::atomic<ULONG> _refCount{ 1 };
+        std::shared_ptr<MemoryMappedFile> _file;
+        std::span<const uint8_t> _data;
+    };
+}
 
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
@@ -18,43 +66,36 @@ std::wstring DxException::ToString() const
     return FunctionName + L" failed in " + Filename + L"; line " + std::to_wstring(LineNumber) + L"; error: " + msg;
 }
 
-ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, uint64_t byteSize, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+GpuAllocation CreateDefaultBuffer(GpuHeapAllocator& heapAllocator, UploadService<CopyQueue>& uploadService, const void* initData, uint64_t byteSize, UploadTicket& ticket)
 {
-    ComPtr<ID3D12Resource> defaultBuffer;
-
-    // Create the buffer on the GPU.
-    CD3DX12_RESOURCE_DESC resourceDesc{ CD3DX12_RESOURCE_DESC::Buffer(byteSize) };
-    ThrowIfFailed(device->CreateCommittedResource(&keep(CD3DX12_HEAP_PROPERTIES{ D3D12_HEAP_TYPE_DEFAULT }), D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
-
-    // Create an upload buffer to read data from the CPU to the GPU.
-    // NOTE: HEAP_TYPE_UPLOAD is only good for CPU-read-once and GPU-read-once.
-    ThrowIfFailed(device->CreateCommittedResource(&keep(CD3DX12_HEAP_PROPERTIES{ D3D12_HEAP_TYPE_UPLOAD }), D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
-
-    // Data to upload to GPU buffer.
-    D3D12_SUBRESOURCE_DATA subResourceData{};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = byteSize;
-    subResourceData.SlicePitch = subResourceData.RowPitch;
-
-    // Transition buffer to copy state.
-    cmdList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER{ CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST) }));
-
-    // Perform the copy.
-    UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-
-    // Transition buffer to read state.
-    cmdList->ResourceBarrier(1, &keep(CD3DX12_RESOURCE_BARRIER{ CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ) }));
+    // Create the buffer on the GPU. Small buffers may share a placed resource with others.
+    GpuAllocation defaultBuffer{ heapAllocator.CreateBuffer(byteSize) };
+
+    // Hand the copy to the copy queue. No barriers, a shared page can't be tracked per
+    // buffer. The copy queue promotes the buffer from COMMON to COPY_DEST and it decays back
+    // once the batch has executed, after which the draws promote it to the read states they
+    // need. Whoever draws with it has to wait on the ticket first.
+    CopyDestination destination;
+    destination.resource = defaultBuffer.Get();
+    destination.offset = defaultBuffer.offset;
+    ticket = uploadService.Enqueue(destination, initData, byteSize, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
 
     return defaultBuffer;
 }
 
-ComPtr<ID3DBlob> D3dUtil::CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines,
-    const std::string& entryPoint, const std::string& target)
+uint32_t D3dUtil::ShaderCompileFlags()
 {
     std::uint32_t compileFlags{ 0 };
 #if defined(_DEBUG)
     compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #endif
+    return compileFlags;
+}
+
+ComPtr<ID3DBlob> D3dUtil::CompileShader(const std::wstring& fileName, const D3D_SHADER_MACRO* defines,
+    const std::string& entryPoint, const std::string& target)
+{
+    std::uint32_t compileFlags{ ShaderCompileFlags() };
 
     HRESULT hr = S_OK;
 
@@ -73,17 +114,17 @@ ComPtr<ID3DBlob> D3dUtil::CompileShader(const std::wstring& fileName, const D3D_
 
 ComPtr<ID3DBlob> D3dUtil::LoadBinary(const std::wstring& fileName)
 {
-    std::ifstream fin{ fileName, std::ios::binary };
+    auto file{ std::make_shared<MemoryMappedFile>() };
+    if (!file->Open(fileName))
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
 
-    fin.seekg(0, std::ios_base::end);
-    std::ifstream::pos_type size = fin.tellg();
-    fin.seekg(0, std::ios_base::beg);
+    std::span<const uint8_t> data{ file->Data() };
+    return LoadBinary(std::move(file), data);
+}
 
+ComPtr<ID3DBlob> D3dUtil::LoadBinary(std::shared_ptr<MemoryMappedFile> file, std::span<const uint8_t> data)
+{
     ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
-
-    fin.read(static_cast<char*>(blob->GetBufferPointer()), size);
-    fin.close();
-
+    blob.Attach(new MappedBlob{ std::move(file), data });
     return blob;
 }
@@ -0,0 +1,518 @@
+#include "vertex_packing.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "job_system.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define VERTEX_PACKING_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(PackedExtraVertex) == 12);
+
+namespace
+{
+    // Vertices per packing job.
+    constexpr uint32_t CHUNK_SIZE = 4096;
+    constexpr uint32_t UNOWNED = std::numeric_limits<uint32_t>::max();
+    // Below this a normal is treated as zero instead of blowing up the division.
+    constexpr float MIN_OCT_LENGTH = 1e-20f;
+    constexpr float SNORM16_MAX = 32767.0f;
+    constexpr float UNORM16_MAX = 65535.0f;
+    constexpr float UNORM8_MAX = 255.0f;
+
+    // Same results as maxps and minps, NaN turns into the bound. Keeps the scalar path bit
+    // identical to the SSE2 one.
+    float Max(float value, float bound)
+    {
+        return value > bound ? value : bound;
+    }
+
+    float Min(float value, float bound)
+    {
+        return value < bound ? value : bound;
+    }
+
+    // Round to nearest even like cvtps2dq, with the default rounding mode.
+    int32_t Round(float value)
+    {
+        return static_cast<int32_t>(std::nearbyint(value));
+    }
+
+    float Inverse(float scale, float range)
+    {
+        return scale > 0.0f ? range / scale : 0.0f;
+    }
+
+    struct QuantizationBox
+    {
+        float offset[3];
+        float scale[3];
+    };
+
+    // Submeshes that reference the same vertex get joined, every group gets the box around
+    // all of its vertices. Unreferenced vertices get a box of their own at the end, they're
+    // never drawn but still have to be written.
+    std::vector<QuantizationBox> FitQuantizationBoxes(MeshData& mesh, std::vector<uint32_t>& vertexBoxes)
+    {
+        uint32_t submeshCount{ static_cast<uint32_t>(mesh.submeshes.size()) };
+        std::vector<uint32_t> parent(submeshCount);
+        std::iota(parent.begin(), parent.end(), 0u);
+        auto find = [&](uint32_t submesh)
+        {
+            while (parent[submesh] != submesh)
+            {
+                parent[submesh] = parent[parent[submesh]];
+                submesh = parent[submesh];
+            }
+            return submesh;
+        };
+
+        std::vector<uint32_t> owners(mesh.vertices.size(), UNOWNED);
+        for (uint32_t submesh = 0; submesh < submeshCount; ++submesh)
+        {
+            const CookedSubmesh& cooked{ mesh.submeshes[submesh] };
+            for (uint32_t i = 0; i < cooked.indexCount; ++i)
+            {
+                uint32_t& owner{ owners[cooked.baseVertexLocation + mesh.indices[cooked.startIndexLocation + i]] };
+                if (owner == UNOWNED)
+                {
+                    owner = submesh;
+                    continue;
+                }
+
+                uint32_t a{ find(owner) };
+                uint32_t b{ find(submesh) };
+                if (a != b)
+                    parent[b] = a;
+            }
+        }
+
+        std::vector<float> minimum((submeshCount + 1) * 3, std::numeric_limits<float>::max());
+        std::vector<float> maximum((submeshCount + 1) * 3, std::numeric_limits<float>::lowest());
+        vertexBoxes.resize(mesh.vertices.size());
+        for (size_t vertex = 0; vertex < mesh.vertices.size(); ++vertex)
+        {
+            uint32_t box{ owners[vertex] == UNOWNED ? submeshCount : find(owners[vertex]) };
+            vertexBoxes[vertex] = box;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                minimum[box * 3 + axis] = std::min(minimum[box * 3 + axis], mesh.vertices[vertex].position[axis]);
+                maximum[box * 3 + axis] = std::max(maximum[box * 3 + axis], mesh.vertices[vertex].position[axis]);
+            }
+        }
+
+        std::vector<QuantizationBox> boxes(submeshCount + 1);
+        for (uint32_t box = 0; box <= submeshCount; ++box)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                // Empty boxes stay at the origin with no extent.
+                bool empty{ minimum[box * 3 + axis] > maximum[box * 3 + axis] };
+                boxes[box].offset[axis] = empty ? 0.0f : minimum[box * 3 + axis];
+                boxes[box].scale[axis] = empty ? 0.0f : maximum[box * 3 + axis] - minimum[box * 3 + axis];
+            }
+        }
+
+        for (uint32_t submesh = 0; submesh < submeshCount; ++submesh)
+        {
+            const QuantizationBox& box{ boxes[find(submesh)] };
+            std::copy(std::begin(box.offset), std::end(box.offset), mesh.submeshes[submesh].positionOffset);
+            std::copy(std::begin(box.scale), std::end(box.scale), mesh.submeshes[submesh].positionScale);
+        }
+
+        return boxes;
+    }
+
+#if VERTEX_PACKING_SSE2
+    // Fabian Giesen's round to nearest even conversion. The result is sign extended to 32
+    // bits, so packs_epi32 narrows it without saturating.
+    __m128i FloatToHalf4(__m128 value)
+    {
+        const __m128i signMask{ _mm_set1_epi32(static_cast<int32_t>(0x80000000u)) };
+        const __m128i halfMax{ _mm_set1_epi32((127 + 16) << 23) };
+        const __m128i minNormal{ _mm_set1_epi32((127 - 14) << 23) };
+        const __m128i subnormalMagic{ _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23) };
+        const __m128i normalBias{ _mm_set1_epi32(0xfff - ((127 - 15) << 23)) };
+
+        __m128 sign{ _mm_and_ps(_mm_castsi128_ps(signMask), value) };
+        __m128 absolute{ _mm_xor_ps(value, sign) };
+        __m128i bits{ _mm_castps_si128(absolute) };
+
+        __m128i isNan{ _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute)) };
+        __m128i isRegular{ _mm_cmpgt_epi32(halfMax, bits) };
+        __m128i special{ _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00)) };
+
+        // Subnormal results round through the float adder.
+        __m128i isSubnormal{ _mm_cmpgt_epi32(minNormal, bits) };
+        __m128i subnormal{ _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(subnormalMagic))), subnormalMagic) };
+
+        // Normal results rebias the exponent and round on the mantissa, up on ties when the
+        // kept mantissa is odd.
+        __m128i odd{ _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31) };
+        __m128i normal{ _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, normalBias), odd), 13) };
+
+        __m128i finite{ _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal)) };
+        __m128i result{ _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special)) };
+        return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+    }
+
+    __m128i Unorm8x4(__m128 value)
+    {
+        __m128 clamped{ _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f)) };
+        return _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(UNORM8_MAX)));
+    }
+
+    // Four vectors in SoA form, returns u0 v0 u1 v1 u2 v2 u3 v3.
+    __m128i OctEncode4(__m128 x, __m128 y, __m128 z)
+    {
+        const __m128 signMask{ _mm_set1_ps(-0.0f) };
+        const __m128 one{ _mm_set1_ps(1.0f) };
+
+        __m128 length{ _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z)) };
+        __m128 inverse{ _mm_div_ps(one, _mm_max_ps(length, _mm_set1_ps(MIN_OCT_LENGTH))) };
+        __m128 u{ _mm_mul_ps(x, inverse) };
+        __m128 v{ _mm_mul_ps(y, inverse) };
+
+        // The lower hemisphere folds over the diagonals.
+        __m128 foldedU{ _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, v)), _mm_or_ps(one, _mm_and_ps(signMask, u))) };
+        __m128 foldedV{ _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, u)), _mm_or_ps(one, _mm_and_ps(signMask, v))) };
+        __m128 lower{ _mm_cmplt_ps(z, _mm_setzero_ps()) };
+        u = _mm_or_ps(_mm_and_ps(lower, foldedU), _mm_andnot_ps(lower, u));
+        v = _mm_or_ps(_mm_and_ps(lower, foldedV), _mm_andnot_ps(lower, v));
+
+        __m128i quantizedU{ _mm_cvtps_epi32(_mm_mul_ps(u, _mm_set1_ps(SNORM16_MAX))) };
+        __m128i quantizedV{ _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(SNORM16_MAX))) };
+        return _mm_packs_epi32(_mm_unpacklo_epi32(quantizedU, quantizedV), _mm_unpackhi_epi32(quantizedU, quantizedV));
+    }
+#endif
+}
+
+CookedMeshDesc PackedVertexStreams::Describe(const MeshData& mesh) const
+{
+    CookedMeshDesc desc{ mesh.Describe() };
+    desc.vertexFormat = format;
+    desc.vertexStride = layout.vertexStride;
+    desc.extraVertexStride = layout.extraVertexStride;
+    desc.vertices = vertices;
+    desc.extraVertices = extraVertices;
+    return desc;
+}
+
+VertexLayout VertexPacking::Layout(uint32_t format)
+{
+    assert((format & ~VERTEX_FORMAT_ALL) == 0 && "Unknown vertex format flags.");
+
+    bool quantized{ (format & VERTEX_FORMAT_QUANTIZED_POSITIONS) != 0 };
+    bool packed{ (format & VERTEX_FORMAT_PACKED_ATTRIBUTES) != 0 };
+    uint32_t positionSize{ static_cast<uint32_t>(quantized ? 4 * sizeof(uint16_t) : 3 * sizeof(float)) };
+    uint32_t texCoordSize{ static_cast<uint32_t>(packed ? 2 * sizeof(uint16_t) : 2 * sizeof(float)) };
+    VertexElementFormat texCoordFormat{ packed ? VertexElementFormat::Half2 : VertexElementFormat::Float2 };
+
+    VertexLayout layout;
+    layout.vertexStride = positionSize + 2 * texCoordSize;
+    layout.elements[0] = { "POSITION", 0, quantized ? VertexElementFormat::Unorm16x4 : VertexElementFormat::Float3, 0, 0 };
+    layout.elements[1] = { "TEX", 0, texCoordFormat, 0, positionSize };
+    layout.elements[2] = { "TEX", 1, texCoordFormat, 0, positionSize + texCoordSize };
+
+    if (packed)
+    {
+        layout.extraVertexStride = sizeof(PackedExtraVertex);
+        layout.elements[3] = { "COLOR", 0, VertexElementFormat::Unorm8x4, 1, offsetof(PackedExtraVertex, color) };
+        layout.elements[4] = { "TANGENT", 0, VertexElementFormat::Snorm16x2, 1, offsetof(PackedExtraVertex, tangent) };
+        layout.elements[5] = { "NORMAL", 0, VertexElementFormat::Snorm16x2, 1, offsetof(PackedExtraVertex, normal) };
+    }
+    else
+    {
+        layout.extraVertexStride = sizeof(MeshExtraVertex);
+        layout.elements[3] = { "COLOR", 0, VertexElementFormat::Float4, 1, offsetof(MeshExtraVertex, color) };
+        layout.elements[4] = { "TANGENT", 0, VertexElementFormat::Float3, 1, offsetof(MeshExtraVertex, tangent) };
+        layout.elements[5] = { "NORMAL", 0, VertexElementFormat::Float3, 1, offsetof(MeshExtraVertex, normal) };
+    }
+
+    return layout;
+}
+
+PackedVertexStreams VertexPacking::Pack(MeshData& mesh, uint32_t format, JobSystem& jobSystem)
+{
+    assert(mesh.extraVertices.size() == mesh.vertices.size() && "Vertex streams disagree on the vertex count.");
+
+    PackedVertexStreams packed;
+    packed.format = format;
+    packed.layout = Layout(format);
+
+    uint32_t vertexCount{ static_cast<uint32_t>(mesh.vertices.size()) };
+    uint32_t stride{ packed.layout.vertexStride };
+    packed.vertices.resize(size_t{ vertexCount } * stride);
+    packed.extraVertices.resize(size_t{ vertexCount } * packed.layout.extraVertexStride);
+
+    bool quantized{ (format & VERTEX_FORMAT_QUANTIZED_POSITIONS) != 0 };
+    std::vector<uint32_t> vertexBoxes;
+    std::vector<QuantizationBox> boxes;
+    if (quantized)
+        boxes = FitQuantizationBoxes(mesh, vertexBoxes);
+
+    uint32_t texCoordOffset{ packed.layout.elements[1].offset };
+    uint32_t chunkCount{ (vertexCount + CHUNK_SIZE - 1) / CHUNK_SIZE };
+    jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t chunk)
+    {
+        uint32_t begin{ chunk * CHUNK_SIZE };
+        uint32_t end{ std::min(vertexCount, begin + CHUNK_SIZE) };
+        std::span<const MeshVertex> vertices{ mesh.vertices.data() + begin, end - begin };
+        std::span<const MeshExtraVertex> extraVertices{ mesh.extraVertices.data() + begin, end - begin };
+        uint8_t* out{ packed.vertices.data() + size_t{ begin } * stride };
+
+        if (quantized)
+        {
+            // Vertex fetch order keeps a submesh's vertices together, so the boxes come in runs.
+            for (uint32_t runBegin = begin; runBegin < end;)
+            {
+                uint32_t runEnd{ runBegin + 1 };
+                while (runEnd < end && vertexBoxes[runEnd] == vertexBoxes[runBegin])
+                    ++runEnd;
+
+                const QuantizationBox& box{ boxes[vertexBoxes[runBegin]] };
+                PackPositions({ mesh.vertices.data() + runBegin, runEnd - runBegin }, box.offset, box.scale, packed.vertices.data() + size_t{ runBegin } * stride, stride);
+                runBegin = runEnd;
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < vertices.size(); ++i)
+                memcpy(out + i * stride, vertices[i].position, sizeof(MeshVertex::position));
+        }
+
+        if (format & VERTEX_FORMAT_PACKED_ATTRIBUTES)
+        {
+            PackTexCoords(vertices, out + texCoordOffset, stride);
+            PackExtraVertices(extraVertices, reinterpret_cast<PackedExtraVertex*>(packed.extraVertices.data()) + begin);
+        }
+        else
+        {
+            for (size_t i = 0; i < vertices.size(); ++i)
+                memcpy(out + i * stride + texCoordOffset, vertices[i].tex0, sizeof(MeshVertex::tex0) + sizeof(MeshVertex::tex1));
+            memcpy(packed.extraVertices.data() + size_t{ begin } * sizeof(MeshExtraVertex), extraVertices.data(), extraVertices.size_bytes());
+        }
+    });
+
+    return packed;
+}
+
+void VertexPacking::PackPositions(std::span<const MeshVertex> vertices, const float offset[3], const float scale[3], uint8_t* out, uint32_t stride)
+{
+    size_t i{ 0 };
+#if VERTEX_PACKING_SSE2
+    const __m128 offsets{ _mm_setr_ps(offset[0], offset[1], offset[2], 0.0f) };
+    const __m128 inverses{ _mm_setr_ps(Inverse(scale[0], UNORM16_MAX), Inverse(scale[1], UNORM16_MAX), Inverse(scale[2], UNORM16_MAX), 0.0f) };
+    const __m128i bias{ _mm_set1_epi32(32768) };
+    const __m128i flip{ _mm_set1_epi16(static_cast<int16_t>(0x8000)) };
+
+    // The load picks up the first UV coordinate as w, which the zero inverse and the clamp
+    // turn into a zero.
+    auto quantize = [&](const MeshVertex& vertex)
+    {
+        __m128 scaled{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(vertex.position), offsets), inverses) };
+        __m128 clamped{ _mm_min_ps(_mm_max_ps(scaled, _mm_setzero_ps()), _mm_set1_ps(UNORM16_MAX)) };
+        return _mm_sub_epi32(_mm_cvtps_epi32(clamped), bias);
+    };
+
+    for (; i + 2 <= vertices.size(); i += 2)
+    {
+        // packs_epi32 saturates signed, so the values go in biased and get their top bit back after.
+        __m128i packed{ _mm_xor_si128(_mm_packs_epi32(quantize(vertices[i]), quantize(vertices[i + 1])), flip) };
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * stride), packed);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + (i + 1) * stride), _mm_srli_si128(packed, 8));
+    }
+#endif
+
+    for (; i < vertices.size(); ++i)
+    {
+        uint16_t quantized[4]{};
+        for (int axis = 0; axis < 3; ++axis)
+            quantized[axis] = QuantizeUnorm16(vertices[i].position[axis], offset[axis], scale[axis]);
+        memcpy(out + i * stride, quantized, sizeof(quantized));
+    }
+}
+
+void VertexPacking::PackTexCoords(std::span<const MeshVertex> vertices, uint8_t* out, uint32_t stride)
+{
+    size_t i{ 0 };
+#if VERTEX_PACKING_SSE2
+    for (; i + 2 <= vertices.size(); i += 2)
+    {
+        // tex0 and tex1 sit next to each other, one load gets both.
+        __m128i packed{ _mm_packs_epi32(FloatToHalf4(_mm_loadu_ps(vertices[i].tex0)), FloatToHalf4(_mm_loadu_ps(vertices[i + 1].tex0))) };
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * stride), packed);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + (i + 1) * stride), _mm_srli_si128(packed, 8));
+    }
+#endif
+
+    for (; i < vertices.size(); ++i)
+    {
+        uint16_t halves[4]{ FloatToHalf(vertices[i].tex0[0]), FloatToHalf(vertices[i].tex0[1]), FloatToHalf(vertices[i].tex1[0]), FloatToHalf(vertices[i].tex1[1]) };
+        memcpy(out + i * stride, halves, sizeof(halves));
+    }
+}
+
+void VertexPacking::PackExtraVertices(std::span<const MeshExtraVertex> extraVertices, PackedExtraVertex* out)
+{
+    size_t i{ 0 };
+#if VERTEX_PACKING_SSE2
+    static_assert(offsetof(MeshExtraVertex, tangent) == 4 * sizeof(float) && offsetof(MeshExtraVertex, normal) == 7 * sizeof(float));
+
+    for (; i + 4 <= extraVertices.size(); i += 4)
+    {
+        // Tangent and normal get loaded one float early so the loads stay inside the vertex.
+        // After the transpose the first row holds the stray floats and the rest x, y and z.
+        __m128 colors[4];
+        __m128 tangents[4];
+        __m128 normals[4];
+        for (size_t k = 0; k < 4; ++k)
+        {
+            const float* floats{ reinterpret_cast<const float*>(&extraVertices[i + k]) };
+            colors[k] = _mm_loadu_ps(floats);
+            tangents[k] = _mm_loadu_ps(floats + 3);
+            normals[k] = _mm_loadu_ps(floats + 6);
+        }
+        _MM_TRANSPOSE4_PS(tangents[0], tangents[1], tangents[2], tangents[3]);
+        _MM_TRANSPOSE4_PS(normals[0], normals[1], normals[2], normals[3]);
+
+        alignas(16) uint32_t packedColors[4];
+        alignas(16) uint32_t packedTangents[4];
+        alignas(16) uint32_t packedNormals[4];
+        __m128i low{ _mm_packs_epi32(Unorm8x4(colors[0]), Unorm8x4(colors[1])) };
+        __m128i high{ _mm_packs_epi32(Unorm8x4(colors[2]), Unorm8x4(colors[3])) };
+        _mm_store_si128(reinterpret_cast<__m128i*>(packedColors), _mm_packus_epi16(low, high));
+        _mm_store_si128(reinterpret_cast<__m128i*>(packedTangents), OctEncode4(tangents[1], tangents[2], tangents[3]));
+        _mm_store_si128(reinterpret_cast<__m128i*>(packedNormals), OctEncode4(normals[1], normals[2], normals[3]));
+
+        for (size_t k = 0; k < 4; ++k)
+        {
+            memcpy(out[i + k].color, &packedColors[k], sizeof(uint32_t));
+            memcpy(out[i + k].tangent, &packedTangents[k], sizeof(uint32_t));
+            memcpy(out[i + k].normal, &packedNormals[k], sizeof(uint32_t));
+        }
+    }
+#endif
+
+    for (; i < extraVertices.size(); ++i)
+    {
+        for (int channel = 0; channel < 4; ++channel)
+            out[i].color[channel] = QuantizeUnorm8(extraVertices[i].color[channel]);
+        OctEncode(extraVertices[i].tangent, out[i].tangent);
+        OctEncode(extraVertices[i].normal, out[i].normal);
+    }
+}
+
+uint16_t VertexPacking::FloatToHalf(float value)
+{
+    constexpr uint32_t infinity{ 255u << 23 };
+    constexpr uint32_t halfMax{ (127u + 16) << 23 };
+    constexpr uint32_t minNormal{ (127u - 14) << 23 };
+    constexpr uint32_t subnormalMagic{ ((127u - 15) + (23 - 10) + 1) << 23 };
+
+    uint32_t bits{ std::bit_cast<uint32_t>(value) };
+    uint32_t sign{ bits & 0x80000000u };
+    bits ^= sign;
+
+    uint32_t half;
+    if (bits >= halfMax)
+    {
+        // Infinity stays infinity, NaN turns quiet.
+        half = bits > infinity ? 0x7e00 : 0x7c00;
+    }
+    else if (bits < minNormal)
+    {
+        float rounded{ std::bit_cast<float>(bits) + std::bit_cast<float>(subnormalMagic) };
+        half = std::bit_cast<uint32_t>(rounded) - subnormalMagic;
+    }
+    else
+    {
+        uint32_t odd{ (bits >> 13) & 1 };
+        half = (bits + ((15u - 127u) << 23) + 0xfff + odd) >> 13;
+    }
+
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+float VertexPacking::HalfToFloat(uint16_t value)
+{
+    constexpr uint32_t shiftedExponent{ 0x7c00u << 13 };
+
+    uint32_t bits{ (value & 0x7fffu) << 13 };
+    uint32_t exponent{ bits & shiftedExponent };
+    bits += (127u - 15) << 23;
+
+    if (exponent == shiftedExponent)
+    {
+        bits += (128u - 16) << 23;
+    }
+    else if (exponent == 0)
+    {
+        // Subnormal, renormalize through the float adder.
+        bits += 1u << 23;
+        bits = std::bit_cast<uint32_t>(std::bit_cast<float>(bits) - std::bit_cast<float>(113u << 23));
+    }
+
+    return std::bit_cast<float>(bits | (uint32_t{ value & 0x8000u } << 16));
+}
+
+void VertexPacking::OctEncode(const float vector[3], int16_t encoded[2])
+{
+    float length{ std::fabs(vector[0]) + std::fabs(vector[1]) + std::fabs(vector[2]) };
+    float inverse{ 1.0f / Max(length, MIN_OCT_LENGTH) };
+    float u{ vector[0] * inverse };
+    float v{ vector[1] * inverse };
+
+    if (vector[2] < 0.0f)
+    {
+        float foldedU{ (1.0f - std::fabs(v)) * std::copysign(1.0f, u) };
+        float foldedV{ (1.0f - std::fabs(u)) * std::copysign(1.0f, v) };
+        u = foldedU;
+        v = foldedV;
+    }
+
+    encoded[0] = static_cast<int16_t>(Round(u * SNORM16_MAX));
+    encoded[1] = static_cast<int16_t>(Round(v * SNORM16_MAX));
+}
+
+void VertexPacking::OctDecode(const int16_t encoded[2], float vector[3])
+{
+    // snorm16 decodes -32768 to -1 as well.
+    float u{ std::max(encoded[0] / SNORM16_MAX, -1.0f) };
+    float v{ std::max(encoded[1] / SNORM16_MAX, -1.0f) };
+    float z{ 1.0f - std::fabs(u) - std::fabs(v) };
+
+    // Unfold the lower hemisphere.
+    float fold{ std::max(-z, 0.0f) };
+    u += u >= 0.0f ? -fold : fold;
+    v += v >= 0.0f ? -fold : fold;
+
+    float length{ std::sqrt(u * u + v * v + z * z) };
+    vector[0] = u / length;
+    vector[1] = v / length;
+    vector[2] = z / length;
+}
+
+uint16_t VertexPacking::QuantizeUnorm16(float value, float offset, float scale)
+{
+    float scaled{ (value - offset) * Inverse(scale, UNORM16_MAX) };
+    return static_cast<uint16_t>(Round(Min(Max(scaled, 0.0f), UNORM16_MAX)));
+}
+
+float VertexPacking::DequantizeUnorm16(uint16_t value, float offset, float scale)
+{
+    return offset + value / UNORM16_MAX * scale;
+}
+
+uint8_t VertexPacking::QuantizeUnorm8(float value)
+{
+    return static_cast<uint8_t>(Round(Min(Max(value, 0.0f), 1.0f) * UNORM8_MAX));
+}
@@ -0,0 +1,162 @@
+#include "command_state_filter.hpp"
+#include "mock_command_list.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+    using Filter = CommandStateFilter<MockCommandTraits>;
+    using Call = MockCommandList::Call;
+
+    class CommandStateFilterTest : public testing::Test
+    {
+    protected:
+        // Calls that reached the list since the last look.
+        std::vector<Call> Take()
+        {
+            std::vector<Call> calls{ std::move(list.calls) };
+            list.calls.clear();
+            return calls;
+        }
+
+        uint64_t Address(const void* pointer) const { return reinterpret_cast<uintptr_t>(pointer); }
+
+        MockCommandList list;
+        Filter filter{ &list };
+        MockCommandList::DescriptorHeap heaps[2];
+        MockCommandList::RootSignature rootSignatures[2];
+    };
+}
+
+TEST_F(CommandStateFilterTest, DropsWhatIsAlreadySet)
+{
+    MockCommandList::PipelineState pipeline;
+    filter.SetPipelineState(&pipeline);
+    filter.SetPipelineState(&pipeline);
+    filter.SetGraphicsRootConstantBufferView(1, 0x1000);
+    filter.SetGraphicsRootConstantBufferView(1, 0x1000);
+    filter.SetGraphicsRootConstantBufferView(1, 0x2000);
+    filter.IASetPrimitiveTopology(4);
+    filter.IASetPrimitiveTopology(4);
+
+    EXPECT_EQ(Take(), (std::vector<Call>{
+        { MockCommandList::SET_PIPELINE_STATE, 0, 0, Address(&pipeline) },
+        { MockCommandList::SET_ROOT_CBV, 1, 0, 0x1000 },
+        { MockCommandList::SET_ROOT_CBV, 1, 0, 0x2000 },
+        { MockCommandList::SET_TOPOLOGY, 0, 0, 4 },
+    }));
+    EXPECT_EQ(filter.Stats().issued, 4u);
+    EXPECT_EQ(filter.Stats().filtered, 3u);
+}
+
+TEST_F(CommandStateFilterTest, NewHeapsForgetTheRootArguments)
+{
+    MockCommandList::DescriptorHeap* first[] = { &heaps[0] };
+    MockCommandList::DescriptorHeap* second[] = { &heaps[1] };
+    filter.SetGraphicsRootSignature(&rootSignatures[0]);
+    filter.SetDescriptorHeaps(1, first);
+    filter.SetGraphicsRootDescriptorTable(3, { 0x40 });
+    filter.SetGraphicsRootConstantBufferView(1, 0x1000);
+    Take();
+
+    // The same heaps again keep every argument.
+    filter.SetDescriptorHeaps(1, first);
+    filter.SetGraphicsRootDescriptorTable(3, { 0x40 });
+    filter.SetGraphicsRootConstantBufferView(1, 0x1000);
+    EXPECT_TRUE(Take().empty());
+
+    // Other heaps, so the same table handle now means something else and has to be set again.
+    filter.SetDescriptorHeaps(1, second);
+    filter.SetGraphicsRootDescriptorTable(3, { 0x40 });
+    filter.SetGraphicsRootConstantBufferView(1, 0x1000);
+    EXPECT_EQ(Take(), (std::vector<Call>{
+        { MockCommandList::SET_DESCRIPTOR_HEAPS, 0, 1, Address(&heaps[1]) },
+        { MockCommandList::SET_ROOT_TABLE, 3, 0, 0x40 },
+        { MockCommandList::SET_ROOT_CBV, 1, 0, 0x1000 },
+    }));
+
+    // A different heap count is a change too.
+    MockCommandList::DescriptorHeap* both[] = { &heaps[1], &heaps[0] };
+    filter.SetDescriptorHeaps(2, both);
+    filter.SetGraphicsRootDescriptorTable(3, { 0x40 });
+    EXPECT_EQ(Take().size(), 2u);
+}
+
+TEST_F(CommandStateFilterTest, NewRootSignatureForgetsTheRootArguments)
+{
+    filter.SetGraphicsRootSignature(&rootSignatures[0]);
+    filter.SetGraphicsRootShaderResourceView(2, 0x3000);
+    filter.SetGraphicsRootSignature(&rootSignatures[0]);
+    filter.SetGraphicsRootShaderResourceView(2, 0x3000);
+    EXPECT_EQ(Take().size(), 2u);
+
+    filter.SetGraphicsRootSignature(&rootSignatures[1]);
+    filter.SetGraphicsRootShaderResourceView(2, 0x3000);
+    EXPECT_EQ(Take(), (std::vector<Call>{
+        { MockCommandList::SET_ROOT_SIGNATURE, 0, 0, Address(&rootSignatures[1]) },
+        { MockCommandList::SET_ROOT_SRV, 2, 0, 0x3000 },
+    }));
+}
+
+TEST_F(CommandStateFilterTest, PassesOnOnlyTheChangedPartOfARange)
+{
+    const uint32_t constants[]{ 1, 2, 3, 4, 5, 6 };
+    filter.SetGraphicsRoot32BitConstants(0, 6, constants, 0);
+    const uint32_t changed[]{ 1, 2, 9, 8, 5, 6 };
+    filter.SetGraphicsRoot32BitConstants(0, 6, changed, 0);
+    filter.SetGraphicsRoot32BitConstants(0, 6, changed, 0);
+
+    const MockCommandList::VertexBufferView views[]{ { 0x100, 64, 16 }, { 0x200, 64, 16 }, { 0x300, 64, 16 } };
+    filter.IASetVertexBuffers(0, 3, views);
+    const MockCommandList::VertexBufferView next[]{ { 0x100, 64, 16 }, { 0x200, 64, 16 }, { 0x400, 64, 16 } };
+    filter.IASetVertexBuffers(0, 3, next);
+
+    EXPECT_EQ(Take(), (std::vector<Call>{
+        { MockCommandList::SET_ROOT_CONSTANTS, 0, 6, 0 },
+        { MockCommandList::SET_ROOT_CONSTANTS, 0, 2, 2 },
+        { MockCommandList::SET_VERTEX_BUFFERS, 0, 3, 0x100 },
+        { MockCommandList::SET_VERTEX_BUFFERS, 2, 1, 0x400 },
+    }));
+}
+
+TEST_F(CommandStateFilterTest, DepthOnlyTargetsHaveNoRenderTargets)
+{
+    const MockCommandList::CpuDescriptorHandle depth{ 0x700 };
+    const MockCommandList::CpuDescriptorHandle otherDepth{ 0x800 };
+    const MockCommandList::CpuDescriptorHandle color{ 0x900 };
+
+    // A shadow pass binds only depth, with no render target array at all.
+    filter.OMSetRenderTargets(0, nullptr, false, &depth);
+    filter.OMSetRenderTargets(0, nullptr, false, &depth);
+    filter.OMSetRenderTargets(0, nullptr, false, &otherDepth);
+    filter.OMSetRenderTargets(1, &color, false, &otherDepth);
+    filter.OMSetRenderTargets(0, nullptr, false, &otherDepth);
+    filter.OMSetRenderTargets(0, nullptr, false, nullptr);
+
+    EXPECT_EQ(Take(), (std::vector<Call>{
+        { MockCommandList::SET_RENDER_TARGETS, 0, 0, 0 },
+        { MockCommandList::SET_RENDER_TARGETS, 0, 0, 0 },
+        { MockCommandList::SET_RENDER_TARGETS, 0, 1, 0x900 },
+        { MockCommandList::SET_RENDER_TARGETS, 0, 0, 0 },
+        { MockCommandList::SET_RENDER_TARGETS, 0, 0, 0 },
+    }));
+    EXPECT_EQ(filter.Stats().filtered, 1u);
+}
+
+TEST_F(CommandStateFilterTest, InvalidateLetsEverythingThrough)
+{
+    MockCommandList::DescriptorHeap* first[] = { &heaps[0] };
+    const MockCommandList::IndexBufferView indexBuffer{ 0x500, 128, 42 };
+    filter.SetDescriptorHeaps(1, first);
+    filter.SetGraphicsRootDescriptorTable(3, { 0x40 });
+    filter.IASetIndexBuffer(&indexBuffer);
+    Take();
+
+    filter.Invalidate();
+    filter.SetDescriptorHeaps(1, first);
+    filter.SetGraphicsRootDescriptorTable(3, { 0x40 });
+    filter.IASetIndexBuffer(&indexBuffer);
+    EXPECT_EQ(Take().size(), 3u);
+}
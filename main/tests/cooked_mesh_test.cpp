@@ -0,0 +1,232 @@
+#include "binary_io.hpp"
+#include "cooked_mesh.hpp"
+#include "job_system.hpp"
+#include "mesh_data.hpp"
+#include "meshlet_builder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A cooked 8 x 8 grid with a full submesh and one LOD, meshlets built, in a directory of
+    // its own. Reject cases patch a copy of the cooked bytes.
+    class CookedMeshTest : public testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            _directory = std::filesystem::temp_directory_path() / (std::string{ "cooked_mesh_test_" } + testing::UnitTest::GetInstance()->current_test_info()->name());
+            std::filesystem::remove_all(_directory);
+            std::filesystem::create_directories(_directory);
+
+            constexpr uint32_t SIDE = 8;
+            for (uint32_t y = 0; y < SIDE; ++y)
+            {
+                for (uint32_t x = 0; x < SIDE; ++x)
+                {
+                    float u{ static_cast<float>(x) / (SIDE - 1) };
+                    float v{ static_cast<float>(y) / (SIDE - 1) };
+                    mesh.vertices.push_back({ { u, 0.1f * (x % 3), v }, { u, v }, { u, v } });
+                    mesh.extraVertices.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+                }
+            }
+            for (uint32_t y = 0; y + 1 < SIDE; ++y)
+            {
+                for (uint32_t x = 0; x + 1 < SIDE; ++x)
+                {
+                    uint32_t i{ y * SIDE + x };
+                    mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + SIDE + 1, i, i + SIDE + 1, i + SIDE });
+                }
+            }
+
+            // The LOD is two triangles over the corners.
+            uint32_t fullCount{ static_cast<uint32_t>(mesh.indices.size()) };
+            uint32_t last{ SIDE * SIDE - 1 };
+            mesh.indices.insert(mesh.indices.end(), { 0, SIDE - 1, last, 0, last, last - SIDE + 1 });
+
+            CookedSubmesh full;
+            full.name = "grid";
+            full.indexCount = fullCount;
+            CookedSubmesh lod;
+            lod.name = "grid_lod1";
+            lod.indexCount = 6;
+            lod.startIndexLocation = fullCount;
+            lod.lodLevel = 1;
+            lod.lodError = 0.25f;
+            mesh.submeshes = { full, lod };
+            mesh.ComputeBounds(_jobSystem);
+            MeshletBuilder::BuildMeshlets(mesh, _jobSystem);
+
+            CookedMeshDesc desc{ mesh.Describe() };
+            cooked = CookedMesh::Build(desc);
+        }
+
+        void TearDown() override { std::filesystem::remove_all(_directory); }
+
+        // Writes bytes to a file of their own, one still mapped mustn't change under it, and
+        // opens them.
+        bool Open(std::span<const uint8_t> bytes)
+        {
+            std::filesystem::path path{ _directory / ("mesh" + std::to_string(_fileCount++) + ".mesh") };
+            EXPECT_TRUE(WriteWholeFile(path, bytes));
+            return cookedMesh.Open(path);
+        }
+
+        template<typename T>
+        T Read(size_t offset) const
+        {
+            T value;
+            memcpy(&value, cooked.data() + offset, sizeof(T));
+            return value;
+        }
+
+        // A copy of the cooked bytes with value written at offset.
+        template<typename T>
+        std::vector<uint8_t> Patched(size_t offset, T value) const
+        {
+            std::vector<uint8_t> bytes{ cooked };
+            memcpy(bytes.data() + offset, &value, sizeof(T));
+            return bytes;
+        }
+
+        // Where the header keeps stream's offset, its size follows.
+        static constexpr size_t StreamRange(size_t stream) { return 36 + stream * 16; }
+
+        MeshData mesh;
+        std::vector<uint8_t> cooked;
+        CookedMesh cookedMesh;
+
+    private:
+        std::filesystem::path _directory;
+        uint32_t _fileCount{ 0 };
+        JobSystem _jobSystem{ 2 };
+    };
+
+    template<typename T>
+    std::vector<uint8_t> Bytes(const std::vector<T>& values)
+    {
+        const uint8_t* data{ reinterpret_cast<const uint8_t*>(values.data()) };
+        return { data, data + values.size() * sizeof(T) };
+    }
+
+    template<typename T>
+    std::vector<uint8_t> Bytes(std::span<const T> values)
+    {
+        const uint8_t* data{ reinterpret_cast<const uint8_t*>(values.data()) };
+        return { data, data + values.size_bytes() };
+    }
+}
+
+TEST_F(CookedMeshTest, OpensWhatWasCooked)
+{
+    ASSERT_TRUE(Open(cooked));
+    EXPECT_TRUE(cookedMesh.IsOpen());
+
+    EXPECT_EQ(cookedMesh.VertexStride(), sizeof(MeshVertex));
+    EXPECT_EQ(cookedMesh.ExtraVertexStride(), sizeof(MeshExtraVertex));
+    EXPECT_EQ(cookedMesh.VertexCount(), mesh.vertices.size());
+    EXPECT_EQ(cookedMesh.IndexSize(), 4u);
+    EXPECT_EQ(cookedMesh.IndexCount(), mesh.indices.size());
+
+    EXPECT_EQ(Bytes(cookedMesh.Vertices()), Bytes(mesh.vertices));
+    EXPECT_EQ(Bytes(cookedMesh.ExtraVertices()), Bytes(mesh.extraVertices));
+    EXPECT_EQ(Bytes(cookedMesh.Indices()), Bytes(mesh.indices));
+    ASSERT_FALSE(mesh.meshlets.meshlets.empty());
+    EXPECT_EQ(Bytes(cookedMesh.Meshlets()), Bytes(mesh.meshlets.meshlets));
+    EXPECT_EQ(Bytes(cookedMesh.MeshletBoundsData()), Bytes(mesh.meshlets.bounds));
+    EXPECT_EQ(Bytes(cookedMesh.MeshletVertices()), Bytes(mesh.meshlets.vertices));
+    EXPECT_EQ(Bytes(cookedMesh.MeshletTriangles()), Bytes(mesh.meshlets.triangles));
+
+    ASSERT_EQ(cookedMesh.SubmeshCount(), 2u);
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        CookedSubmesh expected{ mesh.submeshes[i] };
+        CookedSubmesh submesh{ cookedMesh.SubmeshAt(i) };
+        EXPECT_EQ(submesh.name, expected.name);
+        EXPECT_EQ(submesh.indexCount, expected.indexCount);
+        EXPECT_EQ(submesh.startIndexLocation, expected.startIndexLocation);
+        EXPECT_EQ(submesh.meshletOffset, expected.meshletOffset);
+        EXPECT_EQ(submesh.meshletCount, expected.meshletCount);
+        EXPECT_EQ(submesh.lodLevel, expected.lodLevel);
+        EXPECT_EQ(submesh.lodError, expected.lodError);
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            EXPECT_EQ(submesh.boundsCenter[axis], expected.boundsCenter[axis]);
+            EXPECT_EQ(submesh.boundsExtents[axis], expected.boundsExtents[axis]);
+        }
+    }
+
+    // Cooking what it describes gives the same file back.
+    EXPECT_EQ(CookedMesh::Build(cookedMesh.Describe()), cooked);
+}
+
+TEST_F(CookedMeshTest, RejectsTruncatedFiles)
+{
+    // Inside the header, inside the submesh table, inside the names and inside the last stream.
+    for (size_t size : { size_t{ 0 }, size_t{ 3 }, CookedMesh::HEADER_SIZE - 1, CookedMesh::HEADER_SIZE + CookedMesh::SUBMESH_SIZE,
+                         CookedMesh::HEADER_SIZE + 2 * CookedMesh::SUBMESH_SIZE + 4, cooked.size() - 1 })
+    {
+        EXPECT_FALSE(Open(std::span{ cooked }.first(size))) << "size " << size;
+        EXPECT_FALSE(cookedMesh.IsOpen());
+    }
+}
+
+TEST_F(CookedMeshTest, RejectsBadMagicAndVersion)
+{
+    EXPECT_FALSE(Open(Patched<uint32_t>(0, 0x4853454E)));
+    EXPECT_FALSE(Open(Patched<uint32_t>(4, CookedMesh::VERSION + 1)));
+
+    // A failed open leaves nothing of what was open before.
+    ASSERT_TRUE(Open(cooked));
+    EXPECT_FALSE(Open(Patched<uint32_t>(0, 0)));
+    EXPECT_FALSE(cookedMesh.IsOpen());
+    EXPECT_TRUE(cookedMesh.Vertices().empty());
+    EXPECT_EQ(cookedMesh.SubmeshCount(), 0u);
+}
+
+TEST_F(CookedMeshTest, RejectsStreamsOutsideTheFile)
+{
+    for (size_t stream = 0; stream < CookedMesh::STREAM_COUNT; ++stream)
+    {
+        size_t range{ StreamRange(stream) };
+        uint64_t offset{ Read<uint64_t>(range) };
+        uint64_t size{ Read<uint64_t>(range + 8) };
+
+        // Starting past the end, ending past the end, a size that wraps around, misaligned.
+        EXPECT_FALSE(Open(Patched<uint64_t>(range, (cooked.size() + 16) / 16 * 16))) << "stream " << stream;
+        EXPECT_FALSE(Open(Patched<uint64_t>(range, (cooked.size() - size) / 16 * 16 + 16))) << "stream " << stream;
+        EXPECT_FALSE(Open(Patched<uint64_t>(range + 8, ~uint64_t{ 0 } - offset + 1))) << "stream " << stream;
+        EXPECT_FALSE(Open(Patched<uint64_t>(range, offset + 4))) << "stream " << stream;
+    }
+}
+
+TEST_F(CookedMeshTest, RejectsCountsTheStreamsDontHold)
+{
+    // Vertex and index counts in the header, then the submesh table's first entry: its index
+    // range, its meshlet range and a LOD without the level before it.
+    EXPECT_FALSE(Open(Patched<uint32_t>(20, static_cast<uint32_t>(mesh.vertices.size()) + 1)));
+    EXPECT_FALSE(Open(Patched<uint32_t>(28, static_cast<uint32_t>(mesh.indices.size()) + 1)));
+    EXPECT_FALSE(Open(Patched<uint32_t>(32, 1000)));
+
+    size_t submesh{ CookedMesh::HEADER_SIZE };
+    EXPECT_FALSE(Open(Patched<uint32_t>(submesh + 8, static_cast<uint32_t>(mesh.indices.size()) + 1)));
+    EXPECT_FALSE(Open(Patched<uint32_t>(submesh + 12, static_cast<uint32_t>(mesh.indices.size()))));
+    EXPECT_FALSE(Open(Patched<uint32_t>(submesh + 48, static_cast<uint32_t>(mesh.meshlets.meshlets.size()) + 1)));
+    EXPECT_FALSE(Open(Patched<uint32_t>(submesh + CookedMesh::SUBMESH_SIZE + 52, 2)));
+
+    // A meshlet reaching past the meshlet vertices.
+    size_t meshlets{ static_cast<size_t>(Read<uint64_t>(StreamRange(3))) };
+    EXPECT_FALSE(Open(Patched<uint32_t>(meshlets, static_cast<uint32_t>(mesh.meshlets.vertices.size()))));
+
+    ASSERT_TRUE(Open(cooked));
+}
+
+TEST_F(CookedMeshTest, RejectsMissingFiles)
+{
+    EXPECT_FALSE(cookedMesh.Open(std::filesystem::temp_directory_path() / "cooked_mesh_test_missing.mesh"));
+    EXPECT_FALSE(cookedMesh.IsOpen());
+}
@@ -0,0 +1,203 @@
+#include "copy_kernels.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Bytes around every destination that no kernel may touch.
+    constexpr size_t GUARD_SIZE = 64;
+    constexpr uint8_t GUARD = 0xcd;
+
+    // Puts the kernels back whatever a test selected.
+    class CopyKernelsTest : public testing::Test
+    {
+    protected:
+        void TearDown() override { CopyKernels::Select(CpuFeatures::Detected()); }
+
+        // Every kernel set this CPU can run, scalar first.
+        static std::vector<CpuFeatures::Isa> Kernels()
+        {
+            std::vector<CpuFeatures::Isa> kernels;
+            for (CpuFeatures::Isa isa : { CpuFeatures::Isa::Scalar, CpuFeatures::Isa::Sse2, CpuFeatures::Isa::Avx2 })
+            {
+                if (isa <= CpuFeatures::Detected())
+                    kernels.push_back(isa);
+            }
+            return kernels;
+        }
+
+        // A destination of size bytes misaligned by offset, guard bytes before and after.
+        // Backed by floats so matrix destinations at multiples of four stay float aligned.
+        struct Destination
+        {
+            std::vector<float> storage;
+            size_t offset;
+            size_t size;
+
+            Destination(size_t size, size_t offset) : storage((2 * GUARD_SIZE + 64 + offset + size) / 4 + 1), offset(offset), size(size)
+            {
+                std::memset(storage.data(), GUARD, storage.size() * 4);
+            }
+
+            // Line aligned, then offset.
+            uint8_t* Data()
+            {
+                uintptr_t start{ reinterpret_cast<uintptr_t>(storage.data()) + GUARD_SIZE };
+                return reinterpret_cast<uint8_t*>((start + 63) / 64 * 64 + offset);
+            }
+
+            // The written bytes, with the guards checked.
+            std::vector<uint8_t> Written()
+            {
+                const uint8_t* data{ Data() };
+                for (size_t i = 1; i <= GUARD_SIZE; ++i)
+                    EXPECT_EQ(data[-static_cast<ptrdiff_t>(i)], GUARD) << "before the destination";
+                for (size_t i = 0; i < GUARD_SIZE; ++i)
+                    EXPECT_EQ(data[size + i], GUARD) << "after the destination";
+                return { data, data + size };
+            }
+        };
+
+        static std::vector<uint8_t> Bytes(size_t size)
+        {
+            std::vector<uint8_t> bytes(size);
+            for (size_t i = 0; i < size; ++i)
+                bytes[i] = static_cast<uint8_t>(i * 131 + i / 256);
+            return bytes;
+        }
+
+        static std::vector<float> Matrices(size_t count)
+        {
+            std::vector<float> matrices(count * 16);
+            for (size_t i = 0; i < matrices.size(); ++i)
+                matrices[i] = static_cast<float>(i) * 0.25f - 7.0f;
+            return matrices;
+        }
+    };
+}
+
+TEST_F(CopyKernelsTest, StreamCopyWritesExactlyTheSource)
+{
+    for (CpuFeatures::Isa isa : Kernels())
+    {
+        CopyKernels::Select(isa);
+        ASSERT_EQ(CopyKernels::Selected(), isa);
+
+        // Under a line, ragged ends on both sides, and many whole lines.
+        for (size_t size : { 0, 1, 63, 64, 65, 200, 4096, 100003 })
+        {
+            for (size_t offset : { 0, 1, 16, 37 })
+            {
+                std::vector<uint8_t> source{ Bytes(size) };
+                Destination destination{ size, offset };
+                CopyKernels::StreamCopy(destination.Data(), source.data(), size);
+                EXPECT_EQ(destination.Written(), source) << "kernel " << static_cast<uint32_t>(isa) << " size " << size << " offset " << offset;
+            }
+        }
+    }
+}
+
+TEST_F(CopyKernelsTest, TransposesMatchTheScalarKernels)
+{
+    // Few matrices go through plain stores, more through streaming ones, and a misaligned
+    // destination through plain stores whatever the count.
+    for (size_t count : { 1, 3, 6, 17, 100 })
+    {
+        for (size_t offset : { 0, 4, 16 })
+        {
+            std::vector<float> source{ Matrices(count) };
+
+            // The plain C++ transpose, what every kernel has to write.
+            std::vector<uint8_t> expected4x4(count * 64);
+            std::vector<uint8_t> expected3x4(count * 48);
+            for (size_t m = 0; m < count; ++m)
+            {
+                for (size_t row = 0; row < 4; ++row)
+                {
+                    for (size_t column = 0; column < 4; ++column)
+                    {
+                        float value{ source[m * 16 + column * 4 + row] };
+                        std::memcpy(&expected4x4[(m * 16 + row * 4 + column) * 4], &value, 4);
+                        if (row < 3)
+                            std::memcpy(&expected3x4[(m * 12 + row * 4 + column) * 4], &value, 4);
+                    }
+                }
+            }
+
+            for (CpuFeatures::Isa isa : Kernels())
+            {
+                CopyKernels::Select(isa);
+
+                Destination destination4x4{ count * 64, offset };
+                CopyKernels::StreamTransposed4x4(reinterpret_cast<float*>(destination4x4.Data()), source.data(), count);
+                Destination destination3x4{ count * 48, offset };
+                CopyKernels::StreamTransposed3x4(reinterpret_cast<float*>(destination3x4.Data()), source.data(), count);
+                CopyKernels::Fence();
+
+                EXPECT_EQ(destination4x4.Written(), expected4x4) << "kernel " << static_cast<uint32_t>(isa) << " count " << count << " offset " << offset;
+                EXPECT_EQ(destination3x4.Written(), expected3x4) << "kernel " << static_cast<uint32_t>(isa) << " count " << count << " offset " << offset;
+            }
+        }
+    }
+}
+
+TEST_F(CopyKernelsTest, StridedCopiesMatchTheScalarKernels)
+{
+    struct Case
+    {
+        size_t destinationStride;
+        size_t sourceStride;
+        size_t elementSize;
+        size_t count;
+    };
+
+    // Packed, gathered into a packed destination with every element size the gather
+    // special-cases and some it doesn't, more than one gather block, and scattered
+    // destinations of short aligned, short unaligned and line spanning elements.
+    const Case cases[]{
+        { 12, 12, 12, 1000 },
+        { 4, 16, 4, 3000 },
+        { 8, 20, 8, 700 },
+        { 16, 48, 16, 1000 },
+        { 12, 32, 12, 513 },
+        { 100, 160, 100, 90 },
+        { 32, 16, 16, 200 },
+        { 24, 12, 12, 200 },
+        { 160, 100, 100, 50 },
+        { 16, 64, 16, 0 },
+    };
+
+    for (const Case& test : cases)
+    {
+        size_t destinationSize{ test.count == 0 ? 0 : (test.count - 1) * test.destinationStride + test.elementSize };
+        std::vector<uint8_t> source{ Bytes(test.count * test.sourceStride) };
+
+        for (size_t offset : { 0, 16, 3 })
+        {
+            std::vector<uint8_t> expected;
+            for (CpuFeatures::Isa isa : Kernels())
+            {
+                CopyKernels::Select(isa);
+
+                // Gaps between scattered elements keep the guard bytes too.
+                Destination destination{ destinationSize, offset };
+                CopyKernels::StridedCopy(destination.Data(), test.destinationStride, source.data(), test.sourceStride, test.elementSize, test.count);
+                std::vector<uint8_t> written{ destination.Written() };
+
+                if (isa == CpuFeatures::Isa::Scalar)
+                {
+                    expected = written;
+                    for (size_t i = 0; i < test.count; ++i)
+                    {
+                        const uint8_t* element{ source.data() + i * test.sourceStride };
+                        ASSERT_TRUE(std::equal(element, element + test.elementSize, written.begin() + i * test.destinationStride)) << "element " << i;
+                    }
+                }
+                EXPECT_EQ(written, expected) << "kernel " << static_cast<uint32_t>(isa) << " stride " << test.destinationStride << " size " << test.elementSize << " offset " << offset;
+            }
+        }
+    }
+}
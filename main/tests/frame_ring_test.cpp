@@ -0,0 +1,106 @@
+#include "frame_ring.hpp"
+
+#include <gtest/gtest.h>
+
+#include "support/simulated_queue.hpp"
+
+namespace
+{
+    struct Slot
+    {
+        explicit Slot(uint32_t id = 0) : id(id) {}
+
+        uint32_t id;
+        uint64_t fence{ 0 };
+        // Bumped every time the CPU records into the slot.
+        uint32_t uses{ 0 };
+    };
+
+    // What Device::Draw does per frame: wait for the next slot, record into it, submit it.
+    void RunFrame(FrameRing<Slot>& ring, SimulatedQueue& queue)
+    {
+        queue.Wait(ring.Advance());
+        ASSERT_TRUE(ring.IsRetired(ring.CurrentIndex(), queue.CompletedValue())) << "Recording into a slot the GPU still holds.";
+        ++ring.Current().uses;
+        ring.Submit(queue.Signal());
+    }
+}
+
+TEST(FrameRing, ForwardsConstructorArguments)
+{
+    FrameRing<Slot> ring{ 3, 7u };
+
+    ASSERT_EQ(ring.SlotCount(), 3u);
+    for (uint32_t i = 0; i < ring.SlotCount(); ++i)
+    {
+        EXPECT_EQ(ring[i].id, 7u);
+        EXPECT_EQ(ring[i].fence, 0u);
+    }
+}
+
+TEST(FrameRing, AdvanceWrapsAndReturnsTheSlotsFence)
+{
+    FrameRing<Slot> ring{ 3 };
+
+    EXPECT_EQ(ring.CurrentIndex(), 0u);
+    ring.Submit(5);
+    EXPECT_EQ(ring.Advance(), 0u) << "Untouched slots have nothing to wait for.";
+    ring.Submit(6);
+    EXPECT_EQ(ring.Advance(), 0u);
+    ring.Submit(7);
+    EXPECT_EQ(ring.Advance(), 5u);
+    EXPECT_EQ(ring.CurrentIndex(), 0u);
+    EXPECT_EQ(ring.LastSubmitted(), 7u);
+}
+
+TEST(FrameRing, IsRetiredComparesAgainstTheCompletedFence)
+{
+    FrameRing<Slot> ring{ 2 };
+    ring.Submit(4);
+
+    EXPECT_FALSE(ring.IsRetired(0, 3));
+    EXPECT_TRUE(ring.IsRetired(0, 4));
+    EXPECT_TRUE(ring.IsRetired(1, 0));
+}
+
+TEST(FrameRing, NeverWaitsWhileTheGpuKeepsUp)
+{
+    // A GPU fewer frames behind than there are slots never holds the slot the CPU moves to.
+    for (uint32_t slotCount = 1; slotCount <= 4; ++slotCount)
+    {
+        for (uint64_t latency = 0; latency < slotCount; ++latency)
+        {
+            FrameRing<Slot> ring{ slotCount };
+            SimulatedQueue queue{ latency };
+            for (uint32_t frame = 0; frame < 100; ++frame)
+                RunFrame(ring, queue);
+
+            EXPECT_EQ(queue.WaitCount(), 0u) << slotCount << " slots, " << latency << " frames behind";
+        }
+    }
+}
+
+TEST(FrameRing, WaitsOnlyOnceTheRingWrapsOntoBusySlots)
+{
+    constexpr uint32_t SLOT_COUNT = 3;
+    constexpr uint32_t FRAME_COUNT = 100;
+
+    FrameRing<Slot> ring{ SLOT_COUNT };
+    SimulatedQueue queue{ 10 };
+    for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+        RunFrame(ring, queue);
+
+    // The first lap finds fresh slots, every later frame one still in flight.
+    EXPECT_EQ(queue.WaitCount(), FRAME_COUNT - SLOT_COUNT);
+}
+
+TEST(FrameRing, UsesEverySlotInTurn)
+{
+    FrameRing<Slot> ring{ 4 };
+    SimulatedQueue queue{ 2 };
+    for (uint32_t frame = 0; frame < 40; ++frame)
+        RunFrame(ring, queue);
+
+    for (uint32_t i = 0; i < ring.SlotCount(); ++i)
+        EXPECT_EQ(ring[i].uses, 10u);
+}
@@ -0,0 +1,144 @@
+#include "frustum_culler.hpp"
+#include "job_system.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Looking down +z from the origin with a 90 degree field of view both ways, so the side
+    // planes are x = +-z and y = +-z.
+    Frustum Perspective(float nearZ = 1.0f, float farZ = 1000.0f)
+    {
+        float range{ farZ / (farZ - nearZ) };
+        const float matrix[4][4] = {
+            { 1.0f, 0.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, range, 1.0f },
+            { 0.0f, 0.0f, -nearZ * range, 0.0f },
+        };
+        return Frustum::FromViewProjection(matrix);
+    }
+
+    // Puts the kernel back whatever a test selected.
+    class FrustumCullerKernels : public testing::Test
+    {
+    protected:
+        void TearDown() override { FrustumCuller::SelectKernel(CpuFeatures::Detected()); }
+
+        // Every kernel this CPU can run, scalar first.
+        static std::vector<CpuFeatures::Isa> Kernels()
+        {
+            std::vector<CpuFeatures::Isa> kernels;
+            for (CpuFeatures::Isa isa : { CpuFeatures::Isa::Scalar, CpuFeatures::Isa::Sse2, CpuFeatures::Isa::Avx2 })
+            {
+                if (isa <= CpuFeatures::Detected())
+                    kernels.push_back(isa);
+            }
+            return kernels;
+        }
+    };
+}
+
+TEST_F(FrustumCullerKernels, KeepsWhatTouchesTheFrustum)
+{
+    Frustum frustum{ Perspective() };
+    FrustumCuller culler;
+    const float extents[3]{ 1.0f, 1.0f, 1.0f };
+    auto add = [&](float x, float y, float z, uint32_t payload)
+    {
+        const float center[3]{ x, y, z };
+        culler.Add(center, extents, payload);
+    };
+
+    add(0.0f, 0.0f, 10.0f, 0);
+    add(0.0f, 0.0f, -10.0f, 1);
+    add(-20.0f, 0.0f, 10.0f, 2);
+    // Straddles the left plane, then touches it with its nearest corner, then misses it by a bit.
+    add(-11.0f, 0.0f, 10.0f, 3);
+    add(-12.0f, 0.0f, 10.0f, 4);
+    add(-12.01f, 0.0f, 10.0f, 5);
+    add(0.0f, 0.0f, 1001.5f, 6);
+    add(0.0f, 20.0f, 10.0f, 7);
+    add(0.0f, 0.0f, 0.5f, 8);
+
+    for (CpuFeatures::Isa isa : Kernels())
+    {
+        FrustumCuller::SelectKernel(isa);
+        std::vector<uint32_t> visible(culler.Count());
+        visible.resize(culler.CullRange(frustum, 0, culler.Count(), visible.data()));
+        EXPECT_EQ(visible, (std::vector<uint32_t>{ 0, 3, 4, 8 })) << "kernel " << static_cast<uint32_t>(isa);
+    }
+}
+
+TEST_F(FrustumCullerKernels, AgreeOnRandomBoxes)
+{
+    // Not a multiple of eight so the wide kernels run their scalar tail too, and enough for
+    // several culling jobs. Boxes of every size, some of them flat.
+    constexpr uint32_t BOX_COUNT = 3 * FrustumCuller::CHUNK_SIZE + 13;
+    std::mt19937 random{ 29 };
+    std::uniform_real_distribution<float> position{ -400.0f, 1200.0f };
+    std::uniform_real_distribution<float> size{ 0.0f, 50.0f };
+
+    // A few views, one of them turned so the planes aren't axis aligned.
+    std::vector<Frustum> frustums{ Perspective(), Perspective(0.1f, 300.0f) };
+    const float turned[4][4] = {
+        { 0.8f, 0.0f, 0.6f * 1.001f, 0.6f },
+        { 0.0f, 1.3f, 0.0f, 0.0f },
+        { -0.6f, 0.0f, 0.8f * 1.001f, 0.8f },
+        { 5.0f, -2.0f, -1.0f, 1.0f },
+    };
+    frustums.push_back(Frustum::FromViewProjection(turned));
+
+    FrustumCuller culler;
+    for (uint32_t i = 0; i < BOX_COUNT; ++i)
+    {
+        float center[3]{ position(random) * 0.5f, position(random) * 0.5f, position(random) };
+        const float extents[3]{ size(random), i % 7 == 0 ? 0.0f : size(random), size(random) };
+
+        // Every other box sits right on one of the turned view's planes, where rounding
+        // decides and the kernels only agree if they add up the terms in the same order.
+        if (i % 2 == 0)
+        {
+            const float* plane{ frustums.back().planes[i / 2 % 6] };
+            float rest{ plane[1] * center[1] + plane[2] * center[2] + plane[3] + std::fabs(plane[0]) * extents[0] + std::fabs(plane[1]) * extents[1] +
+                std::fabs(plane[2]) * extents[2] };
+            center[0] = -rest / plane[0] * (1.0f + (static_cast<int32_t>(random() % 9) - 4) * 1e-7f);
+        }
+        culler.Add(center, extents, i);
+    }
+
+    JobSystem jobSystem{ 2 };
+    for (const Frustum& frustum : frustums)
+    {
+        FrustumCuller::SelectKernel(CpuFeatures::Isa::Scalar);
+        std::vector<uint32_t> expected;
+        culler.Cull(frustum, jobSystem, expected);
+        ASSERT_GT(expected.size(), 0u);
+        ASSERT_LT(expected.size(), BOX_COUNT);
+
+        for (CpuFeatures::Isa isa : Kernels())
+        {
+            FrustumCuller::SelectKernel(isa);
+            ASSERT_EQ(FrustumCuller::Kernel(), isa);
+
+            std::vector<uint32_t> visible;
+            culler.Cull(frustum, jobSystem, visible);
+            EXPECT_EQ(visible, expected) << "kernel " << static_cast<uint32_t>(isa);
+
+            // Ranges that start and end off the vector width.
+            std::vector<uint32_t> range(culler.Count());
+            range.resize(culler.CullRange(frustum, 3, 4000, range.data()));
+            std::vector<uint32_t> expectedRange;
+            for (uint32_t payload : expected)
+            {
+                if (payload >= 3 && payload < 4000)
+                    expectedRange.push_back(payload);
+            }
+            EXPECT_EQ(range, expectedRange) << "kernel " << static_cast<uint32_t>(isa);
+        }
+    }
+}
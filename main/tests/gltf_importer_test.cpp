@@ -0,0 +1,111 @@
+#include "job_system.hpp"
+#include "mesh_importer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A .gltf next to its .bin in a directory of its own. The bin holds one triangle: three
+    // float positions followed by three u16 indices.
+    class GltfFiles : public testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            _directory = std::filesystem::temp_directory_path() / (std::string{ "gltf_importer_test_" } + testing::UnitTest::GetInstance()->current_test_info()->name());
+            std::filesystem::remove_all(_directory);
+            std::filesystem::create_directories(_directory);
+
+            const float positions[] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+            const uint16_t indices[] = { 0, 1, 2 };
+            std::vector<uint8_t> bin(sizeof(positions) + sizeof(indices));
+            memcpy(bin.data(), positions, sizeof(positions));
+            memcpy(bin.data() + sizeof(positions), indices, sizeof(indices));
+            std::ofstream{ _directory / "triangle.bin", std::ios::binary }.write(reinterpret_cast<const char*>(bin.data()), static_cast<std::streamsize>(bin.size()));
+        }
+
+        void TearDown() override { std::filesystem::remove_all(_directory); }
+
+        // accessors, bufferViews and meshes are spliced in as given.
+        std::optional<MeshData> Import(const std::string& buffers, const std::string& bufferViews, const std::string& accessors, const std::string& meshes)
+        {
+            std::filesystem::path path{ _directory / "mesh.gltf" };
+            std::ofstream{ path } << R"({ "asset": { "version": "2.0" }, "buffers": )" << buffers << R"(, "bufferViews": )" << bufferViews
+                                  << R"(, "accessors": )" << accessors << R"(, "meshes": )" << meshes << " }";
+            return ImportGltf(path, _jobSystem);
+        }
+
+        static constexpr const char* TRIANGLE_BUFFERS = R"([ { "uri": "triangle.bin", "byteLength": 42 } ])";
+        static constexpr const char* TRIANGLE_VIEWS = R"([ { "buffer": 0, "byteOffset": 0, "byteLength": 36 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 } ])";
+        static constexpr const char* TRIANGLE_MESHES = R"([ { "primitives": [ { "attributes": { "POSITION": 0 }, "indices": 1 } ] } ])";
+
+        // Position accessor fields, then index accessor fields.
+        static std::string Accessors(const std::string& positions, const std::string& indices)
+        {
+            return R"([ { "bufferView": 0, "componentType": 5126, "type": "VEC3", )" + positions + R"( }, { "bufferView": 1, "componentType": 5123, "type": "SCALAR", )" + indices + " } ]";
+        }
+
+        std::filesystem::path _directory;
+        JobSystem _jobSystem{ 2 };
+    };
+}
+
+TEST_F(GltfFiles, ImportsATriangle)
+{
+    std::optional<MeshData> mesh{ Import(TRIANGLE_BUFFERS, TRIANGLE_VIEWS, Accessors(R"("count": 3)", R"("count": 3)"), TRIANGLE_MESHES) };
+    ASSERT_TRUE(mesh);
+    ASSERT_EQ(mesh->vertices.size(), 3u);
+    EXPECT_EQ(mesh->indices, (std::vector<uint32_t>{ 0, 1, 2 }));
+    EXPECT_EQ(mesh->vertices[1].position[0], 1.0f);
+    ASSERT_EQ(mesh->submeshes.size(), 1u);
+    EXPECT_EQ(mesh->submeshes[0].indexCount, 3u);
+}
+
+TEST_F(GltfFiles, RejectsNumbersThatArentSizes)
+{
+    for (const char* count : { R"("count": -1)", R"("count": 2.5)", R"("count": 1e300)", R"("count": "3")" })
+        EXPECT_FALSE(Import(TRIANGLE_BUFFERS, TRIANGLE_VIEWS, Accessors(count, R"("count": 3)"), TRIANGLE_MESHES)) << count;
+
+    for (const char* offset : { R"("count": 3, "byteOffset": -4)", R"("count": 3, "byteOffset": 1e20)", R"("count": 3, "byteOffset": 0.5)" })
+        EXPECT_FALSE(Import(TRIANGLE_BUFFERS, TRIANGLE_VIEWS, Accessors(offset, R"("count": 3)"), TRIANGLE_MESHES)) << offset;
+
+    EXPECT_FALSE(Import(R"([ { "uri": "triangle.bin", "byteLength": -42 } ])", TRIANGLE_VIEWS, Accessors(R"("count": 3)", R"("count": 3)"), TRIANGLE_MESHES));
+    EXPECT_FALSE(Import(TRIANGLE_BUFFERS, R"([ { "buffer": 0, "byteLength": 36, "byteStride": 1e40 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 } ])",
+        Accessors(R"("count": 3)", R"("count": 3)"), TRIANGLE_MESHES));
+}
+
+TEST_F(GltfFiles, RejectsAccessorsPastTheirView)
+{
+    EXPECT_FALSE(Import(TRIANGLE_BUFFERS, TRIANGLE_VIEWS, Accessors(R"("count": 4)", R"("count": 3)"), TRIANGLE_MESHES));
+    EXPECT_FALSE(Import(TRIANGLE_BUFFERS, TRIANGLE_VIEWS, Accessors(R"("count": 3, "byteOffset": 4)", R"("count": 3)"), TRIANGLE_MESHES));
+    EXPECT_FALSE(Import(TRIANGLE_BUFFERS, TRIANGLE_VIEWS, Accessors(R"("count": 3, "byteOffset": 40)", R"("count": 3)"), TRIANGLE_MESHES));
+
+    // stride * (count - 1) comes to just under 2^64, the offset wraps the end around to 14
+    // bytes, which would fit the view.
+    std::string views{ R"([ { "buffer": 0, "byteLength": 36, "byteStride": 4294967295 }, { "buffer": 0, "byteOffset": 36, "byteLength": 6 } ])" };
+    EXPECT_FALSE(Import(TRIANGLE_BUFFERS, views, Accessors(R"("count": 4294967295, "byteOffset": 12884901888)", R"("count": 3)"), TRIANGLE_MESHES));
+}
+
+TEST_F(GltfFiles, RejectsMoreIndicesThanFitIn32Bits)
+{
+    // A sparse buffer with 2^31 + 1 byte indices, two primitives using it add up to more than
+    // 2^32 indices. The data is never read, the totals are checked first.
+    constexpr uint64_t INDEX_COUNT = (1ull << 31) + 1;
+    std::filesystem::path big{ _directory / "big.bin" };
+    std::ofstream{ big, std::ios::binary } << "";
+    std::error_code error;
+    std::filesystem::resize_file(big, 64 + INDEX_COUNT, error);
+    ASSERT_FALSE(error) << error.message();
+
+    std::string buffers{ R"([ { "uri": "triangle.bin", "byteLength": 42 }, { "uri": "big.bin", "byteLength": )" + std::to_string(64 + INDEX_COUNT) + " } ]" };
+    std::string views{ R"([ { "buffer": 0, "byteLength": 36 }, { "buffer": 1, "byteOffset": 64, "byteLength": )" + std::to_string(INDEX_COUNT) + " } ]" };
+    std::string accessors{ R"([ { "bufferView": 0, "componentType": 5126, "type": "VEC3", "count": 3 }, { "bufferView": 1, "componentType": 5121, "type": "SCALAR", "count": )" + std::to_string(INDEX_COUNT) + " } ]" };
+    std::string meshes{ R"([ { "primitives": [ { "attributes": { "POSITION": 0 }, "indices": 1 }, { "attributes": { "POSITION": 0 }, "indices": 1 } ] } ])" };
+
+    EXPECT_FALSE(Import(buffers, views, accessors, meshes));
+}
@@ -0,0 +1,106 @@
+#include "index_allocator.hpp"
+#include "ring_allocator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+
+TEST(IndexAllocator, HandsOutTheLowestFreeIndex)
+{
+    IndexAllocator indices{ 200 };
+
+    for (uint32_t i = 0; i < 130; ++i)
+        ASSERT_EQ(indices.Allocate(), i);
+
+    indices.Free(70);
+    indices.Free(3);
+    EXPECT_EQ(indices.Allocate(), 3u);
+    EXPECT_EQ(indices.Allocate(), 70u);
+    EXPECT_EQ(indices.Allocate(), 130u);
+    EXPECT_EQ(indices.AllocatedCount(), 131u);
+}
+
+TEST(IndexAllocator, StopsAtTheCapacity)
+{
+    // Not a multiple of 64, the bits past the end of the last word must never come out.
+    IndexAllocator indices{ 70 };
+
+    for (uint32_t i = 0; i < 70; ++i)
+        ASSERT_EQ(indices.Allocate(), i);
+    EXPECT_TRUE(indices.IsFull());
+    EXPECT_EQ(indices.Allocate(), IndexAllocator::INVALID_INDEX);
+
+    indices.Free(69);
+    EXPECT_FALSE(indices.IsFull());
+    EXPECT_EQ(indices.Allocate(), 69u);
+}
+
+TEST(IndexAllocator, MatchesASetUnderRandomUse)
+{
+    constexpr uint32_t CAPACITY = 1000;
+
+    std::mt19937 random{ 3 };
+    IndexAllocator indices{ CAPACITY };
+    std::set<uint32_t> allocated;
+
+    for (uint32_t step = 0; step < 50000; ++step)
+    {
+        if (allocated.empty() || random() % 2 == 0)
+        {
+            uint32_t index{ indices.Allocate() };
+            if (allocated.size() == CAPACITY)
+            {
+                ASSERT_EQ(index, IndexAllocator::INVALID_INDEX);
+                continue;
+            }
+
+            // Lowest free index first, the first gap in the set.
+            uint32_t expected{ 0 };
+            for (uint32_t used : allocated)
+            {
+                if (used != expected)
+                    break;
+                ++expected;
+            }
+            ASSERT_EQ(index, expected);
+            allocated.insert(index);
+        }
+        else
+        {
+            auto it{ std::next(allocated.begin(), random() % allocated.size()) };
+            indices.Free(*it);
+            allocated.erase(it);
+        }
+
+        ASSERT_EQ(indices.AllocatedCount(), allocated.size());
+    }
+
+    for (uint32_t index = 0; index < CAPACITY; ++index)
+        ASSERT_EQ(indices.IsAllocated(index), allocated.contains(index));
+}
+
+// The shader visible heap's ring deals in descriptors, one unit each, and makes room by
+// waiting for OldestFence.
+TEST(DescriptorRing, ReclaimsTablesByFence)
+{
+    RingAllocator ring{ 16 };
+
+    EXPECT_EQ(ring.OldestFence(), 0u);
+    EXPECT_EQ(ring.Allocate(6, 1), 0u);
+    ring.FinishFrame(1);
+    EXPECT_EQ(ring.Allocate(6, 1), 6u);
+    ring.FinishFrame(2);
+    EXPECT_EQ(ring.OldestFence(), 1u);
+
+    // Four left at the end, a table of five has to wait for frame 1.
+    EXPECT_EQ(ring.Allocate(5, 1), RingAllocator::INVALID_OFFSET);
+    ring.Retire(ring.OldestFence());
+    EXPECT_EQ(ring.OldestFence(), 2u);
+    EXPECT_EQ(ring.Allocate(5, 1), 0u);
+    ring.FinishFrame(3);
+
+    ring.Retire(3);
+    EXPECT_EQ(ring.OldestFence(), 0u);
+    EXPECT_EQ(ring.Allocate(17, 1), RingAllocator::INVALID_OFFSET) << "Bigger than the ring, waiting won't help.";
+}
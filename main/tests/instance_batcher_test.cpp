@@ -0,0 +1,117 @@
+#include "instance_batcher.hpp"
+#include "job_system.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+    class InstanceBatcherTest : public testing::Test
+    {
+    protected:
+        // Sorted the way the scene sorts them before grouping.
+        void Group(std::vector<RenderPacket> packets)
+        {
+            SortRenderPackets(packets, scratch, jobSystem);
+            sorted = packets;
+            batcher.Group(sorted);
+        }
+
+        // The objects of batch's instances, as WriteInstances lays them out.
+        std::vector<uint32_t> Objects(const InstanceBatch& batch)
+        {
+            std::vector<InstanceData> instances(batcher.InstanceCount());
+            batcher.WriteInstances(sorted, instances.data(), jobSystem);
+
+            std::vector<uint32_t> objects;
+            for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; ++i)
+                objects.push_back(instances[i].object);
+            return objects;
+        }
+
+        JobSystem jobSystem{ 2 };
+        InstanceBatcher batcher;
+        std::vector<RenderPacket> sorted;
+        std::vector<RenderPacket> scratch;
+    };
+}
+
+TEST_F(InstanceBatcherTest, SameStateIsOneBatch)
+{
+    // Same pipeline, material, mesh and LOD at different depths, from different objects.
+    Group({
+        { SortKey::Opaque(PACKET_PASS_SCENE, 3, 7, 11, 1, 40.0f), 5, 100 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 3, 7, 11, 1, 2.0f), 5, 101 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 3, 7, 11, 1, 9.0f), 5, 102 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 3, 7, 11, 1, 9.0f), 5, 103 },
+    });
+
+    ASSERT_EQ(batcher.Batches().size(), 1u);
+    const InstanceBatch& batch{ batcher.Batches()[0] };
+    EXPECT_EQ(batch.drawItem, 5u);
+    EXPECT_EQ(batch.firstInstance, 0u);
+    EXPECT_EQ(batch.instanceCount, 4u);
+    EXPECT_EQ(batcher.InstanceCount(), 4u);
+
+    // Front to back within the batch, equal depths in emission order.
+    EXPECT_EQ(Objects(batch), (std::vector<uint32_t>{ 101, 102, 103, 100 }));
+}
+
+TEST_F(InstanceBatcherTest, DifferentStateSplitsBatches)
+{
+    // Two of each state, one field changed at a time.
+    Group({
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 0, 0, 1.0f), 0, 10 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 1, 0, 1.0f), 1, 20 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 1, 0, 0, 1.0f), 2, 30 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 1, 0, 0, 0, 1.0f), 3, 40 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 0, 1, 1.0f), 4, 50 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 1, 0, 0, 0, 2.0f), 3, 41 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 1, 0, 0, 2.0f), 2, 31 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 1, 0, 2.0f), 1, 21 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 0, 0, 2.0f), 0, 11 },
+        { SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 0, 1, 2.0f), 4, 51 },
+    });
+
+    // In key order: mesh 0 LOD 0, mesh 0 LOD 1, mesh 1, material 1, pipeline 1.
+    std::span<const InstanceBatch> batches{ batcher.Batches() };
+    ASSERT_EQ(batches.size(), 5u);
+    const uint32_t drawItems[]{ 0, 4, 1, 2, 3 };
+    for (uint32_t i = 0; i < batches.size(); ++i)
+    {
+        EXPECT_EQ(batches[i].drawItem, drawItems[i]);
+        EXPECT_EQ(batches[i].firstInstance, i * 2);
+        EXPECT_EQ(batches[i].instanceCount, 2u);
+        uint32_t object{ drawItems[i] * 10 + 10 };
+        EXPECT_EQ(Objects(batches[i]), (std::vector<uint32_t>{ object, object + 1 })) << "batch " << i;
+    }
+}
+
+TEST_F(InstanceBatcherTest, BatchesCoverEveryInstance)
+{
+    // Batches spanning the chunks WriteInstances splits into.
+    constexpr uint32_t COUNT = 3 * InstanceBatcher::CHUNK_SIZE + 123;
+    std::vector<RenderPacket> packets;
+    for (uint32_t i = 0; i < COUNT; ++i)
+        packets.push_back({ SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, i % 3, 0, static_cast<float>(i)), i % 3, i });
+    Group(packets);
+
+    std::span<const InstanceBatch> batches{ batcher.Batches() };
+    ASSERT_EQ(batches.size(), 3u);
+    uint32_t firstInstance{ 0 };
+    for (uint32_t mesh = 0; mesh < 3; ++mesh)
+    {
+        EXPECT_EQ(batches[mesh].firstInstance, firstInstance);
+        std::vector<uint32_t> expected;
+        for (uint32_t object = mesh; object < COUNT; object += 3)
+            expected.push_back(object);
+        EXPECT_EQ(Objects(batches[mesh]), expected) << "mesh " << mesh;
+        firstInstance += batches[mesh].instanceCount;
+    }
+    EXPECT_EQ(firstInstance, COUNT);
+
+    Group({});
+    EXPECT_TRUE(batcher.Batches().empty());
+    EXPECT_EQ(batcher.InstanceCount(), 0u);
+}
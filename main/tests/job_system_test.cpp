@@ -0,0 +1,231 @@
+#include "job_system.hpp"
+#include "work_stealing_deque.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    thread_local bool insideWait{ false };
+}
+#include <vector>
+
+// The owner pushes and pops while thieves steal. Every item has to come out exactly once,
+// including the last-item race between Pop and Steal.
+TEST(WorkStealingDeque, EveryItemIsTakenOnce)
+{
+    constexpr uint32_t ITEM_COUNT = 200000;
+    constexpr uint32_t THIEF_COUNT = 3;
+
+    std::vector<uint32_t> items(ITEM_COUNT);
+    std::vector<std::atomic<uint32_t>> taken(ITEM_COUNT);
+    WorkStealingDeque<uint32_t> deque{ 256 };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> thieves;
+    for (uint32_t t = 0; t < THIEF_COUNT; ++t)
+    {
+        thieves.emplace_back([&]()
+        {
+            while (!done.load(std::memory_order_acquire) || !deque.Empty())
+            {
+                if (uint32_t* item{ deque.Steal() })
+                    taken[*item].fetch_add(1, std::memory_order_relaxed);
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < ITEM_COUNT; ++i)
+    {
+        items[i] = i;
+        while (!deque.Push(&items[i]))
+        {
+            if (uint32_t* item{ deque.Pop() })
+                taken[*item].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Pop every so often so the owner competes for the bottom as well.
+        if (i % 3 == 0)
+        {
+            if (uint32_t* item{ deque.Pop() })
+                taken[*item].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    while (uint32_t* item{ deque.Pop() })
+        taken[*item].fetch_add(1, std::memory_order_relaxed);
+
+    done.store(true, std::memory_order_release);
+    for (std::thread& thief : thieves)
+        thief.join();
+
+    for (uint32_t i = 0; i < ITEM_COUNT; ++i)
+        ASSERT_EQ(taken[i].load(), 1u) << "item " << i;
+}
+
+TEST(WorkStealingDeque, PushFailsWhenFull)
+{
+    uint32_t item{ 0 };
+    WorkStealingDeque<uint32_t> deque{ 4 };
+
+    for (uint32_t i = 0; i < 4; ++i)
+        EXPECT_TRUE(deque.Push(&item));
+    EXPECT_FALSE(deque.Push(&item));
+    EXPECT_EQ(deque.Steal(), &item);
+    EXPECT_TRUE(deque.Push(&item));
+}
+
+TEST(JobSystem, ParallelForVisitsEveryIndexOnce)
+{
+    JobSystem jobSystem{ 4 };
+
+    for (uint32_t grain : { 1u, 7u, 64u, 5000u })
+    {
+        std::vector<std::atomic<uint32_t>> visits(5000);
+        jobSystem.ParallelFor(5000, grain, [&](uint32_t i) { visits[i].fetch_add(1, std::memory_order_relaxed); });
+
+        for (uint32_t i = 0; i < visits.size(); ++i)
+            ASSERT_EQ(visits[i].load(), 1u) << "grain " << grain << " index " << i;
+    }
+}
+
+TEST(JobSystem, NestedParallelForsFinish)
+{
+    JobSystem jobSystem{ 4 };
+    std::atomic<uint32_t> sum{ 0 };
+
+    // Jobs that wait on jobs, the waiting workers have to keep running others meanwhile.
+    jobSystem.ParallelFor(64, 1, [&](uint32_t)
+    {
+        jobSystem.ParallelFor(64, 1, [&](uint32_t)
+        {
+            jobSystem.ParallelFor(8, 1, [&](uint32_t) { sum.fetch_add(1, std::memory_order_relaxed); });
+        });
+    });
+
+    EXPECT_EQ(sum.load(), 64u * 64u * 8u);
+}
+
+TEST(JobSystem, TakesJobsFromOtherThreads)
+{
+    constexpr uint32_t THREAD_COUNT = 4;
+    constexpr uint32_t JOBS_PER_THREAD = 2000;
+
+    JobSystem jobSystem{ 3 };
+    std::atomic<uint32_t> ran{ 0 };
+
+    // Threads that aren't workers go through the shared queue and help out while waiting.
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREAD_COUNT; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            JobCounter counter;
+            for (uint32_t i = 0; i < JOBS_PER_THREAD; ++i)
+                jobSystem.Schedule([&] { ran.fetch_add(1, std::memory_order_relaxed); }, counter);
+            jobSystem.Wait(counter);
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(ran.load(), THREAD_COUNT * JOBS_PER_THREAD);
+}
+
+TEST(JobSystem, WakesSleepingWorkers)
+{
+    JobSystem jobSystem{ 4 };
+
+    // Long enough idle for every worker to have gone to sleep, then jobs only a woken worker
+    // can finish: each one blocks until the next has started on another thread.
+    for (uint32_t round = 0; round < 20; ++round)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+        std::atomic<uint32_t> started{ 0 };
+        JobCounter counter;
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            jobSystem.Schedule([&]
+            {
+                started.fetch_add(1, std::memory_order_relaxed);
+                while (started.load(std::memory_order_relaxed) < 2)
+                    std::this_thread::yield();
+            }, counter);
+        }
+
+        // The main thread doesn't help, only workers woken by Schedule can make progress.
+        while (!counter.IsDone())
+            std::this_thread::yield();
+    }
+}
+
+TEST(JobSystem, ScheduleStress)
+{
+    JobSystem jobSystem{ 4 };
+    std::atomic<uint64_t> sum{ 0 };
+
+    // Jobs scheduling jobs, enough of them to overflow a deque and run inline.
+    JobCounter counter;
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        jobSystem.Schedule([&, i]
+        {
+            JobCounter inner;
+            for (uint32_t j = 0; j < JobSystem::DEQUE_CAPACITY + 100; ++j)
+                jobSystem.Schedule([&, j] { sum.fetch_add(j, std::memory_order_relaxed); }, inner);
+            jobSystem.Wait(inner);
+            sum.fetch_add(i, std::memory_order_relaxed);
+        }, counter);
+    }
+    jobSystem.Wait(counter);
+
+    uint64_t perJob{ (JobSystem::DEQUE_CAPACITY + 100ull) * (JobSystem::DEQUE_CAPACITY + 99ull) / 2 };
+    EXPECT_EQ(sum.load(), 100 * perJob + 99 * 100 / 2);
+}
+
+TEST(JobSystem, WaitDoesntPickUpBackgroundJobs)
+{
+    JobSystem jobSystem{ 2 };
+    std::atomic<bool> outerStarted{ false };
+    std::atomic<bool> innerStarted{ false };
+    std::atomic<bool> ranInsideWait{ false };
+    JobCounter background;
+
+    // The outer job runs on worker 1 and waits for an inner job the main thread takes, with a
+    // background job queued meanwhile. Worker 1 has nothing else to do while waiting, but the
+    // background job has to wait until the outer job is done.
+    JobCounter outer;
+    jobSystem.Schedule([&]
+    {
+        outerStarted = true;
+
+        JobCounter inner;
+        jobSystem.Schedule([&]
+        {
+            innerStarted = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }, inner);
+        jobSystem.ScheduleBackground([&] { ranInsideWait = insideWait; }, background);
+
+        while (!innerStarted)
+            std::this_thread::yield();
+
+        insideWait = true;
+        jobSystem.Wait(inner);
+        insideWait = false;
+    }, outer);
+
+    // Only worker 1 can start the outer job, the main thread only runs jobs while waiting.
+    while (!outerStarted)
+        std::this_thread::yield();
+    jobSystem.Wait(outer);
+
+    while (!background.IsDone())
+        std::this_thread::yield();
+    EXPECT_FALSE(ranInsideWait.load());
+}
@@ -0,0 +1,88 @@
+#include "lod_selection.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace
+{
+    // Level errors in mesh units for a unit radius object on a 1000 pixel viewport, so a
+    // screen size of s puts level n at ERRORS[n] * s * 1000 pixels.
+    constexpr float ERRORS[] = { 0.0f, 0.01f, 0.02f, 0.04f };
+    constexpr float VIEWPORT_HEIGHT = 1000.0f;
+
+    // Screen size at which level's error comes to pixels on screen.
+    float ScreenSizeFor(uint32_t level, float pixels)
+    {
+        return pixels / (ERRORS[level] * VIEWPORT_HEIGHT);
+    }
+
+    uint32_t Select(float screenSize, uint32_t current)
+    {
+        return LodSelection::Select(ERRORS, 1.0f, screenSize, VIEWPORT_HEIGHT, current);
+    }
+}
+
+TEST(LodSelection, NeedsLevelsAndASize)
+{
+    EXPECT_EQ(LodSelection::Select(std::span<const float>{ ERRORS, 1 }, 1.0f, 0.001f, VIEWPORT_HEIGHT, 0), 0u);
+    EXPECT_EQ(LodSelection::Select(ERRORS, 0.0f, 0.001f, VIEWPORT_HEIGHT, 2), 0u);
+}
+
+TEST(LodSelection, StaysFullWhenEveryLevelShows)
+{
+    EXPECT_EQ(Select(ScreenSizeFor(1, 1.5f), 0), 0u);
+    EXPECT_EQ(Select(ScreenSizeFor(1, 1.5f), 3), 0u);
+}
+
+TEST(LodSelection, GoesCoarserOnlyPastTheHysteresis)
+{
+    // Level 2 at 0.9 pixels is under PIXEL_ERROR but not under the 0.75 the hysteresis asks
+    // for, so whatever is showing stays.
+    float screenSize{ ScreenSizeFor(2, 0.9f) };
+    EXPECT_EQ(Select(screenSize, 1), 1u);
+    EXPECT_EQ(Select(screenSize, 2), 2u);
+
+    // A fresh object only gets as coarse as the tighter threshold allows.
+    EXPECT_EQ(Select(screenSize, 0), 1u);
+
+    EXPECT_EQ(Select(ScreenSizeFor(2, 0.7f), 1), 2u);
+}
+
+TEST(LodSelection, GoesFinerRightAway)
+{
+    // Too coarse is visible, no hysteresis on the way back.
+    EXPECT_EQ(Select(ScreenSizeFor(2, 1.1f), 2), 1u);
+    EXPECT_EQ(Select(ScreenSizeFor(1, 1.1f), 3), 0u);
+}
+
+TEST(LodSelection, DoesntFlipAroundAThreshold)
+{
+    // Jitter of a few percent around where level 2 crosses PIXEL_ERROR, like a camera
+    // bobbing. Once it has settled coarser it must stay.
+    uint32_t current{ Select(ScreenSizeFor(2, 0.5f), 0) };
+    ASSERT_EQ(current, 2u);
+
+    uint32_t changes{ 0 };
+    for (uint32_t frame = 0; frame < 200; ++frame)
+    {
+        float pixels{ 0.95f + 0.04f * std::sin(frame * 0.7f) };
+        uint32_t next{ Select(ScreenSizeFor(2, pixels), current) };
+        changes += next != current;
+        current = next;
+    }
+    EXPECT_EQ(changes, 0u);
+    EXPECT_EQ(current, 2u);
+
+    // Coming closer past the threshold switches once, and bobbing under it doesn't switch back.
+    current = Select(ScreenSizeFor(2, 1.05f), current);
+    EXPECT_EQ(current, 1u);
+    for (uint32_t frame = 0; frame < 200; ++frame)
+        ASSERT_EQ(Select(ScreenSizeFor(2, 0.95f + 0.04f * std::sin(frame * 0.7f)), current), 1u);
+}
+
+TEST(LodSelection, ScreenSizeCoversTheScreenInside)
+{
+    EXPECT_FLOAT_EQ(LodSelection::ScreenSize(1.0f, 10.0f, 2.0f), 0.1f);
+    EXPECT_FLOAT_EQ(LodSelection::ScreenSize(1.0f, 0.5f, 2.0f), 1.0f);
+}
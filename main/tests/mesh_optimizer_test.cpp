@@ -0,0 +1,120 @@
+#include "job_system.hpp"
+#include "mesh_data.hpp"
+#include "mesh_optimizer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // A side x side grid with its triangles shuffled and every corner a vertex of its own.
+    MeshData UnweldedGrid(uint32_t side)
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t y = 0; y + 1 < side; ++y)
+        {
+            for (uint32_t x = 0; x + 1 < side; ++x)
+            {
+                uint32_t i{ y * side + x };
+                triangles.push_back({ i, i + 1, i + side + 1 });
+                triangles.push_back({ i, i + side + 1, i + side });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937{ side });
+
+        MeshData mesh;
+        for (const std::array<uint32_t, 3>& triangle : triangles)
+        {
+            for (uint32_t corner : triangle)
+            {
+                float u{ static_cast<float>(corner % side) };
+                float v{ static_cast<float>(corner / side) };
+                mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+                mesh.vertices.push_back({ { u, 0.0f, v }, { u, v }, { u, v } });
+                mesh.extraVertices.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+            }
+        }
+
+        CookedSubmesh submesh;
+        submesh.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        mesh.submeshes.push_back(std::move(submesh));
+        return mesh;
+    }
+
+    // Every triangle as its corner positions, rotated to start at the smallest so the
+    // winding is kept but the starting corner doesn't matter, then sorted.
+    std::vector<std::array<float, 9>> Triangles(const MeshData& mesh)
+    {
+        std::vector<std::array<float, 9>> triangles;
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            std::array<std::array<float, 3>, 3> corners;
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const float* position{ mesh.vertices[mesh.indices[i + c]].position };
+                corners[c] = { position[0], position[1], position[2] };
+            }
+            std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+            std::array<float, 9> triangle;
+            for (uint32_t c = 0; c < 3; ++c)
+                std::copy(corners[c].begin(), corners[c].end(), triangle.begin() + c * 3);
+            triangles.push_back(triangle);
+        }
+
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+TEST(MeshOptimizer, WeldsEveryDuplicate)
+{
+    constexpr uint32_t SIDE = 40;
+    MeshData mesh{ UnweldedGrid(SIDE) };
+    std::vector<std::array<float, 9>> before{ Triangles(mesh) };
+
+    MeshOptimizer::WeldVertices(mesh);
+    EXPECT_EQ(mesh.vertices.size(), SIDE * SIDE);
+    EXPECT_EQ(mesh.extraVertices.size(), SIDE * SIDE);
+    EXPECT_EQ(Triangles(mesh), before);
+}
+
+TEST(MeshOptimizer, KeepsDifferentVerticesApart)
+{
+    MeshData mesh{ UnweldedGrid(4) };
+    mesh.extraVertices[mesh.indices[0]].color[0] = 0.5f;
+
+    MeshOptimizer::WeldVertices(mesh);
+    EXPECT_EQ(mesh.vertices.size(), 17u);
+}
+
+TEST(MeshOptimizer, OptimizeKeepsTheTrianglesAndReusesTheCache)
+{
+    constexpr uint32_t SIDE = 64;
+    MeshData mesh{ UnweldedGrid(SIDE) };
+    std::vector<std::array<float, 9>> before{ Triangles(mesh) };
+    EXPECT_EQ(MeshOptimizer::AnalyzeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size())).acmr, 3.0f);
+
+    JobSystem jobSystem{ 2 };
+    MeshOptimizer::Optimize(mesh, jobSystem);
+    EXPECT_EQ(Triangles(mesh), before);
+    ASSERT_EQ(mesh.vertices.size(), SIDE * SIDE);
+
+    // A grid can't do better than 0.5, the pipeline gets close to the 0.7 Forsyth reaches
+    // with a 16 entry FIFO. The fetch pass leaves every vertex in first use order.
+    VertexCacheStatistics statistics{ MeshOptimizer::AnalyzeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size())) };
+    EXPECT_LT(statistics.acmr, 0.8f);
+    EXPECT_LT(statistics.atvr, 1.5f);
+
+    uint32_t next{ 0 };
+    for (uint32_t index : mesh.indices)
+    {
+        ASSERT_LE(index, next);
+        if (index == next)
+            ++next;
+    }
+}
@@ -0,0 +1,217 @@
+#include "meshlet_builder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using Triangle = std::array<uint32_t, 3>;
+
+    struct Mesh
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // A side by side grid of quads with heights from height(x, z), two triangles each.
+    template <typename Height>
+    Mesh Heightfield(uint32_t side, const Height& height)
+    {
+        Mesh mesh;
+        for (uint32_t z = 0; z <= side; ++z)
+        {
+            for (uint32_t x = 0; x <= side; ++x)
+                mesh.vertices.push_back({ { static_cast<float>(x), height(static_cast<float>(x), static_cast<float>(z)), static_cast<float>(z) } });
+        }
+        for (uint32_t z = 0; z < side; ++z)
+        {
+            for (uint32_t x = 0; x < side; ++x)
+            {
+                uint32_t a{ z * (side + 1) + x };
+                uint32_t b{ a + side + 1 };
+                mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    // A V shaped trough along z, both walls facing into the V: the left wall's normals point
+    // up and right, the right wall's up and left. Concave, so the cone apex has to go down
+    // to the bottom of the V to be behind both walls.
+    Mesh Trough(uint32_t segments)
+    {
+        Mesh mesh;
+        for (uint32_t z = 0; z <= segments; ++z)
+        {
+            float depth{ static_cast<float>(z) };
+            mesh.vertices.push_back({ { -1.0f, 1.0f, depth } });
+            mesh.vertices.push_back({ { 0.0f, 0.0f, depth } });
+            mesh.vertices.push_back({ { 1.0f, 1.0f, depth } });
+        }
+        for (uint32_t z = 0; z < segments; ++z)
+        {
+            uint32_t left{ z * 3 };
+            uint32_t bottom{ left + 1 };
+            uint32_t right{ left + 2 };
+            mesh.indices.insert(mesh.indices.end(), { left, left + 3, bottom, bottom, left + 3, bottom + 3 });
+            mesh.indices.insert(mesh.indices.end(), { bottom, bottom + 3, right, right, bottom + 3, right + 3 });
+        }
+        return mesh;
+    }
+
+    // Rotated to start at the smallest index, which keeps the winding.
+    Triangle Canonical(Triangle triangle)
+    {
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        return triangle;
+    }
+
+    Triangle MeshletTriangle(const MeshletData& data, const Meshlet& meshlet, uint32_t triangle)
+    {
+        const uint8_t* corners{ &data.triangles[(meshlet.triangleOffset + triangle) * 3] };
+        return { data.vertices[meshlet.vertexOffset + corners[0]], data.vertices[meshlet.vertexOffset + corners[1]],
+                 data.vertices[meshlet.vertexOffset + corners[2]] };
+    }
+
+    // Distance of point in front of the triangle's plane, in units of the unnormalized normal.
+    float FrontDistance(const Mesh& mesh, const Triangle& triangle, const float point[3])
+    {
+        const float* p0{ mesh.vertices[triangle[0]].position };
+        const float* p1{ mesh.vertices[triangle[1]].position };
+        const float* p2{ mesh.vertices[triangle[2]].position };
+        float e0[3]{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e1[3]{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float normal[3]{ e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+        return normal[0] * (point[0] - p0[0]) + normal[1] * (point[1] - p0[1]) + normal[2] * (point[2] - p0[2]);
+    }
+
+    // Every meshlet the cone culls from point must only hold triangles facing away from it.
+    void ExpectConesOnlyCullBackfaces(const Mesh& mesh, const MeshletData& data, const float point[3])
+    {
+        for (size_t i = 0; i < data.meshlets.size(); ++i)
+        {
+            if (!MeshletBuilder::IsBackfacing(data.bounds[i], point))
+                continue;
+
+            const Meshlet& meshlet{ data.meshlets[i] };
+            for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+            {
+                ASSERT_LE(FrontDistance(mesh, MeshletTriangle(data, meshlet, triangle), point), 1e-4f)
+                    << "meshlet " << i << " culled from " << point[0] << ", " << point[1] << ", " << point[2];
+            }
+        }
+    }
+}
+
+TEST(MeshletBuilder, StaysInTheLimitsAndEmitsEveryTriangleOnce)
+{
+    Mesh mesh{ Heightfield(40, [](float x, float z) { return std::sin(x * 0.3f) * std::cos(z * 0.2f) * 3.0f; }) };
+
+    struct Limits
+    {
+        uint32_t vertices;
+        uint32_t triangles;
+    };
+    for (Limits limits : { Limits{ MeshletBuilder::MAX_VERTICES, MeshletBuilder::MAX_TRIANGLES }, Limits{ 16, 20 }, Limits{ 3, 1 }, Limits{ 256, 512 } })
+    {
+        MeshletData data{ MeshletBuilder::Build(mesh.indices, mesh.vertices, limits.vertices, limits.triangles) };
+        ASSERT_EQ(data.bounds.size(), data.meshlets.size());
+
+        std::vector<Triangle> expected;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+            expected.push_back(Canonical({ mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] }));
+
+        std::vector<Triangle> emitted;
+        for (const Meshlet& meshlet : data.meshlets)
+        {
+            EXPECT_GT(meshlet.triangleCount, 0u);
+            EXPECT_LE(meshlet.vertexCount, limits.vertices);
+            EXPECT_LE(meshlet.triangleCount, limits.triangles);
+            ASSERT_LE(meshlet.vertexOffset + meshlet.vertexCount, data.vertices.size());
+            ASSERT_LE((meshlet.triangleOffset + meshlet.triangleCount) * 3, data.triangles.size());
+            for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+                ASSERT_LT(data.triangles[meshlet.triangleOffset * 3 + i], meshlet.vertexCount);
+
+            for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+                emitted.push_back(Canonical(MeshletTriangle(data, meshlet, triangle)));
+        }
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(emitted.begin(), emitted.end());
+        EXPECT_EQ(emitted, expected) << "limits " << limits.vertices << ", " << limits.triangles;
+    }
+}
+
+TEST(MeshletBuilder, SpheresHoldEveryVertex)
+{
+    Mesh mesh{ Heightfield(30, [](float x, float z) { return std::sin(x * 0.7f) * std::sin(z * 0.5f) * 4.0f; }) };
+    MeshletData data{ MeshletBuilder::Build(mesh.indices, mesh.vertices) };
+    ASSERT_GT(data.meshlets.size(), 1u);
+
+    for (size_t i = 0; i < data.meshlets.size(); ++i)
+    {
+        const Meshlet& meshlet{ data.meshlets[i] };
+        const MeshletBounds& bounds{ data.bounds[i] };
+        for (uint32_t vertex = 0; vertex < meshlet.vertexCount; ++vertex)
+        {
+            const float* position{ mesh.vertices[data.vertices[meshlet.vertexOffset + vertex]].position };
+            float offset[3]{ position[0] - bounds.center[0], position[1] - bounds.center[1], position[2] - bounds.center[2] };
+            float distance{ std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]) };
+            EXPECT_LE(distance, bounds.radius * (1.0f + 1e-5f)) << "meshlet " << i << " vertex " << vertex;
+        }
+    }
+}
+
+TEST(MeshletBuilder, ConeDoesntCullInsideAConcaveCluster)
+{
+    Mesh mesh{ Trough(4) };
+    MeshletData data{ MeshletBuilder::Build(mesh.indices, mesh.vertices) };
+    ASSERT_EQ(data.meshlets.size(), 1u);
+    const MeshletBounds& bounds{ data.bounds[0] };
+
+    // Walls 45 degrees off the axis, narrow enough for a real cone.
+    ASSERT_LT(bounds.coneCutoff, 1.0f);
+    EXPECT_NEAR(bounds.coneApex[1], 0.0f, 1e-5f);
+
+    // Inside the V, below the cluster's center, both walls face the eye.
+    const float inside[3]{ 0.0f, 0.2f, 2.0f };
+    EXPECT_FALSE(MeshletBuilder::IsBackfacing(bounds, inside));
+
+    // Under the V sees both walls from behind.
+    const float below[3]{ 0.0f, -5.0f, 2.0f };
+    EXPECT_TRUE(MeshletBuilder::IsBackfacing(bounds, below));
+
+    std::mt19937 random{ 17 };
+    std::uniform_real_distribution<float> coordinate{ -4.0f, 6.0f };
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        const float point[3]{ coordinate(random), coordinate(random), coordinate(random) };
+        ExpectConesOnlyCullBackfaces(mesh, data, point);
+    }
+}
+
+TEST(MeshletBuilder, ConesOnlyCullBackfaces)
+{
+    // Hills and valleys, so clusters come out convex and concave.
+    Mesh mesh{ Heightfield(40, [](float x, float z) { return std::sin(x * 0.4f) * std::cos(z * 0.3f) * 2.0f; }) };
+    MeshletData data{ MeshletBuilder::Build(mesh.indices, mesh.vertices) };
+
+    uint32_t narrowCones{ 0 };
+    for (const MeshletBounds& bounds : data.bounds)
+        narrowCones += bounds.coneCutoff < 1.0f;
+    ASSERT_GT(narrowCones, 0u);
+
+    std::mt19937 random{ 23 };
+    std::uniform_real_distribution<float> horizontal{ -10.0f, 50.0f };
+    std::uniform_real_distribution<float> vertical{ -20.0f, 20.0f };
+    for (uint32_t i = 0; i < 500; ++i)
+    {
+        const float point[3]{ horizontal(random), vertical(random), horizontal(random) };
+        ExpectConesOnlyCullBackfaces(mesh, data, point);
+    }
+}
@@ -0,0 +1,148 @@
+#include "object_slots.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using DirtyRun = std::pair<uint32_t, uint32_t>;
+
+    class ObjectSlotsTest : public testing::Test
+    {
+    protected:
+        // Runs written by a flush of copy, in slot order whatever order the jobs ran in.
+        std::vector<DirtyRun> Flush(ObjectSlots& slots, uint32_t copy, uint32_t* written = nullptr)
+        {
+            std::vector<DirtyRun> runs;
+            std::mutex mutex;
+            uint32_t count{ slots.Flush(copy, jobSystem, [&](uint32_t firstSlot, uint32_t count)
+            {
+                std::lock_guard lock{ mutex };
+                runs.push_back({ firstSlot, count });
+            }) };
+            if (written)
+                *written = count;
+            std::sort(runs.begin(), runs.end());
+            return runs;
+        }
+
+        static std::vector<uint32_t> Expand(const std::vector<DirtyRun>& runs)
+        {
+            std::vector<uint32_t> slots;
+            for (auto [first, count] : runs)
+            {
+                for (uint32_t slot = first; slot < first + count; ++slot)
+                    slots.push_back(slot);
+            }
+            return slots;
+        }
+
+        static void Allocate(ObjectSlots& slots, uint32_t count)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+                slots.Allocate();
+        }
+
+        JobSystem jobSystem{ 2 };
+    };
+}
+
+TEST_F(ObjectSlotsTest, NewSlotsAreDirtyInEveryCopyOnce)
+{
+    ObjectSlots slots{ 2 };
+    Allocate(slots, 200);
+
+    uint32_t written;
+    EXPECT_EQ(Expand(Flush(slots, 0, &written)).size(), 200u);
+    EXPECT_EQ(written, 200u);
+    EXPECT_TRUE(Flush(slots, 0).empty());
+
+    // The other copy hasn't been written yet.
+    EXPECT_EQ(Expand(Flush(slots, 1)).size(), 200u);
+    EXPECT_TRUE(Flush(slots, 1).empty());
+}
+
+TEST_F(ObjectSlotsTest, HandsOutEveryRunOfDirtySlots)
+{
+    ObjectSlots slots{ 1 };
+    Allocate(slots, 256);
+    Flush(slots, 0);
+
+    for (uint32_t slot : { 3u, 4u, 5u, 6u, 10u, 62u, 66u, 67u })
+        slots.MarkDirty(slot);
+    // A whole word and the very last bit of one.
+    for (uint32_t slot = 128; slot < 192; ++slot)
+        slots.MarkDirty(slot);
+    slots.MarkDirty(255);
+    // Dirty twice is written once.
+    slots.MarkDirty(10);
+
+    uint32_t written;
+    EXPECT_EQ(Flush(slots, 0, &written), (std::vector<DirtyRun>{ { 3, 4 }, { 10, 1 }, { 62, 1 }, { 66, 2 }, { 128, 64 }, { 255, 1 } }));
+    EXPECT_EQ(written, 73u);
+}
+
+TEST_F(ObjectSlotsTest, RunsAcrossWordsCoverEverySlotOnce)
+{
+    ObjectSlots slots{ 1 };
+    Allocate(slots, 256);
+    Flush(slots, 0);
+
+    // Runs may split at word boundaries, but together they're exactly the dirty slots.
+    for (uint32_t slot = 60; slot < 140; ++slot)
+        slots.MarkDirty(slot);
+
+    std::vector<uint32_t> expected;
+    for (uint32_t slot = 60; slot < 140; ++slot)
+        expected.push_back(slot);
+    EXPECT_EQ(Expand(Flush(slots, 0)), expected);
+}
+
+TEST_F(ObjectSlotsTest, FreeSlotsStayClean)
+{
+    ObjectSlots slots{ 2 };
+    Allocate(slots, 70);
+    slots.Free(5);
+    slots.Free(65);
+    EXPECT_EQ(slots.AllocatedCount(), 68u);
+    EXPECT_EQ(Flush(slots, 0), (std::vector<DirtyRun>{ { 0, 5 }, { 6, 58 }, { 64, 1 }, { 66, 4 } }));
+
+    // A replaced copy gets everything written, except what's free and past the last slot.
+    slots.MarkAllDirty(0);
+    EXPECT_EQ(Flush(slots, 0), (std::vector<DirtyRun>{ { 0, 5 }, { 6, 58 }, { 64, 1 }, { 66, 4 } }));
+
+    // Reuse hands the slot back dirty in both copies.
+    EXPECT_EQ(slots.Allocate(), 65u);
+    EXPECT_EQ(Flush(slots, 0), (std::vector<DirtyRun>{ { 65, 1 } }));
+    EXPECT_EQ(Expand(Flush(slots, 1)).size(), 69u);
+}
+
+TEST_F(ObjectSlotsTest, ChunksFindEveryDirtySlot)
+{
+    // Several chunks and a partial last word.
+    constexpr uint32_t SLOT_COUNT = 3 * ObjectSlots::CHUNK_SIZE + 17;
+    ObjectSlots slots{ 1 };
+    Allocate(slots, SLOT_COUNT);
+    Flush(slots, 0);
+
+    std::mt19937 random{ 3 };
+    std::vector<uint32_t> expected;
+    for (uint32_t slot = 0; slot < SLOT_COUNT; ++slot)
+    {
+        // Some long runs and some scattered slots.
+        if (slot / 500 % 3 == 0 || random() % 7 == 0)
+        {
+            slots.MarkDirty(slot);
+            expected.push_back(slot);
+        }
+    }
+
+    uint32_t written;
+    EXPECT_EQ(Expand(Flush(slots, 0, &written)), expected);
+    EXPECT_EQ(written, expected.size());
+}
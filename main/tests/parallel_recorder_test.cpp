@@ -0,0 +1,84 @@
+#include "parallel_recorder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+    // The ranges cover [0, drawCount) in order without gaps or overlap, sizes differing by
+    // one at most and the larger ones first.
+    void ExpectCovers(const std::vector<DrawRange>& ranges, uint32_t drawCount)
+    {
+        uint32_t end{ 0 };
+        for (const DrawRange& range : ranges)
+        {
+            EXPECT_EQ(range.begin, end);
+            EXPECT_GT(range.Count(), 0u);
+            EXPECT_LE(range.Count(), ranges.front().Count());
+            EXPECT_GE(range.Count() + 1, ranges.front().Count());
+            end = range.end;
+        }
+        EXPECT_EQ(end, drawCount);
+    }
+}
+
+TEST(ParallelRecorderPartition, NoDrawsNoChunks)
+{
+    EXPECT_TRUE(ParallelRecorder::Partition(0, 8, 64).empty());
+    EXPECT_TRUE(ParallelRecorder::Partition(0, 0, 0).empty());
+}
+
+TEST(ParallelRecorderPartition, FewDrawsStayInOneChunk)
+{
+    // Under minDrawsPerChunk still gets recorded, in one chunk.
+    std::vector<DrawRange> ranges{ ParallelRecorder::Partition(10, 8, 64) };
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].begin, 0u);
+    EXPECT_EQ(ranges[0].end, 10u);
+
+    // Only as many chunks as have minDrawsPerChunk each.
+    ranges = ParallelRecorder::Partition(200, 8, 64);
+    EXPECT_EQ(ranges.size(), 3u);
+    ExpectCovers(ranges, 200);
+    for (const DrawRange& range : ranges)
+        EXPECT_GE(range.Count(), 64u);
+}
+
+TEST(ParallelRecorderPartition, AtMostMaxChunks)
+{
+    // No chunks allowed still records everything, in one.
+    std::vector<DrawRange> ranges{ ParallelRecorder::Partition(1000, 0, 64) };
+    ASSERT_EQ(ranges.size(), 1u);
+    ExpectCovers(ranges, 1000);
+
+    ranges = ParallelRecorder::Partition(1000, 1, 64);
+    ASSERT_EQ(ranges.size(), 1u);
+    ExpectCovers(ranges, 1000);
+
+    ranges = ParallelRecorder::Partition(100000, 6, 64);
+    EXPECT_EQ(ranges.size(), 6u);
+    ExpectCovers(ranges, 100000);
+
+    // A zero minimum is one draw per chunk at least.
+    ranges = ParallelRecorder::Partition(3, 8, 0);
+    EXPECT_EQ(ranges.size(), 3u);
+    ExpectCovers(ranges, 3);
+}
+
+TEST(ParallelRecorderPartition, SpreadsTheRemainderOverTheFirstChunks)
+{
+    // 1003 over 4 is 250 with 3 left over, the first three chunks take one each.
+    std::vector<DrawRange> ranges{ ParallelRecorder::Partition(1003, 4, 64) };
+    ASSERT_EQ(ranges.size(), 4u);
+    const uint32_t counts[]{ 251, 251, 251, 250 };
+    for (uint32_t i = 0; i < 4; ++i)
+        EXPECT_EQ(ranges[i].Count(), counts[i]) << "chunk " << i;
+    ExpectCovers(ranges, 1003);
+
+    for (uint32_t drawCount : { 1u, 63u, 64u, 65u, 128u, 129u, 511u, 4097u, 20000u })
+    {
+        for (uint32_t maxChunks : { 1u, 2u, 3u, 7u, 16u })
+            ExpectCovers(ParallelRecorder::Partition(drawCount, maxChunks, 64), drawCount);
+    }
+}
@@ -0,0 +1,85 @@
+#include "pipeline_index.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace
+{
+    PipelineIndex MakeIndex(uint32_t pipelineCount, uint32_t seed)
+    {
+        std::mt19937_64 random{ seed };
+        PipelineIndex index;
+        index.deviceFingerprint = random();
+        index.libraryHash = random();
+        index.librarySize = random() % (1 << 30);
+        for (uint32_t i = 0; i < pipelineCount; ++i)
+            index.pipelines.insert(random());
+        return index;
+    }
+}
+
+TEST(PipelineIndex, RoundTrips)
+{
+    for (uint32_t count : { 0u, 1u, 7u, 1000u })
+    {
+        PipelineIndex index{ MakeIndex(count, count) };
+        std::vector<uint8_t> data{ index.Serialize() };
+        EXPECT_EQ(data.size(), 36 + count * sizeof(uint64_t));
+
+        std::optional<PipelineIndex> read{ PipelineIndex::Deserialize(data) };
+        ASSERT_TRUE(read) << count << " pipelines";
+        EXPECT_EQ(read->deviceFingerprint, index.deviceFingerprint);
+        EXPECT_EQ(read->libraryHash, index.libraryHash);
+        EXPECT_EQ(read->librarySize, index.librarySize);
+        EXPECT_EQ(read->pipelines, index.pipelines);
+    }
+}
+
+TEST(PipelineIndex, SameSetGivesTheSameBytes)
+{
+    PipelineIndex index{ MakeIndex(500, 3) };
+
+    // Same keys inserted in another order, the set iterates differently.
+    PipelineIndex reordered{ index };
+    reordered.pipelines.clear();
+    std::vector<uint64_t> keys{ index.pipelines.begin(), index.pipelines.end() };
+    for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+        reordered.pipelines.insert(*it);
+
+    EXPECT_EQ(index.Serialize(), reordered.Serialize());
+}
+
+TEST(PipelineIndex, RejectsOtherFiles)
+{
+    std::vector<uint8_t> data{ MakeIndex(10, 1).Serialize() };
+
+    std::vector<uint8_t> wrongMagic{ data };
+    wrongMagic[0] ^= 1;
+    EXPECT_FALSE(PipelineIndex::Deserialize(wrongMagic));
+
+    // Version follows the magic.
+    std::vector<uint8_t> wrongVersion{ data };
+    wrongVersion[4] = PipelineIndex::VERSION + 1;
+    EXPECT_FALSE(PipelineIndex::Deserialize(wrongVersion));
+
+    EXPECT_FALSE(PipelineIndex::Deserialize({}));
+}
+
+TEST(PipelineIndex, RejectsTruncatedAndOverlongData)
+{
+    std::vector<uint8_t> data{ MakeIndex(10, 2).Serialize() };
+
+    // Every truncation, inside the header as well as inside the key list.
+    for (size_t size = 0; size < data.size(); ++size)
+        EXPECT_FALSE(PipelineIndex::Deserialize({ data.data(), size })) << size << " bytes";
+
+    std::vector<uint8_t> trailing{ data };
+    trailing.push_back(0);
+    EXPECT_FALSE(PipelineIndex::Deserialize(trailing));
+
+    // A count that claims more keys than there are.
+    std::vector<uint8_t> overcounted{ data };
+    overcounted[32] = 11;
+    EXPECT_FALSE(PipelineIndex::Deserialize(overcounted));
+}
@@ -0,0 +1,396 @@
+#include "render_graph.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // The D3D12_RESOURCE_STATES bits the tests use.
+    enum State : uint32_t
+    {
+        COMMON = 0,
+        RENDER_TARGET = 0x4,
+        UNORDERED_ACCESS = 0x8,
+        DEPTH_WRITE = 0x10,
+        DEPTH_READ = 0x20,
+        NON_PIXEL_SHADER_RESOURCE = 0x40,
+        PIXEL_SHADER_RESOURCE = 0x80,
+        COPY_DEST = 0x400,
+        COPY_SOURCE = 0x800,
+    };
+
+    using Barrier = RenderGraph::Barrier;
+    using BarrierSplit = RenderGraph::BarrierSplit;
+
+    struct Access
+    {
+        RenderGraph::PassId pass;
+        RenderGraph::ResourceId resource;
+        uint32_t state;
+        bool write;
+    };
+
+    struct ResourceDesc
+    {
+        uint32_t initialState;
+        uint32_t finalState;
+        bool exported;
+    };
+
+    // Keeps what was fed into a graph so the compiled result can be checked against it.
+    struct Recorded
+    {
+        std::vector<ResourceDesc> resources;
+        std::vector<uint32_t> passFlags;
+        std::vector<Access> accesses;
+    };
+
+    // Replays the barriers and checks that every pass finds its resources in the states it
+    // asked for with no split transition still open, that split halves pair up on one
+    // command list and that everything ends in its final state.
+    void Validate(const RenderGraph::Compiled& compiled, const Recorded& recorded)
+    {
+        struct Tracked
+        {
+            uint32_t state;
+            bool splitOpen;
+            Barrier open;
+            uint32_t openList;
+        };
+
+        std::vector<Tracked> tracked;
+        for (const ResourceDesc& resource : recorded.resources)
+            tracked.push_back({ resource.initialState, false, {}, 0 });
+
+        ASSERT_EQ(compiled.BatchCount(), compiled.passes.size() + 1);
+
+        uint32_t commandList{ 0 };
+        for (uint32_t batch = 0; batch < compiled.BatchCount(); ++batch)
+        {
+            for (const Barrier& barrier : compiled.Batch(batch))
+            {
+                Tracked& resource{ tracked[barrier.resource] };
+                ASSERT_NE(barrier.before, barrier.after) << "Barrier that does nothing in batch " << batch;
+
+                switch (barrier.split)
+                {
+                case BarrierSplit::None:
+                    ASSERT_FALSE(resource.splitOpen);
+                    ASSERT_EQ(barrier.before, resource.state) << "batch " << batch;
+                    resource.state = barrier.after;
+                    break;
+                case BarrierSplit::Begin:
+                    ASSERT_FALSE(resource.splitOpen) << "Two splits open on resource " << barrier.resource;
+                    ASSERT_EQ(barrier.before, resource.state) << "batch " << batch;
+                    resource.splitOpen = true;
+                    resource.open = barrier;
+                    resource.openList = commandList;
+                    break;
+                case BarrierSplit::End:
+                    ASSERT_TRUE(resource.splitOpen) << "End without a begin on resource " << barrier.resource;
+                    ASSERT_EQ(barrier.before, resource.open.before);
+                    ASSERT_EQ(barrier.after, resource.open.after);
+                    ASSERT_EQ(commandList, resource.openList) << "Split barrier crosses command lists.";
+                    resource.splitOpen = false;
+                    resource.state = barrier.after;
+                    break;
+                }
+            }
+
+            if (batch == compiled.passes.size())
+                break;
+
+            // What the pass asked for, every access to the same resource folded together.
+            RenderGraph::PassId pass{ compiled.passes[batch] };
+            std::vector<uint32_t> wanted(recorded.resources.size(), 0);
+            std::vector<bool> used(recorded.resources.size(), false);
+            std::vector<bool> written(recorded.resources.size(), false);
+            for (const Access& access : recorded.accesses)
+            {
+                if (access.pass != pass)
+                    continue;
+                wanted[access.resource] |= access.state;
+                used[access.resource] = true;
+                written[access.resource] = written[access.resource] || access.write;
+            }
+
+            for (RenderGraph::ResourceId resource = 0; resource < recorded.resources.size(); ++resource)
+            {
+                if (!used[resource])
+                    continue;
+
+                ASSERT_FALSE(tracked[resource].splitOpen) << "Pass " << pass << " uses resource " << resource << " mid-transition.";
+                if (written[resource])
+                    ASSERT_EQ(tracked[resource].state, wanted[resource]) << "pass " << pass << " resource " << resource;
+                else
+                    ASSERT_EQ(tracked[resource].state & wanted[resource], wanted[resource]) << "pass " << pass << " resource " << resource;
+            }
+
+            if (recorded.passFlags[pass] & RenderGraph::PASS_OWN_COMMAND_LISTS)
+                commandList++;
+        }
+
+        for (RenderGraph::ResourceId resource = 0; resource < recorded.resources.size(); ++resource)
+        {
+            ASSERT_FALSE(tracked[resource].splitOpen);
+            ASSERT_EQ(tracked[resource].state, recorded.resources[resource].finalState) << "resource " << resource;
+        }
+    }
+
+    // A pass survives exactly when it has side effects or writes something exported or used by
+    // a later surviving pass.
+    void ValidateCulling(const RenderGraph::Compiled& compiled, const Recorded& recorded)
+    {
+        std::vector<bool> kept(recorded.passFlags.size(), false);
+        for (RenderGraph::PassId pass : compiled.passes)
+            kept[pass] = true;
+
+        for (RenderGraph::PassId pass = 0; pass < recorded.passFlags.size(); ++pass)
+        {
+            bool needed{ (recorded.passFlags[pass] & RenderGraph::PASS_SIDE_EFFECTS) != 0 };
+            for (const Access& write : recorded.accesses)
+            {
+                if (write.pass != pass || !write.write)
+                    continue;
+
+                needed = needed || recorded.resources[write.resource].exported;
+                for (const Access& later : recorded.accesses)
+                    needed = needed || (later.pass > pass && kept[later.pass] && later.resource == write.resource);
+            }
+
+            ASSERT_EQ(kept[pass], needed) << "pass " << pass;
+        }
+    }
+
+    class Builder
+    {
+    public:
+        RenderGraph::ResourceId Import(uint32_t initialState, uint32_t finalState, bool exported = true)
+        {
+            recorded.resources.push_back({ initialState, finalState, exported });
+            return graph.ImportResource("resource", initialState, finalState, exported);
+        }
+
+        RenderGraph::PassId Pass(uint32_t flags = RenderGraph::PASS_NONE)
+        {
+            recorded.passFlags.push_back(flags);
+            return graph.AddPass("pass", flags);
+        }
+
+        void Read(RenderGraph::PassId pass, RenderGraph::ResourceId resource, uint32_t state)
+        {
+            recorded.accesses.push_back({ pass, resource, state, false });
+            graph.Read(pass, resource, state);
+        }
+
+        void Write(RenderGraph::PassId pass, RenderGraph::ResourceId resource, uint32_t state)
+        {
+            recorded.accesses.push_back({ pass, resource, state, true });
+            graph.Write(pass, resource, state);
+        }
+
+        void Reset()
+        {
+            graph.Reset();
+            recorded = {};
+        }
+
+        RenderGraph graph;
+        Recorded recorded;
+    };
+
+    std::vector<Barrier> BarriersOf(const RenderGraph::Compiled& compiled, uint32_t batch)
+    {
+        std::span<const Barrier> barriers{ compiled.Batch(batch) };
+        return { barriers.begin(), barriers.end() };
+    }
+}
+
+TEST(RenderGraph, CullsPassesNothingDependsOn)
+{
+    Builder builder;
+    RenderGraph::ResourceId scratch{ builder.Import(COMMON, COMMON, false) };
+    RenderGraph::ResourceId unused{ builder.Import(COMMON, COMMON, false) };
+    RenderGraph::ResourceId readback{ builder.Import(COMMON, COMMON, false) };
+    RenderGraph::ResourceId backBuffer{ builder.Import(COMMON, COMMON) };
+
+    RenderGraph::PassId producer{ builder.Pass() };
+    builder.Write(producer, scratch, RENDER_TARGET);
+    RenderGraph::PassId dead{ builder.Pass() };
+    builder.Write(dead, unused, RENDER_TARGET);
+    builder.Read(dead, scratch, PIXEL_SHADER_RESOURCE);
+    RenderGraph::PassId composite{ builder.Pass() };
+    builder.Read(composite, scratch, PIXEL_SHADER_RESOURCE);
+    builder.Write(composite, backBuffer, RENDER_TARGET);
+    RenderGraph::PassId capture{ builder.Pass(RenderGraph::PASS_SIDE_EFFECTS) };
+    builder.Write(capture, readback, COPY_DEST);
+
+    const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+    EXPECT_EQ(compiled.passes, (std::vector<RenderGraph::PassId>{ producer, composite, capture }));
+    ValidateCulling(compiled, builder.recorded);
+    Validate(compiled, builder.recorded);
+}
+
+TEST(RenderGraph, KeepsEarlierWritersOfAWrittenResource)
+{
+    Builder builder;
+    RenderGraph::ResourceId target{ builder.Import(COMMON, COMMON) };
+
+    // Writes keep the contents, so the clear is needed by the draw on top of it.
+    RenderGraph::PassId clear{ builder.Pass() };
+    builder.Write(clear, target, RENDER_TARGET);
+    RenderGraph::PassId draw{ builder.Pass() };
+    builder.Write(draw, target, RENDER_TARGET);
+
+    const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+    EXPECT_EQ(compiled.passes, (std::vector<RenderGraph::PassId>{ clear, draw }));
+    Validate(compiled, builder.recorded);
+}
+
+TEST(RenderGraph, SplitsTransitionsAcrossUnrelatedWork)
+{
+    Builder builder;
+    RenderGraph::ResourceId shadowMap{ builder.Import(DEPTH_WRITE, DEPTH_WRITE, false) };
+    RenderGraph::ResourceId backBuffer{ builder.Import(RENDER_TARGET, RENDER_TARGET) };
+
+    RenderGraph::PassId shadows{ builder.Pass() };
+    builder.Write(shadows, shadowMap, DEPTH_WRITE);
+    RenderGraph::PassId sky{ builder.Pass() };
+    builder.Write(sky, backBuffer, RENDER_TARGET);
+    RenderGraph::PassId lighting{ builder.Pass() };
+    builder.Read(lighting, shadowMap, PIXEL_SHADER_RESOURCE);
+    builder.Write(lighting, backBuffer, RENDER_TARGET);
+
+    const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+    ASSERT_EQ(compiled.BatchCount(), 4u);
+
+    // Begins right after the shadow pass, ends right before lighting. Going back to depth
+    // write starts right after lighting and has no work to overlap with.
+    EXPECT_TRUE(BarriersOf(compiled, 0).empty());
+    EXPECT_EQ(BarriersOf(compiled, 1), (std::vector<Barrier>{ { shadowMap, DEPTH_WRITE, PIXEL_SHADER_RESOURCE, BarrierSplit::Begin } }));
+    EXPECT_EQ(BarriersOf(compiled, 2), (std::vector<Barrier>{ { shadowMap, DEPTH_WRITE, PIXEL_SHADER_RESOURCE, BarrierSplit::End } }));
+    EXPECT_EQ(BarriersOf(compiled, 3), (std::vector<Barrier>{ { shadowMap, PIXEL_SHADER_RESOURCE, DEPTH_WRITE, BarrierSplit::None } }));
+    Validate(compiled, builder.recorded);
+}
+
+TEST(RenderGraph, DoesntSplitAcrossCommandLists)
+{
+    Builder builder;
+    RenderGraph::ResourceId shadowMap{ builder.Import(DEPTH_WRITE, DEPTH_WRITE, false) };
+    RenderGraph::ResourceId backBuffer{ builder.Import(RENDER_TARGET, RENDER_TARGET) };
+
+    RenderGraph::PassId shadows{ builder.Pass() };
+    builder.Write(shadows, shadowMap, DEPTH_WRITE);
+    RenderGraph::PassId scene{ builder.Pass(RenderGraph::PASS_OWN_COMMAND_LISTS) };
+    builder.Write(scene, backBuffer, RENDER_TARGET);
+    RenderGraph::PassId lighting{ builder.Pass() };
+    builder.Read(lighting, shadowMap, PIXEL_SHADER_RESOURCE);
+    builder.Write(lighting, backBuffer, RENDER_TARGET);
+
+    const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+    EXPECT_TRUE(BarriersOf(compiled, 1).empty());
+    EXPECT_EQ(BarriersOf(compiled, 2), (std::vector<Barrier>{ { shadowMap, DEPTH_WRITE, PIXEL_SHADER_RESOURCE, BarrierSplit::None } }));
+    Validate(compiled, builder.recorded);
+}
+
+TEST(RenderGraph, MergesTransitionsOfConsecutiveReads)
+{
+    Builder builder;
+    RenderGraph::ResourceId gbuffer{ builder.Import(COMMON, COMMON, false) };
+    RenderGraph::ResourceId output{ builder.Import(COMMON, COMMON) };
+
+    RenderGraph::PassId geometry{ builder.Pass() };
+    builder.Write(geometry, gbuffer, RENDER_TARGET);
+    RenderGraph::PassId lighting{ builder.Pass() };
+    builder.Read(lighting, gbuffer, PIXEL_SHADER_RESOURCE);
+    builder.Write(lighting, output, RENDER_TARGET);
+    RenderGraph::PassId reflections{ builder.Pass() };
+    builder.Read(reflections, gbuffer, NON_PIXEL_SHADER_RESOURCE);
+    builder.Write(reflections, output, UNORDERED_ACCESS);
+    RenderGraph::PassId composite{ builder.Pass() };
+    builder.Read(composite, gbuffer, PIXEL_SHADER_RESOURCE);
+    builder.Read(composite, gbuffer, COPY_SOURCE);
+    builder.Write(composite, output, RENDER_TARGET);
+
+    const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+
+    // One transition into every read state at once, nothing between the reads.
+    constexpr uint32_t READ = PIXEL_SHADER_RESOURCE | NON_PIXEL_SHADER_RESOURCE | COPY_SOURCE;
+    uint32_t gbufferBarriers{ 0 };
+    for (const Barrier& barrier : compiled.barriers)
+    {
+        if (barrier.resource == gbuffer && barrier.split != BarrierSplit::End)
+            gbufferBarriers++;
+    }
+    EXPECT_EQ(gbufferBarriers, 3u) << "Into render target, into the read states and back to common.";
+    EXPECT_EQ(BarriersOf(compiled, 1).front(), (Barrier{ gbuffer, RENDER_TARGET, READ, BarrierSplit::None }));
+    Validate(compiled, builder.recorded);
+}
+
+TEST(RenderGraph, LeavesResourcesAloneInTheRightState)
+{
+    Builder builder;
+    RenderGraph::ResourceId texture{ builder.Import(PIXEL_SHADER_RESOURCE, PIXEL_SHADER_RESOURCE) };
+    RenderGraph::ResourceId target{ builder.Import(RENDER_TARGET, RENDER_TARGET) };
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        RenderGraph::PassId pass{ builder.Pass() };
+        builder.Read(pass, texture, PIXEL_SHADER_RESOURCE);
+        builder.Write(pass, target, RENDER_TARGET);
+    }
+
+    const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+    EXPECT_EQ(compiled.passes.size(), 3u);
+    EXPECT_TRUE(compiled.barriers.empty());
+    Validate(compiled, builder.recorded);
+}
+
+// Random graphs over a handful of resources, checked by replaying their barriers.
+TEST(RenderGraph, RandomGraphsReplayCorrectly)
+{
+    const uint32_t writeStates[] = { RENDER_TARGET, UNORDERED_ACCESS, DEPTH_WRITE, COPY_DEST };
+    const uint32_t readStates[] = { DEPTH_READ, NON_PIXEL_SHADER_RESOURCE, PIXEL_SHADER_RESOURCE, COPY_SOURCE };
+    const uint32_t anyStates[] = { COMMON, RENDER_TARGET, UNORDERED_ACCESS, PIXEL_SHADER_RESOURCE, COPY_SOURCE };
+
+    Builder builder;
+    for (uint32_t seed = 0; seed < 500; ++seed)
+    {
+        std::mt19937 random{ seed };
+        builder.Reset();
+
+        uint32_t resourceCount{ static_cast<uint32_t>(1 + random() % 8) };
+        for (uint32_t i = 0; i < resourceCount; ++i)
+            builder.Import(anyStates[random() % 5], anyStates[random() % 5], random() % 3 == 0);
+
+        uint32_t passCount{ static_cast<uint32_t>(1 + random() % 24) };
+        for (uint32_t i = 0; i < passCount; ++i)
+        {
+            uint32_t flags{ RenderGraph::PASS_NONE };
+            if (random() % 10 == 0)
+                flags |= RenderGraph::PASS_SIDE_EFFECTS;
+            if (random() % 6 == 0)
+                flags |= RenderGraph::PASS_OWN_COMMAND_LISTS;
+
+            RenderGraph::PassId pass{ builder.Pass(flags) };
+            uint32_t accessCount{ static_cast<uint32_t>(random() % 4) };
+            for (uint32_t a = 0; a < accessCount; ++a)
+            {
+                RenderGraph::ResourceId resource{ static_cast<RenderGraph::ResourceId>(random() % resourceCount) };
+                if (random() % 3 == 0)
+                    builder.Write(pass, resource, writeStates[random() % 4]);
+                else
+                    builder.Read(pass, resource, readStates[random() % 4]);
+            }
+        }
+
+        const RenderGraph::Compiled& compiled{ builder.graph.Compile() };
+        SCOPED_TRACE(testing::Message() << "seed " << seed);
+        ValidateCulling(compiled, builder.recorded);
+        Validate(compiled, builder.recorded);
+        if (HasFatalFailure())
+            return;
+    }
+}
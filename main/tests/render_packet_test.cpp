@@ -0,0 +1,159 @@
+#include "job_system.hpp"
+#include "render_packet.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Found by the comparisons inside gtest and std, which an anonymous namespace would hide it from.
+bool operator==(const RenderPacket& a, const RenderPacket& b)
+{
+    return a.key == b.key && a.drawItem == b.drawItem && a.object == b.object;
+}
+
+namespace
+{
+    // drawItem is the packet's place before the sort, so stability shows in the output.
+    std::vector<RenderPacket> Packets(const std::vector<uint64_t>& keys)
+    {
+        std::vector<RenderPacket> packets;
+        for (uint32_t i = 0; i < keys.size(); ++i)
+            packets.push_back({ keys[i], i, i % 7 });
+        return packets;
+    }
+
+    std::vector<RenderPacket> StableSorted(std::vector<RenderPacket> packets)
+    {
+        std::stable_sort(packets.begin(), packets.end(), [](const RenderPacket& a, const RenderPacket& b) { return a.key < b.key; });
+        return packets;
+    }
+
+    class RenderPacketSort : public testing::Test
+    {
+    protected:
+        std::vector<RenderPacket> Sort(std::vector<RenderPacket> packets)
+        {
+            SortRenderPackets(packets, scratch, jobSystem);
+            return packets;
+        }
+
+        // Enough for several sort blocks.
+        static constexpr uint32_t MANY = 50000;
+
+        JobSystem jobSystem{ 2 };
+        std::vector<RenderPacket> scratch;
+    };
+}
+
+TEST_F(RenderPacketSort, MatchesStableSort)
+{
+    // Few distinct keys so most have equal neighbours, spread over every byte.
+    std::mt19937_64 random{ 41 };
+    std::vector<uint64_t> distinct(300);
+    for (uint64_t& key : distinct)
+        key = random();
+
+    std::vector<uint64_t> keys(MANY);
+    for (uint64_t& key : keys)
+        key = distinct[random() % distinct.size()];
+
+    std::vector<RenderPacket> packets{ Packets(keys) };
+    EXPECT_EQ(Sort(packets), StableSorted(packets));
+}
+
+TEST_F(RenderPacketSort, SkipsDigitsThatNeverChange)
+{
+    std::mt19937_64 random{ 43 };
+
+    // Only the lowest byte, only one middle byte, two bytes far apart, and the top byte, on
+    // top of constant bits everywhere else. Odd and even numbers of passes leave the result
+    // in either buffer.
+    const uint64_t masks[]{ 0xffull, 0xffull << 24, (0xffull << 8) | (0xffull << 48), 0xffull << 56 };
+    for (uint64_t mask : masks)
+    {
+        std::vector<uint64_t> keys(MANY);
+        for (uint64_t& key : keys)
+            key = (0x5a5a5a5a5a5a5a5aull & ~mask) | (random() % 16 * 0x1111111111111111ull & mask);
+
+        std::vector<RenderPacket> packets{ Packets(keys) };
+        EXPECT_EQ(Sort(packets), StableSorted(packets)) << std::hex << "mask " << mask;
+    }
+
+    // Nothing varies, nothing moves.
+    std::vector<RenderPacket> same{ Packets(std::vector<uint64_t>(MANY, 0x1234)) };
+    EXPECT_EQ(Sort(same), same);
+
+    EXPECT_TRUE(Sort({}).empty());
+    std::vector<RenderPacket> one{ Packets({ 7 }) };
+    EXPECT_EQ(Sort(one), one);
+}
+
+TEST_F(RenderPacketSort, OpaqueFrontToBackThenTransparentBackToFront)
+{
+    const float depths[]{ 30.0f, 0.5f, 120.0f, 7.0f, 0.0f, 7.5f };
+    std::vector<uint64_t> keys;
+    for (float depth : depths)
+    {
+        keys.push_back(SortKey::Transparent(PACKET_PASS_SCENE, 2, 1, 5, 0, depth));
+        keys.push_back(SortKey::Opaque(PACKET_PASS_SCENE, 2, 1, 5, 0, depth));
+    }
+
+    std::vector<RenderPacket> sorted{ Sort(Packets(keys)) };
+    std::vector<float> opaque;
+    std::vector<float> transparent;
+    for (const RenderPacket& packet : sorted)
+    {
+        bool isTransparent{ SortKey::IsTransparent(packet.key) };
+        EXPECT_EQ(isTransparent, packet.drawItem % 2 == 0);
+        // Opaque before transparent.
+        if (!isTransparent)
+            EXPECT_TRUE(transparent.empty());
+        (isTransparent ? transparent : opaque).push_back(depths[packet.drawItem / 2]);
+    }
+
+    EXPECT_EQ(opaque, (std::vector<float>{ 0.0f, 0.5f, 7.0f, 7.5f, 30.0f, 120.0f }));
+    EXPECT_EQ(transparent, (std::vector<float>{ 120.0f, 30.0f, 7.5f, 7.0f, 0.5f, 0.0f }));
+}
+
+TEST_F(RenderPacketSort, OpaqueSortsByStateBeforeDepth)
+{
+    std::vector<uint64_t> keys{
+        SortKey::Opaque(PACKET_PASS_SCENE, 1, 0, 3, 0, 5.0f),
+        SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 9, 0, 50.0f),
+        SortKey::Opaque(PACKET_PASS_SCENE, 1, 0, 3, 0, 1.0f),
+        SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 9, 1, 2.0f),
+        SortKey::Opaque(PACKET_PASS_SCENE, 0, 0, 9, 0, 3.0f),
+    };
+
+    std::vector<uint32_t> order;
+    for (const RenderPacket& packet : Sort(Packets(keys)))
+        order.push_back(packet.drawItem);
+    EXPECT_EQ(order, (std::vector<uint32_t>{ 4, 1, 3, 2, 0 }));
+
+    // The same state with another depth is still the same state.
+    EXPECT_EQ(SortKey::State(keys[0]), SortKey::State(keys[2]));
+    EXPECT_NE(SortKey::State(keys[1]), SortKey::State(keys[3]));
+}
+
+TEST_F(RenderPacketSort, StreamKeepsWriterOrderForEqualKeys)
+{
+    RenderPacketStream stream;
+    stream.Reset(3);
+    stream.Emit(2, { 1, 20, 0 });
+    stream.Emit(0, { 1, 0, 0 });
+    stream.Emit(1, { 0, 10, 0 });
+    stream.Emit(0, { 1, 1, 0 });
+    stream.Emit(2, { 0, 21, 0 });
+
+    std::vector<uint32_t> order;
+    for (const RenderPacket& packet : stream.Sort(jobSystem))
+        order.push_back(packet.drawItem);
+    EXPECT_EQ(order, (std::vector<uint32_t>{ 10, 21, 0, 1, 20 }));
+
+    // Reset keeps the writers' memory but none of their packets.
+    stream.Reset(2);
+    stream.Emit(1, { 0, 5, 0 });
+    EXPECT_EQ(stream.Sort(jobSystem).size(), 1u);
+}
@@ -0,0 +1,226 @@
+#include "ring_allocator.hpp"
+#include "upload_ring.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // System memory backing for UploadRing, at a made up GPU address.
+    struct SystemMemory
+    {
+        explicit SystemMemory(uint64_t size) : bytes(size) {}
+
+        uint8_t* CpuAddress() { return bytes.data(); }
+        uint64_t GpuAddress() const { return 0x100000000ull; }
+        uint64_t Size() const { return bytes.size(); }
+
+        std::vector<uint8_t> bytes;
+    };
+
+    struct Live
+    {
+        UploadAllocation allocation;
+        uint8_t pattern;
+    };
+
+    struct Frame
+    {
+        uint64_t fence;
+        std::vector<Live> allocations;
+    };
+
+    bool Overlaps(const UploadAllocation& a, const UploadAllocation& b)
+    {
+        return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+    }
+
+    bool HoldsPattern(const Live& live)
+    {
+        for (uint64_t i = 0; i < live.allocation.size; ++i)
+        {
+            if (live.allocation.cpuAddress[i] != live.pattern)
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST(RingAllocator, AlignsAllocations)
+{
+    RingAllocator ring{ 1024 };
+
+    EXPECT_EQ(ring.Allocate(3, 1), 0u);
+    EXPECT_EQ(ring.Allocate(8, 256), 256u);
+    EXPECT_EQ(ring.Allocate(1, 16), 272u);
+    EXPECT_EQ(ring.UsedSize(), 273u) << "Padding counts as used.";
+}
+
+TEST(RingAllocator, RejectsWhatDoesntFit)
+{
+    RingAllocator ring{ 256 };
+
+    EXPECT_EQ(ring.Allocate(0, 1), RingAllocator::INVALID_OFFSET);
+    EXPECT_EQ(ring.Allocate(257, 1), RingAllocator::INVALID_OFFSET);
+    EXPECT_EQ(ring.Allocate(200, 1), 0u);
+    EXPECT_EQ(ring.Allocate(100, 1), RingAllocator::INVALID_OFFSET);
+    EXPECT_EQ(ring.Allocate(56, 1), 200u);
+    EXPECT_EQ(ring.Allocate(1, 1), RingAllocator::INVALID_OFFSET);
+}
+
+TEST(RingAllocator, WrapsAroundAndSkipsTheTailEnd)
+{
+    RingAllocator ring{ 256 };
+
+    EXPECT_EQ(ring.Allocate(100, 1), 0u);
+    ring.FinishFrame(1);
+    EXPECT_EQ(ring.Allocate(100, 1), 100u);
+    ring.FinishFrame(2);
+    ring.Retire(1);
+
+    // 56 bytes are left at the end, not enough, so the allocation goes to the front and the
+    // tail end counts as used until its frame retires.
+    EXPECT_EQ(ring.Allocate(80, 1), 0u);
+    EXPECT_EQ(ring.UsedSize(), 100u + 56u + 80u);
+    EXPECT_EQ(ring.Allocate(21, 1), RingAllocator::INVALID_OFFSET) << "Would run into frame 2.";
+    EXPECT_EQ(ring.Allocate(20, 1), 80u);
+    ring.FinishFrame(3);
+
+    ring.Retire(3);
+    EXPECT_EQ(ring.UsedSize(), 0u);
+    EXPECT_EQ(ring.FramesInFlight(), 0u);
+}
+
+TEST(RingAllocator, StartsOverOnceEverythingRetired)
+{
+    RingAllocator ring{ 256 };
+
+    EXPECT_EQ(ring.Allocate(200, 1), 0u);
+    ring.FinishFrame(1);
+    ring.Retire(1);
+    EXPECT_EQ(ring.Allocate(256, 1), 0u);
+}
+
+TEST(RingAllocator, EmptyFramesDontMoveTheTail)
+{
+    RingAllocator ring{ 256 };
+
+    EXPECT_EQ(ring.Allocate(128, 1), 0u);
+    ring.FinishFrame(1);
+    ring.FinishFrame(2);
+    ring.Retire(1);
+    EXPECT_EQ(ring.Allocate(256, 1), 0u);
+    ring.FinishFrame(3);
+
+    // Frame 2 was empty, retiring it must not free frame 3's space.
+    ring.Retire(2);
+    EXPECT_EQ(ring.UsedSize(), 256u);
+    EXPECT_EQ(ring.Allocate(1, 1), RingAllocator::INVALID_OFFSET);
+}
+
+TEST(UploadRing, ReturnsMatchingCpuAndGpuAddresses)
+{
+    SystemMemory memory{ 4096 };
+    UploadRing<SystemMemory> ring{ memory };
+
+    UploadAllocation constants{ ring.AllocateConstants(10) };
+    ASSERT_TRUE(constants);
+    EXPECT_EQ(constants.size, CONSTANT_BUFFER_ALIGNMENT);
+    UploadAllocation more{ ring.AllocateConstants(10) };
+    ASSERT_TRUE(more);
+    EXPECT_EQ(more.offset, CONSTANT_BUFFER_ALIGNMENT);
+    EXPECT_EQ(more.cpuAddress, memory.CpuAddress() + more.offset);
+    EXPECT_EQ(more.gpuAddress, memory.GpuAddress() + more.offset);
+
+    EXPECT_FALSE(ring.Allocate(8192, 1));
+}
+
+// Random allocations, frame ends and retirements against a model of what's live. Every
+// allocation has to be aligned, inside the ring and clear of everything live, and what's
+// written to it has to survive until its frame retires.
+TEST(UploadRing, Fuzz)
+{
+    constexpr uint64_t RING_SIZE = 64 * 1024;
+
+    for (uint32_t seed = 0; seed < 64; ++seed)
+    {
+        std::mt19937 random{ seed };
+        SystemMemory memory{ RING_SIZE };
+        UploadRing<SystemMemory> ring{ memory };
+
+        std::deque<Frame> frames;
+        Frame current;
+        uint64_t fence{ 0 };
+        uint64_t completed{ 0 };
+        uint32_t allocated{ 0 };
+        uint32_t failed{ 0 };
+
+        for (uint32_t step = 0; step < 4000; ++step)
+        {
+            uint32_t action{ static_cast<uint32_t>(random() % 100) };
+            if (action < 85)
+            {
+                // Mostly small, sometimes large enough to force wrapping and failures.
+                uint64_t size{ random() % 8 == 0 ? 1 + random() % (RING_SIZE / 2) : 1 + random() % 2048 };
+                uint64_t alignment{ 1ull << (random() % 9) };
+                UploadAllocation allocation{ ring.Allocate(size, alignment) };
+                if (!allocation)
+                {
+                    ++failed;
+                    continue;
+                }
+
+                ++allocated;
+                ASSERT_EQ(allocation.offset % alignment, 0u);
+                ASSERT_LE(allocation.offset + allocation.size, RING_SIZE);
+                ASSERT_EQ(allocation.cpuAddress, memory.CpuAddress() + allocation.offset);
+                ASSERT_EQ(allocation.gpuAddress, memory.GpuAddress() + allocation.offset);
+
+                auto clear = [&](const std::vector<Live>& live)
+                {
+                    for (const Live& other : live)
+                        ASSERT_FALSE(Overlaps(allocation, other.allocation)) << "seed " << seed << " step " << step;
+                };
+                clear(current.allocations);
+                for (const Frame& frame : frames)
+                    clear(frame.allocations);
+
+                uint8_t pattern{ static_cast<uint8_t>(random()) };
+                memset(allocation.cpuAddress, pattern, allocation.size);
+                current.allocations.push_back({ allocation, pattern });
+            }
+            else if (action < 95)
+            {
+                current.fence = ++fence;
+                ring.FinishFrame(current.fence);
+                frames.push_back(std::move(current));
+                current = {};
+            }
+            else
+            {
+                completed += random() % (fence - completed + 1);
+                ring.Retire(completed);
+                while (!frames.empty() && frames.front().fence <= completed)
+                {
+                    for (const Live& live : frames.front().allocations)
+                        ASSERT_TRUE(HoldsPattern(live)) << "seed " << seed << " step " << step;
+                    frames.pop_front();
+                }
+            }
+        }
+
+        ASSERT_EQ(ring.Allocator().FramesInFlight(), frames.size());
+        EXPECT_GT(allocated, 0u);
+        EXPECT_GT(failed, 0u) << "The ring never filled up, the fuzzing misses the full case.";
+
+        // With everything retired the whole ring is free again.
+        ring.FinishFrame(++fence);
+        ring.Retire(fence);
+        EXPECT_EQ(ring.Allocator().UsedSize(), 0u);
+        EXPECT_TRUE(ring.Allocate(RING_SIZE, 256));
+    }
+}
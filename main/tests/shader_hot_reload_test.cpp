@@ -0,0 +1,272 @@
+#include "shader_hot_reload.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    // Compiles by reading the file, so a blob is the source it was built from. Programs with
+    // "error" in any of their files fail to compile.
+    class FakeCompiler
+    {
+    public:
+        using Blob = std::string;
+        using Pipeline = std::shared_ptr<const std::string>;
+
+        Blob Compile(const ShaderProgramDesc& desc)
+        {
+            compiles.fetch_add(1, std::memory_order_relaxed);
+
+            std::string main;
+            for (const std::filesystem::path& file : ShaderDependencies::ScanIncludes(desc.file))
+            {
+                std::ifstream stream{ file };
+                std::stringstream source;
+                source << stream.rdbuf();
+                if (source.str().find("error") != std::string::npos)
+                    throw std::runtime_error{ "Doesn't compile." };
+                if (main.empty())
+                    main = source.str();
+            }
+
+            return desc.entryPoint + ":" + main;
+        }
+
+        Pipeline Build(uint32_t, std::span<const Blob> programs)
+        {
+            builds.fetch_add(1, std::memory_order_relaxed);
+
+            std::string pipeline;
+            for (const Blob& program : programs)
+                pipeline += program + "|";
+            return std::make_shared<const std::string>(std::move(pipeline));
+        }
+
+        std::atomic<uint32_t> compiles{ 0 };
+        std::atomic<uint32_t> builds{ 0 };
+    };
+
+    class ShaderFiles : public testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            _directory = std::filesystem::temp_directory_path() / (std::string{ "shader_hot_reload_test_" } + testing::UnitTest::GetInstance()->current_test_info()->name());
+            std::filesystem::remove_all(_directory);
+            std::filesystem::create_directories(_directory);
+        }
+
+        void TearDown() override { std::filesystem::remove_all(_directory); }
+
+        std::filesystem::path Write(const std::filesystem::path& name, const std::string& contents)
+        {
+            std::filesystem::path path{ _directory / name };
+            std::filesystem::create_directories(path.parent_path());
+            std::ofstream{ path } << contents;
+            return path;
+        }
+
+        std::filesystem::path _directory;
+    };
+
+    // Steps the reload until it swaps or gives up, like the render loop does once per frame.
+    template <typename Reload>
+    bool UpdateUntilSwapped(Reload& reload, uint64_t lastSubmittedFence, uint64_t completedFence)
+    {
+        auto deadline{ std::chrono::steady_clock::now() + std::chrono::seconds(5) };
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (reload.Update(lastSubmittedFence, completedFence))
+                return true;
+            if (reload.IsIdle())
+                return false;
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    std::vector<std::filesystem::path> Sorted(std::vector<std::filesystem::path> paths)
+    {
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+}
+
+TEST_F(ShaderFiles, ScansIncludesTransitively)
+{
+    std::filesystem::path main{ Write("main.hlsl", "#include \"common.hlsli\"\n  #  include <lights/lights.hlsli>\n#include \"missing.hlsli\"\n") };
+    std::filesystem::path common{ Write("common.hlsli", "#include \"main.hlsl\"\nfloat4 x;\n") };
+    std::filesystem::path lights{ Write("lights/lights.hlsli", "#include \"../common.hlsli\"\n#include \"shadow.hlsli\"\n") };
+    std::filesystem::path shadow{ Write("lights/shadow.hlsli", "// #include \"nothing.hlsli\" isn't at the line start\n") };
+
+    std::vector<std::filesystem::path> files{ ShaderDependencies::ScanIncludes(main) };
+    ASSERT_FALSE(files.empty());
+    EXPECT_EQ(files.front(), ShaderDependencies::Normalize(main)) << "The file itself comes first.";
+
+    // Cycles and files included twice show up once, missing ones not at all.
+    std::vector<std::filesystem::path> expected{ ShaderDependencies::Normalize(main), ShaderDependencies::Normalize(common),
+        ShaderDependencies::Normalize(lights), ShaderDependencies::Normalize(shadow) };
+    EXPECT_EQ(Sorted(files), Sorted(expected));
+}
+
+TEST_F(ShaderFiles, FindsProgramsAffectedByAChange)
+{
+    std::filesystem::path common{ Write("common.hlsli", "") };
+    std::filesystem::path a{ Write("a.hlsl", "#include \"common.hlsli\"\n") };
+    std::filesystem::path b{ Write("b.hlsl", "") };
+
+    ShaderDependencies dependencies;
+    dependencies.SetFiles(0, ShaderDependencies::ScanIncludes(a));
+    dependencies.SetFiles(1, ShaderDependencies::ScanIncludes(b));
+    dependencies.SetFiles(2, ShaderDependencies::ScanIncludes(a));
+
+    std::vector<std::filesystem::path> changed{ common, _directory / "." / "b.hlsl", common };
+    EXPECT_EQ(dependencies.Affected(changed), (std::vector<ShaderDependencies::ProgramId>{ 0, 1, 2 }));
+
+    // Program 0 dropped the include.
+    dependencies.SetFiles(0, std::vector<std::filesystem::path>{ a });
+    std::vector<std::filesystem::path> onlyCommon{ common };
+    EXPECT_EQ(dependencies.Affected(onlyCommon), (std::vector<ShaderDependencies::ProgramId>{ 2 }));
+
+    std::vector<std::filesystem::path> unrelated{ _directory / "other.hlsl" };
+    EXPECT_TRUE(dependencies.Affected(unrelated).empty());
+}
+
+TEST_F(ShaderFiles, WatcherReportsWrites)
+{
+    std::filesystem::create_directories(_directory / "existing");
+    FileWatcher watcher{ _directory };
+    ASSERT_TRUE(watcher.IsWatching());
+
+    std::filesystem::path top{ Write("top.hlsl", "a") };
+    std::filesystem::path nested{ Write("existing/nested.hlsli", "b") };
+
+    std::vector<std::filesystem::path> seen;
+    auto deadline{ std::chrono::steady_clock::now() + std::chrono::seconds(5) };
+    while (seen.size() < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        for (std::filesystem::path& change : watcher.TakeChanges())
+        {
+            if (std::find(seen.begin(), seen.end(), change) == seen.end())
+                seen.push_back(std::move(change));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    EXPECT_EQ(Sorted(seen), Sorted({ top.lexically_normal(), nested.lexically_normal() }));
+}
+
+TEST_F(ShaderFiles, RecompilesAndSwapsWhatAnIncludeChangeAffects)
+{
+    std::filesystem::path common{ Write("common.hlsli", "v1") };
+    std::filesystem::path vs{ Write("vs.hlsl", "#include \"common.hlsli\"\n") };
+    std::filesystem::path other{ Write("other.hlsl", "other") };
+
+    FakeCompiler compiler;
+    JobSystem jobSystem{ 2 };
+    ShaderHotReload<FakeCompiler> reload{ compiler, jobSystem, {} };
+
+    ShaderDependencies::ProgramId vsProgram{ reload.AddProgram({ vs, {}, "VS", "vs_5_0" }, "startup vs") };
+    ShaderDependencies::ProgramId psProgram{ reload.AddProgram({ vs, {}, "PS", "ps_5_0" }, "startup ps") };
+    ShaderDependencies::ProgramId otherProgram{ reload.AddProgram({ other, {}, "CS", "cs_5_0" }, "startup cs") };
+    uint32_t scene{ reload.AddPipeline({ vsProgram, psProgram }, std::make_shared<const std::string>("startup")) };
+    uint32_t compute{ reload.AddPipeline({ otherProgram }, std::make_shared<const std::string>("compute")) };
+
+    std::weak_ptr<const std::string> startup{ reload.GetPipeline(scene) };
+    Write("common.hlsli", "v2");
+    std::vector<std::filesystem::path> changed{ common };
+    reload.NotifyChanged(changed);
+
+    ASSERT_TRUE(UpdateUntilSwapped(reload, 10, 8));
+    EXPECT_EQ(compiler.compiles.load(), 2u) << "Only the programs including the file.";
+    EXPECT_EQ(compiler.builds.load(), 1u);
+    std::string expectedSource{ "#include \"common.hlsli\"\n" };
+    EXPECT_EQ(*reload.GetPipeline(scene), "VS:" + expectedSource + "|PS:" + expectedSource + "|");
+    EXPECT_EQ(*reload.GetPipeline(compute), "compute");
+    EXPECT_TRUE(reload.IsIdle());
+
+    // The old pipeline lives until the GPU is past the last frame that could use it.
+    EXPECT_FALSE(startup.expired());
+    reload.Update(10, 9);
+    EXPECT_FALSE(startup.expired());
+    reload.Update(11, 10);
+    EXPECT_TRUE(startup.expired());
+}
+
+TEST_F(ShaderFiles, KeepsThePreviousVersionWhenCompilingFails)
+{
+    std::filesystem::path vs{ Write("vs.hlsl", "fine") };
+
+    FakeCompiler compiler;
+    JobSystem jobSystem{ 2 };
+    ShaderHotReload<FakeCompiler> reload{ compiler, jobSystem, {} };
+    ShaderDependencies::ProgramId program{ reload.AddProgram({ vs, {}, "VS", "vs_5_0" }, "startup") };
+    uint32_t pipeline{ reload.AddPipeline({ program }, std::make_shared<const std::string>("startup")) };
+
+    // Pulls in a new include that's broken.
+    std::filesystem::path include{ Write("include.hlsli", "error") };
+    Write("vs.hlsl", "#include \"include.hlsli\"\n");
+    std::vector<std::filesystem::path> changed{ vs };
+    reload.NotifyChanged(changed);
+    EXPECT_FALSE(UpdateUntilSwapped(reload, 1, 1));
+    EXPECT_EQ(reload.ProgramBlob(program), "startup");
+    EXPECT_EQ(*reload.GetPipeline(pipeline), "startup");
+    EXPECT_EQ(compiler.builds.load(), 0u);
+
+    // The failed attempt still picked up the new include, fixing it alone triggers the next one.
+    Write("include.hlsli", "fixed");
+    std::vector<std::filesystem::path> fixed{ include };
+    reload.NotifyChanged(fixed);
+    EXPECT_TRUE(UpdateUntilSwapped(reload, 2, 2));
+    EXPECT_EQ(reload.ProgramBlob(program), "VS:#include \"include.hlsli\"\n");
+    EXPECT_EQ(*reload.GetPipeline(pipeline), "VS:#include \"include.hlsli\"\n|");
+}
+
+TEST_F(ShaderFiles, RunsInlineWithASingleWorker)
+{
+    std::filesystem::path vs{ Write("vs.hlsl", "one") };
+
+    FakeCompiler compiler;
+    JobSystem jobSystem{ 1 };
+    ShaderHotReload<FakeCompiler> reload{ compiler, jobSystem, {} };
+    ShaderDependencies::ProgramId program{ reload.AddProgram({ vs, {}, "VS", "vs_5_0" }, "startup") };
+    uint32_t pipeline{ reload.AddPipeline({ program }, std::make_shared<const std::string>("startup")) };
+
+    Write("vs.hlsl", "two");
+    std::vector<std::filesystem::path> changed{ vs };
+    reload.NotifyChanged(changed);
+    EXPECT_TRUE(UpdateUntilSwapped(reload, 1, 0));
+    EXPECT_EQ(*reload.GetPipeline(pipeline), "VS:two|");
+}
+
+// The whole path, from a file written on disk to the swapped pipeline.
+TEST_F(ShaderFiles, ReloadsWhatTheWatcherSees)
+{
+    std::filesystem::path vs{ Write("vs.hlsl", "#include \"inc/common.hlsli\"\n") };
+    Write("inc/common.hlsli", "v1");
+
+    FakeCompiler compiler;
+    JobSystem jobSystem{ 2 };
+    ShaderHotReload<FakeCompiler> reload{ compiler, jobSystem, _directory };
+    ShaderDependencies::ProgramId program{ reload.AddProgram({ vs, {}, "VS", "vs_5_0" }, "startup") };
+    uint32_t pipeline{ reload.AddPipeline({ program }, std::make_shared<const std::string>("startup")) };
+
+    Write("inc/common.hlsli", "v2");
+
+    bool swapped{ false };
+    auto deadline{ std::chrono::steady_clock::now() + std::chrono::seconds(5) };
+    while (!swapped && std::chrono::steady_clock::now() < deadline)
+    {
+        swapped = reload.Update(1, 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_TRUE(swapped);
+    EXPECT_EQ(*reload.GetPipeline(pipeline), "VS:#include \"inc/common.hlsli\"\n|");
+}
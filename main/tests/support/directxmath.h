@@ -0,0 +1,193 @@
+#pragma once
+#include <cmath>
+#include <pmmintrin.h>
+#include <xmmintrin.h>
+
+// Stand-in for the part of DirectXMath the platform-neutral sources use, for building them
+// where the Windows SDK isn't around. Same layouts and the same row-vector conventions, SSE
+// like the real thing, so the tests and benchmarks see the code paths the app runs.
+namespace DirectX
+{
+    using XMVECTOR = __m128;
+
+    struct XMMATRIX
+    {
+        XMVECTOR r[4];
+    };
+
+    struct XMFLOAT3
+    {
+        float x, y, z;
+
+        XMFLOAT3() = default;
+        constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+    };
+
+    struct XMFLOAT4
+    {
+        float x, y, z, w;
+
+        XMFLOAT4() = default;
+        constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+    };
+
+    struct XMFLOAT3X4
+    {
+        float m[3][4];
+    };
+
+    struct XMFLOAT4X4
+    {
+        float m[4][4];
+
+        XMFLOAT4X4() = default;
+        constexpr XMFLOAT4X4(float m00, float m01, float m02, float m03,
+                             float m10, float m11, float m12, float m13,
+                             float m20, float m21, float m22, float m23,
+                             float m30, float m31, float m32, float m33)
+            : m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } }
+        {
+        }
+    };
+
+    struct alignas(16) XMFLOAT4X4A : XMFLOAT4X4
+    {
+        using XMFLOAT4X4::XMFLOAT4X4;
+    };
+
+    inline XMVECTOR XMVectorZero()
+    {
+        return _mm_setzero_ps();
+    }
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+    {
+        return _mm_set_ps(w, z, y, x);
+    }
+
+    inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source)
+    {
+        return _mm_set_ps(0.0f, source->z, source->y, source->x);
+    }
+
+    inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source)
+    {
+        return _mm_loadu_ps(&source->x);
+    }
+
+    inline void XMStoreFloat3(XMFLOAT3* destination, XMVECTOR v)
+    {
+        alignas(16) float f[4];
+        _mm_store_ps(f, v);
+        *destination = { f[0], f[1], f[2] };
+    }
+
+    inline void XMStoreFloat4(XMFLOAT4* destination, XMVECTOR v)
+    {
+        _mm_storeu_ps(&destination->x, v);
+    }
+
+    inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+    {
+        return { { _mm_loadu_ps(source->m[0]), _mm_loadu_ps(source->m[1]), _mm_loadu_ps(source->m[2]), _mm_loadu_ps(source->m[3]) } };
+    }
+
+    inline XMMATRIX XMLoadFloat4x4A(const XMFLOAT4X4A* source)
+    {
+        return { { _mm_load_ps(source->m[0]), _mm_load_ps(source->m[1]), _mm_load_ps(source->m[2]), _mm_load_ps(source->m[3]) } };
+    }
+
+    inline void XMStoreFloat4x4(XMFLOAT4X4* destination, const XMMATRIX& m)
+    {
+        for (int row = 0; row < 4; ++row)
+            _mm_storeu_ps(destination->m[row], m.r[row]);
+    }
+
+    inline void XMStoreFloat4x4A(XMFLOAT4X4A* destination, const XMMATRIX& m)
+    {
+        for (int row = 0; row < 4; ++row)
+            _mm_store_ps(destination->m[row], m.r[row]);
+    }
+
+    // Writes the transpose's first three rows, like the real one.
+    inline void XMStoreFloat3x4(XMFLOAT3X4* destination, const XMMATRIX& m)
+    {
+        XMVECTOR r0{ m.r[0] }, r1{ m.r[1] }, r2{ m.r[2] }, r3{ m.r[3] };
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(destination->m[0], r0);
+        _mm_storeu_ps(destination->m[1], r1);
+        _mm_storeu_ps(destination->m[2], r2);
+    }
+
+    inline XMMATRIX XMMatrixIdentity()
+    {
+        return { { _mm_set_ps(0, 0, 0, 1), _mm_set_ps(0, 0, 1, 0), _mm_set_ps(0, 1, 0, 0), _mm_set_ps(1, 0, 0, 0) } };
+    }
+
+    inline XMMATRIX XMMatrixTranspose(const XMMATRIX& m)
+    {
+        XMMATRIX result{ m };
+        _MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+        return result;
+    }
+
+    inline XMMATRIX XMMatrixMultiply(const XMMATRIX& a, const XMMATRIX& b)
+    {
+        XMMATRIX result;
+        for (int row = 0; row < 4; ++row)
+        {
+            XMVECTOR v{ a.r[row] };
+            XMVECTOR x{ _mm_shuffle_ps(v, v, 0x00) };
+            XMVECTOR y{ _mm_shuffle_ps(v, v, 0x55) };
+            XMVECTOR z{ _mm_shuffle_ps(v, v, 0xAA) };
+            XMVECTOR w{ _mm_shuffle_ps(v, v, 0xFF) };
+            result.r[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, b.r[0]), _mm_mul_ps(y, b.r[1])),
+                                       _mm_add_ps(_mm_mul_ps(z, b.r[2]), _mm_mul_ps(w, b.r[3])));
+        }
+        return result;
+    }
+
+    inline XMMATRIX operator*(const XMMATRIX& a, const XMMATRIX& b)
+    {
+        return XMMatrixMultiply(a, b);
+    }
+
+    inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+    {
+        XMMATRIX result{ XMMatrixIdentity() };
+        result.r[3] = _mm_set_ps(1, z, y, x);
+        return result;
+    }
+
+    inline XMMATRIX XMMatrixRotationQuaternion(XMVECTOR q)
+    {
+        alignas(16) float f[4];
+        _mm_store_ps(f, q);
+        float x{ f[0] }, y{ f[1] }, z{ f[2] }, w{ f[3] };
+        float xx{ x * x }, yy{ y * y }, zz{ z * z };
+        float xy{ x * y }, xz{ x * z }, yz{ y * z };
+        float wx{ w * x }, wy{ w * y }, wz{ w * z };
+
+        return { {
+            _mm_set_ps(0, 2 * (xz - wy), 2 * (xy + wz), 1 - 2 * (yy + zz)),
+            _mm_set_ps(0, 2 * (yz + wx), 1 - 2 * (xx + zz), 2 * (xy - wz)),
+            _mm_set_ps(0, 1 - 2 * (xx + yy), 2 * (yz - wx), 2 * (xz + wy)),
+            _mm_set_ps(1, 0, 0, 0),
+        } };
+    }
+
+    // Scale, then rotate, then translate. The rotation origin is ignored, the sources only
+    // ever pass zero.
+    inline XMMATRIX XMMatrixAffineTransformation(XMVECTOR scaling, XMVECTOR, XMVECTOR rotation, XMVECTOR translation)
+    {
+        XMMATRIX result{ XMMatrixRotationQuaternion(rotation) };
+        result.r[0] = _mm_mul_ps(result.r[0], _mm_shuffle_ps(scaling, scaling, 0x00));
+        result.r[1] = _mm_mul_ps(result.r[1], _mm_shuffle_ps(scaling, scaling, 0x55));
+        result.r[2] = _mm_mul_ps(result.r[2], _mm_shuffle_ps(scaling, scaling, 0xAA));
+
+        alignas(16) float t[4];
+        _mm_store_ps(t, translation);
+        result.r[3] = _mm_set_ps(1, t[2], t[1], t[0]);
+        return result;
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Stands in for a graphics command list behind CommandStateFilter. Logs every call that
+// reaches it with its first arguments, enough to tell which state got set to what.
+class MockCommandList
+{
+public:
+    enum Method : uint32_t
+    {
+        SET_PIPELINE_STATE,
+        SET_ROOT_SIGNATURE,
+        SET_DESCRIPTOR_HEAPS,
+        SET_ROOT_CONSTANTS,
+        SET_ROOT_CBV,
+        SET_ROOT_SRV,
+        SET_ROOT_UAV,
+        SET_ROOT_TABLE,
+        SET_VERTEX_BUFFERS,
+        SET_INDEX_BUFFER,
+        SET_TOPOLOGY,
+        SET_VIEWPORTS,
+        SET_SCISSORS,
+        SET_RENDER_TARGETS,
+        DRAW,
+    };
+
+    struct Call
+    {
+        Method method;
+        // Root parameter index or first slot, and the count of the call if it has one.
+        uint32_t index;
+        uint32_t count;
+        // Address, handle or first value.
+        uint64_t value;
+
+        bool operator==(const Call&) const = default;
+    };
+
+    struct PipelineState {};
+    struct RootSignature {};
+    struct DescriptorHeap {};
+    struct VertexBufferView { uint64_t location; uint32_t size; uint32_t stride; };
+    struct IndexBufferView { uint64_t location; uint32_t size; uint32_t format; };
+    struct Viewport { float x, y, width, height, minDepth, maxDepth; };
+    struct Rect { int32_t left, top, right, bottom; };
+    struct CpuDescriptorHandle { uint64_t ptr; };
+    struct GpuDescriptorHandle { uint64_t ptr; };
+
+    void SetPipelineState(PipelineState* pipeline) { Log(SET_PIPELINE_STATE, 0, 0, Address(pipeline)); }
+    void SetGraphicsRootSignature(RootSignature* rootSignature) { Log(SET_ROOT_SIGNATURE, 0, 0, Address(rootSignature)); }
+    void SetDescriptorHeaps(uint32_t count, DescriptorHeap* const* heaps) { Log(SET_DESCRIPTOR_HEAPS, 0, count, count ? Address(heaps[0]) : 0); }
+    void SetGraphicsRoot32BitConstants(uint32_t index, uint32_t count, const void* data, uint32_t offset)
+    {
+        Log(SET_ROOT_CONSTANTS, index, count, offset);
+        (void)data;
+    }
+    void SetGraphicsRootConstantBufferView(uint32_t index, uint64_t address) { Log(SET_ROOT_CBV, index, 0, address); }
+    void SetGraphicsRootShaderResourceView(uint32_t index, uint64_t address) { Log(SET_ROOT_SRV, index, 0, address); }
+    void SetGraphicsRootUnorderedAccessView(uint32_t index, uint64_t address) { Log(SET_ROOT_UAV, index, 0, address); }
+    void SetGraphicsRootDescriptorTable(uint32_t index, GpuDescriptorHandle table) { Log(SET_ROOT_TABLE, index, 0, table.ptr); }
+    void IASetVertexBuffers(uint32_t startSlot, uint32_t count, const VertexBufferView* views) { Log(SET_VERTEX_BUFFERS, startSlot, count, views ? views[0].location : 0); }
+    void IASetIndexBuffer(const IndexBufferView* view) { Log(SET_INDEX_BUFFER, 0, 0, view ? view->location : 0); }
+    void IASetPrimitiveTopology(uint32_t topology) { Log(SET_TOPOLOGY, 0, 0, topology); }
+    void RSSetViewports(uint32_t count, const Viewport*) { Log(SET_VIEWPORTS, 0, count, 0); }
+    void RSSetScissorRects(uint32_t count, const Rect*) { Log(SET_SCISSORS, 0, count, 0); }
+    void OMSetRenderTargets(uint32_t count, const CpuDescriptorHandle* renderTargets, bool, const CpuDescriptorHandle*)
+    {
+        Log(SET_RENDER_TARGETS, 0, count, count ? renderTargets[0].ptr : 0);
+    }
+    void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t, uint32_t) { Log(DRAW, vertexCount, instanceCount, 0); }
+    void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t, int32_t, uint32_t) { Log(DRAW, indexCount, instanceCount, 0); }
+
+    std::vector<Call> calls;
+
+private:
+    void Log(Method method, uint32_t index, uint32_t count, uint64_t value) { calls.push_back({ method, index, count, value }); }
+
+    static uint64_t Address(const void* pointer) { return reinterpret_cast<uintptr_t>(pointer); }
+};
+
+struct MockCommandTraits
+{
+    using CommandList = MockCommandList;
+    using PipelineState = MockCommandList::PipelineState;
+    using RootSignature = MockCommandList::RootSignature;
+    using DescriptorHeap = MockCommandList::DescriptorHeap;
+    using VertexBufferView = MockCommandList::VertexBufferView;
+    using IndexBufferView = MockCommandList::IndexBufferView;
+    using Viewport = MockCommandList::Viewport;
+    using Rect = MockCommandList::Rect;
+    using CpuDescriptorHandle = MockCommandList::CpuDescriptorHandle;
+    using GpuDescriptorHandle = MockCommandList::GpuDescriptorHandle;
+    using GpuVirtualAddress = uint64_t;
+    using PrimitiveTopology = uint32_t;
+};
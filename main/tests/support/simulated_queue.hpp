@@ -0,0 +1,40 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+// Stands in for a GPU queue and its fence. The GPU runs latency signals behind the CPU: a
+// signal completes once latency more have been issued after it, or once the CPU waits on it.
+class SimulatedQueue
+{
+public:
+    explicit SimulatedQueue(uint64_t latency) : _latency(latency) {}
+
+    uint64_t Signal()
+    {
+        ++_signalled;
+        if (_signalled > _latency)
+            _completed = std::max(_completed, _signalled - _latency);
+        return _signalled;
+    }
+
+    uint64_t CompletedValue() const { return _completed; }
+
+    // Returns whether the CPU had to block. Zero is never signalled and is always complete.
+    bool Wait(uint64_t fenceValue)
+    {
+        if (fenceValue <= _completed)
+            return false;
+
+        _completed = fenceValue;
+        ++_waitCount;
+        return true;
+    }
+
+    uint64_t WaitCount() const { return _waitCount; }
+
+private:
+    uint64_t _latency;
+    uint64_t _signalled{ 0 };
+    uint64_t _completed{ 0 };
+    uint64_t _waitCount{ 0 };
+};
@@ -0,0 +1,157 @@
+#include "tlsf_allocator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    bool Overlaps(const TlsfAllocator::Allocation& a, const TlsfAllocator::Allocation& b)
+    {
+        return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+    }
+}
+
+TEST(TlsfAllocator, AllocatesFromTheFront)
+{
+    TlsfAllocator allocator{ 1024 };
+
+    TlsfAllocator::Allocation a{ allocator.Allocate(100) };
+    TlsfAllocator::Allocation b{ allocator.Allocate(100) };
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(a.offset, 0u);
+    EXPECT_EQ(b.offset, 100u);
+    EXPECT_EQ(allocator.FreeSize(), 824u);
+    EXPECT_EQ(allocator.AllocationCount(), 2u);
+}
+
+TEST(TlsfAllocator, AlignsAndGivesThePaddingBack)
+{
+    TlsfAllocator allocator{ 1 << 20 };
+
+    TlsfAllocator::Allocation small{ allocator.Allocate(10) };
+    TlsfAllocator::Allocation aligned{ allocator.Allocate(4096, 65536) };
+    ASSERT_TRUE(small && aligned);
+    EXPECT_EQ(aligned.offset % 65536, 0u);
+    EXPECT_EQ(allocator.FreeSize(), (1u << 20) - 10 - 4096) << "Padding isn't lost.";
+
+    // The padding in front is its own free block and serves the next small request.
+    TlsfAllocator::Allocation filler{ allocator.Allocate(1000) };
+    ASSERT_TRUE(filler);
+    EXPECT_LT(filler.offset, aligned.offset);
+}
+
+TEST(TlsfAllocator, RejectsWhatDoesntFit)
+{
+    TlsfAllocator allocator{ 1024 };
+
+    EXPECT_FALSE(allocator.Allocate(0));
+    EXPECT_FALSE(allocator.Allocate(1025));
+    ASSERT_TRUE(allocator.Allocate(1024));
+    EXPECT_FALSE(allocator.Allocate(1));
+}
+
+TEST(TlsfAllocator, CoalescesNeighboursOnFree)
+{
+    TlsfAllocator allocator{ 4096 };
+
+    std::vector<TlsfAllocator::Allocation> allocations;
+    for (uint32_t i = 0; i < 16; ++i)
+        allocations.push_back(allocator.Allocate(256));
+    EXPECT_FALSE(allocator.Allocate(1));
+
+    // Every other one first, nothing can merge yet.
+    for (uint32_t i = 0; i < 16; i += 2)
+        allocator.Free(allocations[i]);
+    EXPECT_EQ(allocator.FreeBlockCount(), 8u);
+    EXPECT_EQ(allocator.LargestFreeBlock(), 256u);
+    EXPECT_FALSE(allocator.Allocate(512));
+
+    for (uint32_t i = 1; i < 16; i += 2)
+        allocator.Free(allocations[i]);
+    EXPECT_TRUE(allocator.IsEmpty());
+    EXPECT_EQ(allocator.FreeBlockCount(), 1u);
+    EXPECT_EQ(allocator.LargestFreeBlock(), 4096u);
+    EXPECT_TRUE(allocator.Allocate(4096));
+}
+
+TEST(TlsfAllocator, FindsABlockWheneverOneClassUpIsFree)
+{
+    // A free block at least one size class above the request must always be found, however
+    // fragmented the rest is.
+    TlsfAllocator allocator{ 1 << 20 };
+    std::vector<TlsfAllocator::Allocation> allocations;
+    while (TlsfAllocator::Allocation allocation{ allocator.Allocate(1000) })
+        allocations.push_back(allocation);
+
+    for (size_t i = 0; i < allocations.size(); i += 3)
+        allocator.Free(allocations[i]);
+    // Freeing 1 and 2 joins 0 to 3 into one block.
+    allocator.Free(allocations[1]);
+    allocator.Free(allocations[2]);
+
+    EXPECT_EQ(allocator.LargestFreeBlock(), 4000u);
+    EXPECT_TRUE(allocator.Allocate(3000));
+}
+
+// Random allocations and frees against a list of what's live. Allocations have to be aligned,
+// inside the range and disjoint, and the bookkeeping has to add up.
+TEST(TlsfAllocator, Fuzz)
+{
+    constexpr uint64_t SIZE = 16 * 1024 * 1024;
+
+    for (uint32_t seed = 0; seed < 16; ++seed)
+    {
+        std::mt19937 random{ seed };
+        TlsfAllocator allocator{ SIZE };
+        std::vector<TlsfAllocator::Allocation> live;
+        uint64_t liveSize{ 0 };
+        uint32_t failed{ 0 };
+
+        for (uint32_t step = 0; step < 20000; ++step)
+        {
+            if (live.empty() || random() % 100 < 55)
+            {
+                uint64_t size{ random() % 16 == 0 ? 1 + random() % (SIZE / 8) : 1 + random() % 65536 };
+                uint64_t alignment{ 1ull << (random() % 17) };
+                TlsfAllocator::Allocation allocation{ allocator.Allocate(size, alignment) };
+                if (!allocation)
+                {
+                    ++failed;
+                    continue;
+                }
+
+                ASSERT_EQ(allocation.size, size);
+                ASSERT_EQ(allocation.offset % alignment, 0u);
+                ASSERT_LE(allocation.offset + allocation.size, SIZE);
+                for (const TlsfAllocator::Allocation& other : live)
+                    ASSERT_FALSE(Overlaps(allocation, other)) << "seed " << seed << " step " << step;
+
+                live.push_back(allocation);
+                liveSize += size;
+            }
+            else
+            {
+                size_t index{ random() % live.size() };
+                allocator.Free(live[index]);
+                liveSize -= live[index].size;
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            ASSERT_EQ(allocator.AllocationCount(), live.size());
+            ASSERT_EQ(allocator.FreeSize(), SIZE - liveSize);
+            ASSERT_LE(allocator.LargestFreeBlock(), allocator.FreeSize());
+        }
+
+        EXPECT_GT(failed, 0u) << "The heap never filled up, the fuzzing misses the full case.";
+
+        for (const TlsfAllocator::Allocation& allocation : live)
+            allocator.Free(allocation);
+        EXPECT_TRUE(allocator.IsEmpty());
+        EXPECT_EQ(allocator.FreeBlockCount(), 1u) << "Everything has to merge back together.";
+        EXPECT_EQ(allocator.LargestFreeBlock(), SIZE);
+    }
+}
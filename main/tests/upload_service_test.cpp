@@ -0,0 +1,265 @@
+#include "upload_service.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Copy queue that runs on system memory. Copies are recorded on Execute and only carried
+    // out once their batch completes, like on a GPU, so staging that gets reused too early
+    // shows up as wrong data at the destination.
+    class MockQueue
+    {
+    public:
+        struct Page
+        {
+            explicit Page(uint64_t size) : bytes(size) {}
+
+            uint8_t* CpuAddress() { return bytes.data(); }
+            uint64_t Size() const { return bytes.size(); }
+
+            std::vector<uint8_t> bytes;
+        };
+
+        struct Destination
+        {
+            std::vector<uint8_t>* buffer;
+            uint64_t offset;
+        };
+
+        std::unique_ptr<Page> CreatePage(uint64_t size)
+        {
+            ++pagesCreated;
+            pageSizes.push_back(size);
+            return std::make_unique<Page>(size);
+        }
+
+        void RecordCopy(const Page& page, uint64_t offset, const Destination& destination, uint64_t size)
+        {
+            _recording.push_back({ &page, offset, destination, size });
+        }
+
+        uint64_t Execute()
+        {
+            _batches.push_back({ ++_signalled, std::move(_recording) });
+            _recording.clear();
+            return _signalled;
+        }
+
+        uint64_t CompletedValue() const { return _completed; }
+
+        void Wait(uint64_t fenceValue) { Complete(fenceValue); }
+
+        // Lets the GPU get through fenceValue.
+        void Complete(uint64_t fenceValue)
+        {
+            while (!_batches.empty() && _batches.front().fence <= fenceValue)
+            {
+                for (const Copy& copy : _batches.front().copies)
+                    memcpy(copy.destination.buffer->data() + copy.destination.offset, copy.page->bytes.data() + copy.offset, copy.size);
+                _completed = _batches.front().fence;
+                _batches.erase(_batches.begin());
+            }
+        }
+
+        void CompleteAll() { Complete(_signalled); }
+
+        uint32_t pagesCreated{ 0 };
+        std::vector<uint64_t> pageSizes;
+
+    private:
+        struct Copy
+        {
+            const Page* page;
+            uint64_t offset;
+            Destination destination;
+            uint64_t size;
+        };
+
+        struct Batch
+        {
+            uint64_t fence;
+            std::vector<Copy> copies;
+        };
+
+        std::vector<Copy> _recording;
+        std::vector<Batch> _batches;
+        uint64_t _signalled{ 0 };
+        uint64_t _completed{ 0 };
+    };
+
+    std::vector<uint8_t> Pattern(size_t size, uint8_t seed)
+    {
+        std::vector<uint8_t> bytes(size);
+        std::iota(bytes.begin(), bytes.end(), seed);
+        return bytes;
+    }
+}
+
+TEST(UploadService, TicketsGetTheirBatchsFence)
+{
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 4096 };
+    std::vector<uint8_t> target(64);
+    std::vector<uint8_t> data{ Pattern(16, 1) };
+
+    UploadTicket first{ service.Enqueue({ &target, 0 }, data.data(), 16) };
+    UploadTicket second{ service.Enqueue({ &target, 16 }, data.data(), 16) };
+    EXPECT_LT(first.id, second.id);
+    EXPECT_EQ(service.FenceOf(first), 0u) << "Not submitted yet.";
+
+    service.Flush();
+    UploadTicket third{ service.Enqueue({ &target, 32 }, data.data(), 16) };
+    service.Flush();
+
+    EXPECT_EQ(service.FenceOf(first), 1u);
+    EXPECT_EQ(service.FenceOf(second), 1u);
+    EXPECT_EQ(service.FenceOf(third), 2u);
+    EXPECT_FALSE(service.IsComplete(first));
+
+    queue.Complete(1);
+    EXPECT_TRUE(service.IsComplete(second));
+    EXPECT_FALSE(service.IsComplete(third));
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), target.begin() + 16));
+
+    // Retired batches still answer for their tickets.
+    queue.Complete(2);
+    service.Flush();
+    service.Enqueue({ &target, 48 }, data.data(), 16);
+    service.Flush();
+    EXPECT_TRUE(service.IsComplete(first));
+    EXPECT_TRUE(service.IsComplete(third));
+}
+
+TEST(UploadService, WaitSubmitsWhatsStillPending)
+{
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 4096 };
+    std::vector<uint8_t> target(256);
+    std::vector<uint8_t> data{ Pattern(256, 7) };
+
+    UploadTicket ticket{ service.Enqueue({ &target, 0 }, data.data(), data.size()) };
+    service.Wait(ticket);
+
+    EXPECT_TRUE(service.IsComplete(ticket));
+    EXPECT_EQ(target, data);
+}
+
+TEST(UploadService, AlignsWithinAPage)
+{
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 4096 };
+    std::vector<uint8_t> target(512);
+
+    std::vector<uint8_t*> staging;
+    auto record = [&](uint8_t* address) { staging.push_back(address); };
+    service.Enqueue({ &target, 0 }, 3, 1, record);
+    service.Enqueue({ &target, 0 }, 3, 256, record);
+    service.Enqueue({ &target, 0 }, 3, 512, record);
+
+    ASSERT_EQ(staging.size(), 3u);
+    EXPECT_EQ(staging[1] - staging[0], 256);
+    EXPECT_EQ(staging[2] - staging[0], 512);
+    EXPECT_EQ(queue.pagesCreated, 1u);
+}
+
+TEST(UploadService, ReusesPagesOnceTheirBatchCompletes)
+{
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 1024 };
+    std::vector<uint8_t> target(1024);
+
+    for (uint8_t frame = 0; frame < 20; ++frame)
+    {
+        std::vector<uint8_t> data{ Pattern(1024, frame) };
+        service.Enqueue({ &target, 0 }, data.data(), data.size());
+        service.Flush();
+        queue.CompleteAll();
+        ASSERT_EQ(target, data);
+    }
+
+    // Every batch completes before the next request, so the one page keeps coming back.
+    EXPECT_EQ(queue.pagesCreated, 1u);
+}
+
+TEST(UploadService, NeverOverwritesStagingInFlight)
+{
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 1024 };
+
+    // Four batches in flight at once, each in a full page. Had a page been reused before its
+    // batch completed, an earlier target would end up with a later pattern.
+    std::vector<std::vector<uint8_t>> targets(4, std::vector<uint8_t>(1024));
+    std::vector<std::vector<uint8_t>> data;
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        data.push_back(Pattern(1024, i * 10));
+        service.Enqueue({ &targets[i], 0 }, data[i].data(), 1024);
+        service.Flush();
+    }
+    EXPECT_EQ(queue.pagesCreated, 4u);
+
+    queue.CompleteAll();
+    EXPECT_EQ(targets, data);
+}
+
+TEST(UploadService, GivesLargeRequestsADedicatedPage)
+{
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 1024 };
+    std::vector<uint8_t> target(5000);
+    std::vector<uint8_t> data{ Pattern(5000, 3) };
+
+    service.Enqueue({ &target, 0 }, data.data(), 8);
+    service.Enqueue({ &target, 0 }, data.data(), data.size());
+    service.Flush();
+    queue.CompleteAll();
+    EXPECT_EQ(target, data);
+    ASSERT_EQ(queue.pageSizes.size(), 2u);
+    EXPECT_EQ(queue.pageSizes[1], 5000u);
+
+    // Dedicated pages aren't pooled, the next large request gets a new one. Small requests
+    // never share it and go to the pooled regular page.
+    service.Enqueue({ &target, 0 }, data.data(), data.size());
+    service.Enqueue({ &target, 0 }, data.data(), 8);
+    service.Flush();
+    queue.CompleteAll();
+    EXPECT_EQ(target, data);
+    ASSERT_EQ(queue.pageSizes.size(), 3u);
+    EXPECT_EQ(queue.pageSizes[2], 5000u);
+}
+
+TEST(UploadService, TakesRequestsFromManyThreads)
+{
+    constexpr uint32_t THREAD_COUNT = 4;
+    constexpr uint32_t REQUESTS_PER_THREAD = 200;
+
+    MockQueue queue;
+    UploadService<MockQueue> service{ queue, 4096 };
+    std::vector<uint8_t> target(THREAD_COUNT * REQUESTS_PER_THREAD * 8);
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREAD_COUNT; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (uint32_t i = 0; i < REQUESTS_PER_THREAD; ++i)
+            {
+                uint64_t offset{ (t * REQUESTS_PER_THREAD + i) * 8ull };
+                std::vector<uint8_t> data(8, static_cast<uint8_t>(offset / 8));
+                service.Enqueue({ &target, offset }, data.data(), data.size());
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    service.Flush();
+    queue.CompleteAll();
+    for (size_t i = 0; i < target.size(); ++i)
+        ASSERT_EQ(target[i], static_cast<uint8_t>(i / 8)) << "byte " << i;
+}
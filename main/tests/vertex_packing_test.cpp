@@ -0,0 +1,340 @@
+#include "job_system.hpp"
+#include "vertex_packing.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr float INFINITY_VALUE = std::numeric_limits<float>::infinity();
+    constexpr float NAN_VALUE = std::numeric_limits<float>::quiet_NaN();
+
+    // snorm16 octahedral steps are 1/32767 apart, half a step in both coordinates moves a
+    // vector by at most 0.0037 degrees where the map stretches the most.
+    constexpr double OCT_MAX_DEGREES = 0.004;
+
+    // Angle between two vectors in degrees, through atan2 so nearly equal ones don't lose it
+    // all to rounding the way acos would.
+    double Degrees(const float a[3], const float b[3])
+    {
+        double cross[3]{ double{ a[1] } * b[2] - double{ a[2] } * b[1], double{ a[2] } * b[0] - double{ a[0] } * b[2], double{ a[0] } * b[1] - double{ a[1] } * b[0] };
+        double dot{ double{ a[0] } * b[0] + double{ a[1] } * b[1] + double{ a[2] } * b[2] };
+        return std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot) * 180.0 / 3.14159265358979;
+    }
+
+    // Random unit vectors, then the axes and the octahedron's edges where the fold happens.
+    std::vector<std::array<float, 3>> UnitVectors()
+    {
+        std::mt19937 random{ 17 };
+        std::normal_distribution<float> normal;
+        std::vector<std::array<float, 3>> vectors;
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            std::array<float, 3> vector{ normal(random), normal(random), normal(random) };
+            float length{ std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]) };
+            vectors.push_back({ vector[0] / length, vector[1] / length, vector[2] / length });
+        }
+
+        const float edge{ std::sqrt(0.5f) };
+        for (float a : { -1.0f, 1.0f })
+        {
+            vectors.push_back({ a, 0.0f, 0.0f });
+            vectors.push_back({ 0.0f, a, 0.0f });
+            vectors.push_back({ 0.0f, 0.0f, a });
+            for (float b : { -1.0f, 1.0f })
+            {
+                vectors.push_back({ a * edge, b * edge, 0.0f });
+                vectors.push_back({ a * edge, 0.0f, b * edge });
+                vectors.push_back({ 0.0f, a * edge, b * edge });
+            }
+        }
+        return vectors;
+    }
+
+    // Floats a batch kernel has to agree with the scalar conversions on, the usual range and
+    // the cases where SSE and scalar code tend to part ways.
+    std::vector<float> AwkwardFloats()
+    {
+        std::vector<float> values{ 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 65504.0f, 65520.0f, -65520.0f, 1e-8f, -1e-8f, 6.1e-5f, 5.96e-8f, 2.98e-8f,
+            1e30f, -1e30f, INFINITY_VALUE, -INFINITY_VALUE, NAN_VALUE, std::numeric_limits<float>::denorm_min() };
+
+        std::mt19937 random{ 5 };
+        std::uniform_real_distribution<float> uniform{ -2.0f, 2.0f };
+        while (values.size() < 4099)
+            values.push_back(uniform(random));
+        return values;
+    }
+}
+
+TEST(VertexPacking, OctahedralNormalsStayWithinTheBound)
+{
+    double worst{ 0.0 };
+    for (const std::array<float, 3>& vector : UnitVectors())
+    {
+        int16_t encoded[2];
+        float decoded[3];
+        VertexPacking::OctEncode(vector.data(), encoded);
+        VertexPacking::OctDecode(encoded, decoded);
+        worst = std::max(worst, Degrees(vector.data(), decoded));
+        ASSERT_NEAR(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2], 1.0f, 1e-6f);
+    }
+    EXPECT_LT(worst, OCT_MAX_DEGREES);
+}
+
+TEST(VertexPacking, OctahedralEncodingIgnoresLength)
+{
+    const float vector[3]{ 0.3f, -0.5f, -0.8f };
+    const float scaled[3]{ 30.0f, -50.0f, -80.0f };
+    int16_t encoded[2];
+    int16_t encodedScaled[2];
+    VertexPacking::OctEncode(vector, encoded);
+    VertexPacking::OctEncode(scaled, encodedScaled);
+    EXPECT_NEAR(encoded[0], encodedScaled[0], 1);
+    EXPECT_NEAR(encoded[1], encodedScaled[1], 1);
+
+    // A zero vector comes back as +z instead of NaN.
+    const float zero[3]{};
+    float decoded[3];
+    VertexPacking::OctEncode(zero, encoded);
+    VertexPacking::OctDecode(encoded, decoded);
+    EXPECT_EQ(decoded[0], 0.0f);
+    EXPECT_EQ(decoded[1], 0.0f);
+    EXPECT_EQ(decoded[2], 1.0f);
+}
+
+TEST(VertexPacking, ExtraVertexKernelMatchesTheScalarConversions)
+{
+    // The tangents and normals go through the four wide kernel, the last few through the
+    // scalar tail. Both have to give the same bits and so the same error.
+    std::vector<std::array<float, 3>> vectors{ UnitVectors() };
+    std::vector<MeshExtraVertex> extraVertices(vectors.size());
+    std::vector<float> colors{ AwkwardFloats() };
+    for (size_t i = 0; i < vectors.size(); ++i)
+    {
+        MeshExtraVertex& extra{ extraVertices[i] };
+        for (int channel = 0; channel < 4; ++channel)
+            extra.color[channel] = colors[(i * 4 + channel) % colors.size()];
+        memcpy(extra.normal, vectors[i].data(), sizeof(extra.normal));
+        memcpy(extra.tangent, vectors[(i + 1) % vectors.size()].data(), sizeof(extra.tangent));
+    }
+
+    std::vector<PackedExtraVertex> packed(extraVertices.size());
+    VertexPacking::PackExtraVertices(extraVertices, packed.data());
+
+    for (size_t i = 0; i < extraVertices.size(); ++i)
+    {
+        PackedExtraVertex expected;
+        for (int channel = 0; channel < 4; ++channel)
+            expected.color[channel] = VertexPacking::QuantizeUnorm8(extraVertices[i].color[channel]);
+        VertexPacking::OctEncode(extraVertices[i].tangent, expected.tangent);
+        VertexPacking::OctEncode(extraVertices[i].normal, expected.normal);
+        ASSERT_EQ(memcmp(&packed[i], &expected, sizeof(expected)), 0) << "vertex " << i;
+
+        float tangent[3];
+        VertexPacking::OctDecode(packed[i].tangent, tangent);
+        ASSERT_LT(Degrees(extraVertices[i].tangent, tangent), OCT_MAX_DEGREES) << "vertex " << i;
+    }
+}
+
+TEST(VertexPacking, HalfsRoundTripExactly)
+{
+    for (uint32_t bits = 0; bits <= 0xffff; ++bits)
+    {
+        uint16_t half{ static_cast<uint16_t>(bits) };
+        float value{ VertexPacking::HalfToFloat(half) };
+        if (std::isnan(value))
+        {
+            // NaN stays NaN with its sign, the payload turns quiet.
+            ASSERT_EQ(VertexPacking::FloatToHalf(value), (half & 0x8000) | 0x7e00) << std::hex << bits;
+            continue;
+        }
+        ASSERT_EQ(VertexPacking::FloatToHalf(value), half) << std::hex << bits;
+    }
+}
+
+TEST(VertexPacking, HalfsRoundToNearestEven)
+{
+    // Exactly between two neighbours goes to the even one, a hair either side to the nearer.
+    for (uint32_t bits = 0; bits < 0x7bff; ++bits)
+    {
+        float low{ VertexPacking::HalfToFloat(static_cast<uint16_t>(bits)) };
+        float high{ VertexPacking::HalfToFloat(static_cast<uint16_t>(bits + 1)) };
+        float middle{ low + (high - low) * 0.5f };
+        uint16_t even{ static_cast<uint16_t>(bits % 2 == 0 ? bits : bits + 1) };
+        ASSERT_EQ(VertexPacking::FloatToHalf(middle), even) << std::hex << bits;
+        ASSERT_EQ(VertexPacking::FloatToHalf(std::nextafter(middle, 0.0f)), bits) << std::hex << bits;
+        ASSERT_EQ(VertexPacking::FloatToHalf(std::nextafter(middle, INFINITY_VALUE)), bits + 1) << std::hex << bits;
+    }
+
+    EXPECT_EQ(VertexPacking::FloatToHalf(65520.0f), 0x7c00);
+    EXPECT_EQ(VertexPacking::FloatToHalf(-1e30f), 0xfc00);
+    EXPECT_EQ(VertexPacking::FloatToHalf(-0.0f), 0x8000);
+}
+
+TEST(VertexPacking, HalfUvsStayWithinHalfAStep)
+{
+    // Half floats are 2^-11 apart just under one, UVs in [0, 1] are off by at most half that.
+    std::mt19937 random{ 11 };
+    std::uniform_real_distribution<float> uniform{ 0.0f, 1.0f };
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        float uv{ uniform(random) };
+        ASSERT_LE(std::fabs(VertexPacking::HalfToFloat(VertexPacking::FloatToHalf(uv)) - uv), 0x1p-12f) << uv;
+    }
+}
+
+TEST(VertexPacking, TexCoordKernelMatchesTheScalarConversion)
+{
+    std::vector<float> values{ AwkwardFloats() };
+    std::vector<MeshVertex> vertices(values.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        vertices[i].tex0[0] = values[i];
+        vertices[i].tex0[1] = values[(i + 1) % values.size()];
+        vertices[i].tex1[0] = values[(i + 2) % values.size()];
+        vertices[i].tex1[1] = values[(i + 3) % values.size()];
+    }
+
+    constexpr uint32_t STRIDE = 12;
+    std::vector<uint8_t> packed(vertices.size() * STRIDE);
+    VertexPacking::PackTexCoords(vertices, packed.data(), STRIDE);
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        uint16_t halves[4];
+        memcpy(halves, packed.data() + i * STRIDE, sizeof(halves));
+        ASSERT_EQ(halves[0], VertexPacking::FloatToHalf(vertices[i].tex0[0])) << "vertex " << i;
+        ASSERT_EQ(halves[1], VertexPacking::FloatToHalf(vertices[i].tex0[1])) << "vertex " << i;
+        ASSERT_EQ(halves[2], VertexPacking::FloatToHalf(vertices[i].tex1[0])) << "vertex " << i;
+        ASSERT_EQ(halves[3], VertexPacking::FloatToHalf(vertices[i].tex1[1])) << "vertex " << i;
+    }
+}
+
+TEST(VertexPacking, Rgba8StaysWithinHalfAStep)
+{
+    for (uint32_t i = 0; i <= 10000; ++i)
+    {
+        float value{ i / 10000.0f };
+        ASSERT_LE(std::fabs(VertexPacking::QuantizeUnorm8(value) / 255.0f - value), 0.5f / 255.0f + 1e-7f) << value;
+    }
+
+    EXPECT_EQ(VertexPacking::QuantizeUnorm8(-0.5f), 0);
+    EXPECT_EQ(VertexPacking::QuantizeUnorm8(1.5f), 255);
+    EXPECT_EQ(VertexPacking::QuantizeUnorm8(INFINITY_VALUE), 255);
+    EXPECT_EQ(VertexPacking::QuantizeUnorm8(NAN_VALUE), 0);
+}
+
+TEST(VertexPacking, Unorm16PositionsStayWithinHalfAStep)
+{
+    // Half a step of the box on every axis, plus the float rounding of decoding it.
+    const float offset[3]{ -3.0f, 10.0f, -0.001f };
+    const float scale[3]{ 6.0f, 250.0f, 0.002f };
+
+    std::mt19937 random{ 23 };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        std::uniform_real_distribution<float> uniform{ offset[axis], offset[axis] + scale[axis] };
+        float bound{ scale[axis] / 65535.0f * 0.5f + std::fabs(offset[axis] + scale[axis]) * 1e-6f };
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            float value{ uniform(random) };
+            uint16_t quantized{ VertexPacking::QuantizeUnorm16(value, offset[axis], scale[axis]) };
+            ASSERT_LE(std::fabs(VertexPacking::DequantizeUnorm16(quantized, offset[axis], scale[axis]) - value), bound) << value;
+        }
+
+        EXPECT_EQ(VertexPacking::QuantizeUnorm16(offset[axis], offset[axis], scale[axis]), 0);
+        EXPECT_EQ(VertexPacking::QuantizeUnorm16(offset[axis] + scale[axis], offset[axis], scale[axis]), 65535);
+        EXPECT_EQ(VertexPacking::QuantizeUnorm16(offset[axis] - 1.0f, offset[axis], scale[axis]), 0);
+        EXPECT_EQ(VertexPacking::QuantizeUnorm16(offset[axis] + scale[axis] * 2.0f, offset[axis], scale[axis]), 65535);
+    }
+
+    // A flat box has no extent to spread over, everything sits at its offset.
+    EXPECT_EQ(VertexPacking::QuantizeUnorm16(4.0f, 4.0f, 0.0f), 0);
+    EXPECT_EQ(VertexPacking::DequantizeUnorm16(0, 4.0f, 0.0f), 4.0f);
+}
+
+TEST(VertexPacking, PositionKernelMatchesTheScalarConversion)
+{
+    std::vector<float> values{ AwkwardFloats() };
+    std::vector<MeshVertex> vertices(values.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            vertices[i].position[axis] = values[(i + axis) % values.size()];
+        // The kernel loads the first UV as a fourth lane, it must not leak into w.
+        vertices[i].tex0[0] = 12345.0f;
+    }
+
+    const float offset[3]{ -2.0f, -1.0f, 0.0f };
+    const float scale[3]{ 4.0f, 2.0f, 0.0f };
+    constexpr uint32_t STRIDE = 16;
+    std::vector<uint8_t> packed(vertices.size() * STRIDE, 0xcd);
+    VertexPacking::PackPositions(vertices, offset, scale, packed.data(), STRIDE);
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        uint16_t quantized[4];
+        memcpy(quantized, packed.data() + i * STRIDE, sizeof(quantized));
+        for (int axis = 0; axis < 3; ++axis)
+            ASSERT_EQ(quantized[axis], VertexPacking::QuantizeUnorm16(vertices[i].position[axis], offset[axis], scale[axis])) << "vertex " << i << " axis " << axis;
+        ASSERT_EQ(quantized[3], 0) << "vertex " << i;
+        ASSERT_EQ(packed[i * STRIDE + 8], 0xcd) << "vertex " << i;
+    }
+}
+
+TEST(VertexPacking, PackSharesBoxesBetweenSubmeshesThatShareVertices)
+{
+    // Submesh 0 and its LOD use vertices 0 to 3, submesh 1 has 4 to 6 to itself.
+    MeshData mesh;
+    const float positions[][3] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 2.0f, 0.0f }, { 0.25f, 0.5f, 0.75f },
+        { 10.0f, 10.0f, 10.0f }, { 11.0f, 10.0f, 10.0f }, { 10.0f, 13.0f, 10.0f } };
+    for (const float* position : positions)
+    {
+        MeshVertex vertex{};
+        memcpy(vertex.position, position, sizeof(vertex.position));
+        mesh.vertices.push_back(vertex);
+        mesh.extraVertices.push_back({ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } });
+    }
+    mesh.indices = { 0, 1, 2, 1, 3, 2, 4, 5, 6, 0, 1, 3 };
+
+    CookedSubmesh full;
+    full.indexCount = 6;
+    CookedSubmesh other;
+    other.startIndexLocation = 6;
+    other.indexCount = 3;
+    CookedSubmesh lod;
+    lod.startIndexLocation = 9;
+    lod.indexCount = 3;
+    lod.lodLevel = 1;
+    mesh.submeshes = { full, other, lod };
+
+    JobSystem jobSystem{ 2 };
+    PackedVertexStreams packed{ VertexPacking::Pack(mesh, VERTEX_FORMAT_ALL, jobSystem) };
+    ASSERT_EQ(packed.vertices.size(), mesh.vertices.size() * packed.layout.vertexStride);
+    ASSERT_EQ(packed.extraVertices.size(), mesh.extraVertices.size() * sizeof(PackedExtraVertex));
+
+    const CookedSubmesh& first{ mesh.submeshes[0] };
+    EXPECT_EQ(memcmp(first.positionOffset, mesh.submeshes[2].positionOffset, sizeof(first.positionOffset)), 0);
+    EXPECT_EQ(memcmp(first.positionScale, mesh.submeshes[2].positionScale, sizeof(first.positionScale)), 0);
+    EXPECT_EQ(first.positionScale[1], 2.0f);
+    EXPECT_EQ(mesh.submeshes[1].positionOffset[0], 10.0f);
+    EXPECT_EQ(mesh.submeshes[1].positionScale[1], 3.0f);
+
+    for (size_t vertex = 0; vertex < mesh.vertices.size(); ++vertex)
+    {
+        const CookedSubmesh& submesh{ mesh.submeshes[vertex < 4 ? 0 : 1] };
+        uint16_t quantized[4];
+        memcpy(quantized, packed.vertices.data() + vertex * packed.layout.vertexStride, sizeof(quantized));
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float decoded{ VertexPacking::DequantizeUnorm16(quantized[axis], submesh.positionOffset[axis], submesh.positionScale[axis]) };
+            EXPECT_NEAR(decoded, mesh.vertices[vertex].position[axis], submesh.positionScale[axis] / 65535.0f * 0.5f + 1e-6f) << "vertex " << vertex;
+        }
+    }
+}